@@ -0,0 +1,231 @@
+#ifndef AUTO_EXPOSURE_H
+#define AUTO_EXPOSURE_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/shader.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+// Automatic exposure for an HDR tonemapper, computed entirely on the GPU:
+// 1. a luminance pass sums log(luminance) of the HDR buffer's pixels into a power-of-two RG16F texture at least half
+//    its size, next to the number of pixels summed (each pixel goes into exactly one texel);
+// 2. glGenerateMipmap reduces it in parallel; the ratio of the 1x1 top mip's channels is the average log luminance
+//    of the frame;
+// 3. an adaptation pass moves the adapted luminance (a 1x1 R32F texture, ping-ponged between frames) towards
+//    exp(average) with an exponential falloff, so the eye adapts smoothly instead of snapping.
+// The tonemapper samples AdaptedLuminance() and derives its exposure from it; nothing is read back to the CPU, so
+// there's no pipeline stall. The luminance shader gets the HDR buffer as 'hdrBuffer' and the size of its target as
+// 'luminanceSize'; the adaptation shader gets 'logLuminance', 'previousLuminance', 'mipLevel' and 'adaptation'. Both
+// are drawn over a screen-filling quad.
+class AutoExposure
+{
+public:
+    // luminance is clamped to this before taking the log (in shaders and the CPU reference alike) so black pixels
+    // don't drag the average to -infinity
+    static constexpr float MinLuminance = 1e-4f;
+
+    // how fast the adapted luminance follows the scene (higher is faster, per second)
+    float AdaptationSpeed;
+    // size of the log luminance texture (power-of-two, at least half the source size)
+    unsigned int Width, Height;
+    unsigned int MipLevels;
+
+    AutoExposure(Shader &luminanceShader, Shader &adaptShader, unsigned int sourceWidth, unsigned int sourceHeight, float adaptationSpeed = 1.5f)
+        : AdaptationSpeed(adaptationSpeed), luminanceShader(luminanceShader), adaptShader(adaptShader),
+          luminanceFBO(0), luminanceTexture(0), current(0), quadVAO(0), quadVBO(0)
+    {
+        Width = halfSizePowerOfTwo(sourceWidth);
+        Height = halfSizePowerOfTwo(sourceHeight);
+        MipLevels = 1;
+        for (unsigned int size = std::max(Width, Height); size > 1; size >>= 1)
+            MipLevels++;
+        create();
+    }
+    ~AutoExposure()
+    {
+        glDeleteFramebuffers(1, &luminanceFBO);
+        glDeleteFramebuffers(2, adaptedFBO);
+        glDeleteTextures(1, &luminanceTexture);
+        glDeleteTextures(2, adaptedTexture);
+        if (quadVAO != 0)
+        {
+            glDeleteVertexArrays(1, &quadVAO);
+            glDeleteBuffers(1, &quadVBO);
+        }
+    }
+
+    // reduces the given HDR texture and adapts the exposure by deltaTime seconds; leaves the default framebuffer
+    // bound with the previous viewport restored
+    void Update(unsigned int hdrTexture, float deltaTime)
+    {
+        GLint viewport[4];
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+        glDisable(GL_DEPTH_TEST);
+
+        // 1. log luminance of the frame
+        glBindFramebuffer(GL_FRAMEBUFFER, luminanceFBO);
+        glViewport(0, 0, Width, Height);
+        luminanceShader.use();
+        luminanceShader.setInt("hdrBuffer", 0);
+        luminanceShader.setVec2("luminanceSize", (float)Width, (float)Height);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, hdrTexture);
+        renderQuad();
+
+        // 2. parallel reduction down to a single texel
+        glBindTexture(GL_TEXTURE_2D, luminanceTexture);
+        glGenerateMipmap(GL_TEXTURE_2D);
+
+        // 3. adapt: read last frame's value, write this frame's into the other texture
+        unsigned int previous = current;
+        current = 1 - current;
+        glBindFramebuffer(GL_FRAMEBUFFER, adaptedFBO[current]);
+        glViewport(0, 0, 1, 1);
+        adaptShader.use();
+        adaptShader.setInt("logLuminance", 0);
+        adaptShader.setInt("previousLuminance", 1);
+        adaptShader.setFloat("mipLevel", (float)(MipLevels - 1));
+        adaptShader.setFloat("adaptation", adaptationFactor(deltaTime, AdaptationSpeed));
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, luminanceTexture);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, adaptedTexture[previous]);
+        renderQuad();
+        glActiveTexture(GL_TEXTURE0);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+        if (depthTest)
+            glEnable(GL_DEPTH_TEST);
+    }
+
+    // 1x1 R32F texture holding the current adapted luminance; bind it to the tonemapper
+    unsigned int AdaptedLuminance() const
+    {
+        return adaptedTexture[current];
+    }
+
+    // reads back the frame's (unadapted) log-average luminance. This stalls the pipeline and is only meant for
+    // validating the GPU reduction against the CPU reference, never for per-frame use.
+    float ReadAverageLuminance() const
+    {
+        float average[2] = { 0.0f, 1.0f };
+        glBindTexture(GL_TEXTURE_2D, luminanceTexture);
+        glGetTexImage(GL_TEXTURE_2D, MipLevels - 1, GL_RG, GL_FLOAT, average);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        return std::exp(average[0] / average[1]);
+    }
+
+    // CPU reference of the reduction: the log-average (geometric mean) luminance of a float image
+    static float LogAverageLuminance(const float *pixels, unsigned int width, unsigned int height, unsigned int channels = 4)
+    {
+        size_t count = (size_t)width * height;
+        if (count == 0)
+            return MinLuminance;
+        const float minLuminance = MinLuminance;
+        double sum = 0.0;
+        for (size_t i = 0; i < count; ++i)
+        {
+            const float *p = pixels + i * channels;
+            float luminance = 0.2126f * p[0] + 0.7152f * p[1] + 0.0722f * p[2];
+            sum += std::log(std::max(luminance, minLuminance));
+        }
+        return (float)std::exp(sum / (double)count);
+    }
+
+    // CPU reference of the adaptation step, matching the adaptation shader
+    static float Adapt(float previous, float current, float deltaTime, float speed)
+    {
+        return previous + (current - previous) * adaptationFactor(deltaTime, speed);
+    }
+
+private:
+    Shader &luminanceShader;
+    Shader &adaptShader;
+    unsigned int luminanceFBO, luminanceTexture;
+    unsigned int adaptedFBO[2], adaptedTexture[2];
+    unsigned int current;
+    unsigned int quadVAO, quadVBO;
+
+    // frame-rate independent blend factor of exponential adaptation
+    static float adaptationFactor(float deltaTime, float speed)
+    {
+        return 1.0f - std::exp(-deltaTime * speed);
+    }
+
+    static unsigned int halfSizePowerOfTwo(unsigned int size)
+    {
+        unsigned int half = std::max(size / 2, 1u);
+        unsigned int result = 1;
+        while (result < half)
+            result <<= 1;
+        return result;
+    }
+
+    void create()
+    {
+        glGenFramebuffers(1, &luminanceFBO);
+        glBindFramebuffer(GL_FRAMEBUFFER, luminanceFBO);
+        glGenTextures(1, &luminanceTexture);
+        glBindTexture(GL_TEXTURE_2D, luminanceTexture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16F, Width, Height, 0, GL_RG, GL_FLOAT, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glGenerateMipmap(GL_TEXTURE_2D); // allocates the mip chain
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, luminanceTexture, 0);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "ERROR::AUTO_EXPOSURE:: Luminance framebuffer is not complete!" << std::endl;
+
+        // start out adapted to a mid-grey scene
+        float initial = 0.18f;
+        glGenFramebuffers(2, adaptedFBO);
+        glGenTextures(2, adaptedTexture);
+        for (unsigned int i = 0; i < 2; ++i)
+        {
+            glBindFramebuffer(GL_FRAMEBUFFER, adaptedFBO[i]);
+            glBindTexture(GL_TEXTURE_2D, adaptedTexture[i]);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, 1, 1, 0, GL_RED, GL_FLOAT, &initial);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, adaptedTexture[i], 0);
+            if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+                std::cout << "ERROR::AUTO_EXPOSURE:: Adaptation framebuffer is not complete!" << std::endl;
+        }
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    // renders a screen-filling quad in NDC
+    void renderQuad()
+    {
+        if (quadVAO == 0)
+        {
+            float quadVertices[] = {
+                // positions   // texCoords
+                -1.0f,  1.0f,  0.0f, 1.0f,
+                -1.0f, -1.0f,  0.0f, 0.0f,
+                 1.0f,  1.0f,  1.0f, 1.0f,
+                 1.0f, -1.0f,  1.0f, 0.0f,
+            };
+            glGenVertexArrays(1, &quadVAO);
+            glGenBuffers(1, &quadVBO);
+            glBindVertexArray(quadVAO);
+            glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
+            glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), &quadVertices, GL_STATIC_DRAW);
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
+            glEnableVertexAttribArray(1);
+            glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
+        }
+        glBindVertexArray(quadVAO);
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+        glBindVertexArray(0);
+    }
+};
+#endif
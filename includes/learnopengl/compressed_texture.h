@@ -0,0 +1,584 @@
+#ifndef COMPRESSED_TEXTURE_H
+#define COMPRESSED_TEXTURE_H
+
+#include <glad/glad.h>
+
+extern "C" {
+#include <image_DXT.h>
+}
+#include <stb_image.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// S3TC is an extension (EXT_texture_compression_s3tc) and isn't part of the core profile glad was generated for
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT 0x8C4C
+#endif
+#ifndef GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
+
+// Block-compressed formats, all made of 4x4 pixel blocks:
+// BC1 (DXT1): RGB, 8 bytes per block (4 bits per pixel)
+// BC3 (DXT5): RGBA, BC1 color plus a separately interpolated alpha, 16 bytes per block
+// BC5 (RGTC2): two independent channels (RG), meant for normal maps whose z is reconstructed in the shader
+// BC7 (BPTC): RGBA at 16 bytes per block, higher quality than BC1/BC3
+enum BlockFormat {
+    FORMAT_BC1,
+    FORMAT_BC3,
+    FORMAT_BC5,
+    FORMAT_BC7
+};
+
+// A block-compressed texture with its full mip chain, as read from or written to a DDS or KTX file.
+struct CompressedImage
+{
+    BlockFormat Format;
+    // whether color is stored in sRGB space (sampled as linear through an sRGB internal format)
+    bool SRGB;
+    // whether the first row is the bottom one, as stb_image loads images with stbi_set_flip_vertically_on_load(true)
+    bool BottomUp;
+    unsigned int Width, Height;
+    // mip levels, largest first
+    std::vector<std::vector<unsigned char> > Levels;
+
+    CompressedImage()
+        : Format(FORMAT_BC1), SRGB(false), BottomUp(false), Width(0), Height(0)
+    {
+    }
+
+    static unsigned int BlockBytes(BlockFormat format)
+    {
+        return format == FORMAT_BC1 ? 8 : 16;
+    }
+
+    static size_t LevelBytes(BlockFormat format, unsigned int width, unsigned int height)
+    {
+        return (size_t)((width + 3) / 4) * ((height + 3) / 4) * BlockBytes(format);
+    }
+
+    static unsigned int MipCount(unsigned int width, unsigned int height)
+    {
+        unsigned int levels = 1;
+        for (unsigned int size = std::max(width, height); size > 1; size >>= 1)
+            levels++;
+        return levels;
+    }
+
+    unsigned int InternalFormat() const
+    {
+        switch (Format)
+        {
+        case FORMAT_BC1: return SRGB ? GL_COMPRESSED_SRGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+        case FORMAT_BC3: return SRGB ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        case FORMAT_BC5: return GL_COMPRESSED_RG_RGTC2;
+        default:         return SRGB ? GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM : GL_COMPRESSED_RGBA_BPTC_UNORM;
+        }
+    }
+
+    size_t Bytes() const
+    {
+        size_t bytes = 0;
+        for (const std::vector<unsigned char> &level : Levels)
+            bytes += level.size();
+        return bytes;
+    }
+};
+
+// DDS and KTX containers
+// ----------------------
+// DXGI formats of the DDS DX10 header extension
+const unsigned int DXGI_FORMAT_BC1_UNORM = 71, DXGI_FORMAT_BC1_UNORM_SRGB = 72, DXGI_FORMAT_BC3_UNORM = 77, DXGI_FORMAT_BC3_UNORM_SRGB = 78,
+                   DXGI_FORMAT_BC5_UNORM = 83, DXGI_FORMAT_BC7_UNORM = 98, DXGI_FORMAT_BC7_UNORM_SRGB = 99;
+const unsigned char KTX_IDENTIFIER[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x31, 0x31, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+// DDS has no orientation field: the baker marks bottom-up files in the reserved words of the header
+const unsigned int DDS_ORIENTATION_TAG = 9, DDS_ORIENTATION_FLAGS = 10, DDS_BOTTOM_UP = 1;
+
+inline unsigned int ddsFourCC(char a, char b, char c, char d)
+{
+    return (unsigned int)a | ((unsigned int)b << 8) | ((unsigned int)c << 16) | ((unsigned int)d << 24);
+}
+
+// reads the levels that follow the header; with offsets only their positions in the file are recorded and the levels
+// are left empty
+inline bool readCompressedLevels(std::ifstream &file, CompressedImage &image, unsigned int levels, bool sizePrefixed, std::vector<size_t> *offsets)
+{
+    image.Levels.clear();
+    if (offsets)
+        offsets->clear();
+    unsigned int width = image.Width, height = image.Height;
+    for (unsigned int level = 0; level < std::max(levels, 1u); ++level)
+    {
+        size_t bytes = CompressedImage::LevelBytes(image.Format, width, height);
+        if (sizePrefixed)
+        {
+            uint32_t imageSize = 0;
+            file.read((char*)&imageSize, sizeof(imageSize));
+            if (imageSize != bytes)
+                return false;
+        }
+        if (offsets)
+        {
+            offsets->push_back((size_t)file.tellg());
+            image.Levels.push_back(std::vector<unsigned char>());
+            file.seekg(bytes, std::ios::cur);
+        }
+        else
+        {
+            image.Levels.push_back(std::vector<unsigned char>(bytes));
+            file.read((char*)&image.Levels.back()[0], bytes);
+        }
+        if (!file)
+            return false;
+        width = std::max(width / 2, 1u);
+        height = std::max(height / 2, 1u);
+    }
+    if (offsets)
+    {
+        // seeking past the end doesn't fail: check the last level fits in the file
+        std::streamoff end = file.tellg();
+        file.seekg(0, std::ios::end);
+        return file && file.tellg() >= end;
+    }
+    return true;
+}
+
+// writes a DDS file: BC1/BC3/BC5 with the classic FourCC codes, BC7 and sRGB formats with the DX10 header extension
+inline bool WriteDDS(const std::string &path, const CompressedImage &image)
+{
+    DDS_header header;
+    std::memset(&header, 0, sizeof(header));
+    header.dwMagic = ddsFourCC('D', 'D', 'S', ' ');
+    header.dwSize = 124;
+    header.dwFlags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_LINEARSIZE | DDSD_MIPMAPCOUNT;
+    header.dwWidth = image.Width;
+    header.dwHeight = image.Height;
+    header.dwPitchOrLinearSize = (unsigned int)image.Levels[0].size();
+    header.dwMipMapCount = (unsigned int)image.Levels.size();
+    header.sPixelFormat.dwSize = 32;
+    header.sPixelFormat.dwFlags = DDPF_FOURCC;
+    header.sCaps.dwCaps1 = DDSCAPS_TEXTURE | (image.Levels.size() > 1 ? DDSCAPS_COMPLEX | DDSCAPS_MIPMAP : 0);
+    if (image.BottomUp)
+    {
+        header.dwReserved1[DDS_ORIENTATION_TAG] = ddsFourCC('L', 'O', 'G', 'L');
+        header.dwReserved1[DDS_ORIENTATION_FLAGS] = DDS_BOTTOM_UP;
+    }
+    unsigned int dxgi = 0;
+    if (image.Format == FORMAT_BC1 && !image.SRGB)
+        header.sPixelFormat.dwFourCC = ddsFourCC('D', 'X', 'T', '1');
+    else if (image.Format == FORMAT_BC3 && !image.SRGB)
+        header.sPixelFormat.dwFourCC = ddsFourCC('D', 'X', 'T', '5');
+    else if (image.Format == FORMAT_BC5)
+        header.sPixelFormat.dwFourCC = ddsFourCC('A', 'T', 'I', '2');
+    else
+    {
+        header.sPixelFormat.dwFourCC = ddsFourCC('D', 'X', '1', '0');
+        if (image.Format == FORMAT_BC1)
+            dxgi = DXGI_FORMAT_BC1_UNORM_SRGB;
+        else if (image.Format == FORMAT_BC3)
+            dxgi = DXGI_FORMAT_BC3_UNORM_SRGB;
+        else
+            dxgi = image.SRGB ? DXGI_FORMAT_BC7_UNORM_SRGB : DXGI_FORMAT_BC7_UNORM;
+    }
+    std::ofstream file(path.c_str(), std::ios::binary);
+    if (!file)
+    {
+        std::cout << "ERROR::DDS:: Could not write " << path << std::endl;
+        return false;
+    }
+    file.write((const char*)&header, sizeof(header));
+    if (dxgi != 0)
+    {
+        // dxgiFormat, resourceDimension (2D texture), miscFlag, arraySize, miscFlags2
+        uint32_t dx10[5] = { dxgi, 3, 0, 1, 0 };
+        file.write((const char*)dx10, sizeof(dx10));
+    }
+    for (const std::vector<unsigned char> &level : image.Levels)
+        file.write((const char*)&level[0], level.size());
+    return (bool)file;
+}
+
+inline bool ReadDDS(const std::string &path, CompressedImage &image, std::vector<size_t> *offsets = nullptr)
+{
+    std::ifstream file(path.c_str(), std::ios::binary);
+    DDS_header header;
+    if (!file.read((char*)&header, sizeof(header)) || header.dwMagic != ddsFourCC('D', 'D', 'S', ' ') || !(header.sPixelFormat.dwFlags & DDPF_FOURCC))
+    {
+        std::cout << "ERROR::DDS:: Not a block-compressed DDS file: " << path << std::endl;
+        return false;
+    }
+    image.Width = header.dwWidth;
+    image.Height = header.dwHeight;
+    image.SRGB = false;
+    image.BottomUp = header.dwReserved1[DDS_ORIENTATION_TAG] == ddsFourCC('L', 'O', 'G', 'L') && (header.dwReserved1[DDS_ORIENTATION_FLAGS] & DDS_BOTTOM_UP);
+    unsigned int code = header.sPixelFormat.dwFourCC;
+    if (code == ddsFourCC('D', 'X', 'T', '1'))
+        image.Format = FORMAT_BC1;
+    else if (code == ddsFourCC('D', 'X', 'T', '5'))
+        image.Format = FORMAT_BC3;
+    else if (code == ddsFourCC('A', 'T', 'I', '2') || code == ddsFourCC('B', 'C', '5', 'U'))
+        image.Format = FORMAT_BC5;
+    else if (code == ddsFourCC('D', 'X', '1', '0'))
+    {
+        uint32_t dx10[5];
+        file.read((char*)dx10, sizeof(dx10));
+        switch (dx10[0])
+        {
+        case DXGI_FORMAT_BC1_UNORM:      image.Format = FORMAT_BC1; break;
+        case DXGI_FORMAT_BC1_UNORM_SRGB: image.Format = FORMAT_BC1; image.SRGB = true; break;
+        case DXGI_FORMAT_BC3_UNORM:      image.Format = FORMAT_BC3; break;
+        case DXGI_FORMAT_BC3_UNORM_SRGB: image.Format = FORMAT_BC3; image.SRGB = true; break;
+        case DXGI_FORMAT_BC5_UNORM:      image.Format = FORMAT_BC5; break;
+        case DXGI_FORMAT_BC7_UNORM:      image.Format = FORMAT_BC7; break;
+        case DXGI_FORMAT_BC7_UNORM_SRGB: image.Format = FORMAT_BC7; image.SRGB = true; break;
+        default:
+            std::cout << "ERROR::DDS:: Unsupported DXGI format " << dx10[0] << ": " << path << std::endl;
+            return false;
+        }
+    }
+    else
+    {
+        std::cout << "ERROR::DDS:: Unsupported format: " << path << std::endl;
+        return false;
+    }
+    unsigned int levels = (header.dwFlags & DDSD_MIPMAPCOUNT) ? header.dwMipMapCount : 1;
+    if (!readCompressedLevels(file, image, levels, false, offsets))
+    {
+        std::cout << "ERROR::DDS:: Truncated file: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// writes a KTX (1.1) file
+inline bool WriteKTX(const std::string &path, const CompressedImage &image)
+{
+    std::ofstream file(path.c_str(), std::ios::binary);
+    if (!file)
+    {
+        std::cout << "ERROR::KTX:: Could not write " << path << std::endl;
+        return false;
+    }
+    unsigned int baseFormat = image.Format == FORMAT_BC5 ? GL_RG : (image.Format == FORMAT_BC1 ? GL_RGB : GL_RGBA);
+    // the orientation as the standard KTXorientation key: T=u if the first row is the bottom one, T=d otherwise
+    std::string orientation = std::string("KTXorientation") + '\0' + (image.BottomUp ? "S=r,T=u" : "S=r,T=d") + '\0';
+    uint32_t orientationBytes = (uint32_t)orientation.size();
+    orientation.resize((orientation.size() + 3) / 4 * 4, '\0');
+    // endianness, glType, glTypeSize, glFormat, glInternalFormat, glBaseInternalFormat, pixelWidth, pixelHeight,
+    // pixelDepth, numberOfArrayElements, numberOfFaces, numberOfMipmapLevels, bytesOfKeyValueData
+    uint32_t header[13] = { 0x04030201, 0, 1, 0, image.InternalFormat(), baseFormat, image.Width, image.Height, 0, 0, 1,
+                            (uint32_t)image.Levels.size(), (uint32_t)(sizeof(orientationBytes) + orientation.size()) };
+    file.write((const char*)KTX_IDENTIFIER, sizeof(KTX_IDENTIFIER));
+    file.write((const char*)header, sizeof(header));
+    file.write((const char*)&orientationBytes, sizeof(orientationBytes));
+    file.write(orientation.data(), orientation.size());
+    // block sizes are multiples of 4 bytes, so levels never need padding
+    for (const std::vector<unsigned char> &level : image.Levels)
+    {
+        uint32_t imageSize = (uint32_t)level.size();
+        file.write((const char*)&imageSize, sizeof(imageSize));
+        file.write((const char*)&level[0], level.size());
+    }
+    return (bool)file;
+}
+
+inline bool ReadKTX(const std::string &path, CompressedImage &image, std::vector<size_t> *offsets = nullptr)
+{
+    std::ifstream file(path.c_str(), std::ios::binary);
+    unsigned char identifier[12];
+    uint32_t header[13];
+    if (!file.read((char*)identifier, sizeof(identifier)) || std::memcmp(identifier, KTX_IDENTIFIER, sizeof(identifier)) != 0 ||
+        !file.read((char*)header, sizeof(header)) || header[0] != 0x04030201)
+    {
+        std::cout << "ERROR::KTX:: Not a (little endian) KTX file: " << path << std::endl;
+        return false;
+    }
+    image.Width = header[6];
+    image.Height = header[7];
+    image.SRGB = false;
+    image.BottomUp = false;
+    switch (header[4])
+    {
+    case GL_COMPRESSED_SRGB_S3TC_DXT1_EXT:       image.SRGB = true; // fall through
+    case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:        image.Format = FORMAT_BC1; break;
+    case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT: image.SRGB = true; // fall through
+    case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:       image.Format = FORMAT_BC3; break;
+    case GL_COMPRESSED_RG_RGTC2:                 image.Format = FORMAT_BC5; break;
+    case GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM:    image.SRGB = true; // fall through
+    case GL_COMPRESSED_RGBA_BPTC_UNORM:          image.Format = FORMAT_BC7; break;
+    default:
+        std::cout << "ERROR::KTX:: Unsupported internal format " << header[4] << ": " << path << std::endl;
+        return false;
+    }
+    // key/value pairs: only the orientation is of interest
+    std::vector<char> keyValues(header[12]);
+    if (header[12] > 0 && !file.read(&keyValues[0], header[12]))
+    {
+        std::cout << "ERROR::KTX:: Truncated file: " << path << std::endl;
+        return false;
+    }
+    for (size_t position = 0; position + 4 <= keyValues.size(); )
+    {
+        uint32_t bytes;
+        std::memcpy(&bytes, &keyValues[position], sizeof(bytes));
+        if (bytes > keyValues.size() - position - 4)
+            break;
+        std::string pair(&keyValues[position + 4], bytes);
+        if (pair.compare(0, 15, std::string("KTXorientation") + '\0') == 0)
+            image.BottomUp = pair.find("T=u") != std::string::npos;
+        position += 4 + (bytes + 3) / 4 * 4;
+    }
+    if (!readCompressedLevels(file, image, header[11], true, offsets))
+    {
+        std::cout << "ERROR::KTX:: Truncated file: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// reads a DDS or KTX file, told apart by their magic numbers. Given offsets, only the header is read: the levels are
+// left empty and offsets receives where each of them starts in the file, so they can be read one at a time.
+inline bool ReadCompressedImage(const std::string &path, CompressedImage &image, std::vector<size_t> *offsets = nullptr)
+{
+    std::ifstream file(path.c_str(), std::ios::binary);
+    char magic[4] = { 0, 0, 0, 0 };
+    if (!file.read(magic, 4))
+    {
+        std::cout << "ERROR::COMPRESSED_TEXTURE:: Could not read " << path << std::endl;
+        return false;
+    }
+    file.close();
+    if (std::memcmp(magic, "DDS ", 4) == 0)
+        return ReadDDS(path, image, offsets);
+    return ReadKTX(path, image, offsets);
+}
+
+// Orientation
+// -----------
+// whether stb_image currently flips images vertically on load (stbi_set_flip_vertically_on_load): the orientation the
+// uncompressed path produces, so the one baked textures have to match. stb_image has no getter for it, so this loads
+// a 1x2 image and looks at which row comes first.
+inline bool StbiFlipsVertically()
+{
+    const unsigned char image[] = { 'P', '5', '\n', '1', ' ', '2', '\n', '2', '5', '5', '\n', 0, 255 };
+    int width, height, channels;
+    unsigned char *data = stbi_load_from_memory(image, sizeof(image), &width, &height, &channels, 1);
+    bool flipped = data != nullptr && data[0] == 255;
+    stbi_image_free(data);
+    return flipped;
+}
+
+// reverses the order of the 16-bit or 12-bit rows of a block's indices, keeping rows past the image's height (padding)
+// in place
+inline uint64_t flipIndexRows(uint64_t indices, unsigned int bitsPerRow, unsigned int rows)
+{
+    uint64_t mask = (1ull << bitsPerRow) - 1, flipped = indices;
+    for (unsigned int row = 0; row < rows; ++row)
+    {
+        unsigned int to = rows - 1 - row;
+        flipped &= ~(mask << (to * bitsPerRow));
+        flipped |= ((indices >> (row * bitsPerRow)) & mask) << (to * bitsPerRow);
+    }
+    return flipped;
+}
+
+// flips the rows of a BC1 color block (2-bit indices in bytes 4-7, a byte per row)
+inline void flipBC1Block(unsigned char *block, unsigned int rows)
+{
+    uint64_t indices = (uint64_t)block[4] | ((uint64_t)block[5] << 8) | ((uint64_t)block[6] << 16) | ((uint64_t)block[7] << 24);
+    indices = flipIndexRows(indices, 8, rows);
+    for (unsigned int i = 0; i < 4; ++i)
+        block[4 + i] = (unsigned char)(indices >> (8 * i));
+}
+
+// flips the rows of a BC4 block (BC3 alpha, BC5 channels): 3-bit indices in bytes 2-7, 12 bits per row
+inline void flipBC4Block(unsigned char *block, unsigned int rows)
+{
+    uint64_t indices = 0;
+    for (unsigned int i = 0; i < 6; ++i)
+        indices |= (uint64_t)block[2 + i] << (8 * i);
+    indices = flipIndexRows(indices, 12, rows);
+    for (unsigned int i = 0; i < 6; ++i)
+        block[2 + i] = (unsigned char)(indices >> (8 * i));
+}
+
+inline unsigned int bc7Bits(const unsigned char *block, unsigned int start, unsigned int count)
+{
+    unsigned int value = 0;
+    for (unsigned int i = 0; i < count; ++i)
+        value |= ((block[(start + i) >> 3] >> ((start + i) & 7)) & 1u) << i;
+    return value;
+}
+
+inline void setBC7Bits(unsigned char *block, unsigned int start, unsigned int count, unsigned int value)
+{
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        unsigned int bit = start + i;
+        block[bit >> 3] = (unsigned char)((block[bit >> 3] & ~(1u << (bit & 7))) | (((value >> i) & 1u) << (bit & 7)));
+    }
+}
+
+// flips the rows of a BC7 mode 6 block (the only mode the baker writes); false for the other modes, whose partition
+// shapes don't survive a flip. Mode 6 has one subset and 4-bit indices, the first pixel's stored without its top bit
+// (implied 0): if the pixel that moves there has it set, the endpoints are swapped and the indices inverted.
+inline bool flipBC7Block(unsigned char *block, unsigned int rows)
+{
+    if ((block[0] & 0x7F) != 0x40)
+        return false;
+    const unsigned int indexStart = 65;
+    unsigned int indices[16], flipped[16];
+    indices[0] = bc7Bits(block, indexStart, 3);
+    for (unsigned int i = 1; i < 16; ++i)
+        indices[i] = bc7Bits(block, indexStart + 3 + (i - 1) * 4, 4);
+    for (unsigned int i = 0; i < 16; ++i)
+    {
+        unsigned int row = i / 4;
+        flipped[i] = indices[(row < rows ? rows - 1 - row : row) * 4 + i % 4];
+    }
+    if (flipped[0] & 8)
+    {
+        for (unsigned int i = 0; i < 16; ++i)
+            flipped[i] = 15 - flipped[i];
+        // R0 R1 G0 G1 B0 B1 A0 A1 (7 bits each, from bit 7), then P0 P1
+        for (unsigned int channel = 0; channel < 4; ++channel)
+        {
+            unsigned int start = 7 + channel * 14, first = bc7Bits(block, start, 7);
+            setBC7Bits(block, start, 7, bc7Bits(block, start + 7, 7));
+            setBC7Bits(block, start + 7, 7, first);
+        }
+        unsigned int p0 = bc7Bits(block, 63, 1);
+        setBC7Bits(block, 63, 1, bc7Bits(block, 64, 1));
+        setBC7Bits(block, 64, 1, p0);
+    }
+    setBC7Bits(block, indexStart, 3, flipped[0]);
+    for (unsigned int i = 1; i < 16; ++i)
+        setBC7Bits(block, indexStart + 3 + (i - 1) * 4, 4, flipped[i]);
+    return true;
+}
+
+// flips a compressed level upside down without decoding it: the rows of blocks swap places and each block's rows are
+// reversed. False if that can't be done: a height that isn't a multiple of 4 (past the first row of blocks) doesn't
+// line up with the blocks, and BC7 blocks other than mode 6 can't be flipped.
+inline bool FlipCompressedLevel(BlockFormat format, unsigned char *data, unsigned int width, unsigned int height)
+{
+    if (height > 4 && height % 4 != 0)
+        return false;
+    unsigned int blockBytes = CompressedImage::BlockBytes(format), rows = std::min(height, 4u);
+    size_t rowBytes = (size_t)((width + 3) / 4) * blockBytes;
+    unsigned int blockRows = (height + 3) / 4;
+    std::vector<unsigned char> swap(rowBytes);
+    for (unsigned int row = 0; row < blockRows / 2; ++row)
+    {
+        unsigned char *top = data + row * rowBytes, *bottom = data + (blockRows - 1 - row) * rowBytes;
+        std::memcpy(&swap[0], top, rowBytes);
+        std::memcpy(top, bottom, rowBytes);
+        std::memcpy(bottom, &swap[0], rowBytes);
+    }
+    for (unsigned char *block = data; block < data + blockRows * rowBytes; block += blockBytes)
+    {
+        switch (format)
+        {
+        case FORMAT_BC1: flipBC1Block(block, rows); break;
+        case FORMAT_BC3: flipBC4Block(block, rows); flipBC1Block(block + 8, rows); break;
+        case FORMAT_BC5: flipBC4Block(block, rows); flipBC4Block(block + 8, rows); break;
+        default:
+            if (!flipBC7Block(block, rows))
+                return false;
+        }
+    }
+    return true;
+}
+
+// flips the (loaded) levels of an image if it isn't in the given orientation; false if it can't be flipped, in which
+// case its levels are left in an undefined state
+inline bool OrientCompressedImage(CompressedImage &image, bool bottomUp)
+{
+    if (image.BottomUp == bottomUp)
+        return true;
+    unsigned int width = image.Width, height = image.Height;
+    for (std::vector<unsigned char> &level : image.Levels)
+    {
+        if (!FlipCompressedLevel(image.Format, &level[0], width, height))
+            return false;
+        width = std::max(width / 2, 1u);
+        height = std::max(height / 2, 1u);
+    }
+    image.BottomUp = bottomUp;
+    return true;
+}
+
+// the texture baked from an image by the texture baker (same name with a .dds or .ktx extension), or an empty string
+// if there is none
+inline std::string BakedTexturePath(const std::string &path)
+{
+    size_t dot = path.find_last_of('.');
+    std::string base = path.substr(0, dot != std::string::npos && path.find_first_of("/\\", dot) == std::string::npos ? dot : path.size());
+    const char *extensions[] = { ".dds", ".ktx" };
+    for (const char *extension : extensions)
+    {
+        std::ifstream file((base + extension).c_str());
+        if (file.good())
+            return base + extension;
+    }
+    return std::string();
+}
+
+// whether the current context can sample the given block format; none of them is core in GL 3.3 (BC5 is core since
+// 3.0, BC7 since 4.2, BC1/BC3 never), so a baked texture is only preferred over its source image when this holds
+inline bool CompressedFormatSupported(BlockFormat format)
+{
+    switch (format)
+    {
+    case FORMAT_BC1:
+    case FORMAT_BC3: return GLAD_GL_EXT_texture_compression_s3tc != 0;
+    case FORMAT_BC5: return GLAD_GL_ARB_texture_compression_rgtc != 0 || GLAD_GL_VERSION_3_0 != 0;
+    default:         return GLAD_GL_ARB_texture_compression_bptc != 0 || GLAD_GL_VERSION_4_2 != 0;
+    }
+}
+
+// uploads every mip level as is with glCompressedTexImage2D (no decompression, no glGenerateMipmap) into the given
+// texture object, which is left bound
+inline void UploadCompressedImage(unsigned int texture, const CompressedImage &image)
+{
+    glBindTexture(GL_TEXTURE_2D, texture);
+    unsigned int width = image.Width, height = image.Height;
+    for (size_t level = 0; level < image.Levels.size(); ++level)
+    {
+        glCompressedTexImage2D(GL_TEXTURE_2D, (GLint)level, image.InternalFormat(), width, height, 0, (GLsizei)image.Levels[level].size(), &image.Levels[level][0]);
+        width = std::max(width / 2, 1u);
+        height = std::max(height / 2, 1u);
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)image.Levels.size() - 1);
+}
+
+// loads a DDS or KTX texture into a new texture object with trilinear filtering; returns 0 if it couldn't be read
+// or its format isn't supported by the context
+inline unsigned int LoadCompressedTexture(const std::string &path, GLint wrap = GL_REPEAT)
+{
+    CompressedImage image;
+    if (!ReadCompressedImage(path, image) || image.Levels.empty() || !CompressedFormatSupported(image.Format))
+        return 0;
+    unsigned int texture;
+    glGenTextures(1, &texture);
+    UploadCompressedImage(texture, image);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrap);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrap);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, image.Levels.size() > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return texture;
+}
+#endif
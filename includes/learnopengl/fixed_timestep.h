@@ -0,0 +1,101 @@
+#ifndef FIXED_TIMESTEP_H
+#define FIXED_TIMESTEP_H
+
+#include <algorithm>
+#include <cmath>
+
+// Default loop values
+const double       TICK_RATE           = 120.0;
+const unsigned int MAX_TICKS_PER_FRAME = 8;
+const double       MAX_FRAME_TIME      = 0.25;
+
+// Fixed-timestep game-loop driver: real (frame) time is accumulated and the simulation is advanced in whole ticks of
+// 1/TickRate seconds, so it behaves the same regardless of frame rate. Whatever is left in the accumulator is less
+// than a tick; Alpha() expresses it as a fraction of a tick, with which the renderer interpolates between the
+// previous and the current simulation state. Usage:
+//     unsigned int ticks = loop.Advance(frameTime);
+//     for (unsigned int i = 0; i < ticks; ++i)
+//         simulate(loop.Step);
+//     render(loop.Alpha());
+// Spiral-of-death protection: when simulating is slower than real time each frame would owe more ticks than the one
+// before. A single frame is never counted as longer than MaxFrameTime (a breakpoint, a window drag) and never runs more
+// than MaxTicksPerFrame ticks; time beyond that is dropped, so the game slows down instead of freezing.
+class FixedTimestep
+{
+public:
+    // ticks per second and the length of a tick (1 / TickRate)
+    double TickRate;
+    double Step;
+    unsigned int MaxTicksPerFrame;
+    double MaxFrameTime;
+    // counters: ticks simulated, frames in which time had to be dropped and the total time dropped (seconds)
+    unsigned long long Ticks;
+    unsigned long long ClampedFrames;
+    double DroppedTime;
+
+    FixedTimestep(double tickRate = TICK_RATE, unsigned int maxTicksPerFrame = MAX_TICKS_PER_FRAME, double maxFrameTime = MAX_FRAME_TIME)
+        : MaxTicksPerFrame(maxTicksPerFrame), MaxFrameTime(maxFrameTime), Ticks(0), ClampedFrames(0), DroppedTime(0.0), accumulator(0.0)
+    {
+        SetTickRate(tickRate);
+    }
+
+    void SetTickRate(double tickRate)
+    {
+        TickRate = std::max(tickRate, 1.0);
+        Step = 1.0 / TickRate;
+    }
+
+    // adds a frame's worth of real time and returns the number of ticks to simulate for it
+    unsigned int Advance(double frameTime)
+    {
+        double dropped = 0.0;
+        if (frameTime > MaxFrameTime)
+        {
+            dropped += frameTime - MaxFrameTime;
+            frameTime = MaxFrameTime;
+        }
+        accumulator += std::max(frameTime, 0.0);
+        unsigned int ticks = 0;
+        while (accumulator >= Step && ticks < MaxTicksPerFrame)
+        {
+            accumulator -= Step;
+            ++ticks;
+        }
+        // still owing whole ticks: drop them rather than carrying them into the next frame
+        if (accumulator >= Step)
+        {
+            double owed = accumulator - std::fmod(accumulator, Step);
+            dropped += owed;
+            accumulator -= owed;
+        }
+        if (dropped > 0.0)
+        {
+            ++ClampedFrames;
+            DroppedTime += dropped;
+        }
+        Ticks += ticks;
+        return ticks;
+    }
+
+    // how far (0 to 1) real time has progressed from the last simulated tick to the next one
+    float Alpha() const
+    {
+        return static_cast<float>(std::min(accumulator / Step, 1.0));
+    }
+
+    // simulated time in seconds
+    double Time() const
+    {
+        return Ticks * Step;
+    }
+
+    // forgets accumulated time, e.g. after loading or when unpausing
+    void Reset()
+    {
+        accumulator = 0.0;
+    }
+
+private:
+    double accumulator;
+};
+#endif
@@ -0,0 +1,449 @@
+#ifndef GLYPH_ATLAS_H
+#define GLYPH_ATLAS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+#include <learnopengl/stream_buffer.h>
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Skyline bin packer: the packed area is described by its top outline (the skyline), a list of horizontal segments.
+// A rectangle is placed bottom-left: on the segment where its top ends up lowest (ties go to the narrowest fit), after
+// which the skyline is raised under it. Fast and tight for rectangles of similar height, like the glyphs of a font.
+class SkylinePacker
+{
+public:
+    unsigned int Width, Height;
+
+    SkylinePacker(unsigned int width = 0, unsigned int height = 0)
+    {
+        Reset(width, height);
+    }
+
+    void Reset(unsigned int width, unsigned int height)
+    {
+        Width = width;
+        Height = height;
+        usedArea = 0;
+        skyline.clear();
+        Segment floor = { 0, 0, (int)width };
+        skyline.push_back(floor);
+    }
+
+    // finds a place for a width x height rectangle; false if it doesn't fit anymore
+    bool Pack(unsigned int width, unsigned int height, unsigned int &x, unsigned int &y)
+    {
+        int bestIndex = -1, bestY = 0, bestWidth = 0;
+        for (size_t i = 0; i < skyline.size(); ++i)
+        {
+            int top;
+            if (!fit(i, width, height, top))
+                continue;
+            if (bestIndex < 0 || top < bestY || (top == bestY && skyline[i].Width < bestWidth))
+            {
+                bestIndex = (int)i;
+                bestY = top;
+                bestWidth = skyline[i].Width;
+            }
+        }
+        if (bestIndex < 0)
+            return false;
+        x = skyline[bestIndex].X;
+        y = bestY;
+
+        // raise the skyline under the rectangle: insert its top and cut it out of the segments it covers
+        Segment raised = { (int)x, bestY + (int)height, (int)width };
+        skyline.insert(skyline.begin() + bestIndex, raised);
+        for (size_t i = bestIndex + 1; i < skyline.size(); )
+        {
+            int end = raised.X + raised.Width;
+            if (skyline[i].X >= end)
+                break;
+            int shrink = end - skyline[i].X;
+            skyline[i].X += shrink;
+            skyline[i].Width -= shrink;
+            if (skyline[i].Width > 0)
+                break;
+            skyline.erase(skyline.begin() + i);
+        }
+        // merge neighbours at the same height
+        for (size_t i = 0; i + 1 < skyline.size(); )
+        {
+            if (skyline[i].Y == skyline[i + 1].Y)
+            {
+                skyline[i].Width += skyline[i + 1].Width;
+                skyline.erase(skyline.begin() + i + 1);
+            }
+            else
+                ++i;
+        }
+        usedArea += (size_t)width * height;
+        return true;
+    }
+
+    // fraction of the area covered by packed rectangles
+    float Occupancy() const
+    {
+        return Width * Height > 0 ? (float)usedArea / ((float)Width * Height) : 0.0f;
+    }
+
+private:
+    struct Segment
+    {
+        int X, Y, Width;
+    };
+    std::vector<Segment> skyline;
+    size_t usedArea;
+
+    // the height at which a rectangle would rest when placed at the start of segment index
+    bool fit(size_t index, unsigned int width, unsigned int height, int &top) const
+    {
+        int x = skyline[index].X;
+        if (x + (int)width > (int)Width)
+            return false;
+        int remaining = (int)width;
+        top = 0;
+        for (size_t i = index; remaining > 0; ++i)
+        {
+            top = std::max(top, skyline[i].Y);
+            if (top + (int)height > (int)Height)
+                return false;
+            remaining -= skyline[i].Width;
+        }
+        return true;
+    }
+};
+
+// decodes the UTF-8 sequence at text[i] and moves i past it; malformed bytes decode as U+FFFD
+inline unsigned int NextCodepoint(const std::string &text, size_t &i)
+{
+    unsigned char lead = (unsigned char)text[i++];
+    if (lead < 0x80)
+        return lead;
+    unsigned int length = lead >= 0xF0 ? 3 : lead >= 0xE0 ? 2 : lead >= 0xC0 ? 1 : 0;
+    if (length == 0 || lead >= 0xF8)
+        return 0xFFFD;
+    unsigned int codepoint = lead & (0x3F >> length);
+    for (unsigned int k = 0; k < length; ++k)
+    {
+        if (i >= text.size() || ((unsigned char)text[i] & 0xC0) != 0x80)
+            return 0xFFFD;
+        codepoint = (codepoint << 6) | ((unsigned char)text[i++] & 0x3F);
+    }
+    return codepoint;
+}
+
+// Position and metrics of a glyph in a GlyphAtlas
+struct AtlasGlyph {
+    unsigned int Page;    // index of the atlas page (texture) holding the glyph
+    glm::vec2    UVMin;   // texture coordinates of the glyph's top-left and bottom-right corner
+    glm::vec2    UVMax;
+    glm::ivec2   Size;    // size of glyph
+    glm::ivec2   Bearing; // offset from baseline to left/top of glyph
+    unsigned int Advance; // horizontal offset to advance to next glyph (in 1/64 pixels)
+};
+
+// Glyphs of a font rasterized by FreeType and packed into one or more single-channel (GL_R8) textures, the atlas
+// pages. A page is only added when the skyline packer can't fit a glyph into the current one. Glyphs are padded
+// by a pixel of empty space so linear filtering doesn't bleed neighbours into each other.
+class GlyphAtlas
+{
+public:
+    unsigned int PageSize;
+    unsigned int Padding;
+    // the font's pixel size and the distance between baselines
+    unsigned int PixelSize;
+    unsigned int LineHeight;
+    std::vector<unsigned int> Pages;
+    std::unordered_map<unsigned int, AtlasGlyph> Glyphs;
+
+    GlyphAtlas(unsigned int pageSize = 512, unsigned int padding = 1)
+        : PageSize(pageSize), Padding(padding), PixelSize(0), LineHeight(0)
+    {
+    }
+    ~GlyphAtlas()
+    {
+        Clear();
+    }
+    // the page textures have a single owner
+    GlyphAtlas(const GlyphAtlas&) = delete;
+    GlyphAtlas &operator=(const GlyphAtlas&) = delete;
+
+    void Clear()
+    {
+        if (!Pages.empty())
+            glDeleteTextures((GLsizei)Pages.size(), &Pages[0]);
+        Pages.clear();
+        Glyphs.clear();
+    }
+
+    // rasterizes the characters [first, last) of a font at the given pixel size into the atlas
+    bool Load(const std::string &font, unsigned int pixelSize, unsigned int first = 0, unsigned int last = 128)
+    {
+        Clear();
+        FT_Library ft;
+        if (FT_Init_FreeType(&ft))
+        {
+            std::cout << "ERROR::FREETYPE: Could not init FreeType Library" << std::endl;
+            return false;
+        }
+        FT_Face face;
+        if (FT_New_Face(ft, font.c_str(), 0, &face))
+        {
+            std::cout << "ERROR::FREETYPE: Failed to load font" << std::endl;
+            FT_Done_FreeType(ft);
+            return false;
+        }
+        FT_Set_Pixel_Sizes(face, 0, pixelSize);
+        PixelSize = pixelSize;
+        LineHeight = (unsigned int)(face->size->metrics.height >> 6);
+
+        // rasterize everything first: packing the glyphs tallest first wastes the least space
+        std::vector<Bitmap> bitmaps;
+        for (unsigned int c = first; c < last; ++c)
+        {
+            if (FT_Load_Char(face, c, FT_LOAD_RENDER))
+            {
+                std::cout << "ERROR::FREETYTPE: Failed to load Glyph" << std::endl;
+                continue;
+            }
+            FT_GlyphSlot slot = face->glyph;
+            Bitmap bitmap;
+            bitmap.Codepoint = c;
+            bitmap.Size = glm::ivec2(slot->bitmap.width, slot->bitmap.rows);
+            bitmap.Bearing = glm::ivec2(slot->bitmap_left, slot->bitmap_top);
+            bitmap.Advance = (unsigned int)slot->advance.x;
+            for (unsigned int row = 0; row < slot->bitmap.rows; ++row)
+                bitmap.Pixels.insert(bitmap.Pixels.end(), slot->bitmap.buffer + row * slot->bitmap.pitch, slot->bitmap.buffer + row * slot->bitmap.pitch + slot->bitmap.width);
+            bitmaps.push_back(bitmap);
+        }
+        FT_Done_Face(face);
+        FT_Done_FreeType(ft);
+
+        std::stable_sort(bitmaps.begin(), bitmaps.end(), [](const Bitmap &a, const Bitmap &b) { return a.Size.y > b.Size.y; });
+        for (const Bitmap &bitmap : bitmaps)
+            Add(bitmap.Codepoint, bitmap.Pixels.empty() ? nullptr : &bitmap.Pixels[0], bitmap.Size, bitmap.Bearing, bitmap.Advance);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        return true;
+    }
+
+    // packs a rasterized glyph (tightly packed 8-bit rows) into the atlas, adding a page if it's full
+    const AtlasGlyph *Add(unsigned int codepoint, const unsigned char *pixels, glm::ivec2 size, glm::ivec2 bearing, unsigned int advance)
+    {
+        AtlasGlyph glyph;
+        glyph.Size = size;
+        glyph.Bearing = bearing;
+        glyph.Advance = advance;
+        glyph.Page = 0;
+        glyph.UVMin = glyph.UVMax = glm::vec2(0.0f);
+        if (size.x > 0 && size.y > 0)
+        {
+            unsigned int x = 0, y = 0;
+            unsigned int width = size.x + Padding, height = size.y + Padding;
+            if (Pages.empty() || !packer.Pack(width, height, x, y))
+            {
+                addPage();
+                if (!packer.Pack(width, height, x, y))
+                {
+                    std::cout << "ERROR::GLYPH_ATLAS: Glyph " << codepoint << " doesn't fit on a " << PageSize << "x" << PageSize << " page" << std::endl;
+                    return nullptr;
+                }
+            }
+            glyph.Page = (unsigned int)Pages.size() - 1;
+            glyph.UVMin = glm::vec2(x, y) / (float)PageSize;
+            glyph.UVMax = glm::vec2(x + size.x, y + size.y) / (float)PageSize;
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+            glBindTexture(GL_TEXTURE_2D, Pages.back());
+            glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, size.x, size.y, GL_RED, GL_UNSIGNED_BYTE, pixels);
+        }
+        return &(Glyphs[codepoint] = glyph);
+    }
+
+    const AtlasGlyph *Find(unsigned int codepoint) const
+    {
+        std::unordered_map<unsigned int, AtlasGlyph>::const_iterator it = Glyphs.find(codepoint);
+        return it != Glyphs.end() ? &it->second : nullptr;
+    }
+
+    // fraction of the last page covered by glyphs
+    float Occupancy() const
+    {
+        return packer.Occupancy();
+    }
+
+    size_t MemoryBytes() const
+    {
+        return Pages.size() * (size_t)PageSize * PageSize;
+    }
+
+private:
+    struct Bitmap
+    {
+        unsigned int Codepoint;
+        glm::ivec2 Size, Bearing;
+        unsigned int Advance;
+        std::vector<unsigned char> Pixels;
+    };
+    SkylinePacker packer;
+
+    void addPage()
+    {
+        // start out cleared: the padding around the glyphs has to be empty
+        std::vector<unsigned char> clear((size_t)PageSize * PageSize, 0);
+        unsigned int texture;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, PageSize, PageSize, 0, GL_RED, GL_UNSIGNED_BYTE, &clear[0]);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        Pages.push_back(texture);
+        packer.Reset(PageSize, PageSize);
+    }
+};
+
+// Batches text into one vertex stream per atlas page: Add lays strings out into quads (position, texture
+// coordinates and color per vertex, so differently colored text still batches), Flush draws each page's quads with
+// a single draw call. The caller binds the text shader (vertex attributes: 0 = vec4 position/uv, 1 = vec3 color,
+// atlas page on texture unit 0) before flushing. Vertices are streamed through a StreamBuffer, shared with other
+// renderers when one is passed in.
+class TextBatch
+{
+public:
+    // statistics since the last ResetStats()
+    unsigned int DrawCalls;
+    unsigned int GlyphsDrawn;
+
+    TextBatch(StreamBuffer *stream = nullptr)
+        : DrawCalls(0), GlyphsDrawn(0), VAO(0), stream(stream), ownsStream(stream == nullptr), pageTextures(nullptr)
+    {
+        if (ownsStream)
+            this->stream = new StreamBuffer(256 * 1024);
+        glGenVertexArrays(1, &VAO);
+        glBindVertexArray(VAO);
+        glEnableVertexAttribArray(0);
+        glEnableVertexAttribArray(1);
+        glBindVertexArray(0);
+    }
+    ~TextBatch()
+    {
+        glDeleteVertexArrays(1, &VAO);
+        if (ownsStream)
+            delete stream;
+    }
+    // the vertex array (and the stream buffer, if it made its own) have a single owner
+    TextBatch(const TextBatch&) = delete;
+    TextBatch &operator=(const TextBatch&) = delete;
+
+    // lays out a line of (UTF-8) text starting at the baseline (x, y). With yDown the y axis points down (screen
+    // space), otherwise up. Characters missing from the atlas are skipped. Works with anything that has Pages and
+    // Find(codepoint) returning an AtlasGlyph, like a GlyphAtlas or a GlyphCache.
+    template <typename Atlas>
+    void Add(Atlas &atlas, const std::string &text, float x, float y, float scale, glm::vec3 color, bool yDown = false)
+    {
+        for (size_t i = 0; i < text.size(); )
+        {
+            const AtlasGlyph *glyph = atlas.Find(NextCodepoint(text, i));
+            if (glyph == nullptr)
+                continue;
+            if (glyph->Size.x > 0 && glyph->Size.y > 0)
+            {
+                float left = x + glyph->Bearing.x * scale;
+                float right = left + glyph->Size.x * scale;
+                float top = yDown ? y - glyph->Bearing.y * scale : y + glyph->Bearing.y * scale;
+                float bottom = yDown ? top + glyph->Size.y * scale : top - glyph->Size.y * scale;
+                AddQuad(atlas.Pages, glyph->Page, left, top, right, bottom, glyph->UVMin, glyph->UVMax, color);
+            }
+            // advance is in 1/64 pixels
+            x += (glyph->Advance >> 6) * scale;
+        }
+    }
+
+    // queues a single glyph quad (in screen coordinates) sampling the given page of an atlas
+    void AddQuad(const std::vector<unsigned int> &pageTextures, unsigned int page, float left, float top, float right, float bottom,
+                 glm::vec2 uvMin, glm::vec2 uvMax, glm::vec3 color)
+    {
+        // a batch refers to the pages of a single atlas
+        if (this->pageTextures != &pageTextures)
+        {
+            Flush();
+            this->pageTextures = &pageTextures;
+        }
+        if (pages.size() <= page)
+            pages.resize(page + 1);
+        std::vector<float> &vertices = pages[page];
+        float quad[6][FloatsPerVertex] = {
+            { left,  top,    uvMin.x, uvMin.y, color.r, color.g, color.b },
+            { left,  bottom, uvMin.x, uvMax.y, color.r, color.g, color.b },
+            { right, bottom, uvMax.x, uvMax.y, color.r, color.g, color.b },
+
+            { left,  top,    uvMin.x, uvMin.y, color.r, color.g, color.b },
+            { right, bottom, uvMax.x, uvMax.y, color.r, color.g, color.b },
+            { right, top,    uvMax.x, uvMin.y, color.r, color.g, color.b }
+        };
+        vertices.insert(vertices.end(), &quad[0][0], &quad[0][0] + 6 * FloatsPerVertex);
+    }
+
+    // draws everything added since the last flush, one draw call per atlas page
+    void Flush()
+    {
+        if (pageTextures == nullptr)
+            return;
+        glActiveTexture(GL_TEXTURE0);
+        glBindVertexArray(VAO);
+        const GLsizei stride = FloatsPerVertex * sizeof(float);
+        for (size_t page = 0; page < pages.size(); ++page)
+        {
+            std::vector<float> &vertices = pages[page];
+            if (vertices.empty())
+                continue;
+            // allocated at a multiple of the stride, so the draw can start at the allocation's first vertex
+            StreamAllocation allocation = stream->Allocate(vertices.size() * sizeof(float), stride);
+            if (allocation.Data == nullptr)
+            {
+                vertices.clear();
+                continue;
+            }
+            std::memcpy(allocation.Data, &vertices[0], vertices.size() * sizeof(float));
+            stream->Commit();
+            glBindBuffer(GL_ARRAY_BUFFER, allocation.Buffer);
+            glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, stride, (void*)0);
+            glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)(4 * sizeof(float)));
+            glBindTexture(GL_TEXTURE_2D, (*pageTextures)[page]);
+            GLsizei count = (GLsizei)(vertices.size() / FloatsPerVertex);
+            glDrawArrays(GL_TRIANGLES, (GLint)(allocation.Offset / stride), count);
+            DrawCalls++;
+            GlyphsDrawn += count / 6;
+            vertices.clear();
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindVertexArray(0);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    void ResetStats()
+    {
+        DrawCalls = GlyphsDrawn = 0;
+    }
+
+private:
+    static const unsigned int FloatsPerVertex = 7;
+    unsigned int VAO;
+    StreamBuffer *stream;
+    bool ownsStream;
+    const std::vector<unsigned int> *pageTextures;
+    // queued vertices per atlas page
+    std::vector<std::vector<float>> pages;
+};
+#endif
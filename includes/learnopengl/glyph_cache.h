@@ -0,0 +1,433 @@
+#ifndef GLYPH_CACHE_H
+#define GLYPH_CACHE_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+#include <learnopengl/glyph_atlas.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <list>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Signed distance field glyphs, cached on demand. Instead of coverage, every texel holds the distance to the glyph's
+// outline (0.5 on the edge, more inside, less outside, 'Spread' pixels mapping to the full range), so a single
+// rasterization at BaseSize renders crisp at any scale: the text shader thresholds the distance at 0.5 with a
+// screen-space smoothing width.
+//
+// Glyphs are rasterized the first time they're asked for (any Unicode codepoint, text is UTF-8), by background
+// threads that each own a FreeType face; Find returns nullptr until the glyph arrives, text simply skips it for a
+// few frames. Update, once per frame on the thread owning the GL context, uploads finished glyphs. The pages are
+// divided into equal cells (sized for the font's largest glyph), so when all pages are full the least recently used
+// glyph is evicted in O(1) and its cell reused; glyphs used since the last Update are never evicted.
+class GlyphCache
+{
+public:
+    unsigned int BaseSize;
+    unsigned int Spread;
+    unsigned int PageSize;
+    unsigned int MaxPages;
+    // cell size and cells per page row
+    unsigned int CellSize;
+    unsigned int CellsPerRow;
+    std::vector<unsigned int> Pages;
+
+    // statistics: lookups of cached glyphs, requests for new ones, glyphs rasterized and put in the atlas, cells
+    // reused and rasterized glyphs thrown away for lack of space
+    unsigned long long Hits, Misses, Arrived, Evictions, Dropped;
+    // time from a glyph's first request until it's in the atlas (milliseconds)
+    double TotalMissLatency, MaxMissLatency;
+
+    GlyphCache(const std::string &font, unsigned int baseSize = 48, unsigned int spread = 6, unsigned int pageSize = 1024, unsigned int maxPages = 4, unsigned int threads = 0)
+        : BaseSize(baseSize), Spread(spread), PageSize(pageSize), MaxPages(std::max(maxPages, 1u)), CellSize(0), CellsPerRow(0),
+          Hits(0), Misses(0), Arrived(0), Evictions(0), Dropped(0), TotalMissLatency(0.0), MaxMissLatency(0.0), frame(0), stop(false), font(font)
+    {
+        // the cell has to hold the largest glyph plus the spread on each side
+        FT_Library ft;
+        FT_Face face;
+        if (FT_Init_FreeType(&ft))
+            std::cout << "ERROR::FREETYPE: Could not init FreeType Library" << std::endl;
+        else if (FT_New_Face(ft, font.c_str(), 0, &face))
+        {
+            std::cout << "ERROR::FREETYPE: Failed to load font " << font << std::endl;
+            FT_Done_FreeType(ft);
+        }
+        else
+        {
+            FT_Set_Pixel_Sizes(face, 0, baseSize);
+            FT_BBox &box = face->bbox;
+            float unitsToPixels = (float)face->size->metrics.y_ppem / face->units_per_EM;
+            unsigned int extent = (unsigned int)std::ceil(std::max(box.xMax - box.xMin, box.yMax - box.yMin) * unitsToPixels);
+            CellSize = std::min(extent, baseSize * 2) + 2 * spread;
+            FT_Done_Face(face);
+            FT_Done_FreeType(ft);
+        }
+        CellsPerRow = CellSize > 0 ? PageSize / CellSize : 0;
+        if (threads == 0)
+            threads = std::max(1u, std::min(std::thread::hardware_concurrency() - 1, 4u));
+        for (unsigned int i = 0; i < threads; ++i)
+            workers.push_back(std::thread(&GlyphCache::rasterize, this));
+    }
+    ~GlyphCache()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stop = true;
+        }
+        requestReady.notify_all();
+        for (std::thread &worker : workers)
+            worker.join();
+        if (!Pages.empty())
+            glDeleteTextures((GLsizei)Pages.size(), &Pages[0]);
+    }
+
+    // the glyph if it's cached; otherwise requests it and returns nullptr. Marks the glyph as used this frame
+    const AtlasGlyph *Find(unsigned int codepoint)
+    {
+        std::unordered_map<unsigned int, Entry>::iterator it = entries.find(codepoint);
+        if (it == entries.end())
+        {
+            Entry &entry = entries[codepoint];
+            entry.Ready = false;
+            entry.Cell = -1;
+            entry.Requested = std::chrono::steady_clock::now();
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                requests.push_back(codepoint);
+            }
+            requestReady.notify_one();
+            Misses++;
+            return nullptr;
+        }
+        Entry &entry = it->second;
+        if (!entry.Ready)
+            return nullptr;
+        if (entry.Cell >= 0)
+        {
+            cellFrame[entry.Cell] = frame;
+            lru.splice(lru.begin(), lru, entry.Recent);
+        }
+        Hits++;
+        return &entry.Glyph;
+    }
+
+    // uploads the glyphs rasterized since the last call and starts a new frame. The uploads come first, so they can't
+    // evict the glyphs looked up in the frame that just ended
+    void Update()
+    {
+        std::deque<Rasterized> done;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            done.swap(finished);
+        }
+        for (Rasterized &glyph : done)
+            upload(glyph);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        frame++;
+    }
+
+    // glyphs requested but not in the atlas yet
+    size_t Pending() const
+    {
+        size_t pending = 0;
+        for (std::unordered_map<unsigned int, Entry>::const_iterator it = entries.begin(); it != entries.end(); ++it)
+            pending += it->second.Ready ? 0 : 1;
+        return pending;
+    }
+
+    size_t CachedGlyphs() const
+    {
+        return lru.size();
+    }
+
+    // the codepoints of the glyphs in the atlas, most recently used first
+    std::vector<unsigned int> CachedCodepoints() const
+    {
+        return std::vector<unsigned int>(lru.begin(), lru.end());
+    }
+
+    double AverageMissLatency() const
+    {
+        return Arrived > 0 ? TotalMissLatency / Arrived : 0.0;
+    }
+
+    size_t MemoryBytes() const
+    {
+        return Pages.size() * (size_t)PageSize * PageSize;
+    }
+
+    // converts 8-bit coverage into a signed distance field with spread pixels of margin around it (see above).
+    // Distances are exact Euclidean distances between texel centers (Felzenszwalb & Huttenlocher), refined by the
+    // coverage of edge texels
+    static void GenerateSDF(const unsigned char *coverage, int width, int height, int pitch, int spread, std::vector<unsigned char> &sdf)
+    {
+        int w = width + 2 * spread, h = height + 2 * spread;
+        const float infinity = 1e20f;
+        std::vector<float> outside((size_t)w * h), inside((size_t)w * h);
+        std::vector<float> alpha((size_t)w * h, 0.0f);
+        for (int y = 0; y < height; ++y)
+            for (int x = 0; x < width; ++x)
+                alpha[(size_t)(y + spread) * w + x + spread] = coverage[y * pitch + x] / 255.0f;
+        // squared distance to the nearest texel inside, resp. outside, the glyph
+        for (size_t i = 0; i < alpha.size(); ++i)
+        {
+            outside[i] = alpha[i] >= 0.5f ? 0.0f : infinity;
+            inside[i] = alpha[i] >= 0.5f ? infinity : 0.0f;
+        }
+        distanceTransform(outside, w, h);
+        distanceTransform(inside, w, h);
+        sdf.resize((size_t)w * h);
+        for (size_t i = 0; i < sdf.size(); ++i)
+        {
+            // edge texels are partially covered: shift by how far the edge is from their center
+            float distance = alpha[i] >= 0.5f ? std::sqrt(inside[i]) - 0.5f : 0.5f - std::sqrt(outside[i]);
+            if (alpha[i] > 0.0f && alpha[i] < 1.0f)
+                distance = alpha[i] - 0.5f;
+            float value = 0.5f + distance / (2.0f * spread);
+            sdf[i] = (unsigned char)(std::min(std::max(value, 0.0f), 1.0f) * 255.0f + 0.5f);
+        }
+    }
+
+private:
+    struct Entry
+    {
+        AtlasGlyph Glyph;
+        bool Ready;
+        int Cell;
+        std::list<unsigned int>::iterator Recent;
+        std::chrono::steady_clock::time_point Requested;
+    };
+    struct Rasterized
+    {
+        unsigned int Codepoint;
+        glm::ivec2 Size, Bearing;
+        unsigned int Advance;
+        std::vector<unsigned char> Pixels;
+    };
+
+    // main thread state
+    std::unordered_map<unsigned int, Entry> entries;
+    std::list<unsigned int> lru; // cached codepoints, most recently used first
+    std::vector<int> freeCells;
+    std::vector<unsigned int> cellCodepoint;
+    std::vector<unsigned long long> cellFrame;
+    unsigned long long frame;
+
+    // shared with the workers
+    std::mutex mutex;
+    std::condition_variable requestReady;
+    std::deque<unsigned int> requests;
+    std::deque<Rasterized> finished;
+    bool stop;
+    std::string font;
+    std::vector<std::thread> workers;
+
+    // worker thread: rasterizes requested codepoints into distance fields with its own FreeType face
+    void rasterize()
+    {
+        FT_Library ft;
+        FT_Face face;
+        if (FT_Init_FreeType(&ft))
+            return;
+        if (FT_New_Face(ft, font.c_str(), 0, &face))
+        {
+            FT_Done_FreeType(ft);
+            return;
+        }
+        FT_Set_Pixel_Sizes(face, 0, BaseSize);
+        for (;;)
+        {
+            unsigned int codepoint;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                requestReady.wait(lock, [this] { return stop || !requests.empty(); });
+                if (stop)
+                    break;
+                codepoint = requests.front();
+                requests.pop_front();
+            }
+            Rasterized glyph;
+            glyph.Codepoint = codepoint;
+            glyph.Size = glyph.Bearing = glm::ivec2(0);
+            glyph.Advance = 0;
+            if (FT_Load_Char(face, codepoint, FT_LOAD_RENDER) == 0)
+            {
+                FT_GlyphSlot slot = face->glyph;
+                glyph.Advance = (unsigned int)slot->advance.x;
+                if (slot->bitmap.width > 0 && slot->bitmap.rows > 0)
+                {
+                    // clip the (rare) glyph bigger than a cell
+                    int maxSize = (int)CellSize - 2 * (int)Spread;
+                    int width = std::min((int)slot->bitmap.width, maxSize), height = std::min((int)slot->bitmap.rows, maxSize);
+                    GenerateSDF(slot->bitmap.buffer, width, height, slot->bitmap.pitch, Spread, glyph.Pixels);
+                    glyph.Size = glm::ivec2(width + 2 * Spread, height + 2 * Spread);
+                    glyph.Bearing = glm::ivec2(slot->bitmap_left - (int)Spread, slot->bitmap_top + (int)Spread);
+                }
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            finished.push_back(glyph);
+        }
+        FT_Done_Face(face);
+        FT_Done_FreeType(ft);
+    }
+
+    // puts a rasterized glyph into a free (or the least recently used) cell
+    void upload(Rasterized &rasterized)
+    {
+        std::unordered_map<unsigned int, Entry>::iterator it = entries.find(rasterized.Codepoint);
+        if (it == entries.end())
+            return;
+        Entry &entry = it->second;
+        AtlasGlyph &glyph = entry.Glyph;
+        glyph.Size = rasterized.Size;
+        glyph.Bearing = rasterized.Bearing;
+        glyph.Advance = rasterized.Advance;
+        glyph.Page = 0;
+        glyph.UVMin = glyph.UVMax = glm::vec2(0.0f);
+        if (!rasterized.Pixels.empty())
+        {
+            int cell = allocateCell();
+            if (cell < 0)
+            {
+                // everything is in use this frame: forget the glyph, it's requested again when next needed
+                Dropped++;
+                entries.erase(it);
+                return;
+            }
+            unsigned int cellsPerPage = CellsPerRow * CellsPerRow;
+            unsigned int page = cell / cellsPerPage, index = cell % cellsPerPage;
+            unsigned int x = (index % CellsPerRow) * CellSize, y = (index / CellsPerRow) * CellSize;
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+            glBindTexture(GL_TEXTURE_2D, Pages[page]);
+            glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, glyph.Size.x, glyph.Size.y, GL_RED, GL_UNSIGNED_BYTE, &rasterized.Pixels[0]);
+            glyph.Page = page;
+            glyph.UVMin = glm::vec2(x, y) / (float)PageSize;
+            glyph.UVMax = glm::vec2(x + glyph.Size.x, y + glyph.Size.y) / (float)PageSize;
+            entry.Cell = cell;
+            cellCodepoint[cell] = rasterized.Codepoint;
+            cellFrame[cell] = frame;
+            lru.push_front(rasterized.Codepoint);
+            entry.Recent = lru.begin();
+        }
+        entry.Ready = true;
+        Arrived++;
+        double latency = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - entry.Requested).count();
+        TotalMissLatency += latency;
+        MaxMissLatency = std::max(MaxMissLatency, latency);
+    }
+
+    int allocateCell()
+    {
+        if (freeCells.empty() && Pages.size() < MaxPages)
+            addPage();
+        if (!freeCells.empty())
+        {
+            int cell = freeCells.back();
+            freeCells.pop_back();
+            return cell;
+        }
+        // evict the least recently used glyph, unless even that one was needed this frame
+        if (lru.empty())
+            return -1;
+        unsigned int codepoint = lru.back();
+        int cell = entries[codepoint].Cell;
+        if (cellFrame[cell] == frame)
+            return -1;
+        lru.pop_back();
+        entries.erase(codepoint);
+        Evictions++;
+        return cell;
+    }
+
+    void addPage()
+    {
+        if (CellsPerRow == 0)
+            return;
+        std::vector<unsigned char> clear((size_t)PageSize * PageSize, 0);
+        unsigned int texture;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, PageSize, PageSize, 0, GL_RED, GL_UNSIGNED_BYTE, &clear[0]);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        unsigned int page = (unsigned int)Pages.size();
+        Pages.push_back(texture);
+        unsigned int cellsPerPage = CellsPerRow * CellsPerRow;
+        cellCodepoint.resize((page + 1) * cellsPerPage, 0);
+        cellFrame.resize((page + 1) * cellsPerPage, 0);
+        // hand out the cells in order
+        for (unsigned int i = cellsPerPage; i > 0; --i)
+            freeCells.push_back((int)(page * cellsPerPage + i - 1));
+    }
+
+    // in-place squared Euclidean distance transform of a grid holding 0 for feature texels and infinity elsewhere:
+    // the 1D transform over every column, then over every row
+    static void distanceTransform(std::vector<float> &grid, int width, int height)
+    {
+        int size = std::max(width, height);
+        std::vector<float> f(size), d(size), z(size + 1);
+        std::vector<int> v(size);
+        for (int x = 0; x < width; ++x)
+        {
+            for (int y = 0; y < height; ++y)
+                f[y] = grid[(size_t)y * width + x];
+            distanceTransform1D(f, d, v, z, height);
+            for (int y = 0; y < height; ++y)
+                grid[(size_t)y * width + x] = d[y];
+        }
+        for (int y = 0; y < height; ++y)
+        {
+            for (int x = 0; x < width; ++x)
+                f[x] = grid[(size_t)y * width + x];
+            distanceTransform1D(f, d, v, z, width);
+            for (int x = 0; x < width; ++x)
+                grid[(size_t)y * width + x] = d[x];
+        }
+    }
+
+    // lower envelope of the parabolas rooted at every sample
+    static void distanceTransform1D(const std::vector<float> &f, std::vector<float> &d, std::vector<int> &v, std::vector<float> &z, int n)
+    {
+        const float infinity = 1e20f;
+        int k = 0;
+        v[0] = 0;
+        z[0] = -infinity;
+        z[1] = infinity;
+        for (int q = 1; q < n; ++q)
+        {
+            float s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2.0f * q - 2.0f * v[k]);
+            while (s <= z[k])
+            {
+                k--;
+                s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2.0f * q - 2.0f * v[k]);
+            }
+            k++;
+            v[k] = q;
+            z[k] = s;
+            z[k + 1] = infinity;
+        }
+        k = 0;
+        for (int q = 0; q < n; ++q)
+        {
+            while (z[k + 1] < q)
+                k++;
+            d[q] = (q - v[k]) * (q - v[k]) + f[v[k]];
+        }
+    }
+};
+#endif
@@ -0,0 +1,82 @@
+#ifndef GPU_TIMER_H
+#define GPU_TIMER_H
+
+#include <glad/glad.h>
+
+// Times a span of GPU commands once per frame without stalling the pipeline. A GL_TIME_ELAPSED query only has its
+// result once the GPU has executed the commands, usually a frame or two after they were issued, so asking for it right
+// away makes the CPU wait for the GPU to drain. Instead a ring of queries is kept in flight, and each frame only the
+// results that have already arrived (GL_QUERY_RESULT_AVAILABLE) are collected. If all queries are still pending, that
+// frame just isn't timed. Call Begin and End around the commands; time elapsed queries can't be nested, so spans timed
+// by different timers mustn't overlap.
+class GpuTimer
+{
+public:
+    static const unsigned int Queries = 3;
+
+    // results collected since the last Reset
+    double       TotalMs;
+    unsigned int Samples;
+
+    GpuTimer() : TotalMs(0.0), Samples(0), oldest(0), pending(0), active(false)
+    {
+        glGenQueries(Queries, queries);
+    }
+    ~GpuTimer()
+    {
+        glDeleteQueries(Queries, queries);
+    }
+    GpuTimer(const GpuTimer &) = delete;
+    GpuTimer &operator=(const GpuTimer &) = delete;
+
+    void Begin()
+    {
+        collect();
+        active = pending < Queries;
+        if (active)
+            glBeginQuery(GL_TIME_ELAPSED, queries[(oldest + pending) % Queries]);
+    }
+    void End()
+    {
+        if (!active)
+            return;
+        glEndQuery(GL_TIME_ELAPSED);
+        pending++;
+        active = false;
+    }
+
+    // average of the collected results in milliseconds, 0 if none arrived yet
+    double AverageMs() const
+    {
+        return Samples > 0 ? TotalMs / Samples : 0.0;
+    }
+    void Reset()
+    {
+        TotalMs = 0.0;
+        Samples = 0;
+    }
+
+private:
+    unsigned int queries[Queries];
+    unsigned int oldest, pending;
+    bool active;
+
+    // results arrive in the order the queries were issued, so stop at the first one that hasn't
+    void collect()
+    {
+        while (pending > 0)
+        {
+            GLint available = 0;
+            glGetQueryObjectiv(queries[oldest], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available)
+                break;
+            GLuint64 elapsed = 0;
+            glGetQueryObjectui64v(queries[oldest], GL_QUERY_RESULT, &elapsed);
+            TotalMs += elapsed / 1000000.0;
+            Samples++;
+            oldest = (oldest + 1) % Queries;
+            pending--;
+        }
+    }
+};
+#endif
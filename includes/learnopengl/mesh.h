@@ -7,6 +7,7 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include <learnopengl/shader.h>
+#include <learnopengl/upload_thread.h>
 
 #include <string>
 #include <vector>
@@ -39,15 +40,20 @@ public:
     vector<Texture>      textures;
     unsigned int VAO;
 
-    // constructor
-    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures)
+    // constructor; given an upload thread (and called on it) only the buffers are created, the vertex array has to
+    // be set up on the render thread with SetupVertexArray once the upload is done
+    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures, UploadThread *uploader = nullptr)
     {
         this->vertices = vertices;
         this->indices = indices;
         this->textures = textures;
+        VAO = 0;
 
         // now that we have all the required data, set the vertex buffers and its attribute pointers.
-        setupMesh();
+        if (uploader)
+            setupBuffers(uploader);
+        else
+            setupMesh();
     }
 
     // render the mesh
@@ -88,10 +94,29 @@ public:
         glActiveTexture(GL_TEXTURE0);
     }
 
+    // creates the vertex array of a mesh whose buffers were created on an upload thread (on the render thread: vertex
+    // arrays aren't shared between contexts)
+    void SetupVertexArray()
+    {
+        glGenVertexArrays(1, &VAO);
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        setupAttributes();
+        glBindVertexArray(0);
+    }
+
 private:
     // render data 
     unsigned int VBO, EBO;
 
+    // creates the buffer objects through the upload thread's staging ring
+    void setupBuffers(UploadThread *uploader)
+    {
+        VBO = uploader->UploadBuffer(&vertices[0], vertices.size() * sizeof(Vertex));
+        EBO = uploader->UploadBuffer(&indices[0], indices.size() * sizeof(unsigned int));
+    }
+
     // initializes all the buffer objects/arrays
     void setupMesh()
     {
@@ -111,6 +136,13 @@ private:
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
         glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
 
+        setupAttributes();
+        glBindVertexArray(0);
+    }
+
+    // sets the vertex attribute pointers of the bound vertex array to the bound GL_ARRAY_BUFFER
+    void setupAttributes()
+    {
         // set the vertex attribute pointers
         // vertex Positions
         glEnableVertexAttribArray(0);	
@@ -127,8 +159,6 @@ private:
         // vertex bitangent
         glEnableVertexAttribArray(4);
         glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
-
-        glBindVertexArray(0);
     }
 };
 #endif
@@ -0,0 +1,321 @@
+#ifndef MIPMAP_GENERATOR_H
+#define MIPMAP_GENERATOR_H
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Filters for downsampling
+enum MipFilter {
+    MIP_FILTER_BOX,     // average of 2x2 pixels: fast, blurs the least but aliases
+    MIP_FILTER_KAISER,  // windowed sinc (Kaiser window, 3 lobes): sharp with little ringing
+    MIP_FILTER_LANCZOS  // Lanczos-3: sharpest, rings a little around hard edges
+};
+
+// An image level: 8 bits per channel, rows tightly packed
+struct MipLevel
+{
+    unsigned int Width, Height;
+    std::vector<unsigned char> Data;
+};
+
+// Generates mip chains on the CPU. Unlike glGenerateMipmap (a box filter in whatever space the driver picks) sRGB
+// images are filtered in linear space: 8-bit sRGB is converted to linear floats, every level is filtered from the
+// float level above it (so rounding doesn't accumulate) and only converted back to 8-bit sRGB for output. Alpha is
+// always linear, and color is weighted by alpha while filtering so transparent texels don't bleed into their
+// neighbours. Filtering is separable (rows, then columns) with the weights computed once per level; both passes are
+// split over threads by rows, and the column pass runs over whole rows at once, which compilers vectorize.
+class MipmapGenerator
+{
+public:
+    MipFilter Filter;
+    // whether the color channels are sRGB encoded
+    bool SRGB;
+    // sample across the edges as GL_REPEAT would (for tiling textures) instead of clamping
+    bool Wrap;
+    // worker threads (0: one per core)
+    unsigned int Threads;
+
+    MipmapGenerator(MipFilter filter = MIP_FILTER_KAISER, bool srgb = false, bool wrap = false, unsigned int threads = 0)
+        : Filter(filter), SRGB(srgb), Wrap(wrap), Threads(threads)
+    {
+    }
+
+    // the full mip chain of an 8-bit image with 1 to 4 channels (with 2 and 4 the last one is alpha), starting with a
+    // copy of the image itself
+    std::vector<MipLevel> Generate(const unsigned char *data, unsigned int width, unsigned int height, unsigned int channels) const
+    {
+        std::vector<MipLevel> levels(1);
+        levels[0].Width = width;
+        levels[0].Height = height;
+        levels[0].Data.assign(data, data + (size_t)width * height * channels);
+        bool alpha = channels == 2 || channels == 4;
+        unsigned int colors = alpha ? channels - 1 : channels;
+
+        // to linear floats, color premultiplied by alpha
+        std::vector<float> current((size_t)width * height * channels);
+        const float *toLinear = srgbToLinearTable();
+        parallelFor(height, [&](unsigned int y)
+        {
+            const unsigned char *in = data + (size_t)y * width * channels;
+            float *out = &current[(size_t)y * width * channels];
+            for (unsigned int x = 0; x < width; ++x, in += channels, out += channels)
+            {
+                float a = alpha ? in[colors] / 255.0f : 1.0f;
+                for (unsigned int c = 0; c < colors; ++c)
+                    out[c] = (SRGB ? toLinear[in[c]] : in[c] / 255.0f) * a;
+                if (alpha)
+                    out[colors] = a;
+            }
+        });
+
+        std::vector<float> rows, next;
+        while (width > 1 || height > 1)
+        {
+            unsigned int w = std::max(width / 2, 1u), h = std::max(height / 2, 1u);
+            Weights horizontal = weights(width, w), vertical = weights(height, h);
+            // 1. filter each row: width x height -> w x height
+            rows.resize((size_t)w * height * channels);
+            parallelFor(height, [&](unsigned int y)
+            {
+                const float *in = &current[(size_t)y * width * channels];
+                float *out = &rows[(size_t)y * w * channels];
+                switch (channels)
+                {
+                case 1:  filterRow<1>(in, out, w, horizontal); break;
+                case 2:  filterRow<2>(in, out, w, horizontal); break;
+                case 3:  filterRow<3>(in, out, w, horizontal); break;
+                default: filterRow<4>(in, out, w, horizontal); break;
+                }
+            });
+            // 2. filter the columns, a whole output row at a time: w x height -> w x h
+            next.resize((size_t)w * h * channels);
+            size_t stride = (size_t)w * channels;
+            parallelFor(h, [&](unsigned int y)
+            {
+                float *out = &next[(size_t)y * stride];
+                std::fill(out, out + stride, 0.0f);
+                const int *taps = &vertical.Taps[(size_t)y * vertical.Size];
+                const float *weight = &vertical.Values[(size_t)y * vertical.Size];
+                for (unsigned int t = 0; t < vertical.Size; ++t)
+                {
+                    const float *in = &rows[(size_t)taps[t] * stride];
+                    float wt = weight[t];
+                    for (size_t i = 0; i < stride; ++i)
+                        out[i] += in[i] * wt;
+                }
+            });
+            current.swap(next);
+            width = w;
+            height = h;
+
+            // back to 8 bits
+            levels.push_back(MipLevel());
+            MipLevel &level = levels.back();
+            level.Width = width;
+            level.Height = height;
+            level.Data.resize((size_t)width * height * channels);
+            const unsigned char *toSRGB = linearToSRGBTable();
+            parallelFor(height, [&](unsigned int y)
+            {
+                const float *in = &current[(size_t)y * width * channels];
+                unsigned char *out = &level.Data[(size_t)y * width * channels];
+                for (unsigned int x = 0; x < width; ++x, in += channels, out += channels)
+                {
+                    // negative lobes can push values out of range
+                    float a = alpha ? std::min(std::max(in[colors], 0.0f), 1.0f) : 1.0f;
+                    float unpremultiply = a > 0.0f ? 1.0f / a : 0.0f;
+                    for (unsigned int c = 0; c < colors; ++c)
+                    {
+                        float value = std::min(std::max(in[c] * unpremultiply, 0.0f), 1.0f);
+                        out[c] = SRGB ? toSRGB[(int)(value * 65535.0f + 0.5f)] : (unsigned char)(value * 255.0f + 0.5f);
+                    }
+                    if (alpha)
+                        out[colors] = (unsigned char)(a * 255.0f + 0.5f);
+                }
+            });
+        }
+        return levels;
+    }
+
+    // uploads the levels to the bound GL_TEXTURE_2D
+    static void Upload(const std::vector<MipLevel> &levels, GLint internalFormat, GLenum format)
+    {
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        for (size_t i = 0; i < levels.size(); ++i)
+            glTexImage2D(GL_TEXTURE_2D, (GLint)i, internalFormat, levels[i].Width, levels[i].Height, 0, format, GL_UNSIGNED_BYTE, &levels[i].Data[0]);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)levels.size() - 1);
+    }
+
+    static float Kernel(MipFilter filter, float x)
+    {
+        x = std::fabs(x);
+        switch (filter)
+        {
+        case MIP_FILTER_BOX:
+            return x < 0.5f ? 1.0f : 0.0f;
+        case MIP_FILTER_LANCZOS:
+            return x < 3.0f ? sinc(x) * sinc(x / 3.0f) : 0.0f;
+        default:
+        {
+            // sinc windowed by a Kaiser window of half width 3 and alpha 4
+            const float width = 3.0f, alpha = 4.0f;
+            if (x >= width)
+                return 0.0f;
+            float t = x / width;
+            return sinc(x) * (float)(besselI0(alpha * std::sqrt(1.0f - t * t)) / besselI0(alpha));
+        }
+        }
+    }
+
+    static float Radius(MipFilter filter)
+    {
+        return filter == MIP_FILTER_BOX ? 0.5f : 3.0f;
+    }
+
+private:
+    // per output pixel the source pixels it takes and their (normalized) weights; all pixels take the same number
+    struct Weights
+    {
+        unsigned int Size;
+        std::vector<int> Taps;
+        std::vector<float> Values;
+    };
+
+    // one row through the horizontal filter (the channel count is a template argument so the loops unroll)
+    template <unsigned int Channels>
+    static void filterRow(const float *in, float *out, unsigned int width, const Weights &weights)
+    {
+        for (unsigned int x = 0; x < width; ++x, out += Channels)
+        {
+            float sum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+            const int *taps = &weights.Taps[(size_t)x * weights.Size];
+            const float *weight = &weights.Values[(size_t)x * weights.Size];
+            for (unsigned int t = 0; t < weights.Size; ++t)
+            {
+                const float *pixel = in + (size_t)taps[t] * Channels;
+                for (unsigned int c = 0; c < Channels; ++c)
+                    sum[c] += pixel[c] * weight[t];
+            }
+            for (unsigned int c = 0; c < Channels; ++c)
+                out[c] = sum[c];
+        }
+    }
+
+    Weights weights(unsigned int source, unsigned int target) const
+    {
+        // the kernel is defined in output pixels: widen it by the scale in source pixels
+        float scale = (float)source / target;
+        float radius = Radius(Filter) * scale;
+        Weights result;
+        result.Size = (unsigned int)std::ceil(radius * 2.0f) + 1;
+        result.Taps.resize((size_t)target * result.Size);
+        result.Values.resize((size_t)target * result.Size);
+        for (unsigned int i = 0; i < target; ++i)
+        {
+            float center = (i + 0.5f) * scale;
+            int first = (int)std::floor(center - radius + 0.5f);
+            float total = 0.0f;
+            for (unsigned int t = 0; t < result.Size; ++t)
+            {
+                int tap = first + (int)t;
+                float weight = Kernel(Filter, (tap + 0.5f - center) / scale);
+                if (Wrap)
+                    tap = ((tap % (int)source) + (int)source) % (int)source;
+                else
+                    tap = std::min(std::max(tap, 0), (int)source - 1);
+                result.Taps[(size_t)i * result.Size + t] = tap;
+                result.Values[(size_t)i * result.Size + t] = weight;
+                total += weight;
+            }
+            for (unsigned int t = 0; t < result.Size; ++t)
+                result.Values[(size_t)i * result.Size + t] /= total;
+        }
+        return result;
+    }
+
+    template <typename Function>
+    void parallelFor(unsigned int count, Function function) const
+    {
+        unsigned int threads = Threads != 0 ? Threads : std::max(std::thread::hardware_concurrency(), 1u);
+        // rows come in chunks so small levels aren't worth waking threads up for
+        const unsigned int chunk = 16;
+        threads = std::min(threads, (count + chunk - 1) / chunk);
+        std::atomic<unsigned int> next(0);
+        auto work = [&]()
+        {
+            for (unsigned int start = next.fetch_add(chunk); start < count; start = next.fetch_add(chunk))
+                for (unsigned int i = start; i < std::min(start + chunk, count); ++i)
+                    function(i);
+        };
+        std::vector<std::thread> workers;
+        for (unsigned int i = 1; i < threads; ++i)
+            workers.push_back(std::thread(work));
+        work();
+        for (std::thread &worker : workers)
+            worker.join();
+    }
+
+    static float sinc(float x)
+    {
+        if (x < 1e-5f)
+            return 1.0f;
+        x *= 3.14159265358979f;
+        return std::sin(x) / x;
+    }
+
+    // modified Bessel function of the first kind, order 0
+    static double besselI0(double x)
+    {
+        double sum = 1.0, term = 1.0;
+        for (int k = 1; k < 32; ++k)
+        {
+            term *= (x / (2.0 * k)) * (x / (2.0 * k));
+            sum += term;
+            if (term < sum * 1e-12)
+                break;
+        }
+        return sum;
+    }
+
+    static const float *srgbToLinearTable()
+    {
+        static std::vector<float> table;
+        static std::once_flag once;
+        std::call_once(once, []()
+        {
+            table.resize(256);
+            for (int i = 0; i < 256; ++i)
+            {
+                float c = i / 255.0f;
+                table[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+            }
+        });
+        return &table[0];
+    }
+
+    // indexed by linear value * 65535: fine enough for the steep start of the sRGB curve
+    static const unsigned char *linearToSRGBTable()
+    {
+        static std::vector<unsigned char> table;
+        static std::once_flag once;
+        std::call_once(once, []()
+        {
+            table.resize(65536);
+            for (int i = 0; i < 65536; ++i)
+            {
+                float c = i / 65535.0f;
+                float s = c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+                table[i] = (unsigned char)(s * 255.0f + 0.5f);
+            }
+        });
+        return &table[0];
+    }
+};
+#endif
@@ -12,6 +12,10 @@
 
 #include <learnopengl/mesh.h>
 #include <learnopengl/shader.h>
+#include <learnopengl/compressed_texture.h>
+#include <learnopengl/mipmap_generator.h>
+#include <learnopengl/texture_streamer.h>
+#include <learnopengl/upload_thread.h>
 
 #include <string>
 #include <fstream>
@@ -21,7 +25,7 @@
 #include <vector>
 using namespace std;
 
-unsigned int TextureFromFile(const char *path, const string &directory, bool gamma = false);
+unsigned int TextureFromFile(const char *path, const string &directory, bool gamma = false, UploadThread *uploader = nullptr);
 
 class Model 
 {
@@ -31,21 +35,60 @@ public:
     vector<Mesh>    meshes;
     string directory;
     bool gammaCorrection;
+    // when set, baked textures are streamed by it instead of loaded whole
+    TextureStreamer *streamer;
+    // when set, the model is loaded on it in the background (without streaming)
+    UploadThread *uploader;
+    // false until a model loaded in the background is handed over to the render thread: until then it isn't drawn,
+    // and meshes and textures_loaded must not be touched
+    bool ready;
 
     // constructor, expects a filepath to a 3D model.
-    Model(string const &path, bool gamma = false) : gammaCorrection(gamma)
+    Model(string const &path, bool gamma = false, TextureStreamer *streamer = nullptr, UploadThread *uploader = nullptr)
+        : gammaCorrection(gamma), streamer(streamer), uploader(uploader), ready(false)
     {
-        loadModel(path);
+        if (uploader)
+            loadModelAsync(path);
+        else
+        {
+            loadModel(path);
+            ready = true;
+        }
     }
 
     // draws the model, and thus all its meshes
     void Draw(Shader &shader)
     {
+        if (!ready)
+            return;
         for(unsigned int i = 0; i < meshes.size(); i++)
             meshes[i].Draw(shader);
     }
+
+    // streaming feedback: requests the mip levels the model's textures need when it covers about the given number of
+    // pixels on screen (see TextureStreamer::ScreenSize)
+    void RequestTextures(float pixels)
+    {
+        if (!streamer || uploader)
+            return;
+        for(unsigned int i = 0; i < textures_loaded.size(); i++)
+            streamer->RequestScreenSize(textures_loaded[i].id, pixels);
+    }
     
 private:
+    // loads the model on the upload thread, buffers and textures included; once the GPU has them the render thread
+    // creates the vertex arrays and the model is ready. The model must stay where it is until then.
+    void loadModelAsync(string const &path)
+    {
+        uploader->Run([this, path]() { loadModel(path); },
+                      [this]()
+                      {
+                          for(unsigned int i = 0; i < meshes.size(); i++)
+                              meshes[i].SetupVertexArray();
+                          ready = true;
+                      });
+    }
+
     // loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
     void loadModel(string const &path)
     {
@@ -165,7 +208,7 @@ private:
         textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
         
         // return a mesh object created from the extracted mesh data
-        return Mesh(vertices, indices, textures);
+        return Mesh(vertices, indices, textures, uploader);
     }
 
     // checks all material textures of a given type and loads the textures if they're not loaded yet.
@@ -191,7 +234,12 @@ private:
             if(!skip)
             {   // if texture hasn't been loaded already, load it
                 Texture texture;
-                texture.id = TextureFromFile(str.C_Str(), this->directory);
+                // stream the texture if it was baked, otherwise load it whole (the streamer isn't thread-safe, so not on
+                // an upload thread)
+                string baked = streamer && !uploader ? BakedTexturePath(this->directory + '/' + str.C_Str()) : string();
+                texture.id = !baked.empty() ? streamer->Add(baked) : 0;
+                if (texture.id == 0)
+                    texture.id = TextureFromFile(str.C_Str(), this->directory, false, uploader);
                 texture.type = typeName;
                 texture.path = str.C_Str();
                 textures.push_back(texture);
@@ -203,13 +251,37 @@ private:
 };
 
 
-unsigned int TextureFromFile(const char *path, const string &directory, bool gamma)
+unsigned int TextureFromFile(const char *path, const string &directory, bool gamma, UploadThread *uploader)
 {
     string filename = string(path);
     filename = directory + '/' + filename;
 
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
+    // prefer a texture baked by the texture baker: compressed, with its mipmaps, oriented the way stb_image would load
+    // the original (flipped in place if it was baked the other way up, skipped if it can't be or if the context can't
+    // sample its format)
+    string baked = BakedTexturePath(filename);
+    CompressedImage image;
+    if (!baked.empty() && ReadCompressedImage(baked, image) && !image.Levels.empty() && CompressedFormatSupported(image.Format) &&
+        OrientCompressedImage(image, StbiFlipsVertically()))
+    {
+        unsigned int textureID;
+        // through the upload thread's staging buffers when loading on it
+        if (uploader)
+            textureID = uploader->UploadTexture(image);
+        else
+        {
+            glGenTextures(1, &textureID);
+            UploadCompressedImage(textureID, image);
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, image.Levels.size() > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        return textureID;
+    }
+
+    unsigned int textureID = 0;
 
     int width, height, nrComponents;
     unsigned char *data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
@@ -223,14 +295,23 @@ unsigned int TextureFromFile(const char *path, const string &directory, bool gam
         else if (nrComponents == 4)
             format = GL_RGBA;
 
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
+        // sRGB (gamma) color textures are filtered in linear space
+        MipmapGenerator mipmaps(MIP_FILTER_KAISER, gamma && nrComponents >= 3, true);
+        vector<MipLevel> levels = mipmaps.Generate(data, width, height, nrComponents);
+        if (uploader)
+            textureID = uploader->UploadTexture(levels, format, format);
+        else
+        {
+            glGenTextures(1, &textureID);
+            glBindTexture(GL_TEXTURE_2D, textureID);
+            MipmapGenerator::Upload(levels, format, format);
+        }
 
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glBindTexture(GL_TEXTURE_2D, 0);
 
         stbi_image_free(data);
     }
@@ -238,6 +319,7 @@ unsigned int TextureFromFile(const char *path, const string &directory, bool gam
     {
         std::cout << "Texture failed to load at path: " << path << std::endl;
         stbi_image_free(data);
+        glGenTextures(1, &textureID);
     }
 
     return textureID;
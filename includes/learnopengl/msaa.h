@@ -0,0 +1,243 @@
+#ifndef MSAA_H
+#define MSAA_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/shader.h>
+
+#include <algorithm>
+#include <iostream>
+
+// Defines the ways a multisampled color buffer can be resolved into a regular texture
+enum MSAA_Resolve {
+    // fixed-function glBlitFramebuffer: a plain box filter over the samples, in whatever range the buffer holds
+    RESOLVE_BLIT,
+    // custom resolve shader reading the individual samples (texelFetch on a sampler2DMS), e.g. to weight
+    // HDR samples before averaging so bright samples don't dominate edges
+    RESOLVE_SHADER
+};
+
+// Multisampled offscreen render target with a configurable sample count (clamped to what every attachment supports:
+// GL_MAX_COLOR_TEXTURE_SAMPLES, and GL_MAX_DEPTH_TEXTURE_SAMPLES or GL_MAX_SAMPLES for depth) and a single-sampled
+// resolve target. The color buffer is a multisample texture so it can be resolved by a shader;
+// depth is a renderbuffer unless something consumes it, in which case it's a multisample texture that gets
+// resolved (blitted) alongside the color buffer. Without a depth consumer the depth resolve is skipped entirely.
+class MultisampleFramebuffer
+{
+public:
+    unsigned int Width, Height;
+    unsigned int Samples;
+    GLenum ColorFormat;
+    bool ResolveDepth;
+    // the multisampled framebuffer to render into
+    unsigned int FBO;
+    // resolved (single-sampled) color and (if requested) depth textures
+    unsigned int ResolvedFBO;
+    unsigned int ResolvedColor;
+    unsigned int ResolvedDepth;
+
+    MultisampleFramebuffer(unsigned int width, unsigned int height, unsigned int samples, GLenum colorFormat = GL_RGBA16F, bool resolveDepth = false)
+        : Width(width), Height(height), Samples(samples), ColorFormat(colorFormat), ResolveDepth(resolveDepth),
+          FBO(0), ResolvedFBO(0), ResolvedColor(0), ResolvedDepth(0), colorMS(0), depthMS(0), quadVAO(0), quadVBO(0)
+    {
+        // the color buffer is a multisample texture; depth is a multisample texture when resolved, a renderbuffer
+        // otherwise
+        GLint maxSamples = 1, colorSamples = 1, depthSamples = 1;
+        glGetIntegerv(GL_MAX_SAMPLES, &maxSamples);
+        glGetIntegerv(GL_MAX_COLOR_TEXTURE_SAMPLES, &colorSamples);
+        if (ResolveDepth)
+            glGetIntegerv(GL_MAX_DEPTH_TEXTURE_SAMPLES, &depthSamples);
+        else
+            depthSamples = maxSamples;
+        maxSamples = std::min(maxSamples, std::min(colorSamples, depthSamples));
+        if (Samples > (unsigned int)maxSamples)
+        {
+            std::cout << "MSAA: " << Samples << "x not supported, falling back to " << maxSamples << "x" << std::endl;
+            Samples = maxSamples;
+        }
+        if (Samples < 1)
+            Samples = 1;
+        create();
+    }
+    ~MultisampleFramebuffer()
+    {
+        destroy();
+    }
+
+    // binds the multisampled framebuffer for rendering
+    void Bind()
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glViewport(0, 0, Width, Height);
+    }
+
+    // resolves the multisampled buffers into ResolvedColor (and ResolvedDepth if requested). With RESOLVE_SHADER
+    // the given shader is run over a screen-filling quad with the multisampled color texture bound to unit 0
+    // (uniform 'screenTextureMS') and the sample count in the 'samples' uniform.
+    void Resolve(MSAA_Resolve mode, Shader *resolveShader = nullptr)
+    {
+        if (mode == RESOLVE_SHADER && resolveShader != nullptr)
+        {
+            glBindFramebuffer(GL_FRAMEBUFFER, ResolvedFBO);
+            glViewport(0, 0, Width, Height);
+            GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+            glDisable(GL_DEPTH_TEST);
+            resolveShader->use();
+            resolveShader->setInt("screenTextureMS", 0);
+            resolveShader->setInt("samples", Samples);
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, colorMS);
+            renderQuad();
+            glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, 0);
+            if (depthTest)
+                glEnable(GL_DEPTH_TEST);
+        }
+        else
+        {
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, FBO);
+            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, ResolvedFBO);
+            glBlitFramebuffer(0, 0, Width, Height, 0, 0, Width, Height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        }
+        // depth can't be resolved by averaging; blit picks a single sample, which is what depth consumers expect
+        if (ResolveDepth)
+        {
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, FBO);
+            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, ResolvedFBO);
+            glBlitFramebuffer(0, 0, Width, Height, 0, 0, Width, Height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    // estimated GPU memory of all attachments (multisampled and resolved) in bytes
+    size_t MemoryBytes() const
+    {
+        size_t pixels = (size_t)Width * Height;
+        size_t colorBytes = bytesPerPixel(ColorFormat);
+        size_t bytes = pixels * colorBytes * Samples + pixels * colorBytes; // multisampled + resolved color
+        bytes += pixels * 4 * Samples;                                       // depth24/stencil8
+        if (ResolveDepth)
+            bytes += pixels * 4;
+        return bytes;
+    }
+
+private:
+    unsigned int colorMS, depthMS;
+    unsigned int quadVAO, quadVBO;
+
+    void create()
+    {
+        // multisampled framebuffer
+        glGenFramebuffers(1, &FBO);
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glGenTextures(1, &colorMS);
+        glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, colorMS);
+        glTexImage2DMultisample(GL_TEXTURE_2D_MULTISAMPLE, Samples, ColorFormat, Width, Height, GL_TRUE);
+        glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, 0);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D_MULTISAMPLE, colorMS, 0);
+        if (ResolveDepth)
+        {
+            // depth is needed after the resolve: keep it in a texture we can blit from
+            glGenTextures(1, &depthMS);
+            glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, depthMS);
+            glTexImage2DMultisample(GL_TEXTURE_2D_MULTISAMPLE, Samples, GL_DEPTH24_STENCIL8, Width, Height, GL_TRUE);
+            glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, 0);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D_MULTISAMPLE, depthMS, 0);
+        }
+        else
+        {
+            // depth is only used for depth testing: a renderbuffer is enough and never gets resolved
+            glGenRenderbuffers(1, &depthMS);
+            glBindRenderbuffer(GL_RENDERBUFFER, depthMS);
+            glRenderbufferStorageMultisample(GL_RENDERBUFFER, Samples, GL_DEPTH24_STENCIL8, Width, Height);
+            glBindRenderbuffer(GL_RENDERBUFFER, 0);
+            glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthMS);
+        }
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "ERROR::FRAMEBUFFER:: Multisampled framebuffer is not complete!" << std::endl;
+
+        // resolve framebuffer
+        glGenFramebuffers(1, &ResolvedFBO);
+        glBindFramebuffer(GL_FRAMEBUFFER, ResolvedFBO);
+        glGenTextures(1, &ResolvedColor);
+        glBindTexture(GL_TEXTURE_2D, ResolvedColor);
+        glTexImage2D(GL_TEXTURE_2D, 0, ColorFormat, Width, Height, 0, GL_RGBA, GL_FLOAT, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, ResolvedColor, 0);
+        if (ResolveDepth)
+        {
+            glGenTextures(1, &ResolvedDepth);
+            glBindTexture(GL_TEXTURE_2D, ResolvedDepth);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH24_STENCIL8, Width, Height, 0, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, NULL);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, ResolvedDepth, 0);
+        }
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "ERROR::FRAMEBUFFER:: Resolve framebuffer is not complete!" << std::endl;
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    void destroy()
+    {
+        glDeleteFramebuffers(1, &FBO);
+        glDeleteFramebuffers(1, &ResolvedFBO);
+        glDeleteTextures(1, &colorMS);
+        glDeleteTextures(1, &ResolvedColor);
+        if (ResolveDepth)
+        {
+            glDeleteTextures(1, &depthMS);
+            glDeleteTextures(1, &ResolvedDepth);
+        }
+        else
+            glDeleteRenderbuffers(1, &depthMS);
+        if (quadVAO != 0)
+        {
+            glDeleteVertexArrays(1, &quadVAO);
+            glDeleteBuffers(1, &quadVBO);
+        }
+    }
+
+    static size_t bytesPerPixel(GLenum format)
+    {
+        switch (format)
+        {
+        case GL_RGBA16F: return 8;
+        case GL_RGB16F:  return 6;
+        case GL_RGBA32F: return 16;
+        case GL_R11F_G11F_B10F: return 4;
+        default:         return 4;
+        }
+    }
+
+    // renders a screen-filling quad in NDC
+    void renderQuad()
+    {
+        if (quadVAO == 0)
+        {
+            float quadVertices[] = {
+                // positions   // texCoords
+                -1.0f,  1.0f,  0.0f, 1.0f,
+                -1.0f, -1.0f,  0.0f, 0.0f,
+                 1.0f,  1.0f,  1.0f, 1.0f,
+                 1.0f, -1.0f,  1.0f, 0.0f,
+            };
+            glGenVertexArrays(1, &quadVAO);
+            glGenBuffers(1, &quadVBO);
+            glBindVertexArray(quadVAO);
+            glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
+            glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), &quadVertices, GL_STATIC_DRAW);
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
+            glEnableVertexAttribArray(1);
+            glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
+        }
+        glBindVertexArray(quadVAO);
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+        glBindVertexArray(0);
+    }
+};
+#endif
@@ -0,0 +1,97 @@
+#ifndef RADIX_SORT_H
+#define RADIX_SORT_H
+
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <vector>
+
+// LSD radix sort of 32-bit keys carrying a 32-bit payload (usually an index into the array that is being sorted).
+// Sorting is stable, runs in 4 passes of 8 bits each and skips passes in which every key shares the same digit.
+// The scratch vectors are kept by the caller so sorting every frame doesn't allocate.
+class RadixSorter
+{
+public:
+    std::vector<uint32_t> Keys;
+    std::vector<uint32_t> Values;
+
+    // converts a float into a key whose unsigned ordering matches the float ordering (negative values included)
+    static uint32_t FloatToKey(float value)
+    {
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        uint32_t mask = (bits & 0x80000000u) ? 0xFFFFFFFFu : 0x80000000u;
+        return bits ^ mask;
+    }
+
+    void Clear()
+    {
+        Keys.clear();
+        Values.clear();
+    }
+    void Push(uint32_t key, uint32_t value)
+    {
+        Keys.push_back(key);
+        Values.push_back(value);
+    }
+
+    // sorts Keys (and Values alongside) in ascending order
+    void Sort()
+    {
+        size_t count = Keys.size();
+        if (count < 2)
+            return;
+        keysTemp.resize(count);
+        valuesTemp.resize(count);
+
+        // build all 4 histograms in a single sweep over the keys
+        uint32_t histograms[4][256];
+        std::memset(histograms, 0, sizeof(histograms));
+        for (size_t i = 0; i < count; ++i)
+        {
+            uint32_t key = Keys[i];
+            histograms[0][key & 0xFF]++;
+            histograms[1][(key >> 8) & 0xFF]++;
+            histograms[2][(key >> 16) & 0xFF]++;
+            histograms[3][key >> 24]++;
+        }
+
+        uint32_t *srcKeys = &Keys[0], *srcValues = &Values[0];
+        uint32_t *dstKeys = &keysTemp[0], *dstValues = &valuesTemp[0];
+        for (unsigned int pass = 0; pass < 4; ++pass)
+        {
+            unsigned int shift = pass * 8;
+            uint32_t *histogram = histograms[pass];
+            // a digit shared by all keys leaves the order unchanged
+            if (histogram[(srcKeys[0] >> shift) & 0xFF] == count)
+                continue;
+            // exclusive prefix sum turns the counts into output offsets
+            uint32_t offset = 0;
+            for (unsigned int d = 0; d < 256; ++d)
+            {
+                uint32_t c = histogram[d];
+                histogram[d] = offset;
+                offset += c;
+            }
+            for (size_t i = 0; i < count; ++i)
+            {
+                uint32_t destination = histogram[(srcKeys[i] >> shift) & 0xFF]++;
+                dstKeys[destination] = srcKeys[i];
+                dstValues[destination] = srcValues[i];
+            }
+            std::swap(srcKeys, dstKeys);
+            std::swap(srcValues, dstValues);
+        }
+        // after an odd number of scatter passes the result lives in the scratch buffers
+        if (srcKeys != &Keys[0])
+        {
+            Keys.swap(keysTemp);
+            Values.swap(valuesTemp);
+        }
+    }
+
+private:
+    std::vector<uint32_t> keysTemp;
+    std::vector<uint32_t> valuesTemp;
+};
+#endif
@@ -0,0 +1,470 @@
+#ifndef RENDER_GRAPH_H
+#define RENDER_GRAPH_H
+
+#include <glad/glad.h>
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <algorithm>
+#include <iostream>
+
+// Describes a 2D render target owned (or imported) by the render graph. Two transient resources with equal
+// descriptions and non-overlapping lifetimes are aliased onto the same GL texture.
+struct RenderTargetDesc {
+    unsigned int Width;
+    unsigned int Height;
+    GLenum InternalFormat;
+    GLenum Format;
+    GLenum Type;
+    GLenum Filter;
+
+    RenderTargetDesc(unsigned int width = 0, unsigned int height = 0, GLenum internalFormat = GL_RGBA, GLenum format = GL_RGBA, GLenum type = GL_UNSIGNED_BYTE, GLenum filter = GL_LINEAR)
+        : Width(width), Height(height), InternalFormat(internalFormat), Format(format), Type(type), Filter(filter)
+    {
+    }
+
+    bool IsDepth() const
+    {
+        return Format == GL_DEPTH_COMPONENT || Format == GL_DEPTH_STENCIL;
+    }
+    bool operator==(const RenderTargetDesc &other) const
+    {
+        return Width == other.Width && Height == other.Height && InternalFormat == other.InternalFormat && Format == other.Format && Type == other.Type && Filter == other.Filter;
+    }
+    // size in bytes of a single texel as stored by the driver (estimated from the internal format)
+    unsigned int BytesPerTexel() const
+    {
+        switch (InternalFormat)
+        {
+        case GL_RED: case GL_R8:                                  return 1;
+        case GL_RG: case GL_RG8: case GL_R16F:                    return 2;
+        case GL_RGB16F:                                           return 6;
+        case GL_RGBA16F: case GL_RG32F:                           return 8;
+        case GL_RGB32F:                                           return 12;
+        case GL_RGBA32F:                                          return 16;
+        case GL_R32F: case GL_DEPTH_COMPONENT24: case GL_DEPTH_COMPONENT32F:
+        case GL_DEPTH24_STENCIL8: case GL_DEPTH_COMPONENT:        return 4;
+        default:                                                  return 4; // GL_RGB(A)8 and friends are padded to 4 bytes
+        }
+    }
+    size_t Bytes() const
+    {
+        return (size_t)Width * Height * BytesPerTexel();
+    }
+};
+
+// The kind of work a pass performs. Raster passes render into a framebuffer built from their writes; compute passes
+// write through image load/store, so anything that reads their output afterwards needs an explicit memory barrier.
+// Custom passes do their own GL work with their own framebuffers (a helper class rendering into textures it owns):
+// the graph binds, clears and attaches nothing for them, and never culls them, as their effects aren't all declared.
+enum RenderPassType {
+    RASTER_PASS,
+    COMPUTE_PASS,
+    CUSTOM_PASS
+};
+
+// A small frame graph: passes declare which resources they read and write, after which Compile() culls passes that
+// don't contribute to an output, assigns transient resources to (aliased) physical textures and builds the framebuffers.
+// Execute() then runs the surviving passes in declaration order, clearing each transient target on its first write and
+// inserting barriers after compute passes.
+class RenderGraph
+{
+public:
+    typedef std::function<void(RenderGraph &graph)> ExecuteFunc;
+
+    // handle of the default framebuffer; writing to it always keeps a pass alive
+    static const unsigned int BACKBUFFER = 0;
+
+    RenderGraph() : compiled(false)
+    {
+        // reserve slot 0 for the backbuffer so resource handles map directly onto indices
+        Resource backbuffer;
+        backbuffer.Name = "backbuffer";
+        backbuffer.Imported = true;
+        resources.push_back(backbuffer);
+    }
+    ~RenderGraph()
+    {
+        release();
+    }
+
+    // declares a transient render target; its GL texture is only valid within pass callbacks
+    unsigned int CreateTexture(const std::string &name, const RenderTargetDesc &desc)
+    {
+        Resource resource;
+        resource.Name = name;
+        resource.Desc = desc;
+        resources.push_back(resource);
+        return (unsigned int)resources.size() - 1;
+    }
+    // registers an externally owned texture; imported resources are never aliased and always count as graph outputs
+    unsigned int ImportTexture(const std::string &name, unsigned int texture, const RenderTargetDesc &desc)
+    {
+        Resource resource;
+        resource.Name = name;
+        resource.Desc = desc;
+        resource.Imported = true;
+        resource.Texture = texture;
+        resources.push_back(resource);
+        return (unsigned int)resources.size() - 1;
+    }
+    // points an imported resource at another texture, e.g. one that is ping-ponged between frames; can be called from the
+    // pass that writes it, so the passes after it see this frame's texture. Raster passes attaching it are rebuilt
+    // on the next Execute
+    void SetImportedTexture(unsigned int resource, unsigned int texture)
+    {
+        if (resources[resource].Texture == texture)
+            return;
+        resources[resource].Texture = texture;
+        for (unsigned int i = 0; i < passes.size(); ++i)
+            if (passes[i].Type == RASTER_PASS && std::find(passes[i].Writes.begin(), passes[i].Writes.end(), resource) != passes[i].Writes.end())
+                compiled = false;
+    }
+    // adds a pass in execution order. Color writes are attached in the given order (GL_COLOR_ATTACHMENT0 + i), a write to a
+    // depth target becomes the depth attachment.
+    void AddPass(const std::string &name, const std::vector<unsigned int> &reads, const std::vector<unsigned int> &writes, ExecuteFunc execute, RenderPassType type = RASTER_PASS)
+    {
+        Pass pass;
+        pass.Name = name;
+        pass.Reads = reads;
+        pass.Writes = writes;
+        pass.Execute = execute;
+        pass.Type = type;
+        passes.push_back(pass);
+        compiled = false;
+    }
+
+    // culls unused passes, computes resource lifetimes, aliases transient resources and creates GL objects
+    void Compile()
+    {
+        release();
+        cullPasses();
+        computeLifetimes();
+        allocatePhysical();
+        createFramebuffers();
+        compiled = true;
+    }
+
+    // runs all live passes
+    void Execute()
+    {
+        if (!compiled)
+            Compile();
+        GLint viewport[4];
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        for (unsigned int i = 0; i < passes.size(); ++i)
+        {
+            Pass &pass = passes[i];
+            if (pass.Culled)
+                continue;
+            if (pass.NeedsBarrier && GLAD_GL_VERSION_4_2)
+                glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_FRAMEBUFFER_BARRIER_BIT);
+            if (pass.Type == RASTER_PASS)
+            {
+                glBindFramebuffer(GL_FRAMEBUFFER, pass.FBO);
+                if (pass.FBO == 0)
+                    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+                else
+                    glViewport(0, 0, pass.Width, pass.Height);
+                if (pass.ClearMask != 0)
+                {
+                    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+                    glClear(pass.ClearMask);
+                }
+            }
+            pass.Execute(*this);
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    }
+
+    // returns the GL texture currently backing a resource (valid after Compile)
+    unsigned int GetTexture(unsigned int resource) const
+    {
+        return resources[resource].Texture;
+    }
+    bool IsCulled(const std::string &passName) const
+    {
+        for (unsigned int i = 0; i < passes.size(); ++i)
+            if (passes[i].Name == passName)
+                return passes[i].Culled;
+        return true;
+    }
+
+    // memory statistics: what every declared resource would cost with its own allocation versus the aliased allocation
+    size_t UnaliasedMemory() const
+    {
+        size_t bytes = 0;
+        for (unsigned int i = 1; i < resources.size(); ++i)
+            bytes += resources[i].Desc.Bytes();
+        return bytes;
+    }
+    size_t AliasedMemory() const
+    {
+        size_t bytes = 0;
+        for (unsigned int i = 1; i < resources.size(); ++i)
+            if (resources[i].Imported)
+                bytes += resources[i].Desc.Bytes();
+        for (unsigned int i = 0; i < physical.size(); ++i)
+            bytes += physical[i].Desc.Bytes();
+        return bytes;
+    }
+    void PrintStatistics(std::ostream &out = std::cout) const
+    {
+        unsigned int live = 0;
+        for (unsigned int i = 0; i < passes.size(); ++i)
+            if (!passes[i].Culled)
+                ++live;
+        out << "RenderGraph: " << live << "/" << passes.size() << " passes live, " << (resources.size() - 1) << " resources on " << physical.size() << " transient textures" << std::endl;
+        out << "RenderGraph: render target memory " << UnaliasedMemory() / (1024.0 * 1024.0) << " MB unaliased -> " << AliasedMemory() / (1024.0 * 1024.0) << " MB aliased" << std::endl;
+    }
+
+private:
+    struct Resource {
+        std::string Name;
+        RenderTargetDesc Desc;
+        bool Imported = false;
+        unsigned int Texture = 0;
+        int Producer = -1;      // last pass writing the resource
+        int FirstUse = -1;
+        int LastUse = -1;
+    };
+    struct Pass {
+        std::string Name;
+        std::vector<unsigned int> Reads;
+        std::vector<unsigned int> Writes;
+        ExecuteFunc Execute;
+        RenderPassType Type = RASTER_PASS;
+        bool Culled = false;
+        bool NeedsBarrier = false;
+        unsigned int RefCount = 0;
+        unsigned int FBO = 0;
+        unsigned int Width = 0, Height = 0;
+        GLbitfield ClearMask = 0;
+    };
+    struct PhysicalTexture {
+        RenderTargetDesc Desc;
+        unsigned int Texture;
+        int FreeAfter;          // last pass index using the texture
+    };
+
+    std::vector<Resource> resources;
+    std::vector<Pass> passes;
+    std::vector<PhysicalTexture> physical;
+    std::vector<unsigned int> framebuffers;
+    bool compiled;
+
+    // frees all GL objects created by a previous Compile()
+    void release()
+    {
+        for (unsigned int i = 0; i < physical.size(); ++i)
+            glDeleteTextures(1, &physical[i].Texture);
+        if (!framebuffers.empty())
+            glDeleteFramebuffers((GLsizei)framebuffers.size(), &framebuffers[0]);
+        physical.clear();
+        framebuffers.clear();
+    }
+
+    // reference-count culling over versions of resources: every write creates a new version of the resource and a read
+    // refers to the latest version written before it. A write of a resource that already has a version implicitly reads
+    // that version (the pass may only update part of it). A pass survives while one of the versions it writes is read
+    // by a surviving pass or is the final version of an imported resource (a graph output). Since each version has a
+    // single producer, a pass is released at most once per write, also in read-modify-write chains
+    void cullPasses()
+    {
+        struct Version {
+            int Producer;
+            unsigned int RefCount;
+        };
+        std::vector<Version> versions;
+        std::vector<int> latest(resources.size(), -1);
+        // per pass the versions it reads, explicitly or implicitly
+        std::vector<std::vector<int> > reads(passes.size());
+        for (unsigned int i = 0; i < passes.size(); ++i)
+        {
+            Pass &pass = passes[i];
+            pass.Culled = false;
+            // (a custom pass holds a reference of its own, so it's never released)
+            pass.RefCount = (unsigned int)pass.Writes.size() + (pass.Type == CUSTOM_PASS ? 1 : 0);
+            for (unsigned int r = 0; r < pass.Reads.size(); ++r)
+                if (latest[pass.Reads[r]] >= 0)
+                    reads[i].push_back(latest[pass.Reads[r]]);
+            for (unsigned int w = 0; w < pass.Writes.size(); ++w)
+            {
+                unsigned int resource = pass.Writes[w];
+                if (latest[resource] >= 0 && std::find(pass.Reads.begin(), pass.Reads.end(), resource) == pass.Reads.end())
+                    reads[i].push_back(latest[resource]);
+                Version version = { (int)i, 0 };
+                versions.push_back(version);
+                latest[resource] = (int)versions.size() - 1;
+            }
+            for (unsigned int r = 0; r < reads[i].size(); ++r)
+                versions[reads[i][r]].RefCount++;
+        }
+        for (unsigned int i = 0; i < resources.size(); ++i)
+            if (resources[i].Imported && latest[i] >= 0)
+                versions[latest[i]].RefCount++;
+
+        std::vector<int> unreferenced;
+        for (unsigned int v = 0; v < versions.size(); ++v)
+            if (versions[v].RefCount == 0)
+                unreferenced.push_back(v);
+        while (!unreferenced.empty())
+        {
+            int producer = versions[unreferenced.back()].Producer;
+            unreferenced.pop_back();
+            Pass &pass = passes[producer];
+            if (pass.Culled || --pass.RefCount > 0)
+                continue;
+            pass.Culled = true;
+            for (unsigned int r = 0; r < reads[producer].size(); ++r)
+                if (--versions[reads[producer][r]].RefCount == 0)
+                    unreferenced.push_back(reads[producer][r]);
+        }
+    }
+
+    // records the first and last live pass touching each resource and where barriers are needed
+    void computeLifetimes()
+    {
+        for (unsigned int i = 0; i < resources.size(); ++i)
+        {
+            resources[i].FirstUse = -1;
+            resources[i].LastUse = -1;
+            resources[i].Producer = -1;
+        }
+        for (unsigned int i = 0; i < passes.size(); ++i)
+        {
+            Pass &pass = passes[i];
+            pass.NeedsBarrier = false;
+            pass.ClearMask = 0;
+            if (pass.Culled)
+                continue;
+            for (unsigned int r = 0; r < pass.Reads.size(); ++r)
+            {
+                Resource &resource = resources[pass.Reads[r]];
+                if (resource.Producer >= 0 && passes[resource.Producer].Type == COMPUTE_PASS)
+                    pass.NeedsBarrier = true;
+                if (resource.FirstUse < 0)
+                    resource.FirstUse = i;
+                resource.LastUse = i;
+            }
+            for (unsigned int w = 0; w < pass.Writes.size(); ++w)
+            {
+                Resource &resource = resources[pass.Writes[w]];
+                // the first write of a transient resource (or of the backbuffer) starts from cleared contents
+                if (resource.FirstUse < 0 && (!resource.Imported || pass.Writes[w] == BACKBUFFER))
+                {
+                    if (pass.Writes[w] == BACKBUFFER)
+                        pass.ClearMask |= GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT;
+                    else
+                        pass.ClearMask |= resource.Desc.IsDepth() ? GL_DEPTH_BUFFER_BIT : GL_COLOR_BUFFER_BIT;
+                }
+                if (resource.FirstUse < 0)
+                    resource.FirstUse = i;
+                resource.LastUse = i;
+                resource.Producer = i;
+                if (pass.Type != RASTER_PASS)
+                    pass.ClearMask = 0;
+            }
+        }
+    }
+
+    // greedily places transient resources (in order of first use) on the first compatible texture that is free again
+    void allocatePhysical()
+    {
+        std::vector<unsigned int> order;
+        for (unsigned int i = 1; i < resources.size(); ++i)
+            if (!resources[i].Imported && resources[i].FirstUse >= 0)
+                order.push_back(i);
+        // resources are created in roughly declaration order; a stable insertion sort on first use keeps that order for ties
+        for (unsigned int i = 1; i < order.size(); ++i)
+            for (unsigned int j = i; j > 0 && resources[order[j]].FirstUse < resources[order[j - 1]].FirstUse; --j)
+                std::swap(order[j], order[j - 1]);
+
+        for (unsigned int i = 0; i < order.size(); ++i)
+        {
+            Resource &resource = resources[order[i]];
+            int slot = -1;
+            for (unsigned int p = 0; p < physical.size(); ++p)
+            {
+                if (physical[p].FreeAfter < resource.FirstUse && physical[p].Desc == resource.Desc)
+                {
+                    slot = p;
+                    break;
+                }
+            }
+            if (slot < 0)
+            {
+                PhysicalTexture texture;
+                texture.Desc = resource.Desc;
+                glGenTextures(1, &texture.Texture);
+                glBindTexture(GL_TEXTURE_2D, texture.Texture);
+                glTexImage2D(GL_TEXTURE_2D, 0, resource.Desc.InternalFormat, resource.Desc.Width, resource.Desc.Height, 0, resource.Desc.Format, resource.Desc.Type, NULL);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, resource.Desc.Filter);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, resource.Desc.Filter);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+                physical.push_back(texture);
+                slot = (int)physical.size() - 1;
+            }
+            physical[slot].FreeAfter = resource.LastUse;
+            resource.Texture = physical[slot].Texture;
+        }
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    // builds one framebuffer per live raster pass from its (physical) write targets
+    void createFramebuffers()
+    {
+        for (unsigned int i = 0; i < passes.size(); ++i)
+        {
+            Pass &pass = passes[i];
+            pass.FBO = 0;
+            if (pass.Culled || pass.Type != RASTER_PASS || pass.Writes.empty())
+                continue;
+            bool toBackbuffer = false;
+            for (unsigned int w = 0; w < pass.Writes.size(); ++w)
+                if (pass.Writes[w] == BACKBUFFER)
+                    toBackbuffer = true;
+            if (toBackbuffer)
+            {
+                if (pass.Writes.size() > 1)
+                    std::cout << "ERROR::RENDER_GRAPH: pass '" << pass.Name << "' mixes backbuffer and offscreen writes" << std::endl;
+                continue;
+            }
+
+            unsigned int fbo;
+            glGenFramebuffers(1, &fbo);
+            glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+            std::vector<GLenum> attachments;
+            for (unsigned int w = 0; w < pass.Writes.size(); ++w)
+            {
+                const Resource &resource = resources[pass.Writes[w]];
+                if (resource.Desc.IsDepth())
+                {
+                    GLenum attachment = resource.Desc.Format == GL_DEPTH_STENCIL ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT;
+                    glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, resource.Texture, 0);
+                }
+                else
+                {
+                    GLenum attachment = GL_COLOR_ATTACHMENT0 + (GLenum)attachments.size();
+                    glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, resource.Texture, 0);
+                    attachments.push_back(attachment);
+                }
+                pass.Width = resource.Desc.Width;
+                pass.Height = resource.Desc.Height;
+            }
+            if (attachments.empty())
+                glDrawBuffer(GL_NONE);
+            else
+                glDrawBuffers((GLsizei)attachments.size(), &attachments[0]);
+            if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+                std::cout << "ERROR::RENDER_GRAPH: framebuffer of pass '" << pass.Name << "' not complete!" << std::endl;
+            framebuffers.push_back(fbo);
+            pass.FBO = fbo;
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+};
+#endif
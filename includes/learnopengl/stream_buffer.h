@@ -0,0 +1,200 @@
+#ifndef STREAM_BUFFER_H
+#define STREAM_BUFFER_H
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+// A piece of a StreamBuffer to write data for the GPU into
+struct StreamAllocation
+{
+    void         *Data;   // where to write; nullptr if the buffer couldn't be mapped
+    unsigned int  Buffer; // the buffer to bind for drawing
+    GLintptr      Offset; // where Data starts in Buffer
+    GLsizeiptr    Size;
+};
+
+// A ring buffer for data the CPU writes every frame (vertices, instance attributes, uniform blocks). The buffer is
+// split into regions, usually one per frame in flight: allocations are handed out from the current region, and when
+// it's retired (at EndFrame, or when it's full) a fence is put behind the draws that read from it. The ring only
+// waits on that fence when it comes back around to the region, which doesn't happen unless the GPU is a whole ring
+// behind. With GL 4.4 (or ARB_buffer_storage) the buffer is mapped persistently and coherently once, so allocating
+// is pointer arithmetic. Otherwise each allocation is mapped unsynchronized and the whole buffer is orphaned when the
+// ring wraps; either way the driver never has to sync with the GPU behind our back.
+// One allocation is in use at a time: write it, Commit, and issue the draws that read it before allocating again.
+class StreamBuffer
+{
+public:
+    unsigned int Buffer;
+    // size of a region; grows when a single allocation doesn't fit
+    GLsizeiptr   RegionSize;
+    unsigned int Regions;
+    // whether the buffer is persistently mapped, otherwise it's orphaned when the ring wraps
+    bool         Persistent;
+    // statistics since construction
+    unsigned int       Waits;     // times a region was still read by the GPU when the ring came back to it
+    unsigned int       Grows;     // times an allocation didn't fit a region
+    unsigned long long Allocated; // bytes handed out
+
+    StreamBuffer(GLsizeiptr regionSize = 1 << 20, unsigned int regions = 3, bool persistent = true)
+        : Buffer(0), RegionSize(regionSize), Regions(std::max(regions, 1u)), Waits(0), Grows(0), Allocated(0),
+          mapped(nullptr), open(false), region(0), head(0)
+    {
+        // persistent mapping needs glBufferStorage, which glad only loads when the context supports it
+        Persistent = persistent && glBufferStorage != nullptr;
+        create();
+    }
+    ~StreamBuffer()
+    {
+        release();
+    }
+
+    // bytes from the current region, with the offset in the buffer a multiple of alignment (the vertex stride, or
+    // GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT for uniform blocks; it doesn't have to be a power of two)
+    StreamAllocation Allocate(GLsizeiptr bytes, GLsizeiptr alignment = 16)
+    {
+        Commit();
+        alignment = std::max(alignment, (GLsizeiptr)1);
+        if (bytes + alignment > RegionSize)
+            grow(bytes + alignment);
+        GLintptr offset = alignUp(head, alignment);
+        if (offset + bytes > (GLintptr)(region + 1) * RegionSize)
+        {
+            nextRegion();
+            offset = alignUp(head, alignment);
+        }
+        StreamAllocation allocation;
+        allocation.Buffer = Buffer;
+        allocation.Offset = offset;
+        allocation.Size = bytes;
+        if (Persistent)
+            allocation.Data = mapped + offset;
+        else
+        {
+            // the ring doesn't return to this range before the buffer is orphaned, so the GPU can't be reading it
+            glBindBuffer(GL_COPY_WRITE_BUFFER, Buffer);
+            allocation.Data = glMapBufferRange(GL_COPY_WRITE_BUFFER, offset, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+            open = allocation.Data != nullptr;
+            if (!open)
+                std::cout << "ERROR::STREAM_BUFFER:: Failed to map " << bytes << " bytes" << std::endl;
+        }
+        head = offset + bytes;
+        Allocated += bytes;
+        return allocation;
+    }
+
+    // makes the last allocation readable by the GPU: unmaps it unless the buffer is persistently mapped (coherent
+    // mapping needs no flush)
+    void Commit()
+    {
+        if (!open)
+            return;
+        glBindBuffer(GL_COPY_WRITE_BUFFER, Buffer);
+        glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+        open = false;
+    }
+
+    // retires the current region once everything reading from it has been drawn, so frames don't share regions
+    void EndFrame()
+    {
+        Commit();
+        nextRegion();
+    }
+
+    GLsizeiptr Size() const
+    {
+        return RegionSize * Regions;
+    }
+
+private:
+    unsigned char *mapped;
+    bool open;
+    unsigned int region;
+    GLintptr head;
+    std::vector<GLsync> fences;
+
+    void create()
+    {
+        glGenBuffers(1, &Buffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, Buffer);
+        if (Persistent)
+        {
+            GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            glBufferStorage(GL_COPY_WRITE_BUFFER, Size(), NULL, flags);
+            mapped = (unsigned char*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, Size(), flags);
+            if (mapped == nullptr)
+            {
+                // storage is immutable: start over with a buffer we can orphan
+                std::cout << "ERROR::STREAM_BUFFER:: Persistent mapping failed, orphaning instead" << std::endl;
+                glDeleteBuffers(1, &Buffer);
+                glGenBuffers(1, &Buffer);
+                glBindBuffer(GL_COPY_WRITE_BUFFER, Buffer);
+                Persistent = false;
+            }
+        }
+        if (!Persistent)
+            glBufferData(GL_COPY_WRITE_BUFFER, Size(), NULL, GL_STREAM_DRAW);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        fences.assign(Regions, (GLsync)0);
+        region = 0;
+        head = 0;
+    }
+
+    // deleting the buffer is fine while the GPU still reads it: GL keeps the storage until those draws are done
+    void release()
+    {
+        Commit();
+        for (GLsync fence : fences)
+            if (fence)
+                glDeleteSync(fence);
+        fences.clear();
+        glDeleteBuffers(1, &Buffer);
+        Buffer = 0;
+        mapped = nullptr;
+    }
+
+    void grow(GLsizeiptr bytes)
+    {
+        release();
+        // keep regions a multiple of 256 bytes so their starts suit any alignment up to that
+        RegionSize = std::max(RegionSize * 2, (bytes + 255) / 256 * 256);
+        Grows++;
+        create();
+    }
+
+    void nextRegion()
+    {
+        if (Persistent)
+            fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        region = (region + 1) % Regions;
+        head = (GLintptr)region * RegionSize;
+        if (Persistent && fences[region])
+        {
+            GLenum status = glClientWaitSync(fences[region], 0, 0);
+            if (status == GL_TIMEOUT_EXPIRED)
+            {
+                Waits++;
+                do
+                    status = glClientWaitSync(fences[region], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+                while (status == GL_TIMEOUT_EXPIRED);
+            }
+            glDeleteSync(fences[region]);
+            fences[region] = 0;
+        }
+        else if (!Persistent && region == 0)
+        {
+            // give the driver a fresh buffer; the old storage lives on until the GPU is done with it
+            glBindBuffer(GL_COPY_WRITE_BUFFER, Buffer);
+            glBufferData(GL_COPY_WRITE_BUFFER, Size(), NULL, GL_STREAM_DRAW);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        }
+    }
+
+    static GLintptr alignUp(GLintptr offset, GLsizeiptr alignment)
+    {
+        return (offset + alignment - 1) / alignment * alignment;
+    }
+};
+#endif
@@ -0,0 +1,539 @@
+#ifndef TEXT_LAYOUT_H
+#define TEXT_LAYOUT_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/glyph_atlas.h>
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// A line of text laid out once: a quad per visible glyph relative to the start of the baseline, at scale 1 with the y
+// axis pointing up. Drawing it again only takes a transform (position, scale) instead of a glyph lookup and the quad
+// math per character. Only valid for the atlas it was laid out with, as long as that atlas isn't reloaded.
+class TextLayout
+{
+public:
+    struct Glyph
+    {
+        unsigned int Page;
+        glm::vec4    Rect;   // left, top, right, bottom
+        glm::vec2    UVMin;
+        glm::vec2    UVMax;
+    };
+    std::string Text;
+    // visible glyphs, per codepoint the byte where it starts, the pen position there and its visible glyph (-1 if none)
+    std::vector<Glyph> Glyphs;
+    std::vector<size_t> Offsets;
+    std::vector<float> Pens;
+    std::vector<int> Visible;
+    // pen position at the end of the text (its advance)
+    float Width;
+    const std::vector<unsigned int> *PageTextures;
+
+    TextLayout()
+        : Width(0.0f), PageTextures(nullptr)
+    {
+    }
+
+    // lays out text, reusing what's already laid out of the part it has in common with the current text (there's
+    // no kerning, so the glyphs before the first changed character stay where they are); returns the number of
+    // codepoints that had to be laid out
+    unsigned int Set(GlyphAtlas &atlas, const std::string &text)
+    {
+        size_t keep = 0;
+        if (PageTextures == &atlas.Pages)
+        {
+            size_t common = 0;
+            size_t length = std::min(text.size(), Text.size());
+            while (common < length && text[common] == Text[common])
+                ++common;
+            // keep the codepoints that end within the common prefix
+            while (keep < Offsets.size() && (keep + 1 < Offsets.size() ? Offsets[keep + 1] : Text.size()) <= common)
+                ++keep;
+        }
+        float pen = 0.0f;
+        size_t i = 0;
+        if (keep > 0)
+        {
+            pen = keep < Pens.size() ? Pens[keep] : Width;
+            i = keep < Offsets.size() ? Offsets[keep] : Text.size();
+        }
+        size_t visible = 0;
+        for (size_t c = 0; c < keep; ++c)
+            if (Visible[c] >= 0)
+                visible = Visible[c] + 1;
+        Glyphs.resize(visible);
+        Offsets.resize(keep);
+        Pens.resize(keep);
+        Visible.resize(keep);
+        Text = text;
+        PageTextures = &atlas.Pages;
+
+        unsigned int laidOut = 0;
+        while (i < text.size())
+        {
+            size_t start = i;
+            const AtlasGlyph *glyph = atlas.Find(NextCodepoint(text, i));
+            if (glyph == nullptr)
+                continue;
+            Offsets.push_back(start);
+            Pens.push_back(pen);
+            Visible.push_back(-1);
+            if (glyph->Size.x > 0 && glyph->Size.y > 0)
+            {
+                Glyph quad;
+                quad.Page = glyph->Page;
+                quad.Rect.x = pen + glyph->Bearing.x;
+                quad.Rect.y = static_cast<float>(glyph->Bearing.y);
+                quad.Rect.z = quad.Rect.x + glyph->Size.x;
+                quad.Rect.w = quad.Rect.y - glyph->Size.y;
+                quad.UVMin = glyph->UVMin;
+                quad.UVMax = glyph->UVMax;
+                Visible.back() = static_cast<int>(Glyphs.size());
+                Glyphs.push_back(quad);
+            }
+            // advance is in 1/64 pixels
+            pen += glyph->Advance >> 6;
+            ++laidOut;
+        }
+        Width = pen;
+        return laidOut;
+    }
+
+    // queues the laid out text in a batch with its baseline starting at (x, y)
+    void Draw(TextBatch &batch, float x, float y, float scale, glm::vec3 color, bool yDown = false) const
+    {
+        if (PageTextures == nullptr)
+            return;
+        float sy = yDown ? -scale : scale;
+        for (const Glyph &glyph : Glyphs)
+            batch.AddQuad(*PageTextures, glyph.Page, x + glyph.Rect.x * scale, y + glyph.Rect.y * sy, x + glyph.Rect.z * scale,
+                          y + glyph.Rect.w * sy, glyph.UVMin, glyph.UVMax, color);
+    }
+};
+
+// Layouts keyed by (font, size, string) so text drawn every frame is laid out once. The font and size are those of the
+// atlas; least recently used layouts are dropped beyond Capacity. Clear() it when an atlas is reloaded.
+class TextLayoutCache
+{
+public:
+    unsigned int Capacity;
+    // statistics
+    unsigned long long Hits;
+    unsigned long long Misses;
+    unsigned long long Evictions;
+
+    TextLayoutCache(unsigned int capacity = 1024)
+        : Capacity(capacity), Hits(0), Misses(0), Evictions(0)
+    {
+    }
+
+    // the layout of text in the given atlas; valid until the next call to Get or Clear
+    const TextLayout &Get(GlyphAtlas &atlas, const std::string &text)
+    {
+        Key key = { &atlas, atlas.PixelSize, text };
+        std::unordered_map<Key, Entry, KeyHash>::iterator it = layouts.find(key);
+        if (it != layouts.end())
+        {
+            ++Hits;
+            recent.splice(recent.begin(), recent, it->second.Recent);
+            return it->second.Layout;
+        }
+        ++Misses;
+        while (!layouts.empty() && layouts.size() >= std::max(Capacity, 1u))
+        {
+            layouts.erase(recent.back());
+            recent.pop_back();
+            ++Evictions;
+        }
+        Entry &entry = layouts[key];
+        recent.push_front(key);
+        entry.Recent = recent.begin();
+        entry.Layout.Set(atlas, text);
+        return entry.Layout;
+    }
+
+    // the layout of text if it's cached (doesn't count as a use), nullptr otherwise
+    const TextLayout *Find(GlyphAtlas &atlas, const std::string &text) const
+    {
+        Key key = { &atlas, atlas.PixelSize, text };
+        std::unordered_map<Key, Entry, KeyHash>::const_iterator it = layouts.find(key);
+        return it != layouts.end() ? &it->second.Layout : nullptr;
+    }
+
+    void Clear()
+    {
+        layouts.clear();
+        recent.clear();
+    }
+
+    size_t Size() const
+    {
+        return layouts.size();
+    }
+
+private:
+    struct Key
+    {
+        const GlyphAtlas *Font;
+        unsigned int Size;
+        std::string Text;
+        bool operator==(const Key &other) const
+        {
+            return Font == other.Font && Size == other.Size && Text == other.Text;
+        }
+    };
+    struct KeyHash
+    {
+        size_t operator()(const Key &key) const
+        {
+            size_t hash = std::hash<std::string>()(key.Text);
+            hash ^= std::hash<const void*>()(key.Font) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+            hash ^= std::hash<unsigned int>()(key.Size) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+            return hash;
+        }
+    };
+    struct Entry
+    {
+        TextLayout Layout;
+        std::list<Key>::iterator Recent;
+    };
+    std::unordered_map<Key, Entry, KeyHash> layouts;
+    // most recently used first
+    std::list<Key> recent;
+};
+
+// Retained text: labels are laid out into vertex blocks that stay in GPU buffers (one per atlas page) between frames.
+// Per frame only the label transforms (position, scale and color, two texels per label) are uploaded to a buffer
+// texture; the vertex shader looks them up with the label index stored in each vertex. Changing a label's text
+// rewrites just its block (growing it at the end of the buffer when it no longer fits) and only lays out the
+// characters after the first one that changed. All labels are drawn with one draw call per atlas page.
+// The shader gets the atlas page on texture unit 0 as 'text' and the transforms on unit 1 as 'labels'.
+class TextLabels
+{
+public:
+    // statistics since the last ResetStats()
+    unsigned int DrawCalls;
+    unsigned int Relayouts;        // labels whose text changed
+    unsigned int LaidOutGlyphs;    // codepoints laid out for them
+    size_t       BytesUploaded;
+
+    TextLabels(GlyphAtlas &atlas, TextLayoutCache &cache)
+        : DrawCalls(0), Relayouts(0), LaidOutGlyphs(0), BytesUploaded(0), atlas(atlas), cache(cache),
+          transformBuffer(0), transformTexture(0), transformCapacity(0), transformsDirty(false)
+    {
+        glGenBuffers(1, &transformBuffer);
+        glGenTextures(1, &transformTexture);
+    }
+    ~TextLabels()
+    {
+        for (PageBuffer &page : pages)
+        {
+            glDeleteVertexArrays(1, &page.VAO);
+            glDeleteBuffers(1, &page.VBO);
+        }
+        glDeleteTextures(1, &transformTexture);
+        glDeleteBuffers(1, &transformBuffer);
+    }
+
+    // adds a label with its baseline starting at (x, y) and returns its handle
+    unsigned int Add(const std::string &text, float x, float y, float scale, glm::vec3 color = glm::vec3(1.0f), bool yDown = false)
+    {
+        unsigned int id;
+        if (!freeLabels.empty())
+        {
+            id = freeLabels.back();
+            freeLabels.pop_back();
+        }
+        else
+        {
+            id = static_cast<unsigned int>(labels.size());
+            labels.push_back(Label());
+            transforms.resize(labels.size() * 2);
+        }
+        Label &label = labels[id];
+        label.Alive = true;
+        // static text is likely to repeat, share its layout through the cache
+        label.Layout = cache.Get(atlas, text);
+        write(id, false);
+        SetTransform(id, x, y, scale, yDown);
+        SetColor(id, color);
+        return id;
+    }
+
+    void Remove(unsigned int id)
+    {
+        Label &label = labels[id];
+        for (size_t page = 0; page < label.Blocks.size(); ++page)
+            release(page, label.Blocks[page]);
+        label = Label();
+        freeLabels.push_back(id);
+    }
+
+    void SetText(unsigned int id, const std::string &text)
+    {
+        Label &label = labels[id];
+        if (label.Layout.Text == text)
+            return;
+        ++Relayouts;
+        const TextLayout *cached = cache.Find(atlas, text);
+        if (cached != nullptr)
+            label.Layout = *cached;
+        else
+            LaidOutGlyphs += label.Layout.Set(atlas, text);
+        write(id, true);
+    }
+
+    void SetTransform(unsigned int id, float x, float y, float scale, bool yDown = false)
+    {
+        transforms[id * 2] = glm::vec4(x, y, scale, yDown ? -scale : scale);
+        transformsDirty = true;
+    }
+
+    void SetColor(unsigned int id, glm::vec3 color)
+    {
+        transforms[id * 2 + 1] = glm::vec4(color, 1.0f);
+        transformsDirty = true;
+    }
+
+    const TextLayout &Layout(unsigned int id) const
+    {
+        return labels[id].Layout;
+    }
+
+    // uploads what changed and draws all labels with the currently bound shader
+    void Draw()
+    {
+        if (transformsDirty && !transforms.empty())
+        {
+            size_t bytes = transforms.size() * sizeof(glm::vec4);
+            glBindBuffer(GL_TEXTURE_BUFFER, transformBuffer);
+            if (bytes > transformCapacity)
+            {
+                transformCapacity = bytes * 2;
+                glBufferData(GL_TEXTURE_BUFFER, transformCapacity, NULL, GL_DYNAMIC_DRAW);
+                glBindTexture(GL_TEXTURE_BUFFER, transformTexture);
+                glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, transformBuffer);
+                glBindTexture(GL_TEXTURE_BUFFER, 0);
+            }
+            glBufferSubData(GL_TEXTURE_BUFFER, 0, bytes, &transforms[0]);
+            glBindBuffer(GL_TEXTURE_BUFFER, 0);
+            BytesUploaded += bytes;
+            transformsDirty = false;
+        }
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_BUFFER, transformTexture);
+        glActiveTexture(GL_TEXTURE0);
+        for (size_t page = 0; page < pages.size() && page < atlas.Pages.size(); ++page)
+        {
+            PageBuffer &buffer = pages[page];
+            if (buffer.Wasted > 64 && buffer.Wasted > buffer.Used / 2)
+                compact(page);
+            upload(buffer);
+            if (buffer.Used == 0)
+                continue;
+            glBindVertexArray(buffer.VAO);
+            glBindTexture(GL_TEXTURE_2D, atlas.Pages[page]);
+            glDrawArrays(GL_TRIANGLES, 0, static_cast<GLsizei>(buffer.Used * 6));
+            DrawCalls++;
+        }
+        glBindVertexArray(0);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    void ResetStats()
+    {
+        DrawCalls = Relayouts = LaidOutGlyphs = 0;
+        BytesUploaded = 0;
+    }
+
+private:
+    static const unsigned int FloatsPerVertex = 5;
+    static const unsigned int FloatsPerGlyph = 6 * FloatsPerVertex;
+    // a label's range of glyph slots in a page buffer
+    struct Block
+    {
+        size_t Offset;
+        size_t Capacity;
+    };
+    struct Label
+    {
+        bool Alive;
+        TextLayout Layout;
+        std::vector<Block> Blocks;
+        Label() : Alive(false) { }
+    };
+    struct PageBuffer
+    {
+        unsigned int VAO, VBO;
+        // CPU copy of the buffer; slots not used by any label hold degenerate quads
+        std::vector<float> Vertices;
+        size_t Used, Wasted;
+        size_t GPUCapacity;
+        size_t DirtyBegin, DirtyEnd;
+    };
+
+    GlyphAtlas &atlas;
+    TextLayoutCache &cache;
+    std::vector<Label> labels;
+    std::vector<unsigned int> freeLabels;
+    std::vector<PageBuffer> pages;
+    std::vector<glm::vec4> transforms;
+    unsigned int transformBuffer, transformTexture;
+    size_t transformCapacity;
+    bool transformsDirty;
+
+    PageBuffer &page(size_t index)
+    {
+        while (pages.size() <= index)
+        {
+            PageBuffer buffer;
+            buffer.Used = buffer.Wasted = buffer.GPUCapacity = 0;
+            buffer.DirtyBegin = buffer.DirtyEnd = 0;
+            glGenVertexArrays(1, &buffer.VAO);
+            glGenBuffers(1, &buffer.VBO);
+            glBindVertexArray(buffer.VAO);
+            glBindBuffer(GL_ARRAY_BUFFER, buffer.VBO);
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, FloatsPerVertex * sizeof(float), (void*)0);
+            glEnableVertexAttribArray(1);
+            glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, FloatsPerVertex * sizeof(float), (void*)(4 * sizeof(float)));
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            glBindVertexArray(0);
+            pages.push_back(buffer);
+        }
+        return pages[index];
+    }
+
+    static void markDirty(PageBuffer &buffer, size_t begin, size_t end)
+    {
+        if (buffer.DirtyBegin == buffer.DirtyEnd)
+        {
+            buffer.DirtyBegin = begin;
+            buffer.DirtyEnd = end;
+        }
+        else
+        {
+            buffer.DirtyBegin = std::min(buffer.DirtyBegin, begin);
+            buffer.DirtyEnd = std::max(buffer.DirtyEnd, end);
+        }
+    }
+
+    void release(size_t index, Block &block)
+    {
+        if (block.Capacity == 0)
+            return;
+        PageBuffer &buffer = pages[index];
+        std::fill(buffer.Vertices.begin() + block.Offset * FloatsPerGlyph, buffer.Vertices.begin() + (block.Offset + block.Capacity) * FloatsPerGlyph, 0.0f);
+        markDirty(buffer, block.Offset, block.Offset + block.Capacity);
+        buffer.Wasted += block.Capacity;
+        block.Capacity = 0;
+    }
+
+    // writes a label's glyphs into its blocks, moving a block to the end of its buffer when it has grown too large;
+    // text that changed once is likely to change again, so with slack it gets some room to grow
+    void write(unsigned int id, bool slack)
+    {
+        Label &label = labels[id];
+        std::vector<size_t> counts(label.Blocks.size(), 0);
+        for (const TextLayout::Glyph &glyph : label.Layout.Glyphs)
+        {
+            if (counts.size() <= glyph.Page)
+                counts.resize(glyph.Page + 1, 0);
+            counts[glyph.Page]++;
+        }
+        if (label.Blocks.size() < counts.size())
+            label.Blocks.resize(counts.size(), Block{ 0, 0 });
+        for (size_t index = 0; index < counts.size(); ++index)
+        {
+            Block &block = label.Blocks[index];
+            if (counts[index] > block.Capacity)
+            {
+                release(index, block);
+                PageBuffer &buffer = page(index);
+                block.Offset = buffer.Used;
+                block.Capacity = slack ? counts[index] + counts[index] / 2 + 2 : counts[index];
+                buffer.Used += block.Capacity;
+                buffer.Vertices.resize(buffer.Used * FloatsPerGlyph, 0.0f);
+            }
+            if (block.Capacity == 0)
+                continue;
+            PageBuffer &buffer = pages[index];
+            float *vertices = &buffer.Vertices[block.Offset * FloatsPerGlyph];
+            std::fill(vertices, vertices + block.Capacity * FloatsPerGlyph, 0.0f);
+            float slot = static_cast<float>(id);
+            for (const TextLayout::Glyph &glyph : label.Layout.Glyphs)
+            {
+                if (glyph.Page != index)
+                    continue;
+                const glm::vec4 &r = glyph.Rect;
+                float quad[6][FloatsPerVertex] = {
+                    { r.x, r.y, glyph.UVMin.x, glyph.UVMin.y, slot },
+                    { r.x, r.w, glyph.UVMin.x, glyph.UVMax.y, slot },
+                    { r.z, r.w, glyph.UVMax.x, glyph.UVMax.y, slot },
+
+                    { r.x, r.y, glyph.UVMin.x, glyph.UVMin.y, slot },
+                    { r.z, r.w, glyph.UVMax.x, glyph.UVMax.y, slot },
+                    { r.z, r.y, glyph.UVMax.x, glyph.UVMin.y, slot }
+                };
+                std::memcpy(vertices, quad, sizeof(quad));
+                vertices += FloatsPerGlyph;
+            }
+            markDirty(buffer, block.Offset, block.Offset + block.Capacity);
+        }
+    }
+
+    // packs the blocks of a page buffer together again once too much of it is unused
+    void compact(size_t index)
+    {
+        PageBuffer &buffer = pages[index];
+        std::vector<float> vertices;
+        vertices.reserve((buffer.Used - buffer.Wasted) * FloatsPerGlyph);
+        for (Label &label : labels)
+        {
+            if (!label.Alive || label.Blocks.size() <= index || label.Blocks[index].Capacity == 0)
+                continue;
+            Block &block = label.Blocks[index];
+            vertices.insert(vertices.end(), buffer.Vertices.begin() + block.Offset * FloatsPerGlyph,
+                            buffer.Vertices.begin() + (block.Offset + block.Capacity) * FloatsPerGlyph);
+            block.Offset = vertices.size() / FloatsPerGlyph - block.Capacity;
+        }
+        buffer.Vertices.swap(vertices);
+        buffer.Used = buffer.Vertices.size() / FloatsPerGlyph;
+        buffer.Wasted = 0;
+        markDirty(buffer, 0, buffer.Used);
+    }
+
+    void upload(PageBuffer &buffer)
+    {
+        if (buffer.DirtyBegin == buffer.DirtyEnd)
+            return;
+        glBindBuffer(GL_ARRAY_BUFFER, buffer.VBO);
+        size_t bytes = buffer.Vertices.size() * sizeof(float);
+        if (bytes > buffer.GPUCapacity)
+        {
+            // grow with room to spare and upload everything
+            buffer.GPUCapacity = bytes * 2;
+            glBufferData(GL_ARRAY_BUFFER, buffer.GPUCapacity, NULL, GL_DYNAMIC_DRAW);
+            glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, &buffer.Vertices[0]);
+            BytesUploaded += bytes;
+        }
+        else
+        {
+            size_t offset = buffer.DirtyBegin * FloatsPerGlyph * sizeof(float);
+            size_t size = (buffer.DirtyEnd - buffer.DirtyBegin) * FloatsPerGlyph * sizeof(float);
+            glBufferSubData(GL_ARRAY_BUFFER, offset, size, &buffer.Vertices[buffer.DirtyBegin * FloatsPerGlyph]);
+            BytesUploaded += size;
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        buffer.DirtyBegin = buffer.DirtyEnd = 0;
+    }
+};
+#endif
@@ -0,0 +1,638 @@
+#ifndef TEXTURE_COMPRESSION_H
+#define TEXTURE_COMPRESSION_H
+
+#include <learnopengl/compressed_texture.h>
+#include <learnopengl/mipmap_generator.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define COMPRESSION_SSE2
+#endif
+
+// the BC1 color and BC3/BC4 alpha block encoders of image_DXT.c (which has to be compiled in)
+extern "C" {
+void compress_DDS_color_block(int channels, const unsigned char *const uncompressed, unsigned char compressed[8]);
+void compress_DDS_alpha_block(const unsigned char *const uncompressed, unsigned char compressed[8]);
+int rgb_to_565(int r, int g, int b);
+void rgb_888_from_565(unsigned int c, int *r, int *g, int *b);
+}
+
+// Block compression of RGBA8 images into BC1, BC3, BC5 and BC7, for baking textures offline. Each function takes a
+// 4x4 block of RGBA pixels (64 bytes, row by row).
+// BC1/BC3 use image_DXT's encoders; a BC5 block is two BC4 blocks, which are encoded just like BC3's alpha. BC7 only
+// uses mode 6 (one subset, RGBA endpoints with 7 bits per channel plus a shared bit and 4-bit indices): a fraction
+// of what the format can do, but already clearly better than BC1 on smooth gradients, and simple enough to encode fast.
+
+#ifdef COMPRESSION_SSE2
+// With SSE2 the encoders work on 4 pixels at a time: image_DXT's color and alpha encoders are redone here with the
+// per-pixel loops (covariance sums, projections on the color line, index fitting) vectorized, computing the same
+// float operations in the same order, so the output is the same bytes; BC7 searches its palette 4 entries at a time.
+
+// the channels of 4 RGBA pixels as floats
+inline void loadPixelsSSE2(const unsigned char *pixels, __m128 &r, __m128 &g, __m128 &b, __m128 &a)
+{
+    __m128i bytes = _mm_loadu_si128((const __m128i*)pixels), mask = _mm_set1_epi32(0xFF);
+    r = _mm_cvtepi32_ps(_mm_and_si128(bytes, mask));
+    g = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(bytes, 8), mask));
+    b = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(bytes, 16), mask));
+    a = _mm_cvtepi32_ps(_mm_srli_epi32(bytes, 24));
+}
+
+// sums of bytes and of their products stay integers well below 2^24, exact whatever the order they're added in
+inline float sumSSE2(__m128 v)
+{
+    float lanes[4];
+    _mm_storeu_ps(lanes, v);
+    return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+}
+
+inline void compressColorBlockSSE2(const unsigned char block[64], unsigned char out[8])
+{
+    __m128 r[4], g[4], b[4], a;
+    __m128 sumR = _mm_setzero_ps(), sumG = sumR, sumB = sumR, sumRR = sumR, sumGG = sumR, sumBB = sumR, sumRG = sumR, sumRB = sumR, sumGB = sumR;
+    for (int q = 0; q < 4; ++q)
+    {
+        loadPixelsSSE2(block + q * 16, r[q], g[q], b[q], a);
+        sumR = _mm_add_ps(sumR, r[q]);
+        sumG = _mm_add_ps(sumG, g[q]);
+        sumB = _mm_add_ps(sumB, b[q]);
+        sumRR = _mm_add_ps(sumRR, _mm_mul_ps(r[q], r[q]));
+        sumGG = _mm_add_ps(sumGG, _mm_mul_ps(g[q], g[q]));
+        sumBB = _mm_add_ps(sumBB, _mm_mul_ps(b[q], b[q]));
+        sumRG = _mm_add_ps(sumRG, _mm_mul_ps(r[q], g[q]));
+        sumRB = _mm_add_ps(sumRB, _mm_mul_ps(r[q], b[q]));
+        sumGB = _mm_add_ps(sumGB, _mm_mul_ps(g[q], b[q]));
+    }
+    // the color line: the mean and the principal axis of the covariance (compute_color_line_STDEV)
+    const float inv16 = 1.0f / 16.0f;
+    float point[3] = { sumSSE2(sumR) * inv16, sumSSE2(sumG) * inv16, sumSSE2(sumB) * inv16 };
+    float rr = sumSSE2(sumRR) - 16.0f * point[0] * point[0], gg = sumSSE2(sumGG) - 16.0f * point[1] * point[1];
+    float bb = sumSSE2(sumBB) - 16.0f * point[2] * point[2], rg = sumSSE2(sumRG) - 16.0f * point[0] * point[1];
+    float rb = sumSSE2(sumRB) - 16.0f * point[0] * point[2], gb = sumSSE2(sumGB) - 16.0f * point[1] * point[2];
+    float direction[3] = { 1.0f, 2.718281828f, 3.141592654f };
+    for (int iteration = 0; iteration < 3; ++iteration)
+    {
+        float x = direction[0], y = direction[1], z = direction[2];
+        direction[0] = x * rr + y * rg + z * rb;
+        direction[1] = x * rg + y * gg + z * gb;
+        direction[2] = x * rb + y * gb + z * bb;
+    }
+    // the master colors: the extremes of the block along the line (LSE_master_colors_max_min)
+    float length2 = 1.0f / (0.00001f + direction[0] * direction[0] + direction[1] * direction[1] + direction[2] * direction[2]);
+    __m128 dr = _mm_set1_ps(direction[0]), dg = _mm_set1_ps(direction[1]), db = _mm_set1_ps(direction[2]);
+    __m128 lowest = _mm_set1_ps(3.4e38f), highest = _mm_set1_ps(-3.4e38f);
+    for (int q = 0; q < 4; ++q)
+    {
+        __m128 dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dr, r[q]), _mm_mul_ps(dg, g[q])), _mm_mul_ps(db, b[q]));
+        lowest = _mm_min_ps(lowest, dot);
+        highest = _mm_max_ps(highest, dot);
+    }
+    float lows[4], highs[4];
+    _mm_storeu_ps(lows, lowest);
+    _mm_storeu_ps(highs, highest);
+    float offset = direction[0] * point[0] + direction[1] * point[1] + direction[2] * point[2];
+    float dotMin = (std::min(std::min(lows[0], lows[1]), std::min(lows[2], lows[3])) - offset) * length2;
+    float dotMax = (std::max(std::max(highs[0], highs[1]), std::max(highs[2], highs[3])) - offset) * length2;
+    int c0[3], c1[3];
+    for (int i = 0; i < 3; ++i)
+    {
+        c0[i] = std::min(std::max((int)(0.5f + point[i] + dotMax * direction[i]), 0), 255);
+        c1[i] = std::min(std::max((int)(0.5f + point[i] + dotMin * direction[i]), 0), 255);
+    }
+    int first = rgb_to_565(c0[0], c0[1], c0[2]), second = rgb_to_565(c1[0], c1[1], c1[2]);
+    int encoded0 = std::max(first, second), encoded1 = std::min(first, second);
+    out[0] = encoded0 & 255;
+    out[1] = (encoded0 >> 8) & 255;
+    out[2] = encoded1 & 255;
+    out[3] = (encoded1 >> 8) & 255;
+
+    // indices: each pixel's position along the line between the decoded master colors
+    int e0[3], e1[3];
+    rgb_888_from_565(encoded0, &e0[0], &e0[1], &e0[2]);
+    rgb_888_from_565(encoded1, &e1[0], &e1[1], &e1[2]);
+    float line[3], lineLength2 = 0.0f;
+    for (int i = 0; i < 3; ++i)
+    {
+        line[i] = (float)(e1[i] - e0[i]);
+        lineLength2 += line[i] * line[i];
+    }
+    if (lineLength2 > 0.0f)
+        lineLength2 = 1.0f / lineLength2;
+    for (int i = 0; i < 3; ++i)
+        line[i] *= lineLength2;
+    float lineOffset = line[0] * e0[0] + line[1] * e0[1] + line[2] * e0[2];
+    __m128 lr = _mm_set1_ps(line[0]), lg = _mm_set1_ps(line[1]), lb = _mm_set1_ps(line[2]);
+    const int swizzle[4] = { 0, 2, 3, 1 };
+    unsigned int bits = 0;
+    for (int q = 0; q < 4; ++q)
+    {
+        __m128 dot = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(lr, r[q]), _mm_mul_ps(lg, g[q])), _mm_mul_ps(lb, b[q])), _mm_set1_ps(lineOffset));
+        // clamping before truncating is the same as clamping the truncated value to [0, 3]
+        __m128 position = _mm_add_ps(_mm_mul_ps(dot, _mm_set1_ps(3.0f)), _mm_set1_ps(0.5f));
+        position = _mm_min_ps(_mm_max_ps(position, _mm_setzero_ps()), _mm_set1_ps(3.0f));
+        int values[4];
+        _mm_storeu_si128((__m128i*)values, _mm_cvttps_epi32(position));
+        for (int i = 0; i < 4; ++i)
+            bits |= (unsigned int)swizzle[values[i]] << ((q * 4 + i) * 2);
+    }
+    for (int i = 0; i < 4; ++i)
+        out[4 + i] = (unsigned char)(bits >> (8 * i));
+}
+
+inline void compressAlphaBlockSSE2(const unsigned char block[64], unsigned char out[8])
+{
+    // the alpha range
+    __m128i alpha[4], highest = _mm_setzero_si128(), lowest = _mm_set1_epi32(255);
+    for (int q = 0; q < 4; ++q)
+    {
+        alpha[q] = _mm_srli_epi32(_mm_loadu_si128((const __m128i*)(block + q * 16)), 24);
+        highest = _mm_max_epi16(highest, alpha[q]);
+        lowest = _mm_min_epi16(lowest, alpha[q]);
+    }
+    int highs[4], lows[4];
+    _mm_storeu_si128((__m128i*)highs, highest);
+    _mm_storeu_si128((__m128i*)lows, lowest);
+    int a0 = std::max(std::max(highs[0], highs[1]), std::max(highs[2], highs[3]));
+    int a1 = std::min(std::min(lows[0], lows[1]), std::min(lows[2], lows[3]));
+    out[0] = (unsigned char)a0;
+    out[1] = (unsigned char)a1;
+    // 3-bit indices, spread evenly over the range
+    const int swizzle[8] = { 1, 7, 6, 5, 4, 3, 2, 0 };
+    __m128 scale = _mm_set1_ps(7.9999f / (a0 - a1));
+    __m128i base = _mm_set1_epi32(a1);
+    unsigned long long bits = 0;
+    for (int q = 0; q < 4; ++q)
+    {
+        int values[4];
+        _mm_storeu_si128((__m128i*)values, _mm_cvttps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(_mm_sub_epi32(alpha[q], base)), scale)));
+        for (int i = 0; i < 4; ++i)
+            bits |= (unsigned long long)swizzle[values[i] & 7] << ((q * 4 + i) * 3);
+    }
+    for (int i = 0; i < 6; ++i)
+        out[2 + i] = (unsigned char)(bits >> (8 * i));
+}
+#endif
+
+inline void CompressBlockBC1(const unsigned char block[64], unsigned char out[8])
+{
+#ifdef COMPRESSION_SSE2
+    compressColorBlockSSE2(block, out);
+#else
+    compress_DDS_color_block(4, block, out);
+#endif
+}
+
+// the BC3/BC4 alpha encoder, on the 4th byte of each pixel
+inline void compressAlphaBlock(const unsigned char block[64], unsigned char out[8])
+{
+#ifdef COMPRESSION_SSE2
+    compressAlphaBlockSSE2(block, out);
+#else
+    compress_DDS_alpha_block(block, out);
+#endif
+}
+
+inline void CompressBlockBC3(const unsigned char block[64], unsigned char out[16])
+{
+    compressAlphaBlock(block, out);
+    CompressBlockBC1(block, out + 8);
+}
+
+inline void CompressBlockBC5(const unsigned char block[64], unsigned char out[16])
+{
+    // the alpha encoder reads the 4th byte of each pixel: move red, then green there
+    unsigned char channel[64];
+    for (unsigned int c = 0; c < 2; ++c)
+    {
+        for (unsigned int i = 0; i < 16; ++i)
+            channel[i * 4 + 3] = block[i * 4 + c];
+        compressAlphaBlock(channel, out + c * 8);
+    }
+}
+
+// BC7 mode 6
+// ----------
+const int BC7_WEIGHTS4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+inline int bc7Interpolate(int e0, int e1, int weight)
+{
+    return ((64 - weight) * e0 + weight * e1 + 32) >> 6;
+}
+
+// quantizes an endpoint to 7 bits per channel plus the shared bit that fits it best
+inline void bc7QuantizeEndpoint(const float endpoint[4], int quantized[4], int &pbit)
+{
+    int bestError = -1;
+    for (int p = 0; p < 2; ++p)
+    {
+        int q[4], error = 0;
+        for (int c = 0; c < 4; ++c)
+        {
+            q[c] = std::min(std::max((int)std::floor((endpoint[c] - p) / 2.0f + 0.5f), 0), 127);
+            int value = (q[c] << 1) | p;
+            error += (int)((value - endpoint[c]) * (value - endpoint[c]));
+        }
+        if (bestError < 0 || error < bestError)
+        {
+            bestError = error;
+            pbit = p;
+            std::memcpy(quantized, q, sizeof(q));
+        }
+    }
+}
+
+// picks the nearest of the 16 palette colors for each pixel; returns the total squared error
+inline int bc7AssignIndices(const unsigned char block[64], const int e0[4], const int e1[4], int indices[16])
+{
+    int palette[16][4];
+    for (int i = 0; i < 16; ++i)
+        for (int c = 0; c < 4; ++c)
+            palette[i][c] = bc7Interpolate(e0[c], e1[c], BC7_WEIGHTS4[i]);
+    int total = 0;
+#ifdef COMPRESSION_SSE2
+    // 4 palette entries per vector as 16-bit (red, green) and (blue, alpha) pairs: a multiply-add of the differences
+    // squares and sums each pair. The error and the entry's number are combined into one key, error * 16 + entry, so
+    // the smallest key is the nearest entry, the first one on ties like the scalar loop
+    __m128i paletteRG[4], paletteBA[4];
+    for (int q = 0; q < 4; ++q)
+    {
+        const int *entry = palette[q * 4];
+        paletteRG[q] = _mm_setr_epi16(entry[0], entry[1], entry[4], entry[5], entry[8], entry[9], entry[12], entry[13]);
+        paletteBA[q] = _mm_setr_epi16(entry[2], entry[3], entry[6], entry[7], entry[10], entry[11], entry[14], entry[15]);
+    }
+    const __m128i entries[4] = { _mm_setr_epi32(0, 1, 2, 3), _mm_setr_epi32(4, 5, 6, 7), _mm_setr_epi32(8, 9, 10, 11), _mm_setr_epi32(12, 13, 14, 15) };
+    for (int p = 0; p < 16; ++p)
+    {
+        const unsigned char *pixel = block + p * 4;
+        __m128i rg = _mm_set1_epi32(pixel[0] | (pixel[1] << 16)), ba = _mm_set1_epi32(pixel[2] | (pixel[3] << 16));
+        __m128i best = _mm_set1_epi32(0x7FFFFFFF);
+        for (int q = 0; q < 4; ++q)
+        {
+            __m128i dRG = _mm_sub_epi16(paletteRG[q], rg), dBA = _mm_sub_epi16(paletteBA[q], ba);
+            __m128i error = _mm_add_epi32(_mm_madd_epi16(dRG, dRG), _mm_madd_epi16(dBA, dBA));
+            __m128i key = _mm_or_si128(_mm_slli_epi32(error, 4), entries[q]);
+            __m128i less = _mm_cmplt_epi32(key, best);
+            best = _mm_or_si128(_mm_and_si128(less, key), _mm_andnot_si128(less, best));
+        }
+        int keys[4];
+        _mm_storeu_si128((__m128i*)keys, best);
+        int key = std::min(std::min(keys[0], keys[1]), std::min(keys[2], keys[3]));
+        indices[p] = key & 15;
+        total += key >> 4;
+    }
+#else
+
+    for (int p = 0; p < 16; ++p)
+    {
+        int best = 0, bestError = 1 << 30;
+        for (int i = 0; i < 16; ++i)
+        {
+            int error = 0;
+            for (int c = 0; c < 4; ++c)
+            {
+                int d = palette[i][c] - block[p * 4 + c];
+                error += d * d;
+            }
+            if (error < bestError)
+            {
+                bestError = error;
+                best = i;
+            }
+        }
+        indices[p] = best;
+        total += bestError;
+    }
+#endif
+    return total;
+}
+
+inline void CompressBlockBC7(const unsigned char block[64], unsigned char out[16])
+{
+    // endpoints: the extremes of the block along its principal axis (power iteration on the covariance)
+    float mean[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    for (int p = 0; p < 16; ++p)
+        for (int c = 0; c < 4; ++c)
+            mean[c] += block[p * 4 + c] / 16.0f;
+    float covariance[4][4] = {};
+    for (int p = 0; p < 16; ++p)
+        for (int i = 0; i < 4; ++i)
+            for (int j = 0; j < 4; ++j)
+                covariance[i][j] += (block[p * 4 + i] - mean[i]) * (block[p * 4 + j] - mean[j]);
+    float axis[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+    for (int iteration = 0; iteration < 8; ++iteration)
+    {
+        float next[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        float length = 0.0f;
+        for (int i = 0; i < 4; ++i)
+        {
+            for (int j = 0; j < 4; ++j)
+                next[i] += covariance[i][j] * axis[j];
+            length = std::max(length, std::fabs(next[i]));
+        }
+        if (length < 1e-6f)
+            break;
+        for (int i = 0; i < 4; ++i)
+            axis[i] = next[i] / length;
+    }
+    float minT = 1e30f, maxT = -1e30f, axisLength = 0.0f;
+    for (int c = 0; c < 4; ++c)
+        axisLength += axis[c] * axis[c];
+    for (int p = 0; p < 16; ++p)
+    {
+        float t = 0.0f;
+        for (int c = 0; c < 4; ++c)
+            t += (block[p * 4 + c] - mean[c]) * axis[c];
+        t /= axisLength;
+        minT = std::min(minT, t);
+        maxT = std::max(maxT, t);
+    }
+    float endpoints[2][4];
+    for (int c = 0; c < 4; ++c)
+    {
+        endpoints[0][c] = std::min(std::max(mean[c] + axis[c] * minT, 0.0f), 255.0f);
+        endpoints[1][c] = std::min(std::max(mean[c] + axis[c] * maxT, 0.0f), 255.0f);
+    }
+
+    int quantized[2][4], pbits[2], e[2][4], indices[16];
+    int bestError = -1, bestQuantized[2][4], bestPbits[2], bestIndices[16];
+    // fit, then refine the endpoints once by least squares on the chosen indices
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        for (int i = 0; i < 2; ++i)
+        {
+            bc7QuantizeEndpoint(endpoints[i], quantized[i], pbits[i]);
+            for (int c = 0; c < 4; ++c)
+                e[i][c] = (quantized[i][c] << 1) | pbits[i];
+        }
+        int error = bc7AssignIndices(block, e[0], e[1], indices);
+        if (bestError < 0 || error < bestError)
+        {
+            bestError = error;
+            std::memcpy(bestQuantized, quantized, sizeof(quantized));
+            std::memcpy(bestPbits, pbits, sizeof(pbits));
+            std::memcpy(bestIndices, indices, sizeof(indices));
+        }
+        // solve for endpoints a, b minimizing sum |(1-w)a + wb - pixel|^2
+        float aa = 0.0f, ab = 0.0f, bb = 0.0f, ax[4] = {}, bx[4] = {};
+        for (int p = 0; p < 16; ++p)
+        {
+            float w = BC7_WEIGHTS4[indices[p]] / 64.0f;
+            aa += (1.0f - w) * (1.0f - w);
+            ab += (1.0f - w) * w;
+            bb += w * w;
+            for (int c = 0; c < 4; ++c)
+            {
+                ax[c] += (1.0f - w) * block[p * 4 + c];
+                bx[c] += w * block[p * 4 + c];
+            }
+        }
+        float determinant = aa * bb - ab * ab;
+        if (std::fabs(determinant) < 1e-6f)
+            break;
+        for (int c = 0; c < 4; ++c)
+        {
+            endpoints[0][c] = std::min(std::max((ax[c] * bb - bx[c] * ab) / determinant, 0.0f), 255.0f);
+            endpoints[1][c] = std::min(std::max((bx[c] * aa - ax[c] * ab) / determinant, 0.0f), 255.0f);
+        }
+    }
+
+    // the first index is stored with 3 bits, its top bit implied 0: swap the endpoints if it's set
+    if (bestIndices[0] & 8)
+    {
+        for (int c = 0; c < 4; ++c)
+            std::swap(bestQuantized[0][c], bestQuantized[1][c]);
+        std::swap(bestPbits[0], bestPbits[1]);
+        for (int p = 0; p < 16; ++p)
+            bestIndices[p] = 15 - bestIndices[p];
+    }
+
+    // pack: mode (bit 6 set), R0 R1 G0 G1 B0 B1 A0 A1 (7 bits each), P0 P1, indices
+    std::memset(out, 0, 16);
+    unsigned int bit = 0;
+    auto write = [&](unsigned int value, unsigned int bits)
+    {
+        for (unsigned int i = 0; i < bits; ++i, ++bit)
+            out[bit >> 3] |= ((value >> i) & 1) << (bit & 7);
+    };
+    write(1 << 6, 7);
+    for (int c = 0; c < 4; ++c)
+    {
+        write(bestQuantized[0][c], 7);
+        write(bestQuantized[1][c], 7);
+    }
+    write(bestPbits[0], 1);
+    write(bestPbits[1], 1);
+    for (int p = 0; p < 16; ++p)
+        write(bestIndices[p], p == 0 ? 3 : 4);
+}
+
+// Decoding, to measure the error of the encoders. BC7 decodes mode 6 only, the one CompressBlockBC7 writes.
+// -----------------------------------------------------------------------------------------------------
+inline void decompressColorBlock(const unsigned char in[8], unsigned char block[64], bool opaque)
+{
+    unsigned int c0 = in[0] | (in[1] << 8), c1 = in[2] | (in[3] << 8);
+    int colors[4][4];
+    for (int i = 0; i < 2; ++i)
+    {
+        unsigned int c = i == 0 ? c0 : c1;
+        colors[i][0] = ((c >> 11) & 31) * 255 / 31;
+        colors[i][1] = ((c >> 5) & 63) * 255 / 63;
+        colors[i][2] = (c & 31) * 255 / 31;
+        colors[i][3] = 255;
+    }
+    for (int c = 0; c < 4; ++c)
+    {
+        if (c0 > c1 || opaque)
+        {
+            colors[2][c] = (2 * colors[0][c] + colors[1][c]) / 3;
+            colors[3][c] = (colors[0][c] + 2 * colors[1][c]) / 3;
+        }
+        else
+        {
+            // 3 color mode: the last index is transparent black
+            colors[2][c] = (colors[0][c] + colors[1][c]) / 2;
+            colors[3][c] = 0;
+        }
+    }
+    for (int p = 0; p < 16; ++p)
+    {
+        int index = (in[4 + p / 4] >> ((p % 4) * 2)) & 3;
+        for (int c = 0; c < 4; ++c)
+            block[p * 4 + c] = (unsigned char)colors[index][c];
+    }
+}
+
+inline void decompressAlphaBlock(const unsigned char in[8], unsigned char block[64], int channel)
+{
+    int a[8] = { in[0], in[1] };
+    for (int i = 2; i < 8; ++i)
+    {
+        if (a[0] > a[1])
+            a[i] = ((8 - i) * a[0] + (i - 1) * a[1]) / 7;
+        else
+            a[i] = i < 6 ? ((6 - i) * a[0] + (i - 1) * a[1]) / 5 : (i == 6 ? 0 : 255);
+    }
+    unsigned long long bits = 0;
+    for (int i = 0; i < 6; ++i)
+        bits |= (unsigned long long)in[2 + i] << (8 * i);
+    for (int p = 0; p < 16; ++p)
+        block[p * 4 + channel] = (unsigned char)a[(bits >> (3 * p)) & 7];
+}
+
+inline void DecompressBlock(BlockFormat format, const unsigned char *in, unsigned char block[64])
+{
+    if (format == FORMAT_BC1)
+        decompressColorBlock(in, block, false);
+    else if (format == FORMAT_BC3)
+    {
+        decompressColorBlock(in + 8, block, true);
+        decompressAlphaBlock(in, block, 3);
+    }
+    else if (format == FORMAT_BC5)
+    {
+        decompressAlphaBlock(in, block, 0);
+        decompressAlphaBlock(in + 8, block, 1);
+        for (int p = 0; p < 16; ++p)
+        {
+            block[p * 4 + 2] = 0;
+            block[p * 4 + 3] = 255;
+        }
+    }
+    else
+    {
+        unsigned int bit = 0;
+        auto read = [&](unsigned int bits)
+        {
+            unsigned int value = 0;
+            for (unsigned int i = 0; i < bits; ++i, ++bit)
+                value |= ((in[bit >> 3] >> (bit & 7)) & 1) << i;
+            return value;
+        };
+        if (read(7) != (1 << 6))
+        {
+            std::memset(block, 0, 64);
+            return;
+        }
+        int e[2][4];
+        for (int c = 0; c < 4; ++c)
+        {
+            e[0][c] = read(7) << 1;
+            e[1][c] = read(7) << 1;
+        }
+        unsigned int p0 = read(1), p1 = read(1);
+        for (int c = 0; c < 4; ++c)
+        {
+            e[0][c] |= p0;
+            e[1][c] |= p1;
+        }
+        for (int p = 0; p < 16; ++p)
+        {
+            int index = read(p == 0 ? 3 : 4);
+            for (int c = 0; c < 4; ++c)
+                block[p * 4 + c] = (unsigned char)bc7Interpolate(e[0][c], e[1][c], BC7_WEIGHTS4[index]);
+        }
+    }
+}
+
+// Whole images
+// ------------
+// compresses an RGBA8 image; rows of blocks are spread over the given number of threads (0: one per core)
+inline std::vector<unsigned char> CompressImage(const unsigned char *rgba, unsigned int width, unsigned int height, BlockFormat format, unsigned int threads = 0)
+{
+    unsigned int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+    unsigned int blockBytes = CompressedImage::BlockBytes(format);
+    std::vector<unsigned char> out((size_t)blocksX * blocksY * blockBytes);
+    std::atomic<unsigned int> nextRow(0);
+    auto work = [&]()
+    {
+        unsigned char block[64];
+        for (unsigned int by = nextRow++; by < blocksY; by = nextRow++)
+        {
+            for (unsigned int bx = 0; bx < blocksX; ++bx)
+            {
+                // edge blocks repeat the last row/column
+                for (unsigned int y = 0; y < 4; ++y)
+                {
+                    unsigned int sy = std::min(by * 4 + y, height - 1);
+                    for (unsigned int x = 0; x < 4; ++x)
+                    {
+                        unsigned int sx = std::min(bx * 4 + x, width - 1);
+                        std::memcpy(&block[(y * 4 + x) * 4], &rgba[((size_t)sy * width + sx) * 4], 4);
+                    }
+                }
+                unsigned char *target = &out[((size_t)by * blocksX + bx) * blockBytes];
+                switch (format)
+                {
+                case FORMAT_BC1: CompressBlockBC1(block, target); break;
+                case FORMAT_BC3: CompressBlockBC3(block, target); break;
+                case FORMAT_BC5: CompressBlockBC5(block, target); break;
+                case FORMAT_BC7: CompressBlockBC7(block, target); break;
+                }
+            }
+        }
+    };
+    if (threads == 0)
+        threads = std::max(std::thread::hardware_concurrency(), 1u);
+    threads = std::min(threads, blocksY);
+    std::vector<std::thread> workers;
+    for (unsigned int i = 1; i < threads; ++i)
+        workers.push_back(std::thread(work));
+    work();
+    for (std::thread &worker : workers)
+        worker.join();
+    return out;
+}
+
+// decodes a compressed level back to RGBA8
+inline std::vector<unsigned char> DecompressImage(const unsigned char *data, unsigned int width, unsigned int height, BlockFormat format)
+{
+    unsigned int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+    unsigned int blockBytes = CompressedImage::BlockBytes(format);
+    std::vector<unsigned char> rgba((size_t)width * height * 4);
+    unsigned char block[64];
+    for (unsigned int by = 0; by < blocksY; ++by)
+        for (unsigned int bx = 0; bx < blocksX; ++bx)
+        {
+            DecompressBlock(format, data + ((size_t)by * blocksX + bx) * blockBytes, block);
+            for (unsigned int y = 0; y < 4 && by * 4 + y < height; ++y)
+                for (unsigned int x = 0; x < 4 && bx * 4 + x < width; ++x)
+                    std::memcpy(&rgba[((size_t)(by * 4 + y) * width + bx * 4 + x) * 4], &block[(y * 4 + x) * 4], 4);
+        }
+    return rgba;
+}
+
+// peak signal to noise ratio (dB) between two RGBA8 images over the first channels
+inline double ImagePSNR(const unsigned char *a, const unsigned char *b, unsigned int width, unsigned int height, unsigned int channels = 4)
+{
+    double error = 0.0;
+    size_t pixels = (size_t)width * height;
+    for (size_t p = 0; p < pixels; ++p)
+        for (unsigned int c = 0; c < channels; ++c)
+        {
+            double d = (double)a[p * 4 + c] - b[p * 4 + c];
+            error += d * d;
+        }
+    error /= (double)pixels * channels;
+    return error > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / error) : 99.0;
+}
+
+// compresses every level of a mip chain of RGBA8 images, as made by a MipmapGenerator
+inline CompressedImage CompressMipChain(const std::vector<MipLevel> &levels, BlockFormat format, bool srgb, unsigned int threads = 0)
+{
+    CompressedImage image;
+    image.Format = format;
+    image.SRGB = srgb;
+    image.Width = levels[0].Width;
+    image.Height = levels[0].Height;
+    for (const MipLevel &level : levels)
+        image.Levels.push_back(CompressImage(&level.Data[0], level.Width, level.Height, format, threads));
+    return image;
+}
+#endif
@@ -0,0 +1,415 @@
+#ifndef TEXTURE_STREAMER_H
+#define TEXTURE_STREAMER_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/compressed_texture.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Streams the mip levels of baked (DDS/KTX) textures in and out of video memory. A texture starts out with only its
+// small levels (the tail) resident; every frame the renderer requests the finest level each texture needs (see
+// ScreenSize), and Update has the missing levels read from the container by background threads, coarse to fine, and
+// uploads them a level at a time, lowering GL_TEXTURE_BASE_LEVEL as they arrive. The streamed levels share a memory
+// budget: when a level doesn't fit, the levels that were least recently needed are evicted first, finest first, and
+// the texture falls back to its next coarser level. Levels baked the other way up from how stb_image currently loads
+// images are flipped as they're read (see OrientCompressedImage).
+class TextureStreamer
+{
+public:
+    // bytes of streamed levels allowed in video memory at once (the tails aren't counted)
+    size_t Budget;
+    // bytes uploaded per Update at most, so a burst of requests doesn't stall a single frame
+    size_t UploadBudget;
+    // levels this size (in pixels, larger side) and smaller are loaded with the texture and never evicted
+    unsigned int TailSize;
+
+    // metrics
+    size_t ResidentBytes;   // all resident levels, tails included
+    size_t StreamedBytes;   // resident streamed levels, counted against the budget
+    unsigned int Loads;     // levels streamed in
+    unsigned int Evictions; // levels evicted
+    double MaxLatency;      // longest time from a level being requested to it being resident, in milliseconds
+
+    TextureStreamer(size_t budget, unsigned int tailSize = 64, unsigned int threads = 1)
+        : Budget(budget), UploadBudget(8 * 1024 * 1024), TailSize(tailSize), ResidentBytes(0), StreamedBytes(0), Loads(0),
+          Evictions(0), MaxLatency(0.0), frame(1), pendingBytes(0), latencyTotal(0.0), stop(false)
+    {
+        for (unsigned int i = 0; i < std::max(threads, 1u); ++i)
+            workers.push_back(std::thread(&TextureStreamer::work, this));
+    }
+
+    ~TextureStreamer()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stop = true;
+        }
+        wake.notify_all();
+        for (std::thread &worker : workers)
+            worker.join();
+    }
+
+    // creates a texture from a baked texture with only its tail resident; returns 0 if it couldn't be read (or can't
+    // be flipped to the orientation stb_image loads images in, or its format isn't supported by the context)
+    unsigned int Add(const std::string &path, GLint wrap = GL_REPEAT)
+    {
+        Entry entry;
+        entry.Path = path;
+        if (!ReadCompressedImage(path, entry.Layout, &entry.Offsets) || entry.Offsets.empty() || !CompressedFormatSupported(entry.Layout.Format))
+            return 0;
+        unsigned int levels = (unsigned int)entry.Offsets.size();
+        entry.Flip = entry.Layout.BottomUp != StbiFlipsVertically();
+        // levels are flipped by whole blocks, which doesn't work for heights that aren't a multiple of the block's
+        for (unsigned int level = 0; entry.Flip && level < levels; ++level)
+            if (levelHeight(entry, level) > 4 && levelHeight(entry, level) % 4 != 0)
+                return 0;
+        entry.Tail = 0;
+        while (entry.Tail + 1 < levels && std::max(levelWidth(entry, entry.Tail), levelHeight(entry, entry.Tail)) > TailSize)
+            entry.Tail++;
+        entry.Resident = entry.Tail;
+        entry.Finest = 0;
+        entry.Wanted = levels;
+        entry.Pending = false;
+        entry.LevelUsed.assign(levels, 0);
+
+        glGenTextures(1, &entry.ID);
+        glBindTexture(GL_TEXTURE_2D, entry.ID);
+        for (unsigned int level = entry.Tail; level < levels; ++level)
+        {
+            std::vector<unsigned char> data;
+            if (!readLevel(makeJob(entry, entries.size(), level), data))
+            {
+                std::cout << "ERROR::TEXTURE_STREAMER:: Could not read " << path << std::endl;
+                glDeleteTextures(1, &entry.ID);
+                return 0;
+            }
+            uploadLevel(entry, level, data);
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, entry.Tail);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrap);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrap);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        index[entry.ID] = entries.size();
+        entries.push_back(entry);
+        return entry.ID;
+    }
+
+    // feedback: the finest level the texture is needed at this frame (0 is full resolution); textures the streamer
+    // doesn't know are ignored
+    void Request(unsigned int texture, float level)
+    {
+        std::map<unsigned int, size_t>::iterator it = index.find(texture);
+        if (it == index.end())
+            return;
+        Entry &entry = entries[it->second];
+        unsigned int wanted = (unsigned int)std::min(std::max(std::floor(level), (float)entry.Finest), (float)(entry.Offsets.size() - 1));
+        entry.Wanted = std::min(entry.Wanted, wanted);
+    }
+
+    // requests the level needed to cover about the given number of pixels on screen (larger side, see ScreenSize)
+    void RequestScreenSize(unsigned int texture, float pixels)
+    {
+        std::map<unsigned int, size_t>::iterator it = index.find(texture);
+        if (it == index.end())
+            return;
+        const Entry &entry = entries[it->second];
+        float size = (float)std::max(entry.Layout.Width, entry.Layout.Height);
+        Request(texture, std::log2(size / std::max(pixels, 1.0f)));
+    }
+
+    // CPU estimate of the pixels an object of the given bounding radius covers on screen (its diameter, vertically)
+    // at a distance from a camera with the given vertical field of view (in radians)
+    static float ScreenSize(float radius, float distance, float fovY, float viewportHeight)
+    {
+        if (distance <= radius)
+            return viewportHeight;
+        return std::min(radius / (distance * std::tan(fovY * 0.5f)), 1.0f) * viewportHeight;
+    }
+
+    // once per frame, after the frame's requests: uploads levels that finished loading, evicts what doesn't fit and
+    // queues reads for the levels still missing
+    void Update()
+    {
+        // 1. the levels needed this frame were used this frame
+        std::vector<size_t> missing;
+        for (size_t i = 0; i < entries.size(); ++i)
+        {
+            Entry &entry = entries[i];
+            for (unsigned int level = entry.Wanted; level < entry.Tail; ++level)
+                entry.LevelUsed[level] = frame;
+            if (entry.Wanted < entry.Resident)
+                missing.push_back(i);
+        }
+
+        // 2. upload finished reads, within the upload budget
+        std::deque<Result> results;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            results.swap(done);
+        }
+        size_t uploaded = 0;
+        while (!results.empty() && uploaded < UploadBudget)
+        {
+            Result &result = results.front();
+            Entry &entry = entries[result.Entry];
+            pendingBytes -= result.Bytes;
+            entry.Pending = false;
+            // don't retry levels that can't be read
+            if (result.Data.empty())
+                entry.Finest = std::max(entry.Finest, result.Level + 1);
+            // the level it was meant to extend may have been evicted in the meantime
+            else if (result.Level + 1 == entry.Resident)
+            {
+                glBindTexture(GL_TEXTURE_2D, entry.ID);
+                uploadLevel(entry, result.Level, result.Data);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, result.Level);
+                entry.Resident = result.Level;
+                StreamedBytes += result.Data.size();
+                uploaded += result.Data.size();
+                Loads++;
+                double latency = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - result.Requested).count();
+                latencyTotal += latency;
+                MaxLatency = std::max(MaxLatency, latency);
+            }
+            results.pop_front();
+        }
+        glBindTexture(GL_TEXTURE_2D, 0);
+        if (!results.empty())
+        {
+            // what is left over waits for the next frame (ahead of anything that finished since)
+            std::lock_guard<std::mutex> lock(mutex);
+            done.insert(done.begin(), results.begin(), results.end());
+        }
+
+        // 3. queue the next level of each texture that needs more, coarse levels (cheap, and the most visible) first
+        std::sort(missing.begin(), missing.end(), [this](size_t a, size_t b) { return entries[a].Resident > entries[b].Resident; });
+        std::vector<Job> jobs;
+        for (size_t i : missing)
+        {
+            Entry &entry = entries[i];
+            if (entry.Pending || entry.Wanted >= entry.Resident)
+                continue;
+            unsigned int level = entry.Resident - 1;
+            size_t bytes = levelBytes(entry, level);
+            if (!makeRoom(bytes))
+                continue;
+            jobs.push_back(makeJob(entry, i, level));
+            entry.Pending = true;
+            pendingBytes += bytes;
+        }
+        if (!jobs.empty())
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                queue.insert(queue.end(), jobs.begin(), jobs.end());
+            }
+            wake.notify_all();
+        }
+
+        for (Entry &entry : entries)
+            entry.Wanted = (unsigned int)entry.Offsets.size();
+        frame++;
+    }
+
+    // mean time from a level being requested to it being resident, in milliseconds
+    double AverageLatency() const
+    {
+        return Loads > 0 ? latencyTotal / Loads : 0.0;
+    }
+
+    // the finest resident level of a texture
+    unsigned int ResidentLevel(unsigned int texture) const
+    {
+        std::map<unsigned int, size_t>::const_iterator it = index.find(texture);
+        return it != index.end() ? entries[it->second].Resident : 0;
+    }
+
+    size_t Size() const
+    {
+        return entries.size();
+    }
+
+private:
+    struct Entry
+    {
+        unsigned int ID;
+        std::string Path;
+        // format and size of the baked texture (its levels stay empty) and where each level starts in the file
+        CompressedImage Layout;
+        std::vector<size_t> Offsets;
+        // the finest resident level, the first level of the tail, the finest level requested this frame and the
+        // finest level that can be streamed (below it levels failed to read)
+        unsigned int Resident, Tail, Wanted, Finest;
+        // a read for the next finer level is in flight
+        bool Pending;
+        // the levels are stored the other way up
+        bool Flip;
+        // per level the last frame it was needed
+        std::vector<unsigned long> LevelUsed;
+    };
+
+    struct Job
+    {
+        size_t Entry;
+        unsigned int Level;
+        std::string Path;
+        size_t Offset, Bytes;
+        // what the level holds, to flip it
+        BlockFormat Format;
+        unsigned int Width, Height;
+        bool Flip;
+        std::chrono::steady_clock::time_point Requested;
+    };
+
+    struct Result
+    {
+        size_t Entry;
+        unsigned int Level;
+        size_t Bytes;
+        std::vector<unsigned char> Data;
+        std::chrono::steady_clock::time_point Requested;
+    };
+
+    std::vector<Entry> entries;
+    std::map<unsigned int, size_t> index;
+    unsigned long frame;
+    // bytes of reads in flight, already reserved in the budget
+    size_t pendingBytes;
+    double latencyTotal;
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<Job> queue;
+    std::deque<Result> done;
+    bool stop;
+
+    static unsigned int levelWidth(const Entry &entry, unsigned int level)
+    {
+        return std::max(entry.Layout.Width >> level, 1u);
+    }
+
+    static unsigned int levelHeight(const Entry &entry, unsigned int level)
+    {
+        return std::max(entry.Layout.Height >> level, 1u);
+    }
+
+    static size_t levelBytes(const Entry &entry, unsigned int level)
+    {
+        return CompressedImage::LevelBytes(entry.Layout.Format, levelWidth(entry, level), levelHeight(entry, level));
+    }
+
+    // into the bound texture
+    void uploadLevel(const Entry &entry, unsigned int level, const std::vector<unsigned char> &data)
+    {
+        glCompressedTexImage2D(GL_TEXTURE_2D, level, entry.Layout.InternalFormat(), levelWidth(entry, level), levelHeight(entry, level), 0,
+                               (GLsizei)data.size(), &data[0]);
+        ResidentBytes += data.size();
+    }
+
+    // evicts the least recently needed streamed levels, not counting those needed this frame, until the given number
+    // of bytes fits in the budget; false if it can't
+    bool makeRoom(size_t bytes)
+    {
+        while (StreamedBytes + pendingBytes + bytes > Budget)
+        {
+            // only a texture's finest level can go, so that its resident levels stay a complete chain
+            size_t victim = entries.size();
+            unsigned long oldest = frame;
+            for (size_t i = 0; i < entries.size(); ++i)
+            {
+                const Entry &entry = entries[i];
+                if (entry.Resident < entry.Tail && entry.LevelUsed[entry.Resident] < oldest)
+                {
+                    victim = i;
+                    oldest = entry.LevelUsed[entry.Resident];
+                }
+            }
+            if (victim == entries.size())
+                return false;
+            Entry &entry = entries[victim];
+            unsigned int level = entry.Resident++;
+            size_t freed = levelBytes(entry, level);
+            glBindTexture(GL_TEXTURE_2D, entry.ID);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, entry.Resident);
+            // respecifying the level as empty releases its memory
+            glCompressedTexImage2D(GL_TEXTURE_2D, level, entry.Layout.InternalFormat(), 0, 0, 0, 0, NULL);
+            glBindTexture(GL_TEXTURE_2D, 0);
+            StreamedBytes -= freed;
+            ResidentBytes -= freed;
+            Evictions++;
+        }
+        return true;
+    }
+
+    static Job makeJob(const Entry &entry, size_t index, unsigned int level)
+    {
+        Job job;
+        job.Entry = index;
+        job.Level = level;
+        job.Path = entry.Path;
+        job.Offset = entry.Offsets[level];
+        job.Bytes = levelBytes(entry, level);
+        job.Format = entry.Layout.Format;
+        job.Width = levelWidth(entry, level);
+        job.Height = levelHeight(entry, level);
+        job.Flip = entry.Flip;
+        job.Requested = std::chrono::steady_clock::now();
+        return job;
+    }
+
+    static bool readLevel(const Job &job, std::vector<unsigned char> &data)
+    {
+        std::ifstream file(job.Path.c_str(), std::ios::binary);
+        data.resize(job.Bytes);
+        file.seekg(job.Offset);
+        if (!file.read((char*)&data[0], job.Bytes))
+            return false;
+        return !job.Flip || FlipCompressedLevel(job.Format, &data[0], job.Width, job.Height);
+    }
+
+    void work()
+    {
+        while (true)
+        {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [this]() { return stop || !queue.empty(); });
+                if (stop)
+                    return;
+                job = queue.front();
+                queue.pop_front();
+            }
+            Result result;
+            result.Entry = job.Entry;
+            result.Level = job.Level;
+            result.Bytes = job.Bytes;
+            result.Requested = job.Requested;
+            if (!readLevel(job, result.Data))
+            {
+                std::cout << "ERROR::TEXTURE_STREAMER:: Could not read level " << job.Level << " of " << job.Path << std::endl;
+                result.Data.clear();
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            done.push_back(result);
+        }
+    }
+};
+#endif
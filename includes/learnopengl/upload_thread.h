@@ -0,0 +1,334 @@
+#ifndef UPLOAD_THREAD_H
+#define UPLOAD_THREAD_H
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <learnopengl/compressed_texture.h>
+#include <learnopengl/mipmap_generator.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A background thread with its own OpenGL context, shared with the render thread's, that creates textures and
+// buffers so large uploads don't stall rendering. Work queued with Run executes on that thread; its pixel and vertex
+// data goes through a ring of staging buffers (mapped, filled and then copied by the GPU, the texture uploads as
+// pixel unpack buffers), so the thread doesn't wait on the driver either. When a piece of work is done a fence is
+// inserted after its commands, and only once the GPU has passed that fence does Poll, on the render thread, hand the
+// results over by calling the work's done function.
+//
+// Textures and buffers are shared between the contexts, vertex arrays aren't: those have to be created on the render
+// thread (in done).
+class UploadThread
+{
+public:
+    // bytes copied through the staging ring
+    std::atomic<size_t> StagedBytes;
+    // times the upload thread had to wait for the GPU to free a staging buffer
+    std::atomic<unsigned int> Stalls;
+
+    // creates a hidden window sharing the given window's context; call from the main thread with the context version
+    // hints the window was created with still set
+    UploadThread(GLFWwindow *share, size_t stagingSize = 4 * 1024 * 1024, unsigned int stagingBuffers = 3)
+        : StagedBytes(0), Stalls(0), stagingSize(stagingSize), current(0), offset(0), pending(0), stop(false)
+    {
+        glfwWindowHint(GLFW_VISIBLE, false);
+        context = glfwCreateWindow(1, 1, "", NULL, share);
+        glfwWindowHint(GLFW_VISIBLE, true);
+        if (context == NULL)
+        {
+            std::cout << "ERROR::UPLOAD_THREAD:: Could not create a shared context, uploading on the render thread" << std::endl;
+            return;
+        }
+        staging.resize(std::max(stagingBuffers, 1u));
+        thread = std::thread(&UploadThread::work, this);
+    }
+
+    // finishes the queued work; done functions that haven't run by now are dropped
+    ~UploadThread()
+    {
+        if (context == NULL)
+            return;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stop = true;
+        }
+        wake.notify_all();
+        thread.join();
+        for (Job &job : finished)
+            glDeleteSync(job.Fence);
+        glfwDestroyWindow(context);
+    }
+
+    // queues work for the upload thread; once the GPU has finished the commands it issued, done is called by Poll on
+    // the render thread. Without a shared context both run right away on the calling (render) thread.
+    void Run(std::function<void()> work, std::function<void()> done = std::function<void()>())
+    {
+        Job job;
+        job.Work = work;
+        job.Done = done;
+        job.Fence = 0;
+        if (context == NULL)
+        {
+            work();
+            if (done)
+                done();
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            queue.push_back(job);
+            pending++;
+        }
+        wake.notify_one();
+    }
+
+    // on the render thread, every frame: hands over finished work, in the order it was queued. Returns the number of
+    // jobs still pending.
+    unsigned int Poll()
+    {
+        while (true)
+        {
+            Job job;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (finished.empty())
+                    return pending;
+                // a fence never signaled without having been flushed, which the upload thread did
+                GLenum status = glClientWaitSync(finished.front().Fence, 0, 0);
+                if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+                    return pending;
+                job = finished.front();
+                finished.pop_front();
+                pending--;
+            }
+            glDeleteSync(job.Fence);
+            if (job.Done)
+                job.Done();
+        }
+    }
+
+    // on the render thread: blocks until all queued work is handed over
+    void Finish()
+    {
+        while (Poll() > 0)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    unsigned int Pending()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return pending;
+    }
+
+    // the following are for work running on the upload thread (or on the render thread when there is no shared
+    // context). They leave the created object bound.
+    // ----------------------------------------------------------------------------------------------------------
+    // creates a texture from 8-bit mip levels
+    unsigned int UploadTexture(const std::vector<MipLevel> &levels, GLint internalFormat, GLenum format)
+    {
+        unsigned int texture;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        for (size_t i = 0; i < levels.size(); ++i)
+        {
+            const MipLevel &level = levels[i];
+            size_t rowBytes = level.Data.size() / level.Height;
+            glTexImage2D(GL_TEXTURE_2D, (GLint)i, internalFormat, level.Width, level.Height, 0, format, GL_UNSIGNED_BYTE, NULL);
+            // in strips of rows that fit in a staging buffer
+            unsigned int rows = (unsigned int)std::max<size_t>(stagingSize / rowBytes, 1);
+            for (unsigned int y = 0; y < level.Height; y += rows)
+            {
+                unsigned int height = std::min(rows, level.Height - y);
+                const void *pixels = stage(&level.Data[y * rowBytes], height * rowBytes, GL_PIXEL_UNPACK_BUFFER);
+                glTexSubImage2D(GL_TEXTURE_2D, (GLint)i, 0, y, level.Width, height, format, GL_UNSIGNED_BYTE, pixels);
+                unstage(GL_PIXEL_UNPACK_BUFFER);
+            }
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)levels.size() - 1);
+        return texture;
+    }
+
+    // creates a texture from a block-compressed image, uploading all of its levels as is
+    unsigned int UploadTexture(const CompressedImage &image)
+    {
+        unsigned int texture;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        unsigned int width = image.Width, height = image.Height;
+        for (size_t i = 0; i < image.Levels.size(); ++i)
+        {
+            const std::vector<unsigned char> &level = image.Levels[i];
+            glCompressedTexImage2D(GL_TEXTURE_2D, (GLint)i, image.InternalFormat(), width, height, 0, (GLsizei)level.size(), NULL);
+            // in strips of block rows (4 pixels high) that fit in a staging buffer
+            size_t rowBytes = CompressedImage::LevelBytes(image.Format, width, 4);
+            unsigned int rows = (unsigned int)std::max<size_t>(stagingSize / rowBytes, 1) * 4;
+            for (unsigned int y = 0; y < height; y += rows)
+            {
+                unsigned int strip = std::min(rows, height - y);
+                size_t bytes = CompressedImage::LevelBytes(image.Format, width, strip);
+                const void *blocks = stage(&level[y / 4 * rowBytes], bytes, GL_PIXEL_UNPACK_BUFFER);
+                glCompressedTexSubImage2D(GL_TEXTURE_2D, (GLint)i, 0, y, width, strip, image.InternalFormat(), (GLsizei)bytes, blocks);
+                unstage(GL_PIXEL_UNPACK_BUFFER);
+            }
+            width = std::max(width / 2, 1u);
+            height = std::max(height / 2, 1u);
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)image.Levels.size() - 1);
+        return texture;
+    }
+
+    // creates a buffer object (bound to GL_COPY_WRITE_BUFFER, buffers can be bound to any target later)
+    unsigned int UploadBuffer(const void *data, size_t bytes, GLenum usage = GL_STATIC_DRAW)
+    {
+        unsigned int buffer;
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, bytes, context == NULL ? data : NULL, usage);
+        if (context == NULL)
+            return buffer;
+        for (size_t start = 0; start < bytes; start += stagingSize)
+        {
+            size_t size = std::min(stagingSize, bytes - start);
+            size_t source = (size_t)stage((const char*)data + start, size, GL_COPY_READ_BUFFER);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, source, start, size);
+            unstage(GL_COPY_READ_BUFFER);
+        }
+        return buffer;
+    }
+
+private:
+    struct Job
+    {
+        std::function<void()> Work, Done;
+        GLsync Fence;
+    };
+
+    // a staging buffer and the fence after the last command reading from it
+    struct Staging
+    {
+        unsigned int Buffer;
+        GLsync Fence;
+    };
+
+    GLFWwindow *context;
+    std::thread thread;
+    std::vector<Staging> staging;
+    size_t stagingSize;
+    // the staging buffer being filled and how far
+    unsigned int current;
+    size_t offset;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<Job> queue, finished;
+    unsigned int pending;
+    bool stop;
+
+    // copies data into the staging ring and binds its buffer to target; returns the offset into it to pass to the
+    // command reading from it, after which unstage must be called. Without a shared context, or if the data doesn't fit
+    // in a staging buffer, nothing is bound and the data itself is returned.
+    const void *stage(const void *data, size_t bytes, GLenum target)
+    {
+        if (context == NULL || bytes > stagingSize)
+            return data;
+        if (offset + bytes > stagingSize)
+        {
+            // move on to the next buffer, once the GPU is done with it
+            current = (current + 1) % staging.size();
+            offset = 0;
+            Staging &next = staging[current];
+            if (next.Fence != 0)
+            {
+                if (glClientWaitSync(next.Fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+                {
+                    Stalls++;
+                    while (glClientWaitSync(next.Fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED)
+                        ;
+                }
+                glDeleteSync(next.Fence);
+                next.Fence = 0;
+            }
+        }
+        Staging &buffer = staging[current];
+        glBindBuffer(target, buffer.Buffer);
+        // the range isn't in use by the GPU (everything before the ring last came around to this buffer has passed
+        // its fence), so there is no need for the driver to synchronize
+        void *memory = glMapBufferRange(target, offset, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+        std::memcpy(memory, data, bytes);
+        glUnmapBuffer(target);
+        StagedBytes += bytes;
+        const void *position = (const void*)offset;
+        // keep ranges aligned for any pixel format and copy
+        offset = (offset + bytes + 63) & ~(size_t)63;
+        return position;
+    }
+
+    void unstage(GLenum target)
+    {
+        if (context == NULL)
+            return;
+        Staging &buffer = staging[current];
+        if (buffer.Fence != 0)
+            glDeleteSync(buffer.Fence);
+        buffer.Fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        glBindBuffer(target, 0);
+    }
+
+    void work()
+    {
+        glfwMakeContextCurrent(context);
+        for (Staging &buffer : staging)
+        {
+            glGenBuffers(1, &buffer.Buffer);
+            glBindBuffer(GL_COPY_READ_BUFFER, buffer.Buffer);
+            glBufferData(GL_COPY_READ_BUFFER, stagingSize, NULL, GL_STREAM_DRAW);
+            buffer.Fence = 0;
+        }
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        // the first staging call moves on to the first buffer
+        current = (unsigned int)staging.size() - 1;
+        offset = stagingSize;
+
+        while (true)
+        {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [this]() { return stop || !queue.empty(); });
+                if (queue.empty())
+                    break;
+                job = queue.front();
+                queue.pop_front();
+            }
+            job.Work();
+            // the render thread may use the results once the GPU has passed this fence; flushing makes sure it gets
+            // there
+            job.Fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            glFlush();
+            std::lock_guard<std::mutex> lock(mutex);
+            finished.push_back(job);
+        }
+
+        for (Staging &buffer : staging)
+        {
+            if (buffer.Fence != 0)
+                glDeleteSync(buffer.Fence);
+            glDeleteBuffers(1, &buffer.Buffer);
+        }
+        glFinish();
+        glfwMakeContextCurrent(NULL);
+    }
+};
+#endif
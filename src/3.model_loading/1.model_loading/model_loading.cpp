@@ -82,7 +82,11 @@ int main()
 
     // load models
     // -----------
-    Model ourModel(FileSystem::getPath("resources/objects/backpack/backpack.obj"));
+    // textures baked by the texture baker are streamed: only the mip levels the model needs at its size on screen are
+    // kept in video memory, within a 32 MB budget
+    TextureStreamer streamer(32 * 1024 * 1024);
+    Model ourModel(FileSystem::getPath("resources/objects/backpack/backpack.obj"), false, &streamer);
+    float lastReport = 0.0f;
 
     
     // draw in wireframe
@@ -123,6 +127,18 @@ int main()
         ourShader.setMat4("model", model);
         ourModel.Draw(ourShader);
 
+        // texture streaming: feedback from the model's size on screen (it fits in a sphere of radius 2), then load and
+        // evict mip levels
+        float distance = glm::length(camera.Position);
+        ourModel.RequestTextures(TextureStreamer::ScreenSize(2.0f, distance, glm::radians(camera.Zoom), (float)SCR_HEIGHT));
+        streamer.Update();
+        if (streamer.Size() > 0 && currentFrame - lastReport > 2.0f)
+        {
+            std::cout << "Streaming: " << streamer.ResidentBytes / 1024 << " KB resident (" << streamer.StreamedBytes / 1024 << " KB streamed, budget "
+                      << streamer.Budget / 1024 << " KB), " << streamer.Loads << " loads, " << streamer.Evictions << " evictions, latency "
+                      << streamer.AverageLatency() << " ms average, " << streamer.MaxLatency << " ms max" << std::endl;
+            lastReport = currentFrame;
+        }
 
         // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
         // -------------------------------------------------------------------------------
@@ -79,10 +79,13 @@ int main()
     Shader asteroidShader("10.3.asteroids.vs", "10.3.asteroids.fs");
     Shader planetShader("10.3.planet.vs", "10.3.planet.fs");
 
-    // load models
-    // -----------
-    Model rock(FileSystem::getPath("resources/objects/rock/rock.obj"));
-    Model planet(FileSystem::getPath("resources/objects/planet/planet.obj"));
+    // load models, in the background: file parsing, image decoding and the uploads run on a thread with its own
+    // (shared) context, while the render loop keeps going and draws each model once it's in
+    // ---------------------------------------------------------------------------------------------------------------
+    UploadThread *uploader = new UploadThread(window);
+    float loadStart = glfwGetTime();
+    Model rock(FileSystem::getPath("resources/objects/rock/rock.obj"), false, nullptr, uploader);
+    Model planet(FileSystem::getPath("resources/objects/planet/planet.obj"), false, nullptr, uploader);
 
     // generate a large list of semi-random model transformation matrices
     // ------------------------------------------------------------------
@@ -124,34 +127,11 @@ int main()
     glBindBuffer(GL_ARRAY_BUFFER, buffer);
     glBufferData(GL_ARRAY_BUFFER, amount * sizeof(glm::mat4), &modelMatrices[0], GL_STATIC_DRAW);
 
-    // set transformation matrices as an instance vertex attribute (with divisor 1)
-    // note: we're cheating a little by taking the, now publicly declared, VAO of the model's mesh(es) and adding new vertexAttribPointers
-    // normally you'd want to do this in a more organized fashion, but for learning purposes this will do.
-    // -----------------------------------------------------------------------------------------------------------------------------------
-    for (unsigned int i = 0; i < rock.meshes.size(); i++)
-    {
-        unsigned int VAO = rock.meshes[i].VAO;
-        glBindVertexArray(VAO);
-        // set attribute pointers for matrix (4 times vec4)
-        glEnableVertexAttribArray(3);
-        glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)0);
-        glEnableVertexAttribArray(4);
-        glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(sizeof(glm::vec4)));
-        glEnableVertexAttribArray(5);
-        glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(2 * sizeof(glm::vec4)));
-        glEnableVertexAttribArray(6);
-        glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(3 * sizeof(glm::vec4)));
-
-        glVertexAttribDivisor(3, 1);
-        glVertexAttribDivisor(4, 1);
-        glVertexAttribDivisor(5, 1);
-        glVertexAttribDivisor(6, 1);
-
-        glBindVertexArray(0);
-    }
-
     // render loop
     // -----------
+    bool loading = true, instanced = false;
+    float longestFrame = 0.0f;
+    lastFrame = glfwGetTime();
     while (!glfwWindowShouldClose(window))
     {
         // per-frame time logic
@@ -160,6 +140,51 @@ int main()
         deltaTime = currentFrame - lastFrame;
         lastFrame = currentFrame;
 
+        // take over the models loaded in the background; report how long that took and the longest frame meanwhile
+        // ----------------------------------------------------------------------------------------------------------
+        if (loading)
+        {
+            longestFrame = std::max(longestFrame, deltaTime);
+            if (uploader->Poll() == 0)
+            {
+                std::cout << "models loaded in " << (currentFrame - loadStart) * 1000.0f << " ms, longest frame meanwhile "
+                          << longestFrame * 1000.0f << " ms (" << uploader->StagedBytes / 1024 << " KB staged, "
+                          << uploader->Stalls << " staging stalls)" << std::endl;
+                loading = false;
+            }
+        }
+
+        // set transformation matrices as an instance vertex attribute (with divisor 1), once the rock is in
+        // note: we're cheating a little by taking the, now publicly declared, VAO of the model's mesh(es) and adding new vertexAttribPointers
+        // normally you'd want to do this in a more organized fashion, but for learning purposes this will do.
+        // -----------------------------------------------------------------------------------------------------------------------------------
+        if (rock.ready && !instanced)
+        {
+            glBindBuffer(GL_ARRAY_BUFFER, buffer);
+            for (unsigned int i = 0; i < rock.meshes.size(); i++)
+            {
+                unsigned int VAO = rock.meshes[i].VAO;
+                glBindVertexArray(VAO);
+                // set attribute pointers for matrix (4 times vec4)
+                glEnableVertexAttribArray(3);
+                glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)0);
+                glEnableVertexAttribArray(4);
+                glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(sizeof(glm::vec4)));
+                glEnableVertexAttribArray(5);
+                glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(2 * sizeof(glm::vec4)));
+                glEnableVertexAttribArray(6);
+                glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(3 * sizeof(glm::vec4)));
+
+                glVertexAttribDivisor(3, 1);
+                glVertexAttribDivisor(4, 1);
+                glVertexAttribDivisor(5, 1);
+                glVertexAttribDivisor(6, 1);
+
+                glBindVertexArray(0);
+            }
+            instanced = true;
+        }
+
         // input
         // -----
         processInput(window);
@@ -187,6 +212,12 @@ int main()
         planet.Draw(planetShader);
 
         // draw meteorites
+        if (!instanced)
+        {
+            glfwSwapBuffers(window);
+            glfwPollEvents();
+            continue;
+        }
         asteroidShader.use();
         asteroidShader.setInt("texture_diffuse1", 0);
         glActiveTexture(GL_TEXTURE0);
@@ -204,6 +235,7 @@ int main()
         glfwPollEvents();
     }
 
+    delete uploader;
     glfwTerminate();
     return 0;
 }
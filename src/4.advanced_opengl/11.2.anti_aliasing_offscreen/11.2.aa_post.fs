@@ -4,10 +4,13 @@ out vec4 FragColor;
 in vec2 TexCoords;
 
 uniform sampler2D screenTexture;
+uniform float exposure;
 
 void main()
 {
     vec3 col = texture(screenTexture, TexCoords).rgb;
+    // exposure tone mapping of the (resolved) HDR scene
+    col = vec3(1.0) - exp(-col * exposure);
     float grayscale = 0.2126 * col.r + 0.7152 * col.g + 0.0722 * col.b;
     FragColor = vec4(vec3(grayscale), 1.0);
-} 
\ No newline at end of file
+} 
@@ -3,5 +3,6 @@ out vec4 FragColor;
 
 void main()
 {
-    FragColor = vec4(0.0, 1.0, 0.0, 1.0);
-} 
\ No newline at end of file
+    // HDR color: bright edges against the dark background are where a naive resolve produces fireflies
+    FragColor = vec4(0.0, 8.0, 0.0, 1.0);
+}
@@ -0,0 +1,27 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2DMS screenTextureMS;
+uniform int samples;
+uniform float exposure;
+
+// tonemap-aware resolve: every sample is weighted by the inverse of its (exposed) luminance before averaging.
+// A plain box filter lets a single very bright sample turn a whole edge pixel bright, which shows up as fireflies
+// once the result is tonemapped; the weighting approximates averaging in tonemapped space while staying in HDR.
+void main()
+{
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+    vec3 color = vec3(0.0);
+    float weightSum = 0.0;
+    for (int i = 0; i < samples; i++)
+    {
+        vec3 sampleColor = texelFetch(screenTextureMS, texel, i).rgb;
+        float luminance = dot(sampleColor * exposure, vec3(0.2126, 0.7152, 0.0722));
+        float weight = 1.0 / (1.0 + luminance);
+        color += sampleColor * weight;
+        weightSum += weight;
+    }
+    FragColor = vec4(color / weightSum, 1.0);
+}
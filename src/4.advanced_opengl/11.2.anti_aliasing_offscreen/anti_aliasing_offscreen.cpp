@@ -10,6 +10,8 @@
 #include <learnopengl/shader.h>
 #include <learnopengl/camera.h>
 #include <learnopengl/model.h>
+#include <learnopengl/msaa.h>
+#include <learnopengl/gpu_timer.h>
 
 #include <iostream>
 
@@ -21,6 +23,11 @@ void processInput(GLFWwindow *window);
 // settings
 const unsigned int SCR_WIDTH = 800;
 const unsigned int SCR_HEIGHT = 600;
+const unsigned int sampleCounts[] = { 2, 4, 8 };
+unsigned int sampleCountIndex = 1;
+bool shaderResolve = true;
+bool resolveKeyPressed = false;
+float exposure = 1.0f;
 
 // camera
 Camera camera(glm::vec3(0.0f, 0.0f, 3.0f));
@@ -78,6 +85,7 @@ int main()
     // -------------------------
     Shader shader("11.2.anti_aliasing.vs", "11.2.anti_aliasing.fs");
     Shader screenShader("11.2.aa_post.vs", "11.2.aa_post.fs");
+    Shader resolveShader("11.2.aa_post.vs", "11.2.msaa_resolve.fs");
 
     // set up vertex data (and buffer(s)) and configure vertex attributes
     // ------------------------------------------------------------------
@@ -159,49 +167,23 @@ int main()
 
     // configure MSAA framebuffer
     // --------------------------
-    unsigned int framebuffer;
-    glGenFramebuffers(1, &framebuffer);
-    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
-    // create a multisampled color attachment texture
-    unsigned int textureColorBufferMultiSampled;
-    glGenTextures(1, &textureColorBufferMultiSampled);
-    glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, textureColorBufferMultiSampled);
-    glTexImage2DMultisample(GL_TEXTURE_2D_MULTISAMPLE, 4, GL_RGB, SCR_WIDTH, SCR_HEIGHT, GL_TRUE);
-    glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, 0);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D_MULTISAMPLE, textureColorBufferMultiSampled, 0);
-    // create a (also multisampled) renderbuffer object for depth and stencil attachments
-    unsigned int rbo;
-    glGenRenderbuffers(1, &rbo);
-    glBindRenderbuffer(GL_RENDERBUFFER, rbo);
-    glRenderbufferStorageMultisample(GL_RENDERBUFFER, 4, GL_DEPTH24_STENCIL8, SCR_WIDTH, SCR_HEIGHT);
-    glBindRenderbuffer(GL_RENDERBUFFER, 0);
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, rbo);
-
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-        cout << "ERROR::FRAMEBUFFER:: Framebuffer is not complete!" << endl;
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-    // configure second post-processing framebuffer
-    unsigned int intermediateFBO;
-    glGenFramebuffers(1, &intermediateFBO);
-    glBindFramebuffer(GL_FRAMEBUFFER, intermediateFBO);
-    // create a color attachment texture
-    unsigned int screenTexture;
-    glGenTextures(1, &screenTexture);
-    glBindTexture(GL_TEXTURE_2D, screenTexture);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, screenTexture, 0);	// we only need a color buffer
-
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-        cout << "ERROR::FRAMEBUFFER:: Intermediate framebuffer is not complete!" << endl;
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    // a floating point color buffer with a selectable sample count (keys 1-3: 2x, 4x, 8x); depth is only used for
+    // depth testing, so it stays an unresolved renderbuffer. The framebuffer clamps its sample count to what the GPU
+    // supports, so the requested count is kept separately to tell when the selection changes
+    unsigned int requestedSamples = sampleCounts[sampleCountIndex];
+    MultisampleFramebuffer *msaa = new MultisampleFramebuffer(SCR_WIDTH, SCR_HEIGHT, requestedSamples, GL_RGBA16F);
+
+    // GPU timer for the resolve
+    GpuTimer *resolveTimer = new GpuTimer();
+    double lastReport = glfwGetTime();
 
     // shader configuration
     // --------------------
-    shader.use();
+    screenShader.use();
     screenShader.setInt("screenTexture", 0);
+    screenShader.setFloat("exposure", exposure);
+    resolveShader.use();
+    resolveShader.setFloat("exposure", exposure);
 
     // render loop
     // -----------
@@ -216,14 +198,17 @@ int main()
         // input
         // -----
         processInput(window);
+        if (requestedSamples != sampleCounts[sampleCountIndex])
+        {
+            requestedSamples = sampleCounts[sampleCountIndex];
+            delete msaa;
+            msaa = new MultisampleFramebuffer(SCR_WIDTH, SCR_HEIGHT, requestedSamples, GL_RGBA16F);
+        }
 
         // render
         // ------
-        glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
         // 1. draw scene as normal in multisampled buffers
-        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        msaa->Bind();
         glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         glEnable(GL_DEPTH_TEST);
@@ -238,13 +223,15 @@ int main()
         glBindVertexArray(cubeVAO);
         glDrawArrays(GL_TRIANGLES, 0, 36);
 
-        // 2. now blit multisampled buffer(s) to normal colorbuffer of intermediate FBO. Image is stored in screenTexture
-        glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
-        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, intermediateFBO);
-        glBlitFramebuffer(0, 0, SCR_WIDTH, SCR_HEIGHT, 0, 0, SCR_WIDTH, SCR_HEIGHT, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        // 2. now resolve the multisampled buffer into a normal colorbuffer, either by blitting or with the
+        // tonemap-aware resolve shader. The image is stored in the MSAA framebuffer's ResolvedColor texture
+        resolveTimer->Begin();
+        msaa->Resolve(shaderResolve ? RESOLVE_SHADER : RESOLVE_BLIT, &resolveShader);
+        resolveTimer->End();
 
         // 3. now render quad with scene's visuals as its texture image
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
         glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT);
         glDisable(GL_DEPTH_TEST);
@@ -253,15 +240,27 @@ int main()
         screenShader.use();
         glBindVertexArray(quadVAO);
         glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, screenTexture); // use the now resolved color attachment as the quad's texture
+        glBindTexture(GL_TEXTURE_2D, msaa->ResolvedColor); // use the now resolved color attachment as the quad's texture
         glDrawArrays(GL_TRIANGLES, 0, 6);
 
+        // report the averaged resolve cost once a second
+        if (currentFrame - lastReport >= 1.0)
+        {
+            std::cout << "MSAA " << msaa->Samples << "x | " << (shaderResolve ? "tonemap-aware shader" : "blit") << " resolve: "
+                      << resolveTimer->AverageMs() << " ms | memory: " << msaa->MemoryBytes() / (1024.0 * 1024.0) << " MB" << std::endl;
+            resolveTimer->Reset();
+            lastReport = currentFrame;
+        }
+
         // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
         // -------------------------------------------------------------------------------
         glfwSwapBuffers(window);
         glfwPollEvents();
     }
 
+    delete msaa;
+    delete resolveTimer;
+
     glfwTerminate();
     return 0;
 }
@@ -281,6 +280,19 @@ void processInput(GLFWwindow *window)
         camera.ProcessKeyboard(LEFT, deltaTime);
     if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
         camera.ProcessKeyboard(RIGHT, deltaTime);
+
+    // keys 1-3 select 2x, 4x or 8x MSAA
+    for (unsigned int i = 0; i < 3; i++)
+        if (glfwGetKey(window, GLFW_KEY_1 + i) == GLFW_PRESS)
+            sampleCountIndex = i;
+    // space toggles between the blit and the tonemap-aware shader resolve
+    if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS && !resolveKeyPressed)
+    {
+        shaderResolve = !shaderResolve;
+        resolveKeyPressed = true;
+    }
+    if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_RELEASE)
+        resolveKeyPressed = false;
 }
 
 // glfw: whenever the window size changed (by OS or user resize) this callback function executes
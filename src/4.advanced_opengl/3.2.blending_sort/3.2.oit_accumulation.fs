@@ -0,0 +1,20 @@
+#version 330 core
+// weighted blended order-independent transparency (McGuire & Bavoil 2013)
+// attachment 0: rgb = sum(color * alpha * weight), a = product(1 - alpha) (the revealage)
+// attachment 1: r   = sum(alpha * weight)
+// both are produced with a single blend state: additive rgb, multiplicative alpha
+layout (location = 0) out vec4 accum;
+layout (location = 1) out float weightSum;
+
+in vec2 TexCoords;
+
+uniform sampler2D texture1;
+
+void main()
+{
+    vec4 color = texture(texture1, TexCoords);
+    // weight fragments close to the camera and with high coverage more strongly
+    float weight = clamp(pow(min(1.0, color.a * 10.0) + 0.01, 3.0) * 1e8 * pow(1.0 - gl_FragCoord.z * 0.9, 3.0), 1e-2, 3e3);
+    accum = vec4(color.rgb * color.a * weight, color.a);
+    weightSum = color.a * weight;
+}
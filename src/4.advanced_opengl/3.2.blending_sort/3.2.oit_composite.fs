@@ -0,0 +1,20 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D accumTexture;
+uniform sampler2D weightTexture;
+
+void main()
+{
+    vec4 accum = texture(accumTexture, TexCoords);
+    float revealage = accum.a;
+    // nothing transparent covers this pixel: keep the opaque color
+    if (revealage >= 1.0)
+        discard;
+    float weightSum = texture(weightTexture, TexCoords).r;
+    vec3 averageColor = accum.rgb / max(weightSum, 1e-5);
+    // blended over the opaque scene with GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA
+    FragColor = vec4(averageColor, 1.0 - revealage);
+}
@@ -10,19 +10,29 @@
 #include <learnopengl/shader_m.h>
 #include <learnopengl/camera.h>
 #include <learnopengl/model.h>
+#include <learnopengl/gpu_timer.h>
+#include <learnopengl/radix_sort.h>
 
 #include <iostream>
+#include <random>
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 void processInput(GLFWwindow *window);
 unsigned int loadTexture(const char *path);
+void generateWindows(std::vector<glm::vec3> &windows, unsigned int count);
 
 // settings
 const unsigned int SCR_WIDTH = 800;
 const unsigned int SCR_HEIGHT = 600;
 
+// transparency
+bool useOIT = true;
+bool oitKeyPressed = false;
+const unsigned int windowCounts[] = { 10, 100, 1000, 10000, 100000 };
+unsigned int windowCountIndex = 0;
+
 // camera
 Camera camera(glm::vec3(0.0f, 0.0f, 3.0f));
 float lastX = (float)SCR_WIDTH / 2.0;
@@ -80,6 +90,9 @@ int main()
     // build and compile shaders
     // -------------------------
     Shader shader("3.2.blending.vs", "3.2.blending.fs");
+    Shader shaderInstanced("3.2.blending_instanced.vs", "3.2.blending.fs");
+    Shader shaderAccumulation("3.2.blending_instanced.vs", "3.2.oit_accumulation.fs");
+    Shader shaderComposite("3.2.oit_composite.vs", "3.2.oit_composite.fs");
 
     // set up vertex data (and buffer(s)) and configure vertex attributes
     // ------------------------------------------------------------------
@@ -189,20 +202,106 @@ int main()
     unsigned int transparentTexture = loadTexture(FileSystem::getPath("resources/textures/window.png").c_str());
 
     // transparent window locations
-    // --------------------------------
-    vector<glm::vec3> windows
-    {
-        glm::vec3(-1.5f, 0.0f, -0.48f),
-        glm::vec3( 1.5f, 0.0f, 0.51f),
-        glm::vec3( 0.0f, 0.0f, 0.7f),
-        glm::vec3(-0.3f, 0.0f, -2.3f),
-        glm::vec3( 0.5f, 0.0f, -0.6f)
+    // ----------------------------
+    // the window count is switched at runtime (keys 1-5) to compare both transparency paths from 10 up to 100k windows
+    std::vector<glm::vec3> windows;
+    std::vector<glm::vec3> sortedWindows;
+    RadixSorter sorter;
+    generateWindows(windows, windowCounts[windowCountIndex]);
+
+    // instance buffer holding the window offsets (in back-to-front order for the sorted path)
+    unsigned int instanceVBO;
+    glGenBuffers(1, &instanceVBO);
+    glBindVertexArray(transparentVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
+    glVertexAttribDivisor(2, 1); // tell OpenGL this is an instanced vertex attribute.
+    glBindVertexArray(0);
+
+    // screen quad VAO for the OIT composite pass
+    float quadVertices[] = {
+        // positions   // texCoords
+        -1.0f,  1.0f,  0.0f, 1.0f,
+        -1.0f, -1.0f,  0.0f, 0.0f,
+         1.0f, -1.0f,  1.0f, 0.0f,
+
+        -1.0f,  1.0f,  0.0f, 1.0f,
+         1.0f, -1.0f,  1.0f, 0.0f,
+         1.0f,  1.0f,  1.0f, 1.0f
     };
+    unsigned int quadVAO, quadVBO;
+    glGenVertexArrays(1, &quadVAO);
+    glGenBuffers(1, &quadVBO);
+    glBindVertexArray(quadVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), &quadVertices, GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
+    glBindVertexArray(0);
+
+    // opaque framebuffer: the opaque scene's depth buffer is shared with the OIT framebuffer for depth testing
+    // ----------------------------------------------------------------------------------------------------------
+    unsigned int opaqueFBO, opaqueColor, depthTexture;
+    glGenFramebuffers(1, &opaqueFBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, opaqueFBO);
+    glGenTextures(1, &opaqueColor);
+    glBindTexture(GL_TEXTURE_2D, opaqueColor);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, opaqueColor, 0);
+    glGenTextures(1, &depthTexture);
+    glBindTexture(GL_TEXTURE_2D, depthTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, SCR_WIDTH, SCR_HEIGHT, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthTexture, 0);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cout << "ERROR::FRAMEBUFFER:: Opaque framebuffer is not complete!" << std::endl;
+
+    // OIT framebuffer: accumulation (rgb: premultiplied color sum, a: revealage) and weight sum targets
+    // ---------------------------------------------------------------------------------------------------
+    unsigned int oitFBO, accumTexture, weightTexture;
+    glGenFramebuffers(1, &oitFBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, oitFBO);
+    glGenTextures(1, &accumTexture);
+    glBindTexture(GL_TEXTURE_2D, accumTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGBA, GL_FLOAT, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, accumTexture, 0);
+    glGenTextures(1, &weightTexture);
+    glBindTexture(GL_TEXTURE_2D, weightTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R16F, SCR_WIDTH, SCR_HEIGHT, 0, GL_RED, GL_FLOAT, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, weightTexture, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthTexture, 0);
+    unsigned int attachments[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+    glDrawBuffers(2, attachments);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cout << "ERROR::FRAMEBUFFER:: OIT framebuffer is not complete!" << std::endl;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    // GPU timer for the transparent pass
+    GpuTimer *transparentTimer = new GpuTimer();
+    double sortTime = 0.0, lastReport = glfwGetTime();
+    unsigned int frames = 0;
 
     // shader configuration
     // --------------------
     shader.use();
     shader.setInt("texture1", 0);
+    shaderInstanced.use();
+    shaderInstanced.setInt("texture1", 0);
+    shaderAccumulation.use();
+    shaderAccumulation.setInt("texture1", 0);
+    shaderComposite.use();
+    shaderComposite.setInt("accumTexture", 0);
+    shaderComposite.setInt("weightTexture", 1);
 
     // render loop
     // -----------
@@ -217,22 +316,17 @@ int main()
         // input
         // -----
         processInput(window);
-
-        // sort the transparent windows before rendering
-        // ---------------------------------------------
-        std::map<float, glm::vec3> sorted;
-        for (unsigned int i = 0; i < windows.size(); i++)
-        {
-            float distance = glm::length(camera.Position - windows[i]);
-            sorted[distance] = windows[i];
-        }
+        if (windows.size() != windowCounts[windowCountIndex])
+            generateWindows(windows, windowCounts[windowCountIndex]);
 
         // render
         // ------
+        glBindFramebuffer(GL_FRAMEBUFFER, opaqueFBO);
         glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        // draw objects
+        // draw opaque objects
+        glDisable(GL_BLEND);
         shader.use();
         glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
         glm::mat4 view = camera.GetViewMatrix();
@@ -256,17 +350,89 @@ int main()
         model = glm::mat4(1.0f);
         shader.setMat4("model", model);
         glDrawArrays(GL_TRIANGLES, 0, 6);
-        // windows (from furthest to nearest)
+
+        // draw windows: a single instanced draw call in either mode
+        transparentTimer->Begin();
         glBindVertexArray(transparentVAO);
         glBindTexture(GL_TEXTURE_2D, transparentTexture);
-        for (std::map<float, glm::vec3>::reverse_iterator it = sorted.rbegin(); it != sorted.rend(); ++it)
+        if (useOIT)
         {
-            model = glm::mat4(1.0f);
-            model = glm::translate(model, it->second);
-            shader.setMat4("model", model);
+            // 1. accumulate all windows in any order; depth testing against the opaque scene, no depth writes
+            glBindFramebuffer(GL_FRAMEBUFFER, oitFBO);
+            float clearAccum[4] = { 0.0f, 0.0f, 0.0f, 1.0f }; // revealage starts at 1: nothing covers the pixel
+            float clearWeight[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+            glClearBufferfv(GL_COLOR, 0, clearAccum);
+            glClearBufferfv(GL_COLOR, 1, clearWeight);
+            glDepthMask(GL_FALSE);
+            glEnable(GL_BLEND);
+            glBlendFuncSeparate(GL_ONE, GL_ONE, GL_ZERO, GL_ONE_MINUS_SRC_ALPHA);
+            glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+            glBufferData(GL_ARRAY_BUFFER, windows.size() * sizeof(glm::vec3), &windows[0], GL_STREAM_DRAW);
+            shaderAccumulation.use();
+            shaderAccumulation.setMat4("projection", projection);
+            shaderAccumulation.setMat4("view", view);
+            glDrawArraysInstanced(GL_TRIANGLES, 0, 6, windows.size());
+            glDepthMask(GL_TRUE);
+        }
+        else
+        {
+            // sort windows back-to-front with a radix sort on their (negated) distance; equal distances keep a stable order
+            double sortStart = glfwGetTime();
+            sorter.Clear();
+            for (unsigned int i = 0; i < windows.size(); i++)
+            {
+                float distance = glm::length(camera.Position - windows[i]);
+                sorter.Push(RadixSorter::FloatToKey(-distance), i);
+            }
+            sorter.Sort();
+            sortedWindows.resize(windows.size());
+            for (unsigned int i = 0; i < windows.size(); i++)
+                sortedWindows[i] = windows[sorter.Values[i]];
+            sortTime += glfwGetTime() - sortStart;
+
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+            glBufferData(GL_ARRAY_BUFFER, sortedWindows.size() * sizeof(glm::vec3), &sortedWindows[0], GL_STREAM_DRAW);
+            shaderInstanced.use();
+            shaderInstanced.setMat4("projection", projection);
+            shaderInstanced.setMat4("view", view);
+            glDrawArraysInstanced(GL_TRIANGLES, 0, 6, sortedWindows.size());
+        }
+
+        // present: copy the opaque scene to the default framebuffer and composite the OIT result on top
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, opaqueFBO);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+        glBlitFramebuffer(0, 0, SCR_WIDTH, SCR_HEIGHT, 0, 0, SCR_WIDTH, SCR_HEIGHT, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        if (useOIT)
+        {
+            glDisable(GL_DEPTH_TEST);
+            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            shaderComposite.use();
+            glBindVertexArray(quadVAO);
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, accumTexture);
+            glActiveTexture(GL_TEXTURE1);
+            glBindTexture(GL_TEXTURE_2D, weightTexture);
             glDrawArrays(GL_TRIANGLES, 0, 6);
+            glActiveTexture(GL_TEXTURE0);
+            glEnable(GL_DEPTH_TEST);
         }
+        transparentTimer->End();
 
+        // report the averaged timings once a second
+        frames++;
+        if (currentFrame - lastReport >= 1.0)
+        {
+            std::cout << (useOIT ? "weighted blended OIT" : "radix sorted") << " | windows: " << windows.size()
+                      << " | transparent pass (GPU): " << transparentTimer->AverageMs() << " ms"
+                      << " | sort (CPU): " << sortTime * 1000.0 / frames << " ms" << std::endl;
+            transparentTimer->Reset();
+            sortTime = 0.0;
+            frames = 0;
+            lastReport = currentFrame;
+        }
 
         // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
         // -------------------------------------------------------------------------------
@@ -280,6 +446,14 @@ int main()
     glDeleteVertexArrays(1, &planeVAO);
     glDeleteBuffers(1, &cubeVBO);
     glDeleteBuffers(1, &planeVBO);
+    glDeleteVertexArrays(1, &transparentVAO);
+    glDeleteVertexArrays(1, &quadVAO);
+    glDeleteBuffers(1, &transparentVBO);
+    glDeleteBuffers(1, &instanceVBO);
+    glDeleteBuffers(1, &quadVBO);
+    glDeleteFramebuffers(1, &opaqueFBO);
+    glDeleteFramebuffers(1, &oitFBO);
+    delete transparentTimer;
 
     glfwTerminate();
     return 0;
@@ -300,6 +474,38 @@ void processInput(GLFWwindow *window)
         camera.ProcessKeyboard(LEFT, deltaTime);
     if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
         camera.ProcessKeyboard(RIGHT, deltaTime);
+
+    // space toggles between weighted blended OIT and the radix sorted path
+    if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS && !oitKeyPressed)
+    {
+        useOIT = !useOIT;
+        oitKeyPressed = true;
+    }
+    if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_RELEASE)
+        oitKeyPressed = false;
+    // keys 1-5 select the number of windows
+    for (unsigned int i = 0; i < 5; i++)
+        if (glfwGetKey(window, GLFW_KEY_1 + i) == GLFW_PRESS)
+            windowCountIndex = i;
+}
+
+// fills the scene with the 5 original windows, followed by randomly scattered ones up to the requested count
+// ----------------------------------------------------------------------------------------------------------
+void generateWindows(std::vector<glm::vec3> &windows, unsigned int count)
+{
+    windows.clear();
+    windows.push_back(glm::vec3(-1.5f, 0.0f, -0.48f));
+    windows.push_back(glm::vec3( 1.5f, 0.0f, 0.51f));
+    windows.push_back(glm::vec3( 0.0f, 0.0f, 0.7f));
+    windows.push_back(glm::vec3(-0.3f, 0.0f, -2.3f));
+    windows.push_back(glm::vec3( 0.5f, 0.0f, -0.6f));
+    // spread the windows over a volume that grows with their count so the scene stays readable
+    float extent = 2.0f * std::cbrt((float)count);
+    std::default_random_engine generator(count);
+    std::uniform_real_distribution<float> horizontal(-extent, extent);
+    std::uniform_real_distribution<float> vertical(0.0f, extent * 0.5f);
+    while (windows.size() < count)
+        windows.push_back(glm::vec3(horizontal(generator), vertical(generator), -horizontal(generator) - 3.0f));
 }
 
 // glfw: whenever the window size changed (by OS or user resize) this callback function executes
@@ -0,0 +1,132 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D screenTexture;
+uniform vec2 inverseScreenSize; // 1.0 / framebuffer size
+
+// FXAA (after Timothy Lottes' FXAA 3.11, PC quality preset): detect edges from local luma contrast,
+// search along the edge for its end points and blend across it proportionally to the pixel's position on the edge
+#define EDGE_THRESHOLD_MIN 0.0312
+#define EDGE_THRESHOLD_MAX 0.125
+#define SUBPIXEL_QUALITY 0.75
+#define ITERATIONS 12
+const float QUALITY[ITERATIONS] = float[](1.0, 1.0, 1.0, 1.0, 1.0, 1.5, 2.0, 2.0, 2.0, 2.0, 4.0, 8.0);
+
+float rgb2luma(vec3 rgb)
+{
+    // perceptual luma of the (already gamma encoded) color
+    return sqrt(dot(rgb, vec3(0.299, 0.587, 0.114)));
+}
+
+float lumaAt(vec2 uv)
+{
+    return rgb2luma(textureLod(screenTexture, uv, 0.0).rgb);
+}
+
+void main()
+{
+    vec3 colorCenter = texture(screenTexture, TexCoords).rgb;
+
+    // 1. luma of the pixel and its 4 direct neighbours; skip pixels without enough contrast
+    float lumaCenter = rgb2luma(colorCenter);
+    float lumaDown   = rgb2luma(textureOffset(screenTexture, TexCoords, ivec2( 0, -1)).rgb);
+    float lumaUp     = rgb2luma(textureOffset(screenTexture, TexCoords, ivec2( 0,  1)).rgb);
+    float lumaLeft   = rgb2luma(textureOffset(screenTexture, TexCoords, ivec2(-1,  0)).rgb);
+    float lumaRight  = rgb2luma(textureOffset(screenTexture, TexCoords, ivec2( 1,  0)).rgb);
+    float lumaMin = min(lumaCenter, min(min(lumaDown, lumaUp), min(lumaLeft, lumaRight)));
+    float lumaMax = max(lumaCenter, max(max(lumaDown, lumaUp), max(lumaLeft, lumaRight)));
+    float lumaRange = lumaMax - lumaMin;
+    if (lumaRange < max(EDGE_THRESHOLD_MIN, lumaMax * EDGE_THRESHOLD_MAX))
+    {
+        FragColor = vec4(colorCenter, 1.0);
+        return;
+    }
+
+    // 2. corners, then estimate whether the edge is horizontal or vertical
+    float lumaDownLeft  = rgb2luma(textureOffset(screenTexture, TexCoords, ivec2(-1, -1)).rgb);
+    float lumaUpRight   = rgb2luma(textureOffset(screenTexture, TexCoords, ivec2( 1,  1)).rgb);
+    float lumaUpLeft    = rgb2luma(textureOffset(screenTexture, TexCoords, ivec2(-1,  1)).rgb);
+    float lumaDownRight = rgb2luma(textureOffset(screenTexture, TexCoords, ivec2( 1, -1)).rgb);
+    float lumaDownUp    = lumaDown + lumaUp;
+    float lumaLeftRight = lumaLeft + lumaRight;
+    float lumaLeftCorners  = lumaDownLeft + lumaUpLeft;
+    float lumaDownCorners  = lumaDownLeft + lumaDownRight;
+    float lumaRightCorners = lumaDownRight + lumaUpRight;
+    float lumaUpCorners    = lumaUpRight + lumaUpLeft;
+    float edgeHorizontal = abs(-2.0 * lumaLeft + lumaLeftCorners) + abs(-2.0 * lumaCenter + lumaDownUp) * 2.0 + abs(-2.0 * lumaRight + lumaRightCorners);
+    float edgeVertical   = abs(-2.0 * lumaUp + lumaUpCorners) + abs(-2.0 * lumaCenter + lumaLeftRight) * 2.0 + abs(-2.0 * lumaDown + lumaDownCorners);
+    bool isHorizontal = edgeHorizontal >= edgeVertical;
+
+    // 3. pick the side of the pixel with the steepest gradient
+    float luma1 = isHorizontal ? lumaDown : lumaLeft;
+    float luma2 = isHorizontal ? lumaUp : lumaRight;
+    float gradient1 = luma1 - lumaCenter;
+    float gradient2 = luma2 - lumaCenter;
+    bool is1Steepest = abs(gradient1) >= abs(gradient2);
+    float gradientScaled = 0.25 * max(abs(gradient1), abs(gradient2));
+    float stepLength = isHorizontal ? inverseScreenSize.y : inverseScreenSize.x;
+    float lumaLocalAverage = 0.0;
+    if (is1Steepest)
+    {
+        stepLength = -stepLength;
+        lumaLocalAverage = 0.5 * (luma1 + lumaCenter);
+    }
+    else
+        lumaLocalAverage = 0.5 * (luma2 + lumaCenter);
+    // move half a pixel onto the edge
+    vec2 currentUv = TexCoords;
+    if (isHorizontal)
+        currentUv.y += stepLength * 0.5;
+    else
+        currentUv.x += stepLength * 0.5;
+
+    // 4. walk along the edge in both directions until the luma delta exceeds the local gradient
+    vec2 offset = isHorizontal ? vec2(inverseScreenSize.x, 0.0) : vec2(0.0, inverseScreenSize.y);
+    vec2 uv1 = currentUv - offset * QUALITY[0];
+    vec2 uv2 = currentUv + offset * QUALITY[0];
+    float lumaEnd1 = lumaAt(uv1) - lumaLocalAverage;
+    float lumaEnd2 = lumaAt(uv2) - lumaLocalAverage;
+    bool reached1 = abs(lumaEnd1) >= gradientScaled;
+    bool reached2 = abs(lumaEnd2) >= gradientScaled;
+    for (int i = 1; i < ITERATIONS && !(reached1 && reached2); i++)
+    {
+        if (!reached1)
+        {
+            uv1 -= offset * QUALITY[i];
+            lumaEnd1 = lumaAt(uv1) - lumaLocalAverage;
+            reached1 = abs(lumaEnd1) >= gradientScaled;
+        }
+        if (!reached2)
+        {
+            uv2 += offset * QUALITY[i];
+            lumaEnd2 = lumaAt(uv2) - lumaLocalAverage;
+            reached2 = abs(lumaEnd2) >= gradientScaled;
+        }
+    }
+
+    // 5. offset along the gradient based on the distance to the closest edge end
+    float distance1 = isHorizontal ? (TexCoords.x - uv1.x) : (TexCoords.y - uv1.y);
+    float distance2 = isHorizontal ? (uv2.x - TexCoords.x) : (uv2.y - TexCoords.y);
+    bool isDirection1 = distance1 < distance2;
+    float distanceFinal = min(distance1, distance2);
+    float edgeThickness = distance1 + distance2;
+    bool isLumaCenterSmaller = lumaCenter < lumaLocalAverage;
+    bool correctVariation = ((isDirection1 ? lumaEnd1 : lumaEnd2) < 0.0) != isLumaCenterSmaller;
+    float pixelOffset = correctVariation ? (-distanceFinal / edgeThickness + 0.5) : 0.0;
+
+    // 6. sub-pixel aliasing: blend with the 3x3 neighbourhood average for thin features
+    float lumaAverage = (1.0 / 12.0) * (2.0 * (lumaDownUp + lumaLeftRight) + lumaLeftCorners + lumaRightCorners);
+    float subPixelOffset1 = clamp(abs(lumaAverage - lumaCenter) / lumaRange, 0.0, 1.0);
+    float subPixelOffset2 = (-2.0 * subPixelOffset1 + 3.0) * subPixelOffset1 * subPixelOffset1;
+    float subPixelOffsetFinal = subPixelOffset2 * subPixelOffset2 * SUBPIXEL_QUALITY;
+    pixelOffset = max(pixelOffset, subPixelOffsetFinal);
+
+    vec2 finalUv = TexCoords;
+    if (isHorizontal)
+        finalUv.y += pixelOffset * stepLength;
+    else
+        finalUv.x += pixelOffset * stepLength;
+    FragColor = vec4(textureLod(screenTexture, finalUv, 0.0).rgb, 1.0);
+}
@@ -10,6 +10,8 @@
 #include <learnopengl/shader_m.h>
 #include <learnopengl/camera.h>
 #include <learnopengl/model.h>
+#include <learnopengl/msaa.h>
+#include <learnopengl/gpu_timer.h>
 
 #include <iostream>
 
@@ -23,6 +25,14 @@ unsigned int loadTexture(const char *path);
 const unsigned int SCR_WIDTH = 800;
 const unsigned int SCR_HEIGHT = 600;
 
+// anti-aliasing: keys 1-3 switch between none, FXAA as part of the screen-quad pass and 4x MSAA for comparison
+enum AntiAliasing {
+    AA_NONE,
+    AA_FXAA,
+    AA_MSAA
+};
+AntiAliasing antiAliasing = AA_FXAA;
+
 // camera
 Camera camera(glm::vec3(0.0f, 0.0f, 3.0f));
 float lastX = (float)SCR_WIDTH / 2.0;
@@ -80,6 +90,7 @@ int main()
     Shader shader("5.1.framebuffers.vs", "5.1.framebuffers.fs");
     Shader screenShader("5.1.framebuffers_screen.vs", "5.1.framebuffers_screen.fs");
     Shader skyShader("5.1.framebuffers_screen.vs", "sky.fs");
+    Shader fxaaShader("5.1.framebuffers_screen.vs", "5.1.framebuffers_fxaa.fs");
 
     // set up vertex data (and buffer(s)) and configure vertex attributes
     // ------------------------------------------------------------------
@@ -193,6 +204,9 @@ int main()
 
     screenShader.use();
     screenShader.setInt("screenTexture", 0);
+    fxaaShader.use();
+    fxaaShader.setInt("screenTexture", 0);
+    fxaaShader.setVec2("inverseScreenSize", glm::vec2(1.0f / SCR_WIDTH, 1.0f / SCR_HEIGHT));
 
     // framebuffer configuration
     // -------------------------
@@ -218,6 +232,14 @@ int main()
         cout << "ERROR::FRAMEBUFFER:: Framebuffer is not complete!" << endl;
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
+    // the 4x MSAA framebuffer used for comparison is only allocated while MSAA is selected
+    MultisampleFramebuffer *msaa = nullptr;
+
+    // GPU timers for the scene and for the anti-aliasing step (resolve and screen pass); together they make the frame
+    GpuTimer *sceneTimer = new GpuTimer();
+    GpuTimer *aaTimer = new GpuTimer();
+    double lastReport = glfwGetTime();
+
     // draw as wireframe
     //glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 
@@ -234,12 +256,23 @@ int main()
         // input
         // -----
         processInput(window);
+        if (antiAliasing == AA_MSAA && msaa == nullptr)
+            msaa = new MultisampleFramebuffer(SCR_WIDTH, SCR_HEIGHT, 4, GL_RGBA8);
+        else if (antiAliasing != AA_MSAA && msaa != nullptr)
+        {
+            delete msaa;
+            msaa = nullptr;
+        }
 
 
         // render
         // ------
+        sceneTimer->Begin();
         // bind to framebuffer and draw scene as we normally would to color texture 
-        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        if (msaa)
+            msaa->Bind();
+        else
+            glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
         glEnable(GL_DEPTH_TEST); // enable depth testing (is disabled for rendering screen-space quad)
 
         // make sure we clear the framebuffer's content
@@ -277,6 +310,12 @@ int main()
         shader.setMat4("model", glm::mat4(1.0f));
         glDrawArrays(GL_TRIANGLES, 0, 6);
         glBindVertexArray(0);
+        sceneTimer->End();
+
+        // with MSAA the samples are first resolved into a regular texture
+        aaTimer->Begin();
+        if (msaa)
+            msaa->Resolve(RESOLVE_BLIT);
 
         // now bind back to default framebuffer and draw a quad plane with the attached framebuffer color texture
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
@@ -286,10 +325,28 @@ int main()
         glClear(GL_COLOR_BUFFER_BIT);
 
 
-        screenShader.use();
+        // FXAA runs as part of the screen quad pass: a different shader on the same quad and texture
+        if (antiAliasing == AA_FXAA)
+            fxaaShader.use();
+        else
+            screenShader.use();
         glBindVertexArray(quadVAO);
-        glBindTexture(GL_TEXTURE_2D, textureColorbuffer);	// use the color attachment texture as the texture of the quad plane
+        glBindTexture(GL_TEXTURE_2D, msaa ? msaa->ResolvedColor : textureColorbuffer);	// use the color attachment texture as the texture of the quad plane
         glDrawArrays(GL_TRIANGLES, 0, 6);
+        aaTimer->End();
+
+        // report averaged timings and render target memory once a second
+        if (currentFrame - lastReport >= 1.0)
+        {
+            // the regular framebuffer holds an RGB8 color texture (padded to 4 bytes) and a depth24/stencil8 renderbuffer
+            size_t memory = msaa ? msaa->MemoryBytes() : (size_t)SCR_WIDTH * SCR_HEIGHT * (4 + 4);
+            const char *names[] = { "no AA", "FXAA", "4x MSAA" };
+            std::cout << names[antiAliasing] << " | frame (GPU): " << sceneTimer->AverageMs() + aaTimer->AverageMs() << " ms | resolve + screen pass: " << aaTimer->AverageMs()
+                      << " ms | render targets: " << memory / (1024.0 * 1024.0) << " MB" << std::endl;
+            sceneTimer->Reset();
+            aaTimer->Reset();
+            lastReport = currentFrame;
+        }
 
 
         // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
@@ -306,6 +363,9 @@ int main()
     glDeleteBuffers(1, &cubeVBO);
     glDeleteBuffers(1, &planeVBO);
     glDeleteBuffers(1, &quadVBO);
+    delete sceneTimer;
+    delete aaTimer;
+    delete msaa;
 
     glfwTerminate();
     return 0;
@@ -326,6 +386,13 @@ void processInput(GLFWwindow *window)
         camera.ProcessKeyboard(LEFT, deltaTime);
     if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
         camera.ProcessKeyboard(RIGHT, deltaTime);
+
+    if (glfwGetKey(window, GLFW_KEY_1) == GLFW_PRESS)
+        antiAliasing = AA_NONE;
+    if (glfwGetKey(window, GLFW_KEY_2) == GLFW_PRESS)
+        antiAliasing = AA_FXAA;
+    if (glfwGetKey(window, GLFW_KEY_3) == GLFW_PRESS)
+        antiAliasing = AA_MSAA;
 }
 
 // glfw: whenever the window size changed (by OS or user resize) this callback function executes
@@ -10,6 +10,7 @@
 #include <learnopengl/shader_m.h>
 #include <learnopengl/camera.h>
 #include <learnopengl/model.h>
+#include <learnopengl/stream_buffer.h>
 
 #include <iostream>
 
@@ -147,20 +148,15 @@ int main()
     glUniformBlockBinding(shaderGreen.ID, uniformBlockIndexGreen, 0);
     glUniformBlockBinding(shaderBlue.ID, uniformBlockIndexBlue, 0);
     glUniformBlockBinding(shaderYellow.ID, uniformBlockIndexYellow, 0);
-    // Now actually create the buffer
-    unsigned int uboMatrices;
-    glGenBuffers(1, &uboMatrices);
-    glBindBuffer(GL_UNIFORM_BUFFER, uboMatrices);
-    glBufferData(GL_UNIFORM_BUFFER, 2 * sizeof(glm::mat4), NULL, GL_STATIC_DRAW);
-    glBindBuffer(GL_UNIFORM_BUFFER, 0);
-    // define the range of the buffer that links to a uniform binding point
-    glBindBufferRange(GL_UNIFORM_BUFFER, 0, uboMatrices, 0, 2 * sizeof(glm::mat4));
-
-    // store the projection matrix (we only do this once now) (note: we're not using zoom anymore by changing the FoV)
+    // Now actually create the buffer: the matrices change every frame, so rather than overwriting a single buffer
+    // (which makes the driver wait until the previous frame is done with it) each frame writes its matrices to a new
+    // piece of a ring buffer. Uniform blocks have to start at a multiple of GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT.
+    StreamBuffer *uniforms = new StreamBuffer(64 * 1024);
+    GLint uniformAlignment = 256;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformAlignment);
+
+    // the projection matrix doesn't change (note: we're not using zoom anymore by changing the FoV)
     glm::mat4 projection = glm::perspective(45.0f, (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
-    glBindBuffer(GL_UNIFORM_BUFFER, uboMatrices);
-    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(glm::mat4), glm::value_ptr(projection));
-    glBindBuffer(GL_UNIFORM_BUFFER, 0);
   
     // render loop
     // -----------
@@ -183,9 +179,16 @@ int main()
 
         // set the view and projection matrix in the uniform block - we only have to do this once per loop iteration.
         glm::mat4 view = camera.GetViewMatrix();
-        glBindBuffer(GL_UNIFORM_BUFFER, uboMatrices);
-        glBufferSubData(GL_UNIFORM_BUFFER, sizeof(glm::mat4), sizeof(glm::mat4), glm::value_ptr(view));
-        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        StreamAllocation matrices = uniforms->Allocate(2 * sizeof(glm::mat4), uniformAlignment);
+        if (matrices.Data)
+        {
+            glm::mat4 *block = static_cast<glm::mat4*>(matrices.Data);
+            block[0] = projection;
+            block[1] = view;
+            uniforms->Commit();
+            // define the range of the buffer that links to a uniform binding point
+            glBindBufferRange(GL_UNIFORM_BUFFER, 0, matrices.Buffer, matrices.Offset, matrices.Size);
+        }
 
         // draw 4 cubes 
         // RED
@@ -213,6 +216,8 @@ int main()
         model = glm::translate(model, glm::vec3(0.75f, -0.75f, 0.0f)); // move bottom-right
         shaderBlue.setMat4("model", model);
         glDrawArrays(GL_TRIANGLES, 0, 36);
+        // done with this frame's matrices
+        uniforms->EndFrame();
 
         // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
         // -------------------------------------------------------------------------------
@@ -224,6 +229,7 @@ int main()
     // ------------------------------------------------------------------------
     glDeleteVertexArrays(1, &cubeVAO);
     glDeleteBuffers(1, &cubeVBO);
+    delete uniforms;
 
     glfwTerminate();
     return 0;
@@ -10,7 +10,9 @@
 #include <learnopengl/shader.h>
 #include <learnopengl/camera.h>
 #include <learnopengl/model.h>
+#include <learnopengl/mipmap_generator.h>
 
+#include <cstring>
 #include <iostream>
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
@@ -18,6 +20,7 @@ void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 void processInput(GLFWwindow *window);
 unsigned int loadTexture(const char *path, bool gammaCorrection);
+void benchmarkMipmaps(const char *path);
 
 // settings
 const unsigned int SCR_WIDTH = 800;
@@ -35,7 +38,7 @@ bool firstMouse = true;
 float deltaTime = 0.0f;
 float lastFrame = 0.0f;
 
-int main()
+int main(int argc, char *argv[])
 {
     // glfw: initialize and configure
     // ------------------------------
@@ -110,6 +113,14 @@ int main()
     glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
     glBindVertexArray(0);
 
+    // run with --mipmap-benchmark to measure the mipmap generators instead
+    if (argc > 1 && std::strcmp(argv[1], "--mipmap-benchmark") == 0)
+    {
+        benchmarkMipmaps(FileSystem::getPath("resources/textures/wood.png").c_str());
+        glfwTerminate();
+        return 0;
+    }
+
     // load textures
     // -------------
     unsigned int floorTexture               = loadTexture(FileSystem::getPath("resources/textures/wood.png").c_str(), false);
@@ -279,9 +290,11 @@ unsigned int loadTexture(char const * path, bool gammaCorrection)
             dataFormat = GL_RGBA;
         }
 
+        // mipmaps are filtered on the CPU, in linear space if the texture is in sRGB (glGenerateMipmap would
+        // average the sRGB values, darkening the smaller levels)
+        MipmapGenerator mipmaps(MIP_FILTER_KAISER, gammaCorrection && nrComponents >= 3, true);
         glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, dataFormat, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
+        MipmapGenerator::Upload(mipmaps.Generate(data, width, height, nrComponents), internalFormat, dataFormat);
 
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT); 
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
@@ -298,3 +311,44 @@ unsigned int loadTexture(char const * path, bool gammaCorrection)
 
     return textureID;
 }
+
+// benchmarkMipmaps() generates the mip chain of an image with each filter, treating it as linear and as sRGB data, and
+// compares the throughput (in MPix/s of the source image) with glGenerateMipmap on the same image
+// -----------------------------------------------------------------------------------------------------------------
+void benchmarkMipmaps(const char *path)
+{
+    int width, height, nrComponents;
+    unsigned char *data = stbi_load(path, &width, &height, &nrComponents, 0);
+    if (!data)
+        return;
+    const char *filters[] = { "box", "kaiser", "lanczos" };
+    const unsigned int runs = 5;
+    double megapixels = width * (double)height / 1000000.0;
+    for (unsigned int filter = 0; filter < 3; ++filter)
+    {
+        for (unsigned int srgb = 0; srgb < 2; ++srgb)
+        {
+            MipmapGenerator mipmaps((MipFilter)filter, srgb == 1, true);
+            double start = glfwGetTime();
+            for (unsigned int i = 0; i < runs; ++i)
+                mipmaps.Generate(data, width, height, nrComponents);
+            double elapsed = (glfwGetTime() - start) / runs;
+            std::cout << "mipmaps (" << filters[filter] << ", " << (srgb ? "sRGB" : "linear") << "): " << width << "x" << height << " in "
+                      << elapsed * 1000.0 << " ms | " << megapixels / elapsed << " MPix/s" << std::endl;
+        }
+    }
+    GLenum format = nrComponents == 4 ? GL_RGBA : (nrComponents == 3 ? GL_RGB : GL_RED);
+    unsigned int texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
+    glFinish();
+    double start = glfwGetTime();
+    for (unsigned int i = 0; i < runs; ++i)
+        glGenerateMipmap(GL_TEXTURE_2D);
+    glFinish();
+    double elapsed = (glfwGetTime() - start) / runs;
+    std::cout << "glGenerateMipmap: " << elapsed * 1000.0 << " ms | " << megapixels / elapsed << " MPix/s" << std::endl;
+    glDeleteTextures(1, &texture);
+    stbi_image_free(data);
+}
\ No newline at end of file
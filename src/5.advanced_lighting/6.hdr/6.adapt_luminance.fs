@@ -0,0 +1,16 @@
+#version 330 core
+out float FragColor;
+
+uniform sampler2D logLuminance;
+uniform sampler2D previousLuminance;
+uniform float mipLevel;
+uniform float adaptation; // 1 - exp(-deltaTime * speed)
+
+void main()
+{
+    // the top mip of the log luminance texture holds the frame's summed log luminance and pixel count, both averaged
+    vec2 average = textureLod(logLuminance, vec2(0.5), mipLevel).rg;
+    float current = exp(average.r / average.g);
+    float previous = texture(previousLuminance, vec2(0.5)).r;
+    FragColor = previous + (current - previous) * adaptation;
+}
\ No newline at end of file
@@ -6,6 +6,9 @@ in vec2 TexCoords;
 uniform sampler2D hdrBuffer;
 uniform bool hdr;
 uniform float exposure;
+// when set, exposure acts as a compensation on top of the GPU-adapted scene luminance
+uniform bool autoExposure;
+uniform sampler2D adaptedLuminance;
 
 void main()
 {             
@@ -16,7 +19,10 @@ void main()
         // reinhard
         // vec3 result = hdrColor / (hdrColor + vec3(1.0));
         // exposure
-        vec3 result = vec3(1.0) - exp(-hdrColor * exposure);
+        float e = exposure;
+        if(autoExposure)
+            e *= 0.18 / texture(adaptedLuminance, vec2(0.5)).r; // map the average luminance to middle grey
+        vec3 result = vec3(1.0) - exp(-hdrColor * e);
         // also gamma correct while we're at it       
         result = pow(result, vec3(1.0 / gamma));
         FragColor = vec4(result, 1.0);
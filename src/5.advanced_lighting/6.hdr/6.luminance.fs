@@ -0,0 +1,35 @@
+#version 330 core
+out vec2 FragColor;
+
+uniform sampler2D hdrBuffer;
+uniform vec2 luminanceSize; // size of the log luminance texture
+
+// must match AutoExposure::MinLuminance
+const float minLuminance = 1e-4;
+
+void main()
+{
+    // take the log of each source pixel whose center lies in this texel (so every pixel counts exactly once) rather
+    // than of a filtered sample, which would average colors first and skew the result towards the brightest pixels
+    ivec2 size = textureSize(hdrBuffer, 0);
+    vec2 scale = vec2(size) / luminanceSize;
+    vec2 texel = floor(gl_FragCoord.xy);
+    ivec2 first = ivec2(ceil(texel * scale - 0.5));
+    ivec2 last = min(ivec2(ceil((texel + 1.0) * scale - 0.5)), size);
+    float logSum = 0.0;
+    float count = 0.0;
+    for (int y = first.y; y < last.y; ++y)
+    {
+        for (int x = first.x; x < last.x; ++x)
+        {
+            vec3 hdrColor = texelFetch(hdrBuffer, ivec2(x, y), 0).rgb;
+            float luminance = dot(hdrColor, vec3(0.2126, 0.7152, 0.0722));
+            logSum += log(max(luminance, minLuminance));
+            count += 1.0;
+        }
+    }
+    // the mip chain averages both, so the ratio in the top level is the log-average (geometric mean) luminance of
+    // all pixels; dividing by the texel's area keeps the values in the range half floats are precise in
+    float area = scale.x * scale.y;
+    FragColor = vec2(logSum, count) / area;
+}
\ No newline at end of file
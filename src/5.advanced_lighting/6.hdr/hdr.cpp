@@ -10,8 +10,12 @@
 #include <learnopengl/shader.h>
 #include <learnopengl/camera.h>
 #include <learnopengl/model.h>
+#include <learnopengl/auto_exposure.h>
 
+#include <cstring>
 #include <iostream>
+#include <random>
+#include <vector>
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
@@ -20,6 +24,7 @@ void processInput(GLFWwindow *window);
 unsigned int loadTexture(const char *path, bool gammaCorrection);
 void renderQuad();
 void renderCube();
+void benchmarkAutoExposure(Shader &luminanceShader, Shader &adaptShader);
 
 // settings
 const unsigned int SCR_WIDTH = 800;
@@ -27,6 +32,8 @@ const unsigned int SCR_HEIGHT = 600;
 bool hdr = true;
 bool hdrKeyPressed = false;
 float exposure = 1.0f;
+bool autoExposure = true;
+bool autoExposureKeyPressed = false;
 
 // camera
 Camera camera(glm::vec3(0.0f, 0.0f, 5.0f));
@@ -38,7 +45,7 @@ bool firstMouse = true;
 float deltaTime = 0.0f;
 float lastFrame = 0.0f;
 
-int main()
+int main(int argc, char *argv[])
 {
     // glfw: initialize and configure
     // ------------------------------
@@ -84,6 +91,8 @@ int main()
     // -------------------------
     Shader shader("6.lighting.vs", "6.lighting.fs");
     Shader hdrShader("6.hdr.vs", "6.hdr.fs");
+    Shader luminanceShader("6.hdr.vs", "6.luminance.fs");
+    Shader adaptShader("6.hdr.vs", "6.adapt_luminance.fs");
 
     // load textures
     // -------------
@@ -113,6 +122,17 @@ int main()
         std::cout << "Framebuffer not complete!" << std::endl;
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
+    // automatic exposure: the HDR buffer's log-average luminance is reduced and adapted on the GPU every frame
+    // (run with --exposure-benchmark to measure the reduction instead)
+    // --------------------------------------------------------------------------------------------------------
+    if (argc > 1 && std::strcmp(argv[1], "--exposure-benchmark") == 0)
+    {
+        benchmarkAutoExposure(luminanceShader, adaptShader);
+        glfwTerminate();
+        return 0;
+    }
+    AutoExposure exposureAdaptation(luminanceShader, adaptShader, SCR_WIDTH, SCR_HEIGHT);
+
     // lighting info
     // -------------
     // positions
@@ -134,6 +154,7 @@ int main()
     shader.setInt("diffuseTexture", 0);
     hdrShader.use();
     hdrShader.setInt("hdrBuffer", 0);
+    hdrShader.setInt("adaptedLuminance", 1);
 
     // render loop
     // -----------
@@ -181,17 +202,26 @@ int main()
             renderCube();
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
-        // 2. now render floating point color buffer to 2D quad and tonemap HDR colors to default framebuffer's (clamped) color range
+        // 2. measure the scene's average luminance and let the exposure adapt to it (stays on the GPU)
+        // ---------------------------------------------------------------------------------------------
+        if (autoExposure)
+            exposureAdaptation.Update(colorBuffer, deltaTime);
+
+        // 3. now render floating point color buffer to 2D quad and tonemap HDR colors to default framebuffer's (clamped) color range
         // --------------------------------------------------------------------------------------------------------------------------
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         hdrShader.use();
         glActiveTexture(GL_TEXTURE0);
         glBindTexture(GL_TEXTURE_2D, colorBuffer);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, exposureAdaptation.AdaptedLuminance());
         hdrShader.setInt("hdr", hdr);
+        hdrShader.setInt("autoExposure", autoExposure);
         hdrShader.setFloat("exposure", exposure);
         renderQuad();
+        glActiveTexture(GL_TEXTURE0);
 
-        std::cout << "hdr: " << (hdr ? "on" : "off") << "| exposure: " << exposure << std::endl;
+        std::cout << "hdr: " << (hdr ? "on" : "off") << "| auto exposure: " << (autoExposure ? "on" : "off") << "| exposure: " << exposure << std::endl;
 
         // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
         // -------------------------------------------------------------------------------
@@ -203,6 +233,63 @@ int main()
     return 0;
 }
 
+// benchmarkAutoExposure() measures the GPU cost of the luminance reduction at 1080p and 4K on synthetic HDR content
+// and compares its result with the CPU reference. Reading the result back is fine here, never in the render loop.
+// ------------------------------------------------------------------------------------------------------------------
+void benchmarkAutoExposure(Shader &luminanceShader, Shader &adaptShader)
+{
+    const unsigned int resolutions[2][2] = { { 1920, 1080 }, { 3840, 2160 } };
+    const unsigned int iterations = 100;
+    // luminance spread over several orders of magnitude, like a scene with a bright light in it
+    std::mt19937 generator(1337);
+    std::uniform_real_distribution<float> logLuminance(-6.0f, 6.0f);
+    unsigned int query;
+    glGenQueries(1, &query);
+    for (unsigned int r = 0; r < 2; ++r)
+    {
+        unsigned int width = resolutions[r][0];
+        unsigned int height = resolutions[r][1];
+        std::vector<float> pixels((size_t)width * height * 4);
+        for (size_t i = 0; i < pixels.size(); i += 4)
+        {
+            float value = std::exp(logLuminance(generator));
+            pixels[i + 0] = value;
+            pixels[i + 1] = value * 0.8f;
+            pixels[i + 2] = value * 0.6f;
+            pixels[i + 3] = 1.0f;
+        }
+        unsigned int texture;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, &pixels[0]);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+        AutoExposure reduction(luminanceShader, adaptShader, width, height);
+        reduction.Update(texture, 0.0f); // warm up
+        glBeginQuery(GL_TIME_ELAPSED, query);
+        for (unsigned int i = 0; i < iterations; ++i)
+            reduction.Update(texture, 1.0f / 60.0f);
+        glEndQuery(GL_TIME_ELAPSED);
+        GLuint64 elapsed = 0;
+        glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+        float gpuAverage = reduction.ReadAverageLuminance();
+
+        double cpuStart = glfwGetTime();
+        float cpuAverage = AutoExposure::LogAverageLuminance(&pixels[0], width, height);
+        double cpuTime = glfwGetTime() - cpuStart;
+
+        std::cout << "auto exposure " << width << "x" << height << ": " << elapsed / (double)iterations / 1000000.0 << " ms GPU per frame ("
+                  << reduction.Width << "x" << reduction.Height << ", " << reduction.MipLevels << " mips) vs " << cpuTime * 1000.0 << " ms CPU reference"
+                  << " | average luminance GPU " << gpuAverage << ", CPU " << cpuAverage << std::endl;
+        glDeleteTextures(1, &texture);
+    }
+    glDeleteQueries(1, &query);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
 // renderCube() renders a 1x1 3D cube in NDC.
 // -------------------------------------------------
 unsigned int cubeVAO = 0;
@@ -335,6 +422,16 @@ void processInput(GLFWwindow *window)
         hdrKeyPressed = false;
     }
 
+    if (glfwGetKey(window, GLFW_KEY_X) == GLFW_PRESS && !autoExposureKeyPressed)
+    {
+        autoExposure = !autoExposure;
+        autoExposureKeyPressed = true;
+    }
+    if (glfwGetKey(window, GLFW_KEY_X) == GLFW_RELEASE)
+    {
+        autoExposureKeyPressed = false;
+    }
+
     if (glfwGetKey(window, GLFW_KEY_Q) == GLFW_PRESS)
     {
         if (exposure > 0.0f)
@@ -7,6 +7,9 @@ uniform sampler2D scene;
 uniform sampler2D bloomBlur;
 uniform bool bloom;
 uniform float exposure;
+// when set, exposure acts as a compensation on top of the GPU-adapted scene luminance
+uniform bool autoExposure;
+uniform sampler2D adaptedLuminance;
 
 void main()
 {             
@@ -16,7 +19,10 @@ void main()
     if(bloom)
         hdrColor += bloomColor; // additive blending
     // tone mapping
-    vec3 result = vec3(1.0) - exp(-hdrColor * exposure);
+    float e = exposure;
+    if(autoExposure)
+        e *= 0.18 / texture(adaptedLuminance, vec2(0.5)).r; // map the average luminance to middle grey
+    vec3 result = vec3(1.0) - exp(-hdrColor * e);
     // also gamma correct while we're at it       
     result = pow(result, vec3(1.0 / gamma));
     FragColor = vec4(result, 1.0);
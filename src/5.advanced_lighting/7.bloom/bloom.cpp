@@ -10,6 +10,8 @@
 #include <learnopengl/shader.h>
 #include <learnopengl/camera.h>
 #include <learnopengl/model.h>
+#include <learnopengl/render_graph.h>
+#include <learnopengl/auto_exposure.h>
 
 #include <iostream>
 
@@ -27,6 +29,8 @@ const unsigned int SCR_HEIGHT = 600;
 bool bloom = true;
 bool bloomKeyPressed = false;
 float exposure = 1.0f;
+bool autoExposure = true;
+bool autoExposureKeyPressed = false;
 
 // camera
 Camera camera(glm::vec3(0.0f, 0.0f, 5.0f));
@@ -86,65 +90,14 @@ int main()
     Shader shaderLight("7.bloom.vs", "7.light_box.fs");
     Shader shaderBlur("7.blur.vs", "7.blur.fs");
     Shader shaderBloomFinal("7.bloom_final.vs", "7.bloom_final.fs");
+    Shader shaderLuminance("7.bloom_final.vs", "7.luminance.fs");
+    Shader shaderAdapt("7.bloom_final.vs", "7.adapt_luminance.fs");
 
     // load textures
     // -------------
     unsigned int woodTexture      = loadTexture(FileSystem::getPath("resources/textures/wood.png").c_str(), true); // note that we're loading the texture as an SRGB texture
     unsigned int containerTexture = loadTexture(FileSystem::getPath("resources/textures/container2.png").c_str(), true); // note that we're loading the texture as an SRGB texture
 
-    // configure (floating point) framebuffers
-    // ---------------------------------------
-    unsigned int hdrFBO;
-    glGenFramebuffers(1, &hdrFBO);
-    glBindFramebuffer(GL_FRAMEBUFFER, hdrFBO);
-    // create 2 floating point color buffers (1 for normal rendering, other for brightness treshold values)
-    unsigned int colorBuffers[2];
-    glGenTextures(2, colorBuffers);
-    for (unsigned int i = 0; i < 2; i++)
-    {
-        glBindTexture(GL_TEXTURE_2D, colorBuffers[i]);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGBA, GL_FLOAT, NULL);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);  // we clamp to the edge as the blur filter would otherwise sample repeated texture values!
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        // attach texture to framebuffer
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, colorBuffers[i], 0);
-    }
-    // create and attach depth buffer (renderbuffer)
-    unsigned int rboDepth;
-    glGenRenderbuffers(1, &rboDepth);
-    glBindRenderbuffer(GL_RENDERBUFFER, rboDepth);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, SCR_WIDTH, SCR_HEIGHT);
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, rboDepth);
-    // tell OpenGL which color attachments we'll use (of this framebuffer) for rendering 
-    unsigned int attachments[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
-    glDrawBuffers(2, attachments);
-    // finally check if framebuffer is complete
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-        std::cout << "Framebuffer not complete!" << std::endl;
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-    // ping-pong-framebuffer for blurring
-    unsigned int pingpongFBO[2];
-    unsigned int pingpongColorbuffers[2];
-    glGenFramebuffers(2, pingpongFBO);
-    glGenTextures(2, pingpongColorbuffers);
-    for (unsigned int i = 0; i < 2; i++)
-    {
-        glBindFramebuffer(GL_FRAMEBUFFER, pingpongFBO[i]);
-        glBindTexture(GL_TEXTURE_2D, pingpongColorbuffers[i]);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGBA, GL_FLOAT, NULL);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE); // we clamp to the edge as the blur filter would otherwise sample repeated texture values!
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, pingpongColorbuffers[i], 0);
-        // also check if framebuffers are complete (no need for depth buffer)
-        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-            std::cout << "Framebuffer not complete!" << std::endl;
-    }
-
     // lighting info
     // -------------
     // positions
@@ -170,32 +123,29 @@ int main()
     shaderBloomFinal.use();
     shaderBloomFinal.setInt("scene", 0);
     shaderBloomFinal.setInt("bloomBlur", 1);
-
-    // render loop
-    // -----------
-    while (!glfwWindowShouldClose(window))
+    shaderBloomFinal.setInt("adaptedLuminance", 2);
+
+    // automatic exposure: log-average luminance of the scene, reduced and adapted on the GPU
+    // --------------------------------------------------------------------------------------
+    AutoExposure exposureAdaptation(shaderLuminance, shaderAdapt, SCR_WIDTH, SCR_HEIGHT);
+
+    // configure render graph
+    // ----------------------
+    // the scene renders into 2 floating point color buffers (1 for normal rendering, other for brightness treshold values)
+    // which are then blurred through a chain of ping-pong targets. Instead of creating every framebuffer by hand, the passes
+    // only declare what they read and write; the graph aliases the short-lived blur targets onto as few textures as possible.
+    RenderTargetDesc hdrDesc(SCR_WIDTH, SCR_HEIGHT, GL_RGBA16F, GL_RGBA, GL_FLOAT, GL_LINEAR);
+    RenderTargetDesc depthDesc(SCR_WIDTH, SCR_HEIGHT, GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT, GL_FLOAT, GL_NEAREST);
+    RenderGraph graph;
+    unsigned int sceneColor  = graph.CreateTexture("sceneColor", hdrDesc);
+    unsigned int brightColor = graph.CreateTexture("brightColor", hdrDesc);
+    unsigned int sceneDepth  = graph.CreateTexture("sceneDepth", depthDesc);
+    glm::mat4 projection, view;
+
+    // 1. render scene into floating point framebuffer
+    // -----------------------------------------------
+    graph.AddPass("scene", {}, { sceneColor, brightColor, sceneDepth }, [&](RenderGraph &)
     {
-        // per-frame time logic
-        // --------------------
-        float currentFrame = glfwGetTime();
-        deltaTime = currentFrame - lastFrame;
-        lastFrame = currentFrame;
-
-        // input
-        // -----
-        processInput(window);
-
-        // render
-        // ------
-        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-        // 1. render scene into floating point framebuffer
-        // -----------------------------------------------
-        glBindFramebuffer(GL_FRAMEBUFFER, hdrFBO);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
-        glm::mat4 view = camera.GetViewMatrix();
         glm::mat4 model = glm::mat4(1.0f);
         shader.use();
         shader.setMat4("projection", projection);
@@ -269,38 +219,83 @@ int main()
             shaderLight.setVec3("lightColor", lightColors[i]);
             renderCube();
         }
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-        // 2. blur bright fragments with two-pass Gaussian Blur 
-        // --------------------------------------------------
-        bool horizontal = true, first_iteration = true;
-        unsigned int amount = 10;
-        shaderBlur.use();
-        for (unsigned int i = 0; i < amount; i++)
+    });
+
+    // 2. blur bright fragments with two-pass Gaussian Blur; every iteration writes a new (transient) target
+    // -----------------------------------------------------------------------------------------------------
+    unsigned int amount = 10;
+    unsigned int blurred = brightColor;
+    for (unsigned int i = 0; i < amount; i++)
+    {
+        bool horizontal = i % 2 == 0;
+        unsigned int source = blurred;
+        blurred = graph.CreateTexture("blur" + std::to_string(i), hdrDesc);
+        graph.AddPass("blur" + std::to_string(i), { source }, { blurred }, [&, horizontal, source](RenderGraph &g)
         {
-            glBindFramebuffer(GL_FRAMEBUFFER, pingpongFBO[horizontal]);
+            shaderBlur.use();
             shaderBlur.setInt("horizontal", horizontal);
-            glBindTexture(GL_TEXTURE_2D, first_iteration ? colorBuffers[1] : pingpongColorbuffers[!horizontal]);  // bind texture of other framebuffer (or scene if first iteration)
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, g.GetTexture(source));
             renderQuad();
-            horizontal = !horizontal;
-            if (first_iteration)
-                first_iteration = false;
-        }
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        });
+    }
 
-        // 3. now render floating point color buffer to 2D quad and tonemap HDR colors to default framebuffer's (clamped) color range
-        // --------------------------------------------------------------------------------------------------------------------------
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    // 3. reduce the scene's luminance and adapt the exposure to it. The reduction manages its own framebuffers, so it's a
+    // custom pass; the adapted luminance ping-pongs between two textures, so the pass re-imports the one it wrote
+    // -------------------------------------------------------------------------------------------------------------------
+    RenderTargetDesc luminanceDesc(1, 1, GL_R32F, GL_RED, GL_FLOAT, GL_NEAREST);
+    unsigned int adaptedLuminance = graph.ImportTexture("adaptedLuminance", exposureAdaptation.AdaptedLuminance(), luminanceDesc);
+    graph.AddPass("exposure", { sceneColor }, { adaptedLuminance }, [&](RenderGraph &g)
+    {
+        if (autoExposure)
+            exposureAdaptation.Update(g.GetTexture(sceneColor), deltaTime);
+        g.SetImportedTexture(adaptedLuminance, exposureAdaptation.AdaptedLuminance());
+    }, CUSTOM_PASS);
+
+    // 4. now render floating point color buffer to 2D quad and tonemap HDR colors to default framebuffer's (clamped) color range
+    // --------------------------------------------------------------------------------------------------------------------------
+    graph.AddPass("tonemap", { sceneColor, blurred, adaptedLuminance }, { RenderGraph::BACKBUFFER }, [&](RenderGraph &g)
+    {
         shaderBloomFinal.use();
         glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, colorBuffers[0]);
+        glBindTexture(GL_TEXTURE_2D, g.GetTexture(sceneColor));
         glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, pingpongColorbuffers[!horizontal]);
+        glBindTexture(GL_TEXTURE_2D, g.GetTexture(blurred));
+        glActiveTexture(GL_TEXTURE2);
+        glBindTexture(GL_TEXTURE_2D, g.GetTexture(adaptedLuminance));
         shaderBloomFinal.setInt("bloom", bloom);
+        shaderBloomFinal.setInt("autoExposure", autoExposure);
         shaderBloomFinal.setFloat("exposure", exposure);
         renderQuad();
+        glActiveTexture(GL_TEXTURE0);
+    });
+    graph.Compile();
+    // the hand-managed version allocated 4 HDR color buffers (scene, brightness, 2 ping-pong) and a depth buffer
+    size_t handManaged = 4 * hdrDesc.Bytes() + depthDesc.Bytes();
+    std::cout << "peak render target memory: " << handManaged / (1024.0 * 1024.0) << " MB by hand -> " << graph.AliasedMemory() / (1024.0 * 1024.0) << " MB with render graph" << std::endl;
+    graph.PrintStatistics();
+
+    // render loop
+    // -----------
+    while (!glfwWindowShouldClose(window))
+    {
+        // per-frame time logic
+        // --------------------
+        float currentFrame = glfwGetTime();
+        deltaTime = currentFrame - lastFrame;
+        lastFrame = currentFrame;
 
-        std::cout << "bloom: " << (bloom ? "on" : "off") << "| exposure: " << exposure << std::endl;
+        // input
+        // -----
+        processInput(window);
+
+        // render
+        // ------
+        projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
+        view = camera.GetViewMatrix();
+        graph.Execute();
+
+        std::cout << "bloom: " << (bloom ? "on" : "off") << "| auto exposure: " << (autoExposure ? "on" : "off") << "| exposure: " << exposure << std::endl;
 
         // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
         // -------------------------------------------------------------------------------
@@ -444,6 +439,16 @@ void processInput(GLFWwindow *window)
         bloomKeyPressed = false;
     }
 
+    if (glfwGetKey(window, GLFW_KEY_X) == GLFW_PRESS && !autoExposureKeyPressed)
+    {
+        autoExposure = !autoExposure;
+        autoExposureKeyPressed = true;
+    }
+    if (glfwGetKey(window, GLFW_KEY_X) == GLFW_RELEASE)
+    {
+        autoExposureKeyPressed = false;
+    }
+
     if (glfwGetKey(window, GLFW_KEY_Q) == GLFW_PRESS)
     {
         if (exposure > 0.0f)
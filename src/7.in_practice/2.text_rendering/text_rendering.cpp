@@ -1,6 +1,7 @@
+#include <cstring>
 #include <iostream>
-#include <map>
 #include <string>
+#include <thread>
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
@@ -9,32 +10,30 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
-#include <ft2build.h>
-#include FT_FREETYPE_H
-
 #include <learnopengl/filesystem.h>
+#include <learnopengl/glyph_atlas.h>
+#include <learnopengl/glyph_cache.h>
 #include <learnopengl/shader.h>
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void processInput(GLFWwindow *window);
-void RenderText(Shader &shader, std::string text, float x, float y, float scale, glm::vec3 color);
+void RenderText(std::string text, float x, float y, float scale, glm::vec3 color);
+void FlushText(Shader &shader);
+void benchmarkText(GLFWwindow *window, Shader &shader);
+void benchmarkGlyphCache(const std::string &font);
 
 // settings
 const unsigned int SCR_WIDTH = 800;
 const unsigned int SCR_HEIGHT = 600;
 
-/// Holds all state information relevant to a character as loaded using FreeType
-struct Character {
-    unsigned int TextureID; // ID handle of the glyph texture
-    glm::ivec2   Size;      // Size of glyph
-    glm::ivec2   Bearing;   // Offset from baseline to left/top of glyph
-    unsigned int Advance;   // Horizontal offset to advance to next glyph
-};
-
-std::map<GLchar, Character> Characters;
-unsigned int VAO, VBO;
+// all glyphs packed into as few textures as possible; text is batched per atlas texture (page)
+GlyphAtlas *Atlas;
+TextBatch *Text;
+// signed distance field glyphs, rasterized on first use (any codepoint) and drawn at any scale
+GlyphCache *DistanceFields;
+TextBatch *DistanceFieldText;
 
-int main()
+int main(int argc, char *argv[])
 {
     // glfw: initialize and configure
     // ------------------------------
@@ -80,16 +79,8 @@ int main()
     shader.use();
     glUniformMatrix4fv(glGetUniformLocation(shader.ID, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
 
-    // FreeType
-    // --------
-    FT_Library ft;
-    // All functions return a value different than 0 whenever an error occurred
-    if (FT_Init_FreeType(&ft))
-    {
-        std::cout << "ERROR::FREETYPE: Could not init FreeType Library" << std::endl;
-        return -1;
-    }
-
+    // FreeType: rasterize the first 128 characters of ASCII into the glyph atlas
+    // ---------------------------------------------------------------------------
 	// find path to font
     std::string font_name = FileSystem::getPath("resources/fonts/Antonio-Bold.ttf");
     if (font_name.empty())
@@ -97,76 +88,40 @@ int main()
         std::cout << "ERROR::FREETYPE: Failed to load font_name" << std::endl;
         return -1;
     }
-	
-	// load font as face
-    FT_Face face;
-    if (FT_New_Face(ft, font_name.c_str(), 0, &face)) {
-        std::cout << "ERROR::FREETYPE: Failed to load font" << std::endl;
+    Atlas = new GlyphAtlas();
+    if (!Atlas->Load(font_name, 48))
         return -1;
-    }
-    else {
-        // set size to load glyphs as
-        FT_Set_Pixel_Sizes(face, 0, 48);
-
-        // disable byte-alignment restriction
-        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    Text = new TextBatch();
+    shader.use();
+    shader.setInt("text", 0);
 
-        // load first 128 characters of ASCII set
-        for (unsigned char c = 0; c < 128; c++)
-        {
-            // Load character glyph 
-            if (FT_Load_Char(face, c, FT_LOAD_RENDER))
-            {
-                std::cout << "ERROR::FREETYTPE: Failed to load Glyph" << std::endl;
-                continue;
-            }
-            // generate texture
-            unsigned int texture;
-            glGenTextures(1, &texture);
-            glBindTexture(GL_TEXTURE_2D, texture);
-            glTexImage2D(
-                GL_TEXTURE_2D,
-                0,
-                GL_RED,
-                face->glyph->bitmap.width,
-                face->glyph->bitmap.rows,
-                0,
-                GL_RED,
-                GL_UNSIGNED_BYTE,
-                face->glyph->bitmap.buffer
-            );
-            // set texture options
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-            // now store character for later use
-            Character character = {
-                texture,
-                glm::ivec2(face->glyph->bitmap.width, face->glyph->bitmap.rows),
-                glm::ivec2(face->glyph->bitmap_left, face->glyph->bitmap_top),
-                static_cast<unsigned int>(face->glyph->advance.x)
-            };
-            Characters.insert(std::pair<char, Character>(c, character));
-        }
-        glBindTexture(GL_TEXTURE_2D, 0);
+    // run with --text-benchmark to measure the text renderer instead
+    if (argc > 1 && std::strcmp(argv[1], "--text-benchmark") == 0)
+    {
+        benchmarkText(window, shader);
+        delete Text;
+        delete Atlas;
+        glfwTerminate();
+        return 0;
     }
-    // destroy FreeType once we're finished
-    FT_Done_Face(face);
-    FT_Done_FreeType(ft);
 
-    
-    // configure VAO/VBO for texture quads
-    // -----------------------------------
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-    glBindVertexArray(VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 6 * 4, NULL, GL_DYNAMIC_DRAW);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), 0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+    // signed distance field text: a single rasterization of each glyph serves every size
+    // -----------------------------------------------------------------------------------
+    Shader sdfShader("text.vs", "text_sdf.fs");
+    sdfShader.use();
+    glUniformMatrix4fv(glGetUniformLocation(sdfShader.ID, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+    sdfShader.setInt("text", 0);
+    // run with --glyph-cache-benchmark to measure the distance field cache instead
+    if (argc > 1 && std::strcmp(argv[1], "--glyph-cache-benchmark") == 0)
+    {
+        benchmarkGlyphCache(font_name);
+        delete Text;
+        delete Atlas;
+        glfwTerminate();
+        return 0;
+    }
+    DistanceFields = new GlyphCache(font_name);
+    DistanceFieldText = new TextBatch();
 
     // render loop
     // -----------
@@ -181,8 +136,22 @@ int main()
         glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT);
 
-        RenderText(shader, "This is sample text", 25.0f, 25.0f, 1.0f, glm::vec3(0.5, 0.8f, 0.2f));
-        RenderText(shader, "(C) LearnOpenGL.com", 540.0f, 570.0f, 0.5f, glm::vec3(0.3, 0.7f, 0.9f));
+        RenderText("This is sample text", 25.0f, 25.0f, 1.0f, glm::vec3(0.5, 0.8f, 0.2f));
+        RenderText("(C) LearnOpenGL.com", 540.0f, 570.0f, 0.5f, glm::vec3(0.3, 0.7f, 0.9f));
+        FlushText(shader);
+
+        // glyphs show up as soon as the background threads have rasterized them
+        DistanceFields->Update();
+        float sizes[] = { 12.0f, 24.0f, 48.0f, 96.0f };
+        float y = 420.0f;
+        for (float size : sizes)
+        {
+            float scale = size / DistanceFields->BaseSize;
+            DistanceFieldText->Add(*DistanceFields, "Distance fields: \xC3\xA9\xC3\xA0\xC3\xBC \xCE\xB1\xCE\xB2\xCE\xB3 \xD0\xB6\xD0\xB8", 25.0f, y, scale, glm::vec3(0.9f, 0.6f, 0.2f));
+            y -= size * 1.2f + 10.0f;
+        }
+        sdfShader.use();
+        DistanceFieldText->Flush();
        
         // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
         // -------------------------------------------------------------------------------
@@ -190,6 +159,10 @@ int main()
         glfwPollEvents();
     }
 
+    delete DistanceFieldText;
+    delete DistanceFields;
+    delete Text;
+    delete Atlas;
     glfwTerminate();
     return 0;
 }
@@ -212,49 +185,105 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 }
 
 
-// render line of text
-// -------------------
-void RenderText(Shader &shader, std::string text, float x, float y, float scale, glm::vec3 color)
+// render line of text: queues the glyphs' quads, drawn by the next FlushText
+// ---------------------------------------------------------------------------
+void RenderText(std::string text, float x, float y, float scale, glm::vec3 color)
+{
+    Text->Add(*Atlas, text, x, y, scale, color);
+}
+
+// draws all queued text, a single draw call per atlas page
+// ---------------------------------------------------------
+void FlushText(Shader &shader)
 {
-    // activate corresponding render state	
     shader.use();
-    glUniform3f(glGetUniformLocation(shader.ID, "textColor"), color.x, color.y, color.z);
-    glActiveTexture(GL_TEXTURE0);
-    glBindVertexArray(VAO);
+    Text->Flush();
+}
 
-    // iterate through all characters
-    std::string::const_iterator c;
-    for (c = text.begin(); c != text.end(); c++) 
+// benchmarkText() renders a screen full of text (several thousand glyphs) for a number of frames, once batched and
+// once with a draw call per glyph like text used to be rendered, and reports the glyph throughput of both
+// ----------------------------------------------------------------------------------------------------------------
+void benchmarkText(GLFWwindow *window, Shader &shader)
+{
+    const unsigned int frames = 100;
+    const char *line = "The quick brown fox jumps over the lazy dog 0123456789 !?";
+    glfwSwapInterval(0); // don't measure vsync
+    for (int batched = 1; batched >= 0; --batched)
     {
-        Character ch = Characters[*c];
-
-        float xpos = x + ch.Bearing.x * scale;
-        float ypos = y - (ch.Size.y - ch.Bearing.y) * scale;
-
-        float w = ch.Size.x * scale;
-        float h = ch.Size.y * scale;
-        // update VBO for each character
-        float vertices[6][4] = {
-            { xpos,     ypos + h,   0.0f, 0.0f },            
-            { xpos,     ypos,       0.0f, 1.0f },
-            { xpos + w, ypos,       1.0f, 1.0f },
-
-            { xpos,     ypos + h,   0.0f, 0.0f },
-            { xpos + w, ypos,       1.0f, 1.0f },
-            { xpos + w, ypos + h,   1.0f, 0.0f }           
-        };
-        // render glyph texture over quad
-        glBindTexture(GL_TEXTURE_2D, ch.TextureID);
-        // update content of VBO memory
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vertices), vertices); // be sure to use glBufferSubData and not glBufferData
-
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-        // render quad
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-        // now advance cursors for next glyph (note that advance is number of 1/64 pixels)
-        x += (ch.Advance >> 6) * scale; // bitshift by 6 to get value in pixels (2^6 = 64 (divide amount of 1/64th pixels by 64 to get amount of pixels))
+        Text->ResetStats();
+        glFinish();
+        double start = glfwGetTime();
+        for (unsigned int frame = 0; frame < frames; ++frame)
+        {
+            glClear(GL_COLOR_BUFFER_BIT);
+            for (float y = SCR_HEIGHT - 12.0f; y > 0.0f; y -= 12.0f)
+            {
+                if (batched)
+                    RenderText(line, 5.0f, y, 0.25f, glm::vec3(0.5, 0.8f, 0.2f));
+                else
+                {
+                    float x = 5.0f;
+                    for (const char *c = line; *c != '\0'; ++c)
+                    {
+                        RenderText(std::string(1, *c), x, y, 0.25f, glm::vec3(0.5, 0.8f, 0.2f));
+                        FlushText(shader);
+                        x += (Atlas->Find(*c)->Advance >> 6) * 0.25f;
+                    }
+                }
+            }
+            FlushText(shader);
+            glfwSwapBuffers(window);
+        }
+        glFinish();
+        double elapsed = glfwGetTime() - start;
+        std::cout << (batched ? "batched:  " : "per glyph: ") << Text->GlyphsDrawn / frames << " glyphs per frame in " << Text->DrawCalls / frames
+                  << " draw calls | frame: " << elapsed * 1000.0 / frames << " ms | " << Text->GlyphsDrawn / elapsed / 1000000.0 << " M glyphs/s" << std::endl;
     }
-    glBindVertexArray(0);
-    glBindTexture(GL_TEXTURE_2D, 0);
+    std::cout << "atlas: " << Atlas->Glyphs.size() << " glyphs on " << Atlas->Pages.size() << " page(s) of " << Atlas->PageSize << "x" << Atlas->PageSize
+              << " (" << Atlas->MemoryBytes() / 1024 << " KB) | last page " << Atlas->Occupancy() * 100.0f << "% used" << std::endl;
+    glfwSwapInterval(1);
 }
+
+// benchmarkGlyphCache() requests ~1000 codepoints (Latin, Greek and Cyrillic) from a distance field cache that only
+// has room for a few hundred, like text in many scripts streaming through a small cache, and reports how long glyphs
+// take to arrive (miss latency), how many were evicted and how much memory the atlas uses
+// ---------------------------------------------------------------------------------------------------------------
+void benchmarkGlyphCache(const std::string &font)
+{
+    const unsigned int ranges[][2] = { { 0x20, 0x7F }, { 0xA0, 0x250 }, { 0x370, 0x400 }, { 0x400, 0x530 } };
+    GlyphCache cache(font, 48, 6, 1024, 1);
+    unsigned int requested = 0;
+    double start = glfwGetTime();
+    for (const unsigned int *range : ranges)
+    {
+        // a frame's worth of requests at a time, uploads in between
+        for (unsigned int codepoint = range[0]; codepoint < range[1]; ++codepoint, ++requested)
+        {
+            cache.Find(codepoint);
+            if (requested % 64 == 63)
+                cache.Update();
+        }
+    }
+    while (cache.Pending() > 0)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        cache.Update();
+    }
+    double elapsed = glfwGetTime() - start;
+    // lookups of glyphs in the cache (only those resident, so every lookup is a hit)
+    cache.Update();
+    std::vector<unsigned int> cached = cache.CachedCodepoints();
+    start = glfwGetTime();
+    unsigned int lookups = 0;
+    for (unsigned int i = 0; i < 100; ++i)
+        for (unsigned int codepoint : cached)
+        {
+            cache.Find(codepoint);
+            lookups++;
+        }
+    double lookup = glfwGetTime() - start;
+    std::cout << "glyph cache: " << requested << " codepoints in " << elapsed * 1000.0 << " ms | miss latency: " << cache.AverageMissLatency()
+              << " ms average, " << cache.MaxMissLatency << " ms max | " << cache.CachedGlyphs() << " cached, " << cache.Evictions << " evicted, "
+              << cache.Dropped << " dropped | atlas: " << cache.Pages.size() << " page(s), " << cache.CellSize << "px cells, "
+              << cache.MemoryBytes() / 1024 << " KB | hit: " << lookup * 1e9 / lookups << " ns" << std::endl;
+}
\ No newline at end of file
@@ -0,0 +1,15 @@
+#version 330 core
+in vec2 TexCoords;
+in vec3 TextColor;
+out vec4 color;
+
+uniform sampler2D text;
+
+void main()
+{    
+    // the texture holds the distance to the outline (0.5 on the edge); smooth over about a pixel on screen
+    float distance = texture(text, TexCoords).r;
+    float smoothing = fwidth(distance) * 0.75;
+    float alpha = smoothstep(0.5 - smoothing, 0.5 + smoothing, distance);
+    color = vec4(TextColor, alpha);
+}
\ No newline at end of file
@@ -0,0 +1,585 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#include "audio_mixer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define MIXER_SSE
+#endif
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+// Play/Stop calls that can be queued before the mixer thread picks them up (a power of two)
+const unsigned int COMMAND_QUEUE_SIZE = 256;
+// music handed back to the game thread: no more than was queued, plus what's playing
+const unsigned int RETIRED_QUEUE_SIZE = 2 * COMMAND_QUEUE_SIZE;
+// music is read from disk at least half a second ahead, so a slow frame doesn't starve the mixer
+const unsigned int MUSIC_BUFFER_MS = 500;
+
+
+// adds samples * volume to out (count floats)
+static void mixInto(float *out, const float *samples, size_t count, float volume)
+{
+    size_t i = 0;
+#ifdef MIXER_SSE
+    // 8 samples (4 stereo frames) at a time
+    __m128 gain = _mm_set1_ps(volume);
+    for (; i + 8 <= count; i += 8)
+    {
+        __m128 a = _mm_add_ps(_mm_loadu_ps(out + i), _mm_mul_ps(_mm_loadu_ps(samples + i), gain));
+        __m128 b = _mm_add_ps(_mm_loadu_ps(out + i + 4), _mm_mul_ps(_mm_loadu_ps(samples + i + 4), gain));
+        _mm_storeu_ps(out + i, a);
+        _mm_storeu_ps(out + i + 4, b);
+    }
+#endif
+    for (; i < count; ++i)
+        out[i] += samples[i] * volume;
+}
+
+// linear resampling of interleaved stereo frames, appending to out; step is source frames per output frame.
+// phase is where the next output frame falls relative to the first of these frames, frame -1 being last (the
+// final frame of the previous call): both carry over between calls so a stream can be resampled piece by piece
+static void resample(const float *in, unsigned int frames, double step, double &phase, float last[2], std::vector<float> &out)
+{
+    if (frames == 0)
+        return;
+    while (phase < frames - 1.0)
+    {
+        int i = static_cast<int>(std::floor(phase));
+        float t = static_cast<float>(phase - i);
+        const float *a = i < 0 ? last : in + 2 * i;
+        const float *b = in + 2 * (i + 1);
+        out.push_back(a[0] + (b[0] - a[0]) * t);
+        out.push_back(a[1] + (b[1] - a[1]) * t);
+        phase += step;
+    }
+    phase -= frames;
+    last[0] = in[2 * (frames - 1)];
+    last[1] = in[2 * (frames - 1) + 1];
+}
+
+
+WavDecoder::WavDecoder()
+    : SampleRate(0), Channels(0), Frames(0), dataStart(0), bytesPerSample(0), isFloat(false), position(0)
+{
+
+}
+
+bool WavDecoder::Open(const char *file)
+{
+    this->stream.close();
+    this->stream.clear();
+    this->stream.open(file, std::ios::binary);
+    if (!this->stream)
+        return false;
+    char riff[12];
+    if (!this->stream.read(riff, 12) || std::memcmp(riff, "RIFF", 4) != 0 || std::memcmp(riff + 8, "WAVE", 4) != 0)
+        return false;
+    // walk the chunks up to the samples, picking up the format on the way
+    uint16_t format = 0, channels = 0, bits = 0;
+    uint32_t rate = 0, dataSize = 0;
+    bool haveFormat = false;
+    for (;;)
+    {
+        char id[4];
+        uint32_t size;
+        if (!this->stream.read(id, 4) || !this->stream.read(reinterpret_cast<char*>(&size), 4))
+            return false;
+        if (std::memcmp(id, "data", 4) == 0)
+        {
+            dataSize = size;
+            break;
+        }
+        // chunks are padded to an even size
+        uint32_t skip = size + (size & 1);
+        if (std::memcmp(id, "fmt ", 4) == 0 && size >= 16)
+        {
+            std::vector<char> chunk(size);
+            if (!this->stream.read(&chunk[0], size))
+                return false;
+            std::memcpy(&format, &chunk[0], 2);
+            std::memcpy(&channels, &chunk[2], 2);
+            std::memcpy(&rate, &chunk[4], 4);
+            std::memcpy(&bits, &chunk[14], 2);
+            // WAVE_FORMAT_EXTENSIBLE: the actual format starts the sub format GUID
+            if (format == 0xFFFE && size >= 26)
+                std::memcpy(&format, &chunk[24], 2);
+            haveFormat = true;
+            skip -= size;
+        }
+        this->stream.seekg(skip, std::ios::cur);
+    }
+    bool pcm = format == 1 && (bits == 8 || bits == 16 || bits == 24 || bits == 32);
+    bool ieeeFloat = format == 3 && bits == 32;
+    if (!haveFormat || !(pcm || ieeeFloat) || channels < 1 || channels > 2 || rate == 0)
+        return false;
+    this->dataStart = this->stream.tellg();
+    this->SampleRate = rate;
+    this->Channels = channels;
+    this->bytesPerSample = bits / 8;
+    this->isFloat = ieeeFloat;
+    this->Frames = dataSize / (this->bytesPerSample * channels);
+    this->position = 0;
+    return true;
+}
+
+unsigned int WavDecoder::Read(float *samples, unsigned int frames)
+{
+    frames = std::min(frames, this->Frames - this->position);
+    size_t frameBytes = this->bytesPerSample * this->Channels;
+    if (frames == 0 || frameBytes == 0)
+        return 0;
+    this->raw.resize(std::max(this->raw.size(), frames * frameBytes));
+    this->stream.read(reinterpret_cast<char*>(&this->raw[0]), frames * frameBytes);
+    frames = static_cast<unsigned int>(this->stream.gcount() / frameBytes);
+    // mono is decoded into the second half and spread over both channels after
+    size_t count = static_cast<size_t>(frames) * this->Channels;
+    float *out = this->Channels == 1 ? samples + count : samples;
+    const unsigned char *in = &this->raw[0];
+    switch (this->bytesPerSample)
+    {
+    case 1: // unsigned
+        for (size_t i = 0; i < count; ++i)
+            out[i] = (in[i] - 128) * (1.0f / 128.0f);
+        break;
+    case 2:
+        for (size_t i = 0; i < count; ++i)
+        {
+            int16_t value;
+            std::memcpy(&value, in + 2 * i, 2);
+            out[i] = value * (1.0f / 32768.0f);
+        }
+        break;
+    case 3:
+        for (size_t i = 0; i < count; ++i)
+        {
+            const unsigned char *sample = in + 3 * i;
+            int32_t value = static_cast<int32_t>(sample[0] << 8 | sample[1] << 16 | static_cast<uint32_t>(sample[2]) << 24);
+            out[i] = value * (1.0f / 2147483648.0f);
+        }
+        break;
+    case 4:
+        if (this->isFloat)
+            std::memcpy(out, in, count * 4);
+        else
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                int32_t value;
+                std::memcpy(&value, in + 4 * i, 4);
+                out[i] = value * (1.0f / 2147483648.0f);
+            }
+        }
+        break;
+    }
+    if (this->Channels == 1)
+    {
+        for (size_t i = 0; i < count; ++i)
+            samples[2 * i] = samples[2 * i + 1] = out[i];
+    }
+    this->position += frames;
+    return frames;
+}
+
+void WavDecoder::Rewind()
+{
+    this->stream.clear();
+    this->stream.seekg(this->dataStart);
+    this->position = 0;
+}
+
+
+// Music streamed from disk: the game thread decodes and resamples it into a
+// ring of frames that the mixer thread reads (single producer, single consumer)
+struct AudioMixer::Music {
+    WavDecoder                Decoder;
+    float                     Volume;
+    bool                      Loop;
+    // frames at the mixer's rate (Capacity is a power of two); Written and Read count the frames put in and taken out
+    std::vector<float>        Ring;
+    unsigned int              Capacity;
+    std::atomic<unsigned int> Written, Read;
+    // set once the last frame is in the ring
+    std::atomic<bool>         Ended;
+    // game thread: decoded frames before resampling, the resampling state and the resampled frames
+    std::vector<float>        Source, Resampled;
+    double                    Step, Phase;
+    float                     Last[2];
+
+    Music()
+        : Written(0), Read(0), Ended(false)
+    {
+
+    }
+    bool Open(const char *file, unsigned int sampleRate, bool loop, float volume)
+    {
+        if (!this->Decoder.Open(file))
+            return false;
+        this->Volume = volume;
+        this->Loop = loop;
+        this->Capacity = 1;
+        while (this->Capacity < sampleRate * MUSIC_BUFFER_MS / 1000)
+            this->Capacity *= 2;
+        this->Ring.resize(static_cast<size_t>(this->Capacity) * 2);
+        this->Step = static_cast<double>(this->Decoder.SampleRate) / sampleRate;
+        this->Phase = 0.0;
+        this->Last[0] = this->Last[1] = 0.0f;
+        this->Source.resize((static_cast<size_t>(this->Capacity * this->Step) + 2) * 2);
+        this->Fill();
+        return true;
+    }
+    // game thread: reads from the file until the ring is full
+    void Fill()
+    {
+        bool rewound = false;
+        while (!this->Ended.load(std::memory_order_relaxed))
+        {
+            unsigned int written = this->Written.load(std::memory_order_relaxed);
+            unsigned int space = this->Capacity - (written - this->Read.load(std::memory_order_acquire));
+            // the resampler turns n source frames into at most n / Step + 1 frames
+            unsigned int wanted = space > 1 ? static_cast<unsigned int>(std::min<double>(this->Source.size() / 2, (space - 1) * this->Step)) : 0;
+            if (wanted == 0)
+                break;
+            unsigned int read = this->Decoder.Read(&this->Source[0], wanted);
+            if (read == 0)
+            {
+                // (a file that reads nothing right after rewinding is done for good)
+                if (this->Loop && !rewound)
+                {
+                    this->Decoder.Rewind();
+                    rewound = true;
+                    continue;
+                }
+                this->Ended.store(true, std::memory_order_release);
+                break;
+            }
+            rewound = false;
+            this->Resampled.clear();
+            resample(&this->Source[0], read, this->Step, this->Phase, this->Last, this->Resampled);
+            unsigned int frames = static_cast<unsigned int>(this->Resampled.size() / 2);
+            for (unsigned int done = 0; done < frames; )
+            {
+                unsigned int at = (written + done) & (this->Capacity - 1);
+                unsigned int count = std::min(frames - done, this->Capacity - at);
+                std::memcpy(&this->Ring[at * 2], &this->Resampled[done * 2], count * 2 * sizeof(float));
+                done += count;
+            }
+            this->Written.store(written + frames, std::memory_order_release);
+        }
+    }
+};
+
+
+AudioMixer::AudioMixer(AudioOutput *output, unsigned int sampleRate, unsigned int blockFrames)
+    : SampleRate(sampleRate), BlockFrames(blockFrames), output(output), commands(COMMAND_QUEUE_SIZE), commandHead(0), commandTail(0),
+      nextVoice(0), retired(RETIRED_QUEUE_SIZE), retiredHead(0), retiredTail(0), music(nullptr), running(false), blocks(0), voiceFrames(0), mixNanoseconds(0), peakVoices(0), droppedCommands(0), droppedVoices(0)
+{
+    this->voices.reserve(MAX_VOICES);
+}
+
+AudioMixer::~AudioMixer()
+{
+    // (the music, queued or not, is freed with streams once the mixer thread is gone)
+    this->Shutdown();
+}
+
+unsigned int AudioMixer::LoadSound(const char *file)
+{
+    WavDecoder decoder;
+    std::vector<float> decoded;
+    unsigned int frames = 0;
+    if (decoder.Open(file))
+    {
+        decoded.resize(static_cast<size_t>(decoder.Frames) * 2);
+        frames = decoder.Frames > 0 ? decoder.Read(&decoded[0], decoder.Frames) : 0;
+    }
+    if (frames == 0)
+    {
+        std::cout << "ERROR::AUDIO: Failed to load " << file << " (only WAV files are supported)" << std::endl;
+        return 0;
+    }
+    std::unique_ptr<SoundBuffer> sound(new SoundBuffer());
+    if (decoder.SampleRate == this->SampleRate)
+        sound->Samples.assign(decoded.begin(), decoded.begin() + frames * 2);
+    else
+    {
+        double phase = 0.0;
+        float last[2] = { 0.0f, 0.0f };
+        resample(&decoded[0], frames, static_cast<double>(decoder.SampleRate) / this->SampleRate, phase, last, sound->Samples);
+    }
+    sound->Frames = static_cast<unsigned int>(sound->Samples.size() / 2);
+    if (sound->Frames == 0)
+        return 0;
+    // the mixer thread only sees the buffer (through Play), which doesn't move when this list grows
+    this->sounds.push_back(std::move(sound));
+    return static_cast<unsigned int>(this->sounds.size());
+}
+
+unsigned int AudioMixer::Play(unsigned int sound, float volume, bool loop)
+{
+    if (sound == 0 || sound > this->sounds.size())
+        return 0;
+    if (++this->nextVoice == 0)
+        this->nextVoice = 1;
+    Command command = { COMMAND_PLAY, this->nextVoice, this->sounds[sound - 1].get(), volume, loop, nullptr };
+    return this->send(command) ? this->nextVoice : 0;
+}
+
+void AudioMixer::Stop(unsigned int voice)
+{
+    Command command = { COMMAND_STOP, voice, nullptr, 0.0f, false, nullptr };
+    this->send(command);
+}
+
+bool AudioMixer::PlayMusic(const char *file, float volume, bool loop)
+{
+    this->collect();
+    std::unique_ptr<Music> music(new Music());
+    if (!music->Open(file, this->SampleRate, loop, volume))
+    {
+        std::cout << "ERROR::AUDIO: Failed to stream " << file << " (only WAV files are supported)" << std::endl;
+        return false;
+    }
+    Command command = { COMMAND_MUSIC, 0, nullptr, volume, loop, music.get() };
+    if (!this->send(command))
+        return false;
+    // kept until the mixer thread hands it back
+    this->streams.push_back(std::move(music));
+    return true;
+}
+
+void AudioMixer::StopMusic()
+{
+    Command command = { COMMAND_MUSIC, 0, nullptr, 0.0f, false, nullptr };
+    this->send(command);
+}
+
+void AudioMixer::Update()
+{
+    this->collect();
+    for (std::unique_ptr<Music> &stream : this->streams)
+        stream->Fill();
+}
+
+void AudioMixer::Start()
+{
+    if (this->running)
+        return;
+    if (!this->output->Open(this->SampleRate, this->BlockFrames))
+    {
+        std::cout << "ERROR::AUDIO: Failed to open the " << this->output->Name() << " output, continuing without sound" << std::endl;
+        this->output.reset(new NullAudioOutput());
+        this->output->Open(this->SampleRate, this->BlockFrames);
+    }
+    this->running = true;
+    this->thread = std::thread(&AudioMixer::run, this);
+}
+
+void AudioMixer::Shutdown()
+{
+    if (!this->running)
+        return;
+    this->running = false;
+    this->thread.join();
+    this->output->Close();
+}
+
+bool AudioMixer::IsRunning() const
+{
+    return this->running;
+}
+
+void AudioMixer::Mix(float *samples, unsigned int frames)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    frames = std::min(frames, this->BlockFrames);
+    this->receive();
+    std::fill(samples, samples + frames * 2, 0.0f);
+    unsigned int playing = static_cast<unsigned int>(this->voices.size()) + (this->music ? 1 : 0);
+    unsigned long long mixed = 0;
+    for (size_t i = 0; i < this->voices.size(); )
+    {
+        Voice &voice = this->voices[i];
+        unsigned int done = 0;
+        while (done < frames)
+        {
+            unsigned int count = std::min(frames - done, voice.Sound->Frames - voice.Position);
+            mixInto(samples + done * 2, &voice.Sound->Samples[voice.Position * 2], count * 2, voice.Volume);
+            done += count;
+            voice.Position += count;
+            if (voice.Position < voice.Sound->Frames)
+                continue;
+            if (!voice.Loop)
+                break;
+            voice.Position = 0;
+        }
+        mixed += done;
+        // finished voices make room by swapping in the last one (the order doesn't matter)
+        if (voice.Position == voice.Sound->Frames)
+        {
+            voice = this->voices.back();
+            this->voices.pop_back();
+        }
+        else
+            ++i;
+    }
+    if (this->music)
+    {
+        // (Ended first: once it's set, Written doesn't change anymore)
+        Music &music = *this->music;
+        bool ended = music.Ended.load(std::memory_order_acquire);
+        unsigned int read = music.Read.load(std::memory_order_relaxed);
+        unsigned int available = music.Written.load(std::memory_order_acquire) - read;
+        unsigned int count = std::min(frames, available);
+        for (unsigned int done = 0; done < count; )
+        {
+            unsigned int at = (read + done) & (music.Capacity - 1);
+            unsigned int piece = std::min(count - done, music.Capacity - at);
+            mixInto(samples + done * 2, &music.Ring[at * 2], piece * 2, music.Volume);
+            done += piece;
+        }
+        music.Read.store(read + count, std::memory_order_release);
+        mixed += count;
+        if (ended && count == available)
+        {
+            this->retire(this->music);
+            this->music = nullptr;
+        }
+    }
+    this->blocks++;
+    this->voiceFrames += mixed;
+    if (playing > this->peakVoices)
+        this->peakVoices = playing;
+    this->mixNanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+const AudioOutput &AudioMixer::Output() const
+{
+    return *this->output;
+}
+
+MixerStats AudioMixer::Stats() const
+{
+    MixerStats stats;
+    stats.Blocks = this->blocks;
+    stats.VoiceFrames = this->voiceFrames;
+    stats.MixSeconds = this->mixNanoseconds * 1e-9;
+    stats.PeakVoices = this->peakVoices;
+    stats.DroppedCommands = this->droppedCommands;
+    stats.DroppedVoices = this->droppedVoices;
+    return stats;
+}
+
+bool AudioMixer::send(const Command &command)
+{
+    unsigned int head = this->commandHead.load(std::memory_order_relaxed);
+    if (head - this->commandTail.load(std::memory_order_acquire) >= COMMAND_QUEUE_SIZE)
+    {
+        this->droppedCommands++;
+        return false;
+    }
+    this->commands[head % COMMAND_QUEUE_SIZE] = command;
+    this->commandHead.store(head + 1, std::memory_order_release);
+    return true;
+}
+
+void AudioMixer::receive()
+{
+    unsigned int tail = this->commandTail.load(std::memory_order_relaxed);
+    unsigned int head = this->commandHead.load(std::memory_order_acquire);
+    for (; tail != head; ++tail)
+    {
+        const Command &command = this->commands[tail % COMMAND_QUEUE_SIZE];
+        if (command.Type == COMMAND_PLAY)
+        {
+            if (this->voices.size() < MAX_VOICES)
+            {
+                Voice voice = { command.Sound, 0, command.Volume, command.Loop, command.Voice };
+                this->voices.push_back(voice);
+            }
+            else
+                this->droppedVoices++;
+        }
+        else if (command.Type == COMMAND_STOP)
+        {
+            for (size_t i = 0; i < this->voices.size(); ++i)
+            {
+                if (this->voices[i].Id == command.Voice)
+                {
+                    this->voices[i] = this->voices.back();
+                    this->voices.pop_back();
+                    break;
+                }
+            }
+        }
+        else // COMMAND_MUSIC
+        {
+            if (this->music)
+                this->retire(this->music);
+            this->music = command.Stream;
+        }
+    }
+    this->commandTail.store(tail, std::memory_order_release);
+}
+
+void AudioMixer::retire(Music *stream)
+{
+    // (it can't be full, see RETIRED_QUEUE_SIZE; if it were, the music would be freed with the mixer)
+    unsigned int head = this->retiredHead.load(std::memory_order_relaxed);
+    if (head - this->retiredTail.load(std::memory_order_acquire) >= RETIRED_QUEUE_SIZE)
+        return;
+    this->retired[head % RETIRED_QUEUE_SIZE] = stream;
+    this->retiredHead.store(head + 1, std::memory_order_release);
+}
+
+void AudioMixer::collect()
+{
+    unsigned int tail = this->retiredTail.load(std::memory_order_relaxed);
+    unsigned int head = this->retiredHead.load(std::memory_order_acquire);
+    for (; tail != head; ++tail)
+    {
+        Music *stream = this->retired[tail % RETIRED_QUEUE_SIZE];
+        for (size_t i = 0; i < this->streams.size(); ++i)
+        {
+            if (this->streams[i].get() == stream)
+            {
+                this->streams.erase(this->streams.begin() + i);
+                break;
+            }
+        }
+    }
+    this->retiredTail.store(tail, std::memory_order_release);
+}
+
+void AudioMixer::run()
+{
+#ifdef _WIN32
+    // a late block is an audible glitch, a late frame isn't
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_HIGHEST);
+#endif
+    std::vector<float> block(static_cast<size_t>(this->BlockFrames) * 2);
+    while (this->running.load(std::memory_order_relaxed))
+    {
+        this->Mix(&block[0], this->BlockFrames);
+        if (!this->output->Write(&block[0], this->BlockFrames))
+        {
+            std::cout << "ERROR::AUDIO: Failed to write to the " << this->output->Name() << " output, stopping" << std::endl;
+            break;
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,155 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#ifndef AUDIO_MIXER_H
+#define AUDIO_MIXER_H
+#include <atomic>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "audio_output.h"
+
+
+// Voices mixed at once; Play drops sounds beyond this
+const unsigned int MAX_VOICES = 64;
+
+// A sound decoded up front: interleaved stereo float samples at the mixer's rate
+struct SoundBuffer {
+    std::vector<float> Samples;
+    unsigned int       Frames;
+};
+
+// WavDecoder reads a WAV file (8, 16, 24 or 32-bit PCM or 32-bit float,
+// mono or stereo) a piece at a time, as interleaved stereo float samples
+class WavDecoder
+{
+public:
+    // format of the file
+    unsigned int SampleRate, Channels, Frames;
+    // constructor
+    WavDecoder();
+    // opens a file and finds its samples; returns false if it isn't a WAV file we can read
+    bool Open(const char *file);
+    // reads up to frames frames into samples; returns the number read (0 at the end of the file)
+    unsigned int Read(float *samples, unsigned int frames);
+    // back to the first frame
+    void Rewind();
+private:
+    std::ifstream              stream;
+    std::streamoff             dataStart;
+    unsigned int               bytesPerSample;
+    bool                       isFloat;
+    unsigned int               position;
+    std::vector<unsigned char> raw;
+};
+
+// Mixer statistics, since construction
+struct MixerStats {
+    unsigned long long Blocks;          // blocks mixed
+    unsigned long long VoiceFrames;     // frames mixed summed over voices (a block with 3 voices counts 3 blocks worth)
+    double             MixSeconds;      // time spent mixing
+    unsigned int       PeakVoices;      // most voices playing at once (music included)
+    unsigned int       DroppedCommands; // Play/Stop calls lost because the mixer didn't keep up
+    unsigned int       DroppedVoices;   // sounds not played because MAX_VOICES were playing
+};
+
+// AudioMixer plays sounds on a thread of its own. Sounds are decoded into
+// memory up front, so playing one touches neither the disk nor the heap;
+// music is streamed from disk instead, by Update on the game thread, into
+// a ring the mixer thread only reads. The mixer thread mixes a block of
+// all voices at a time (with SSE when available) and hands it to the
+// output, which blocks until it can take it. Play, Stop and PlayMusic
+// are queued to the mixer thread without locks, and music it's done with
+// is handed back to be freed: call them and Update from a single thread
+// (the game's).
+class AudioMixer
+{
+public:
+    // output format: stereo at SampleRate, mixed BlockFrames at a time (the latency is a few blocks)
+    unsigned int SampleRate, BlockFrames;
+    // constructor/destructor (takes ownership of the output)
+    AudioMixer(AudioOutput *output, unsigned int sampleRate = 44100, unsigned int blockFrames = 512);
+    ~AudioMixer();
+    // decodes a WAV file (resampled to SampleRate); returns the sound's handle or 0 if it couldn't be loaded
+    unsigned int LoadSound(const char *file);
+    // starts playing a loaded sound; returns the voice's handle for Stop
+    unsigned int Play(unsigned int sound, float volume = 1.0f, bool loop = false);
+    // stops a voice (no-op if it's done already)
+    void Stop(unsigned int voice);
+    // streams a WAV file from disk, replacing the current music
+    bool PlayMusic(const char *file, float volume = 1.0f, bool loop = true);
+    void StopMusic();
+    // reads the music ahead from disk and frees music the mixer is done with: call it once a frame
+    void Update();
+    // opens the output and starts the mixer thread; falls back to a null output if the output can't be opened
+    void Start();
+    // stops the mixer thread and closes the output
+    void Shutdown();
+    bool IsRunning() const;
+    // mixes the next frames (at most BlockFrames) into samples: what the mixer thread does per block. Without the
+    // thread, it can be called directly to run the mixer in step with something else (a headless simulation)
+    void Mix(float *samples, unsigned int frames);
+    const AudioOutput &Output() const;
+    MixerStats Stats() const;
+private:
+    struct Music;
+    struct Voice {
+        const SoundBuffer *Sound;
+        unsigned int       Position; // frame
+        float              Volume;
+        bool               Loop;
+        unsigned int       Id;
+    };
+    enum CommandType {
+        COMMAND_PLAY,
+        COMMAND_STOP,
+        COMMAND_MUSIC
+    };
+    struct Command {
+        CommandType        Type;
+        unsigned int       Voice;
+        const SoundBuffer *Sound;
+        float              Volume;
+        bool               Loop;
+        Music             *Stream;
+    };
+    std::unique_ptr<AudioOutput>              output;
+    std::vector<std::unique_ptr<SoundBuffer>> sounds;
+    // commands from the game thread to the mixer thread (single producer, single consumer)
+    std::vector<Command>      commands;
+    std::atomic<unsigned int> commandHead, commandTail;
+    unsigned int              nextVoice;
+    // all music, playing or on its way to or from the mixer thread (owned by the game thread)
+    std::vector<std::unique_ptr<Music>> streams;
+    // music the mixer thread is done with, on its way back to the game thread (single producer, single consumer)
+    std::vector<Music*>       retired;
+    std::atomic<unsigned int> retiredHead, retiredTail;
+    // owned by the mixer thread
+    std::vector<Voice> voices;
+    Music             *music;
+    std::thread        thread;
+    std::atomic<bool>      running;
+    // statistics, updated by the mixer thread
+    std::atomic<unsigned long long> blocks, voiceFrames, mixNanoseconds;
+    std::atomic<unsigned int>       peakVoices, droppedCommands, droppedVoices;
+    // queues a command for the mixer thread; false if the queue is full
+    bool send(const Command &command);
+    // applies the queued commands
+    void receive();
+    // hands music back to the game thread (mixer thread)
+    void retire(Music *stream);
+    // frees the music handed back (game thread)
+    void collect();
+    // the mixer thread
+    void run();
+};
+
+#endif
\ No newline at end of file
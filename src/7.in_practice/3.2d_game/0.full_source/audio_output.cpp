@@ -0,0 +1,363 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#include "audio_output.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define AUDIO_SSE2
+#endif
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <mmsystem.h>
+#ifdef _MSC_VER
+#pragma comment(lib, "winmm.lib")
+#endif
+#elif defined(__linux__)
+#include <dlfcn.h>
+#endif
+
+
+void ConvertToPcm16(const float *samples, int16_t *pcm, size_t count)
+{
+    size_t i = 0;
+#ifdef AUDIO_SSE2
+    // 8 samples at a time; packing saturates, the clamp is for the rounding to match the scalar path
+    __m128 low = _mm_set1_ps(-1.0f), high = _mm_set1_ps(1.0f), scale = _mm_set1_ps(32767.0f);
+    for (; i + 8 <= count; i += 8)
+    {
+        __m128 a = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(samples + i), low), high);
+        __m128 b = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(samples + i + 4), low), high);
+        __m128i packed = _mm_packs_epi32(_mm_cvtps_epi32(_mm_mul_ps(a, scale)), _mm_cvtps_epi32(_mm_mul_ps(b, scale)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pcm + i), packed);
+    }
+#endif
+    for (; i < count; ++i)
+        pcm[i] = static_cast<int16_t>(std::lrint(std::min(std::max(samples[i], -1.0f), 1.0f) * 32767.0f));
+}
+
+
+NullAudioOutput::NullAudioOutput(bool realTime)
+    : Frames(0), realTime(realTime), sampleRate(0)
+{
+
+}
+
+bool NullAudioOutput::Open(unsigned int sampleRate, unsigned int blockFrames)
+{
+    this->sampleRate = sampleRate;
+    this->Frames = 0;
+    this->start = std::chrono::steady_clock::now();
+    return true;
+}
+
+bool NullAudioOutput::Write(const float *samples, unsigned int frames)
+{
+    this->Frames += frames;
+    // a device would take the next block once this one's playing
+    if (this->realTime && this->sampleRate > 0)
+        std::this_thread::sleep_until(this->start + std::chrono::microseconds((this->Frames - frames) * 1000000 / this->sampleRate));
+    return true;
+}
+
+void NullAudioOutput::Close()
+{
+
+}
+
+const char *NullAudioOutput::Name() const
+{
+    return "null";
+}
+
+
+// canonical 44 byte header of a PCM WAV file
+struct WavHeader {
+    char     Riff[4];
+    uint32_t RiffSize;
+    char     Wave[4];
+    char     Fmt[4];
+    uint32_t FmtSize;
+    uint16_t Format;
+    uint16_t Channels;
+    uint32_t SampleRate;
+    uint32_t ByteRate;
+    uint16_t BlockAlign;
+    uint16_t BitsPerSample;
+    char     Data[4];
+    uint32_t DataSize;
+};
+
+static WavHeader wavHeader(unsigned int sampleRate, unsigned long long frames)
+{
+    WavHeader header;
+    std::memcpy(header.Riff, "RIFF", 4);
+    std::memcpy(header.Wave, "WAVE", 4);
+    std::memcpy(header.Fmt, "fmt ", 4);
+    std::memcpy(header.Data, "data", 4);
+    header.FmtSize = 16;
+    header.Format = 1; // PCM
+    header.Channels = 2;
+    header.SampleRate = sampleRate;
+    header.ByteRate = sampleRate * 4;
+    header.BlockAlign = 4;
+    header.BitsPerSample = 16;
+    header.DataSize = static_cast<uint32_t>(frames * 4);
+    header.RiffSize = header.DataSize + sizeof(WavHeader) - 8;
+    return header;
+}
+
+WavFileAudioOutput::WavFileAudioOutput(const char *file)
+    : path(file), sampleRate(0), frames(0)
+{
+
+}
+
+WavFileAudioOutput::~WavFileAudioOutput()
+{
+    this->Close();
+}
+
+bool WavFileAudioOutput::Open(unsigned int sampleRate, unsigned int blockFrames)
+{
+    this->Close();
+    this->file.open(this->path.c_str(), std::ios::binary);
+    if (!this->file)
+        return false;
+    this->sampleRate = sampleRate;
+    this->frames = 0;
+    this->pcm.resize(static_cast<size_t>(blockFrames) * 2);
+    // the sizes are filled in by Close
+    WavHeader header = wavHeader(sampleRate, 0);
+    this->file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    return static_cast<bool>(this->file);
+}
+
+bool WavFileAudioOutput::Write(const float *samples, unsigned int frames)
+{
+    if (this->pcm.size() < static_cast<size_t>(frames) * 2)
+        this->pcm.resize(static_cast<size_t>(frames) * 2);
+    ConvertToPcm16(samples, &this->pcm[0], static_cast<size_t>(frames) * 2);
+    this->file.write(reinterpret_cast<const char*>(&this->pcm[0]), static_cast<std::streamsize>(frames) * 4);
+    this->frames += frames;
+    return static_cast<bool>(this->file);
+}
+
+void WavFileAudioOutput::Close()
+{
+    if (!this->file.is_open())
+        return;
+    WavHeader header = wavHeader(this->sampleRate, this->frames);
+    this->file.seekp(0);
+    this->file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    this->file.close();
+}
+
+const char *WavFileAudioOutput::Name() const
+{
+    return this->path.c_str();
+}
+
+
+#ifdef _WIN32
+// blocks queued on the device; Write waits for the oldest one to finish playing
+const unsigned int WAVE_OUT_BLOCKS = 4;
+
+class WaveOutAudioOutput : public AudioOutput
+{
+public:
+    WaveOutAudioOutput() : device(NULL), event(NULL), next(0) { }
+    ~WaveOutAudioOutput()
+    {
+        this->Close();
+    }
+    bool Open(unsigned int sampleRate, unsigned int blockFrames)
+    {
+        WAVEFORMATEX format = {};
+        format.wFormatTag = WAVE_FORMAT_PCM;
+        format.nChannels = 2;
+        format.nSamplesPerSec = sampleRate;
+        format.wBitsPerSample = 16;
+        format.nBlockAlign = 4;
+        format.nAvgBytesPerSec = sampleRate * 4;
+        this->event = CreateEvent(NULL, FALSE, FALSE, NULL);
+        if (waveOutOpen(&this->device, WAVE_MAPPER, &format, reinterpret_cast<DWORD_PTR>(this->event), 0, CALLBACK_EVENT) != MMSYSERR_NOERROR)
+        {
+            CloseHandle(this->event);
+            this->device = NULL;
+            this->event = NULL;
+            return false;
+        }
+        for (unsigned int i = 0; i < WAVE_OUT_BLOCKS; ++i)
+        {
+            this->buffers[i].assign(static_cast<size_t>(blockFrames) * 2, 0);
+            this->headers[i] = WAVEHDR();
+            this->headers[i].lpData = reinterpret_cast<LPSTR>(&this->buffers[i][0]);
+            this->headers[i].dwBufferLength = blockFrames * 4;
+            waveOutPrepareHeader(this->device, &this->headers[i], sizeof(WAVEHDR));
+            this->queued[i] = false;
+        }
+        this->next = 0;
+        return true;
+    }
+    bool Write(const float *samples, unsigned int frames)
+    {
+        WAVEHDR &header = this->headers[this->next];
+        // the device sets WHDR_DONE (and signals the event) when it's done with a block
+        while (this->queued[this->next] && !(header.dwFlags & WHDR_DONE))
+            WaitForSingleObject(this->event, INFINITE);
+        frames = std::min(frames, static_cast<unsigned int>(this->buffers[this->next].size() / 2));
+        ConvertToPcm16(samples, &this->buffers[this->next][0], static_cast<size_t>(frames) * 2);
+        header.dwBufferLength = frames * 4;
+        if (waveOutWrite(this->device, &header, sizeof(WAVEHDR)) != MMSYSERR_NOERROR)
+            return false;
+        this->queued[this->next] = true;
+        this->next = (this->next + 1) % WAVE_OUT_BLOCKS;
+        return true;
+    }
+    void Close()
+    {
+        if (this->device == NULL)
+            return;
+        waveOutReset(this->device);
+        for (unsigned int i = 0; i < WAVE_OUT_BLOCKS; ++i)
+            waveOutUnprepareHeader(this->device, &this->headers[i], sizeof(WAVEHDR));
+        waveOutClose(this->device);
+        CloseHandle(this->event);
+        this->device = NULL;
+        this->event = NULL;
+    }
+    const char *Name() const
+    {
+        return "waveOut";
+    }
+private:
+    HWAVEOUT             device;
+    HANDLE               event;
+    WAVEHDR              headers[WAVE_OUT_BLOCKS];
+    std::vector<int16_t> buffers[WAVE_OUT_BLOCKS];
+    bool                 queued[WAVE_OUT_BLOCKS];
+    unsigned int         next;
+};
+#elif defined(__linux__)
+// the few ALSA calls used, resolved from libasound at runtime so neither building nor running needs
+// it installed (the constants are from alsa/pcm.h)
+const int SND_PCM_STREAM_PLAYBACK = 0;
+const int SND_PCM_FORMAT_S16_LE = 2;
+const int SND_PCM_ACCESS_RW_INTERLEAVED = 3;
+typedef int  (*SndPcmOpen)(void **pcm, const char *name, int stream, int mode);
+typedef int  (*SndPcmSetParams)(void *pcm, int format, int access, unsigned int channels, unsigned int rate, int softResample, unsigned int latency);
+typedef long (*SndPcmWritei)(void *pcm, const void *buffer, unsigned long frames);
+typedef int  (*SndPcmRecover)(void *pcm, int error, int silent);
+typedef int  (*SndPcmClose)(void *pcm);
+
+class AlsaAudioOutput : public AudioOutput
+{
+public:
+    AlsaAudioOutput() : library(nullptr), device(nullptr) { }
+    ~AlsaAudioOutput()
+    {
+        this->Close();
+        if (this->library)
+            dlclose(this->library);
+    }
+    // returns false if libasound isn't there
+    bool Load()
+    {
+        this->library = dlopen("libasound.so.2", RTLD_NOW);
+        if (!this->library)
+            return false;
+        this->open = reinterpret_cast<SndPcmOpen>(dlsym(this->library, "snd_pcm_open"));
+        this->setParams = reinterpret_cast<SndPcmSetParams>(dlsym(this->library, "snd_pcm_set_params"));
+        this->writei = reinterpret_cast<SndPcmWritei>(dlsym(this->library, "snd_pcm_writei"));
+        this->recover = reinterpret_cast<SndPcmRecover>(dlsym(this->library, "snd_pcm_recover"));
+        this->close = reinterpret_cast<SndPcmClose>(dlsym(this->library, "snd_pcm_close"));
+        return this->open && this->setParams && this->writei && this->recover && this->close;
+    }
+    bool Open(unsigned int sampleRate, unsigned int blockFrames)
+    {
+        if (this->open(&this->device, "default", SND_PCM_STREAM_PLAYBACK, 0) < 0)
+        {
+            this->device = nullptr;
+            return false;
+        }
+        // a few blocks of latency
+        unsigned int latency = static_cast<unsigned int>(3ull * blockFrames * 1000000 / sampleRate);
+        if (this->setParams(this->device, SND_PCM_FORMAT_S16_LE, SND_PCM_ACCESS_RW_INTERLEAVED, 2, sampleRate, 1, latency) < 0)
+        {
+            this->Close();
+            return false;
+        }
+        this->pcm.resize(static_cast<size_t>(blockFrames) * 2);
+        return true;
+    }
+    bool Write(const float *samples, unsigned int frames)
+    {
+        if (this->pcm.size() < static_cast<size_t>(frames) * 2)
+            this->pcm.resize(static_cast<size_t>(frames) * 2);
+        ConvertToPcm16(samples, &this->pcm[0], static_cast<size_t>(frames) * 2);
+        const int16_t *data = &this->pcm[0];
+        while (frames > 0)
+        {
+            long written = this->writei(this->device, data, frames);
+            if (written < 0)
+            {
+                // underrun or suspend: restart the stream and try again
+                if (this->recover(this->device, static_cast<int>(written), 1) < 0)
+                    return false;
+                continue;
+            }
+            data += written * 2;
+            frames -= static_cast<unsigned int>(written);
+        }
+        return true;
+    }
+    void Close()
+    {
+        if (this->device)
+            this->close(this->device);
+        this->device = nullptr;
+    }
+    const char *Name() const
+    {
+        return "ALSA";
+    }
+private:
+    void                 *library;
+    void                 *device;
+    std::vector<int16_t>  pcm;
+    SndPcmOpen            open;
+    SndPcmSetParams       setParams;
+    SndPcmWritei          writei;
+    SndPcmRecover         recover;
+    SndPcmClose           close;
+};
+#endif
+
+AudioOutput *CreateDeviceOutput()
+{
+#if defined(_WIN32)
+    return new WaveOutAudioOutput();
+#elif defined(__linux__)
+    AlsaAudioOutput *output = new AlsaAudioOutput();
+    if (output->Load())
+        return output;
+    delete output;
+    return nullptr;
+#else
+    return nullptr;
+#endif
+}
\ No newline at end of file
@@ -0,0 +1,79 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#ifndef AUDIO_OUTPUT_H
+#define AUDIO_OUTPUT_H
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+
+// AudioOutput is where the mixer sends the sound it mixed: blocks of
+// interleaved stereo float samples in [-1, 1]. Write blocks while the
+// output is full, which is what paces the mixer thread.
+class AudioOutput
+{
+public:
+    virtual ~AudioOutput() { }
+    // opens the output for blocks of at most blockFrames frames; returns false if it isn't available
+    virtual bool Open(unsigned int sampleRate, unsigned int blockFrames) = 0;
+    // queues a block; blocks until the output can take it
+    virtual bool Write(const float *samples, unsigned int frames) = 0;
+    virtual void Close() = 0;
+    virtual const char *Name() const = 0;
+};
+
+// NullAudioOutput drops the samples, taking them at the rate a device
+// would (or as fast as they come if realTime is false)
+class NullAudioOutput : public AudioOutput
+{
+public:
+    // frames written since opened
+    unsigned long long Frames;
+    // constructor
+    NullAudioOutput(bool realTime = true);
+    bool Open(unsigned int sampleRate, unsigned int blockFrames);
+    bool Write(const float *samples, unsigned int frames);
+    void Close();
+    const char *Name() const;
+private:
+    bool         realTime;
+    unsigned int sampleRate;
+    std::chrono::steady_clock::time_point start;
+};
+
+// WavFileAudioOutput writes the samples to a 16-bit stereo WAV file, so
+// headless runs can be listened to (or compared) afterwards
+class WavFileAudioOutput : public AudioOutput
+{
+public:
+    // constructor/destructor
+    WavFileAudioOutput(const char *file);
+    ~WavFileAudioOutput();
+    bool Open(unsigned int sampleRate, unsigned int blockFrames);
+    bool Write(const float *samples, unsigned int frames);
+    void Close();
+    const char *Name() const;
+private:
+    std::string          path;
+    std::ofstream        file;
+    unsigned int         sampleRate;
+    unsigned long long   frames;
+    std::vector<int16_t> pcm;
+};
+
+// the platform's sound device: waveOut on Windows, ALSA on Linux (if
+// libasound is installed, it's loaded at runtime); nullptr if there is none
+AudioOutput *CreateDeviceOutput();
+
+// converts float samples to 16-bit ones, clamping them to [-1, 1]
+void ConvertToPcm16(const float *samples, int16_t *pcm, size_t count);
+
+#endif
\ No newline at end of file
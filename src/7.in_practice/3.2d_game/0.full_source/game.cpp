@@ -7,14 +7,12 @@
 ** option) any later version.
 ******************************************************************/
 #include <algorithm>
+#include <random>
 #include <sstream>
 #include <iostream>
 
 #include <learnopengl/filesystem.h>
 
-#include <irrklang/irrKlang.h>
-using namespace irrklang;
-
 #include "game.h"
 #include "resource_manager.h"
 #include "sprite_renderer.h"
@@ -23,6 +21,7 @@ using namespace irrklang;
 #include "particle_generator.h"
 #include "post_processor.h"
 #include "text_renderer.h"
+#include "audio_mixer.h"
 
 
 // Game-related State data
@@ -31,14 +30,32 @@ GameObject        *Player;
 BallObject        *Ball;
 ParticleGenerator *Particles;
 PostProcessor     *Effects;
-ISoundEngine      *SoundEngine = createIrrKlangDevice();
+AudioMixer        *Audio;
 TextRenderer      *Text;
+// per-frame data of all renderers (sprite instances, particles, text) is streamed through this
+StreamBuffer      *Stream;
+// rolls for powerups; seeded by Init so a simulation replays identically (independent of rendering)
+std::minstd_rand   Random;
 
 float ShakeTime = 0.0f;
+// bricks hit by the ball this frame, in order of impact (kept around so collision detection doesn't allocate)
+std::vector<unsigned int> HitBricks;
+
+
+// sounds, loaded by Init so playing one doesn't touch the disk
+unsigned int BrickSound, SolidSound, PowerUpSound, PaddleSound;
+
+// plays a loaded sound, unless the game runs without audio
+void PlayAudio(unsigned int sound)
+{
+    if (Audio)
+        Audio->Play(sound);
+}
 
 
 Game::Game(unsigned int width, unsigned int height) 
-    : State(GAME_MENU), Keys(), KeysProcessed(), Width(width), Height(height), Level(0), Lives(3)
+    : State(GAME_MENU), Keys(), KeysProcessed(), Width(width), Height(height), Level(0), Lives(3),
+      Shake(false), Chaos(false), Confuse(false), Headless(false), Ticks(0)
 { 
 
 }
@@ -51,40 +68,27 @@ Game::~Game()
     delete Particles;
     delete Effects;
     delete Text;
-    SoundEngine->drop();
+    delete Stream;
+    delete Audio;
+    // the game state is global: leave it ready for another Game
+    Renderer = nullptr;
+    Player = nullptr;
+    Ball = nullptr;
+    Particles = nullptr;
+    Effects = nullptr;
+    Text = nullptr;
+    Stream = nullptr;
+    Audio = nullptr;
 }
 
-void Game::Init()
+void Game::Init(bool headless)
 {
-    // load shaders
-    ResourceManager::LoadShader("sprite.vs", "sprite.fs", nullptr, "sprite");
-    ResourceManager::LoadShader("particle.vs", "particle.fs", nullptr, "particle");
-    ResourceManager::LoadShader("post_processing.vs", "post_processing.fs", nullptr, "postprocessing");
-    // configure shaders
-    glm::mat4 projection = glm::ortho(0.0f, static_cast<float>(this->Width), static_cast<float>(this->Height), 0.0f, -1.0f, 1.0f);
-    ResourceManager::GetShader("sprite").Use().SetInteger("sprite", 0);
-    ResourceManager::GetShader("sprite").SetMatrix4("projection", projection);
-    ResourceManager::GetShader("particle").Use().SetInteger("sprite", 0);
-    ResourceManager::GetShader("particle").SetMatrix4("projection", projection);
-    // load textures
-    ResourceManager::LoadTexture(FileSystem::getPath("resources/textures/background.jpg").c_str(), false, "background");
-    ResourceManager::LoadTexture(FileSystem::getPath("resources/textures/awesomeface.png").c_str(), true, "face");
-    ResourceManager::LoadTexture(FileSystem::getPath("resources/textures/block.png").c_str(), false, "block");
-    ResourceManager::LoadTexture(FileSystem::getPath("resources/textures/block_solid.png").c_str(), false, "block_solid");
-    ResourceManager::LoadTexture(FileSystem::getPath("resources/textures/paddle.png").c_str(), true, "paddle");
-    ResourceManager::LoadTexture(FileSystem::getPath("resources/textures/particle.png").c_str(), true, "particle");
-    ResourceManager::LoadTexture(FileSystem::getPath("resources/textures/powerup_speed.png").c_str(), true, "powerup_speed");
-    ResourceManager::LoadTexture(FileSystem::getPath("resources/textures/powerup_sticky.png").c_str(), true, "powerup_sticky");
-    ResourceManager::LoadTexture(FileSystem::getPath("resources/textures/powerup_increase.png").c_str(), true, "powerup_increase");
-    ResourceManager::LoadTexture(FileSystem::getPath("resources/textures/powerup_confuse.png").c_str(), true, "powerup_confuse");
-    ResourceManager::LoadTexture(FileSystem::getPath("resources/textures/powerup_chaos.png").c_str(), true, "powerup_chaos");
-    ResourceManager::LoadTexture(FileSystem::getPath("resources/textures/powerup_passthrough.png").c_str(), true, "powerup_passthrough");
-    // set render-specific controls
-    Renderer = new SpriteRenderer(ResourceManager::GetShader("sprite"));
-    Particles = new ParticleGenerator(ResourceManager::GetShader("particle"), ResourceManager::GetTexture("particle"), 500);
-    Effects = new PostProcessor(ResourceManager::GetShader("postprocessing"), this->Width, this->Height);
-    Text = new TextRenderer(this->Width, this->Height);
-    Text->Load(FileSystem::getPath("resources/fonts/OCRAEXT.TTF").c_str(), 24);
+    this->Headless = headless;
+    Random.seed(1337);
+    ShakeTime = 0.0f;
+    HitBricks.clear();
+    if (!headless)
+        this->initRendering();
     // load levels
     GameLevel one; one.Load(FileSystem::getPath("resources/levels/one.lvl").c_str(), this->Width, this->Height / 2);
     GameLevel two; two.Load(FileSystem::getPath("resources/levels/two.lvl").c_str(), this->Width, this->Height /2 );
@@ -100,18 +104,89 @@ void Game::Init()
     Player = new GameObject(playerPos, PLAYER_SIZE, ResourceManager::GetTexture("paddle"));
     glm::vec2 ballPos = playerPos + glm::vec2(PLAYER_SIZE.x / 2.0f - BALL_RADIUS, -BALL_RADIUS * 2.0f);
     Ball = new BallObject(ballPos, BALL_RADIUS, INITIAL_BALL_VELOCITY, ResourceManager::GetTexture("face"));
-    // audio
-    SoundEngine->play2D(FileSystem::getPath("resources/audio/breakout.mp3").c_str(), true);
+    // audio (silent, but still mixed, if there's no sound device)
+    if (!headless)
+    {
+        AudioOutput *device = CreateDeviceOutput();
+        Audio = new AudioMixer(device ? device : new NullAudioOutput());
+        BrickSound = Audio->LoadSound(FileSystem::getPath("resources/audio/bleep.wav").c_str());
+        SolidSound = Audio->LoadSound(FileSystem::getPath("resources/audio/solid.wav").c_str());
+        PowerUpSound = Audio->LoadSound(FileSystem::getPath("resources/audio/powerup.wav").c_str());
+        PaddleSound = BrickSound;
+        Audio->Start();
+        Audio->PlayMusic(FileSystem::getPath("resources/audio/breakout.wav").c_str());
+    }
+}
+
+void Game::initRendering()
+{
+    // load shaders and textures in the background, the game renders meanwhile: the textures show up as they come in
+    // and the renderers are created by FinishInit once the shaders are in
+    this->shaderLoads.clear();
+    this->shaderLoads.push_back(ResourceManager::LoadShaderAsync("sprite.vs", "sprite.fs", nullptr, "sprite"));
+    this->shaderLoads.push_back(ResourceManager::LoadShaderAsync("particle.vs", "particle.fs", nullptr, "particle"));
+    std::vector<LoadHandle> postProcessingLoads = PostProcessor::LoadShaders("post_processing.vs", "post_processing.fs", "postprocessing");
+    this->shaderLoads.insert(this->shaderLoads.end(), postProcessingLoads.begin(), postProcessingLoads.end());
+    // load textures
+    ResourceManager::LoadTextureAsync(FileSystem::getPath("resources/textures/background.jpg").c_str(), false, "background");
+    ResourceManager::LoadTextureAsync(FileSystem::getPath("resources/textures/awesomeface.png").c_str(), true, "face");
+    ResourceManager::LoadTextureAsync(FileSystem::getPath("resources/textures/block.png").c_str(), false, "block");
+    ResourceManager::LoadTextureAsync(FileSystem::getPath("resources/textures/block_solid.png").c_str(), false, "block_solid");
+    ResourceManager::LoadTextureAsync(FileSystem::getPath("resources/textures/paddle.png").c_str(), true, "paddle");
+    ResourceManager::LoadTextureAsync(FileSystem::getPath("resources/textures/particle.png").c_str(), true, "particle");
+    ResourceManager::LoadTextureAsync(FileSystem::getPath("resources/textures/powerup_speed.png").c_str(), true, "powerup_speed");
+    ResourceManager::LoadTextureAsync(FileSystem::getPath("resources/textures/powerup_sticky.png").c_str(), true, "powerup_sticky");
+    ResourceManager::LoadTextureAsync(FileSystem::getPath("resources/textures/powerup_increase.png").c_str(), true, "powerup_increase");
+    ResourceManager::LoadTextureAsync(FileSystem::getPath("resources/textures/powerup_confuse.png").c_str(), true, "powerup_confuse");
+    ResourceManager::LoadTextureAsync(FileSystem::getPath("resources/textures/powerup_chaos.png").c_str(), true, "powerup_chaos");
+    ResourceManager::LoadTextureAsync(FileSystem::getPath("resources/textures/powerup_passthrough.png").c_str(), true, "powerup_passthrough");
+}
+
+bool Game::FinishInit()
+{
+    if (Renderer)
+        return true;
+    for (LoadHandle load : this->shaderLoads)
+        if (!ResourceManager::IsReady(load))
+            return false;
+    // configure shaders
+    glm::mat4 projection = glm::ortho(0.0f, static_cast<float>(this->Width), static_cast<float>(this->Height), 0.0f, -1.0f, 1.0f);
+    ResourceManager::GetShader("sprite").Use().SetInteger("sprite", 0);
+    ResourceManager::GetShader("sprite").SetMatrix4("projection", projection);
+    ResourceManager::GetShader("particle").Use().SetInteger("sprite", 0);
+    ResourceManager::GetShader("particle").SetMatrix4("projection", projection);
+    // set render-specific controls
+    Stream = new StreamBuffer();
+    Renderer = new SpriteRenderer(ResourceManager::GetShader("sprite"), Stream);
+    Particles = new ParticleGenerator(ResourceManager::GetShader("particle"), ResourceManager::GetTexture("particle"), 500, PARTICLES_DROP, Stream);
+    Effects = new PostProcessor("postprocessing", this->Width, this->Height);
+    Text = new TextRenderer(this->Width, this->Height, Stream);
+    Text->Load(FileSystem::getPath("resources/fonts/OCRAEXT.TTF").c_str(), 24);
+    return true;
+}
+
+// advances the simulation by one tick of a fixed-timestep loop
+void Game::Step(float dt)
+{
+    // remember where the moving objects were, Render interpolates from there
+    Player->PreviousPosition = Player->Position;
+    Ball->PreviousPosition = Ball->Position;
+    for (PowerUp &powerUp : this->PowerUps)
+        powerUp.PreviousPosition = powerUp.Position;
+    this->ProcessInput(dt);
+    this->Update(dt);
+    ++this->Ticks;
 }
 
 void Game::Update(float dt)
 {
-    // update objects
-    Ball->Move(dt, this->Width);
+    // update objects; the ball is swept through the level so it can't tunnel through bricks at high speeds
+    this->Levels[this->Level].MoveBall(*Ball, dt, this->Width, HitBricks);
     // check for collisions
     this->DoCollisions();
-    // update particles
-    Particles->Update(dt, *Ball, 2, glm::vec2(Ball->Radius / 2.0f));
+    // update particles (purely visual, so not part of a headless simulation)
+    if (Particles)
+        Particles->Update(dt, *Ball, 2, glm::vec2(Ball->Radius / 2.0f));
     // update PowerUps
     this->UpdatePowerUps(dt);
     // reduce shake time
@@ -119,7 +194,7 @@ void Game::Update(float dt)
     {
         ShakeTime -= dt;
         if (ShakeTime <= 0.0f)
-            Effects->Shake = false;
+            this->Shake = false;
     }
     // check loss condition
     if (Ball->Position.y >= this->Height) // did ball reach bottom edge?
@@ -138,7 +213,7 @@ void Game::Update(float dt)
     {
         this->ResetLevel();
         this->ResetPlayer();
-        Effects->Chaos = true;
+        this->Chaos = true;
         this->State = GAME_WIN;
     }
 }
@@ -173,7 +248,7 @@ void Game::ProcessInput(float dt)
         if (this->Keys[GLFW_KEY_ENTER])
         {
             this->KeysProcessed[GLFW_KEY_ENTER] = true;
-            Effects->Chaos = false;
+            this->Chaos = false;
             this->State = GAME_MENU;
         }
     }
@@ -204,26 +279,93 @@ void Game::ProcessInput(float dt)
     }
 }
 
-void Game::Render()
+void Game::SetKey(int key, bool pressed)
+{
+    if (key < 0 || key >= 1024)
+        return;
+    this->Keys[key] = pressed;
+    if (!pressed)
+        this->KeysProcessed[key] = false;
+}
+
+// FNV-1a over the bytes of a value
+template <typename T>
+void HashValue(unsigned long long &hash, const T &value)
+{
+    const unsigned char *bytes = reinterpret_cast<const unsigned char*>(&value);
+    for (size_t i = 0; i < sizeof(T); ++i)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+}
+
+unsigned long long Game::StateHash() const
+{
+    unsigned long long hash = 14695981039346656037ull;
+    HashValue(hash, this->State);
+    HashValue(hash, this->Level);
+    HashValue(hash, this->Lives);
+    HashValue(hash, this->Shake);
+    HashValue(hash, this->Chaos);
+    HashValue(hash, this->Confuse);
+    HashValue(hash, ShakeTime);
+    HashValue(hash, Player->Position);
+    HashValue(hash, Player->Size);
+    HashValue(hash, Ball->Position);
+    HashValue(hash, Ball->Velocity);
+    HashValue(hash, Ball->Stuck);
+    HashValue(hash, Ball->Sticky);
+    HashValue(hash, Ball->PassThrough);
+    const GameLevel &level = this->Levels[this->Level];
+    for (unsigned int i = 0; i < level.BrickCount(); ++i)
+        HashValue(hash, level.IsDestroyed(i));
+    for (const PowerUp &powerUp : this->PowerUps)
+    {
+        for (char c : powerUp.Type)
+            HashValue(hash, c);
+        HashValue(hash, powerUp.Position);
+        HashValue(hash, powerUp.Duration);
+        HashValue(hash, powerUp.Activated);
+        HashValue(hash, powerUp.Destroyed);
+    }
+    return hash;
+}
+
+// alpha is how far real time is between the last two simulation ticks (see FixedTimestep)
+void Game::Render(float alpha)
 {
+    // once a frame, read the music ahead (it streams from disk on this thread, not the mixer's)
+    if (Audio)
+        Audio->Update();
+    // nothing to render with until the shaders are loaded
+    if (!this->FinishInit())
+        return;
     if (this->State == GAME_ACTIVE || this->State == GAME_MENU || this->State == GAME_WIN)
     {
-        // begin rendering to postprocessing framebuffer
+        // begin rendering to postprocessing framebuffer (or straight to the screen if no effect is enabled)
+        Effects->Shake = this->Shake;
+        Effects->Chaos = this->Chaos;
+        Effects->Confuse = this->Confuse;
         Effects->BeginRender();
             // draw background
             Renderer->DrawSprite(ResourceManager::GetTexture("background"), glm::vec2(0.0f, 0.0f), glm::vec2(this->Width, this->Height), 0.0f);
+            Renderer->Flush();
             // draw level
             this->Levels[this->Level].Draw(*Renderer);
+            Renderer->Flush(); // falling PowerUps overlap the bricks
             // draw player
-            Player->Draw(*Renderer);
+            Player->Draw(*Renderer, alpha);
             // draw PowerUps
             for (PowerUp &powerUp : this->PowerUps)
                 if (!powerUp.Destroyed)
-                    powerUp.Draw(*Renderer);
+                    powerUp.Draw(*Renderer, alpha);
+            Renderer->Flush();
             // draw particles	
             Particles->Draw();
             // draw ball
-            Ball->Draw(*Renderer);            
+            Ball->Draw(*Renderer, alpha);            
+            Renderer->Flush();
         // end rendering to postprocessing framebuffer
         Effects->EndRender();
         // render postprocessing quad
@@ -242,19 +384,22 @@ void Game::Render()
         Text->RenderText("You WON!!!", 320.0f, this->Height / 2.0f - 20.0f, 1.0f, glm::vec3(0.0f, 1.0f, 0.0f));
         Text->RenderText("Press ENTER to retry or ESC to quit", 130.0f, this->Height / 2.0f, 1.0f, glm::vec3(1.0f, 1.0f, 0.0f));
     }
+    Text->Flush();
+    // the next frame writes to the next region of the stream buffer
+    Stream->EndFrame();
 }
 
 
 void Game::ResetLevel()
 {
     if (this->Level == 0)
-        this->Levels[0].Load("levels/one.lvl", this->Width, this->Height / 2);
+        this->Levels[0].Load(FileSystem::getPath("resources/levels/one.lvl").c_str(), this->Width, this->Height / 2);
     else if (this->Level == 1)
-        this->Levels[1].Load("levels/two.lvl", this->Width, this->Height / 2);
+        this->Levels[1].Load(FileSystem::getPath("resources/levels/two.lvl").c_str(), this->Width, this->Height / 2);
     else if (this->Level == 2)
-        this->Levels[2].Load("levels/three.lvl", this->Width, this->Height / 2);
+        this->Levels[2].Load(FileSystem::getPath("resources/levels/three.lvl").c_str(), this->Width, this->Height / 2);
     else if (this->Level == 3)
-        this->Levels[3].Load("levels/four.lvl", this->Width, this->Height / 2);
+        this->Levels[3].Load(FileSystem::getPath("resources/levels/four.lvl").c_str(), this->Width, this->Height / 2);
 
     this->Lives = 3;
 }
@@ -265,8 +410,11 @@ void Game::ResetPlayer()
     Player->Size = PLAYER_SIZE;
     Player->Position = glm::vec2(this->Width / 2.0f - PLAYER_SIZE.x / 2.0f, this->Height - PLAYER_SIZE.y);
     Ball->Reset(Player->Position + glm::vec2(PLAYER_SIZE.x / 2.0f - BALL_RADIUS, -(BALL_RADIUS * 2.0f)), INITIAL_BALL_VELOCITY);
+    // teleported: don't interpolate from where they were
+    Player->PreviousPosition = Player->Position;
+    Ball->PreviousPosition = Ball->Position;
     // also disable all active powerups
-    Effects->Chaos = Effects->Confuse = false;
+    this->Chaos = this->Confuse = false;
     Ball->PassThrough = Ball->Sticky = false;
     Player->Color = glm::vec3(1.0f);
     Ball->Color = glm::vec3(1.0f);
@@ -310,14 +458,14 @@ void Game::UpdatePowerUps(float dt)
                 {
                     if (!IsOtherPowerUpActive(this->PowerUps, "confuse"))
                     {	// only reset if no other PowerUp of type confuse is active
-                        Effects->Confuse = false;
+                        this->Confuse = false;
                     }
                 }
                 else if (powerUp.Type == "chaos")
                 {
                     if (!IsOtherPowerUpActive(this->PowerUps, "chaos"))
                     {	// only reset if no other PowerUp of type chaos is active
-                        Effects->Chaos = false;
+                        this->Chaos = false;
                     }
                 }
             }
@@ -332,26 +480,26 @@ void Game::UpdatePowerUps(float dt)
 
 bool ShouldSpawn(unsigned int chance)
 {
-    unsigned int random = rand() % chance;
+    unsigned int random = Random() % chance;
     return random == 0;
 }
-void Game::SpawnPowerUps(GameObject &block)
+void Game::SpawnPowerUps(glm::vec2 position)
 {
     if (ShouldSpawn(75)) // 1 in 75 chance
-        this->PowerUps.push_back(PowerUp("speed", glm::vec3(0.5f, 0.5f, 1.0f), 0.0f, block.Position, ResourceManager::GetTexture("powerup_speed")));
+        this->PowerUps.push_back(PowerUp("speed", glm::vec3(0.5f, 0.5f, 1.0f), 0.0f, position, ResourceManager::GetTexture("powerup_speed")));
     if (ShouldSpawn(75))
-        this->PowerUps.push_back(PowerUp("sticky", glm::vec3(1.0f, 0.5f, 1.0f), 20.0f, block.Position, ResourceManager::GetTexture("powerup_sticky")));
+        this->PowerUps.push_back(PowerUp("sticky", glm::vec3(1.0f, 0.5f, 1.0f), 20.0f, position, ResourceManager::GetTexture("powerup_sticky")));
     if (ShouldSpawn(75))
-        this->PowerUps.push_back(PowerUp("pass-through", glm::vec3(0.5f, 1.0f, 0.5f), 10.0f, block.Position, ResourceManager::GetTexture("powerup_passthrough")));
+        this->PowerUps.push_back(PowerUp("pass-through", glm::vec3(0.5f, 1.0f, 0.5f), 10.0f, position, ResourceManager::GetTexture("powerup_passthrough")));
     if (ShouldSpawn(75))
-        this->PowerUps.push_back(PowerUp("pad-size-increase", glm::vec3(1.0f, 0.6f, 0.4), 0.0f, block.Position, ResourceManager::GetTexture("powerup_increase")));
+        this->PowerUps.push_back(PowerUp("pad-size-increase", glm::vec3(1.0f, 0.6f, 0.4), 0.0f, position, ResourceManager::GetTexture("powerup_increase")));
     if (ShouldSpawn(15)) // Negative powerups should spawn more often
-        this->PowerUps.push_back(PowerUp("confuse", glm::vec3(1.0f, 0.3f, 0.3f), 15.0f, block.Position, ResourceManager::GetTexture("powerup_confuse")));
+        this->PowerUps.push_back(PowerUp("confuse", glm::vec3(1.0f, 0.3f, 0.3f), 15.0f, position, ResourceManager::GetTexture("powerup_confuse")));
     if (ShouldSpawn(15))
-        this->PowerUps.push_back(PowerUp("chaos", glm::vec3(0.9f, 0.25f, 0.25f), 15.0f, block.Position, ResourceManager::GetTexture("powerup_chaos")));
+        this->PowerUps.push_back(PowerUp("chaos", glm::vec3(0.9f, 0.25f, 0.25f), 15.0f, position, ResourceManager::GetTexture("powerup_chaos")));
 }
 
-void ActivatePowerUp(PowerUp &powerUp)
+void ActivatePowerUp(Game &game, PowerUp &powerUp)
 {
     if (powerUp.Type == "speed")
     {
@@ -373,13 +521,13 @@ void ActivatePowerUp(PowerUp &powerUp)
     }
     else if (powerUp.Type == "confuse")
     {
-        if (!Effects->Chaos)
-            Effects->Confuse = true; // only activate if chaos wasn't already active
+        if (!game.Chaos)
+            game.Confuse = true; // only activate if chaos wasn't already active
     }
     else if (powerUp.Type == "chaos")
     {
-        if (!Effects->Confuse)
-            Effects->Chaos = true;
+        if (!game.Confuse)
+            game.Chaos = true;
     }
 }
 
@@ -404,55 +552,23 @@ Direction VectorDirection(glm::vec2 closest);
 
 void Game::DoCollisions()
 {
-    for (GameObject &box : this->Levels[this->Level].Bricks)
+    // the ball already bounced off the bricks it hit while moving (see GameLevel::MoveBall); react to those hits
+    GameLevel &level = this->Levels[this->Level];
+    for (unsigned int index : HitBricks)
     {
-        if (!box.Destroyed)
+        if (!level.IsSolid(index))
         {
-            Collision collision = CheckCollision(*Ball, box);
-            if (std::get<0>(collision)) // if collision is true
-            {
-                // destroy block if not solid
-                if (!box.IsSolid)
-                {
-                    box.Destroyed = true;
-                    this->SpawnPowerUps(box);
-                    SoundEngine->play2D(FileSystem::getPath("resources/audio/bleep.mp3").c_str(), false);
-                }
-                else
-                {   // if block is solid, enable shake effect
-                    ShakeTime = 0.05f;
-                    Effects->Shake = true;
-                    SoundEngine->play2D(FileSystem::getPath("resources/audio/bleep.mp3").c_str(), false);
-                }
-                // collision resolution
-                Direction dir = std::get<1>(collision);
-                glm::vec2 diff_vector = std::get<2>(collision);
-                if (!(Ball->PassThrough && !box.IsSolid)) // don't do collision resolution on non-solid bricks if pass-through is activated
-                {
-                    if (dir == LEFT || dir == RIGHT) // horizontal collision
-                    {
-                        Ball->Velocity.x = -Ball->Velocity.x; // reverse horizontal velocity
-                        // relocate
-                        float penetration = Ball->Radius - std::abs(diff_vector.x);
-                        if (dir == LEFT)
-                            Ball->Position.x += penetration; // move ball to right
-                        else
-                            Ball->Position.x -= penetration; // move ball to left;
-                    }
-                    else // vertical collision
-                    {
-                        Ball->Velocity.y = -Ball->Velocity.y; // reverse vertical velocity
-                        // relocate
-                        float penetration = Ball->Radius - std::abs(diff_vector.y);
-                        if (dir == UP)
-                            Ball->Position.y -= penetration; // move ball bback up
-                        else
-                            Ball->Position.y += penetration; // move ball back down
-                    }
-                }
-            }
-        }    
+            this->SpawnPowerUps(level.BrickPositions[index]);
+            PlayAudio(BrickSound);
+        }
+        else
+        {   // if block is solid, enable shake effect
+            ShakeTime = 0.05f;
+            this->Shake = true;
+            PlayAudio(SolidSound);
+        }
     }
+    HitBricks.clear();
 
     // also check collisions on PowerUps and if so, activate them
     for (PowerUp &powerUp : this->PowerUps)
@@ -465,10 +581,10 @@ void Game::DoCollisions()
 
             if (CheckCollision(*Player, powerUp))
             {	// collided with player, now activate powerup
-                ActivatePowerUp(powerUp);
+                ActivatePowerUp(*this, powerUp);
                 powerUp.Destroyed = true;
                 powerUp.Activated = true;
-                SoundEngine->play2D(FileSystem::getPath("resources/audio/powerup.wav").c_str(), false);
+                PlayAudio(PowerUpSound);
             }
         }
     }
@@ -493,7 +609,7 @@ void Game::DoCollisions()
         // if Sticky powerup is activated, also stick ball to paddle once new velocity vectors were calculated
         Ball->Stuck = Ball->Sticky;
 
-        SoundEngine->play2D(FileSystem::getPath("resources/audio/bleep.wav").c_str(), false);
+        PlayAudio(PaddleSound);
     }
 }
 
@@ -58,22 +58,42 @@ public:
     std::vector<PowerUp>    PowerUps;
     unsigned int            Level;
     unsigned int            Lives;
+    // effects state (shown by the post-processor)
+    bool                    Shake, Chaos, Confuse;
+    // simulating without rendering and audio
+    bool                    Headless;
+    // number of simulated ticks
+    unsigned int            Ticks;
     // constructor/destructor
     Game(unsigned int width, unsigned int height);
     ~Game();
-    // initialize game state (load all shaders/textures/levels)
-    void Init();
+    // initialize game state (load all shaders/textures/levels); a headless game only loads what the simulation
+    // needs and needs neither an OpenGL context nor an audio device
+    void Init(bool headless = false);
+    // shaders and textures load asynchronously (see ResourceManager::Update): once the shaders are in, configures
+    // them and creates the renderers. Returns whether the game is ready to render; Render calls it.
+    bool FinishInit();
     // game loop
+    void Step(float dt);
     void ProcessInput(float dt);
     void Update(float dt);
-    void Render();
+    void Render(float alpha = 1.0f);
     void DoCollisions();
+    // input
+    void SetKey(int key, bool pressed);
+    // hash over the complete simulation state, for determinism checks
+    unsigned long long StateHash() const;
     // reset
     void ResetLevel();
     void ResetPlayer();
     // powerups
-    void SpawnPowerUps(GameObject &block);
+    void SpawnPowerUps(glm::vec2 position);
     void UpdatePowerUps(float dt);
+private:
+    // the shaders being loaded
+    std::vector<LoadHandle> shaderLoads;
+    // starts loading shaders/textures
+    void initRendering();
 };
 
 #endif
\ No newline at end of file
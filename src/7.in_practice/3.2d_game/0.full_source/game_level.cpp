@@ -8,86 +8,507 @@
 ******************************************************************/
 #include "game_level.h"
 
-#include <fstream>
-#include <sstream>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define LEVEL_SSE
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// index of the lowest set bit (bits != 0)
+static unsigned int lowestBit(uint64_t bits)
+{
+#if defined(_MSC_VER) && defined(_M_X64)
+    unsigned long index;
+    _BitScanForward64(&index, bits);
+    return index;
+#elif defined(__GNUC__)
+    return static_cast<unsigned int>(__builtin_ctzll(bits));
+#else
+    unsigned int index = 0;
+    while (!(bits & 1))
+    {
+        bits >>= 1;
+        index++;
+    }
+    return index;
+#endif
+}
+
+// color of a brick by tile code
+static glm::vec3 brickColor(unsigned char code)
+{
+    static const glm::vec3 colors[] = {
+        glm::vec3(1.0f),
+        glm::vec3(0.8f, 0.8f, 0.7f), // solid
+        glm::vec3(0.2f, 0.6f, 1.0f),
+        glm::vec3(0.0f, 0.7f, 0.0f),
+        glm::vec3(0.8f, 0.8f, 0.4f),
+        glm::vec3(1.0f, 0.5f, 0.0f)
+    };
+    return code < 6 ? colors[code] : glm::vec3(1.0f); // original: white
+}
 
 
 void GameLevel::Load(const char *file, unsigned int levelWidth, unsigned int levelHeight)
 {
     // clear old data
-    this->Bricks.clear();
-    // load from file
-    unsigned int tileCode;
-    GameLevel level;
-    std::string line;
-    std::ifstream fstream(file);
-    std::vector<std::vector<unsigned int>> tileData;
-    if (fstream)
+    this->reset();
+    // binary levels are used straight from the mapping, text levels are parsed into tile codes first
+    LevelFile binary;
+    if (binary.Open(file))
+    {
+        const LevelHeader &header = binary.Header();
+        if (header.Width > 0 && header.Height > 0)
+            this->init(binary.Tiles(), header.Width, header.Height, levelWidth, levelHeight);
+        return;
+    }
+    std::vector<unsigned char> tiles;
+    unsigned int width, height;
+    if (LevelFile::ReadText(file, tiles, width, height))
+        this->init(&tiles[0], width, height, levelWidth, levelHeight);
+}
+
+bool GameLevel::LoadStreaming(const char *file, unsigned int levelWidth, unsigned int levelHeight, unsigned int rowsPerChunk)
+{
+    this->reset();
+    std::shared_ptr<LevelFile> level = std::make_shared<LevelFile>();
+    if (!level->Open(file) || level->Header().Width == 0 || level->Header().Height == 0)
     {
-        while (std::getline(fstream, line)) // read each line from level file
+        std::cout << "ERROR::LEVEL: Can only stream binary levels, failed to open " << file << std::endl;
+        return false;
+    }
+    const LevelHeader &header = level->Header();
+    this->file = level;
+    this->chunkRows = std::max(rowsPerChunk, 1u);
+    this->destroyedTiles.assign(static_cast<size_t>(header.Width) * header.Height, false);
+    // the header knows how many bricks there are to destroy, so completion doesn't need all rows
+    this->remaining = header.Destructible;
+    this->GridWidth = header.Width;
+    this->GridHeight = header.Height;
+    this->CellSize = glm::vec2(levelWidth / static_cast<float>(header.Width), levelHeight / header.Height);
+    return true;
+}
+
+unsigned int GameLevel::StreamRows(float top, float bottom)
+{
+    if (!this->file || this->CellSize.y <= 0.0f)
+        return 0;
+    // chunks overlapping the range
+    unsigned int chunks = (this->GridHeight + this->chunkRows - 1) / this->chunkRows;
+    float chunkHeight = this->CellSize.y * this->chunkRows;
+    unsigned int first = static_cast<unsigned int>(glm::clamp(std::floor(top / chunkHeight), 0.0f, static_cast<float>(chunks)));
+    unsigned int last = static_cast<unsigned int>(glm::clamp(std::floor(bottom / chunkHeight) + 1.0f, 0.0f, static_cast<float>(chunks)));
+    if (first >= last || (first == this->firstChunk && last == this->lastChunk))
+        return 0;
+    unsigned int loaded = 0;
+    for (unsigned int chunk = first; chunk < last; ++chunk)
+        if (chunk < this->firstChunk || chunk >= this->lastChunk)
+            loaded++;
+    // only a few screens worth of bricks are loaded at a time, so rebuilding them is cheaper than keeping
+    // the brick arrays and grid compact while chunks come and go
+    this->clearBricks();
+    this->loadRows(this->file->Tiles(), first * this->chunkRows, std::min(last * this->chunkRows, this->GridHeight));
+    this->firstChunk = first;
+    this->lastChunk = last;
+    return loaded;
+}
+
+bool GameLevel::IsStreaming() const
+{
+    return this->file != nullptr;
+}
+
+void GameLevel::Generate(unsigned int tilesX, unsigned int tilesY, unsigned int levelWidth, unsigned int levelHeight, unsigned int seed, bool solidBorder)
+{
+    this->reset();
+    if (tilesX == 0 || tilesY == 0)
+        return;
+    // roughly a third empty, one in ten solid, the rest colored
+    srand(seed);
+    std::vector<unsigned char> tiles(static_cast<size_t>(tilesX) * tilesY);
+    for (unsigned int y = 0; y < tilesY; ++y)
+    {
+        for (unsigned int x = 0; x < tilesX; ++x)
         {
-            std::istringstream sstream(line);
-            std::vector<unsigned int> row;
-            while (sstream >> tileCode) // read each word seperated by spaces
-                row.push_back(tileCode);
-            tileData.push_back(row);
+            unsigned int r = rand() % 10;
+            unsigned char &tile = tiles[static_cast<size_t>(y) * tilesX + x];
+            tile = r < 3 ? 0 : r == 3 ? 1 : 2 + rand() % 4;
+            if (solidBorder && (x == 0 || y == 0 || x == tilesX - 1 || y == tilesY - 1))
+                tile = 1;
         }
-        if (tileData.size() > 0)
-            this->init(tileData, levelWidth, levelHeight);
     }
+    this->init(&tiles[0], tilesX, tilesY, levelWidth, levelHeight);
 }
 
 void GameLevel::Draw(SpriteRenderer &renderer)
 {
-    for (GameObject &tile : this->Bricks)
-        if (!tile.Destroyed)
-            tile.Draw(renderer);
+    // walk the zero bits of the destroyed set, skipping 64 destroyed bricks at a time
+    for (size_t word = 0; word < this->destroyed.size(); ++word)
+    {
+        for (uint64_t live = ~this->destroyed[word]; live != 0; live &= live - 1)
+        {
+            unsigned int index = static_cast<unsigned int>(word * 64 + lowestBit(live));
+            unsigned char code = this->BrickCodes[index];
+            renderer.DrawSprite(code == 1 ? this->solidTexture : this->blockTexture, this->BrickPositions[index], this->CellSize, 0.0f, brickColor(code));
+        }
+    }
 }
 
-bool GameLevel::IsCompleted()
+bool GameLevel::IsCompleted() const
 {
-    for (GameObject &tile : this->Bricks)
-        if (!tile.IsSolid && !tile.Destroyed)
-            return false;
-    return true;
+    return this->remaining == 0;
+}
+
+unsigned int GameLevel::BrickCount() const
+{
+    return static_cast<unsigned int>(this->BrickCodes.size());
+}
+
+bool GameLevel::IsSolid(unsigned int index) const
+{
+    return this->BrickCodes[index] == 1;
+}
+
+bool GameLevel::IsDestroyed(unsigned int index) const
+{
+    return (this->destroyed[index / 64] >> (index % 64)) & 1;
+}
+
+unsigned int GameLevel::Remaining() const
+{
+    return this->remaining;
+}
+
+void GameLevel::DestroyBrick(unsigned int index)
+{
+    uint64_t &word = this->destroyed[index / 64];
+    uint64_t bit = static_cast<uint64_t>(1) << (index % 64);
+    if (word & bit)
+        return;
+    word |= bit;
+    if (!this->IsSolid(index))
+        this->remaining--;
+    if (this->CellSize.x <= 0.0f || this->CellSize.y <= 0.0f)
+        return;
+    // bricks never move, so the cell follows from the brick's position
+    glm::vec2 center = this->BrickPositions[index] + 0.5f * this->CellSize;
+    unsigned int x = static_cast<unsigned int>(center.x / this->CellSize.x);
+    unsigned int y = static_cast<unsigned int>(center.y / this->CellSize.y);
+    if (x >= this->GridWidth || y >= this->GridHeight)
+        return;
+    unsigned int rows = static_cast<unsigned int>(this->Grid.size()) / std::max(this->GridWidth, 1u);
+    if (y >= this->GridTop && y < this->GridTop + rows && this->Grid[(y - this->GridTop) * this->GridWidth + x] == static_cast<int>(index))
+        this->Grid[(y - this->GridTop) * this->GridWidth + x] = -1;
+    // remember it for when its row is loaded again
+    if (this->file)
+        this->destroyedTiles[static_cast<size_t>(y) * this->GridWidth + x] = true;
+}
+
+void GameLevel::QueryBricks(glm::vec2 min, glm::vec2 max, std::vector<unsigned int> &bricks) const
+{
+    bricks.clear();
+    if (this->Grid.empty() || this->CellSize.x <= 0.0f || this->CellSize.y <= 0.0f)
+        return;
+    // cell range covered by the rectangle, clamped to the grid
+    float firstX = std::floor(min.x / this->CellSize.x), lastX = std::floor(max.x / this->CellSize.x);
+    float firstY = std::floor(min.y / this->CellSize.y), lastY = std::floor(max.y / this->CellSize.y);
+    // (only the loaded rows are in the grid)
+    unsigned int rows = static_cast<unsigned int>(this->Grid.size()) / this->GridWidth;
+    float top = static_cast<float>(this->GridTop), bottom = static_cast<float>(this->GridTop + rows);
+    if (lastX < 0.0f || lastY < top || firstX >= this->GridWidth || firstY >= bottom)
+        return;
+    unsigned int x0 = static_cast<unsigned int>(std::max(firstX, 0.0f));
+    unsigned int y0 = static_cast<unsigned int>(std::max(firstY, top));
+    unsigned int x1 = std::min(static_cast<unsigned int>(lastX), this->GridWidth - 1);
+    unsigned int y1 = std::min(static_cast<unsigned int>(lastY), this->GridTop + rows - 1);
+    // bricks were added in row-major order, so walking the cells row by row yields ascending indices
+    for (unsigned int y = y0; y <= y1; ++y)
+    {
+        const int *row = &this->Grid[(y - this->GridTop) * this->GridWidth];
+        for (unsigned int x = x0; x <= x1; ++x)
+            if (row[x] >= 0)
+                bricks.push_back(static_cast<unsigned int>(row[x]));
+    }
+}
+
+void GameLevel::CollideCircle(glm::vec2 center, float radius, std::vector<unsigned int> &bricks)
+{
+    bricks.clear();
+    this->QueryBricks(center - radius, center + radius, this->candidates);
+    // a circle overlaps a box if the box's closest point to the circle's center lies within the radius
+    unsigned int count = static_cast<unsigned int>(this->candidates.size());
+    unsigned int i = 0;
+#ifdef LEVEL_SSE
+    // 4 boxes at a time
+    __m128 centerX = _mm_set1_ps(center.x);
+    __m128 centerY = _mm_set1_ps(center.y);
+    __m128 radius2 = _mm_set1_ps(radius * radius);
+    for (; i + 4 <= count; i += 4)
+    {
+        float minX[4], minY[4];
+        for (unsigned int k = 0; k < 4; ++k)
+        {
+            const glm::vec2 &position = this->BrickPositions[this->candidates[i + k]];
+            minX[k] = position.x;
+            minY[k] = position.y;
+        }
+        // (all bricks are a cell large)
+        __m128 boxMinX = _mm_loadu_ps(minX), boxMinY = _mm_loadu_ps(minY);
+        __m128 boxMaxX = _mm_add_ps(boxMinX, _mm_set1_ps(this->CellSize.x));
+        __m128 boxMaxY = _mm_add_ps(boxMinY, _mm_set1_ps(this->CellSize.y));
+        __m128 dx = _mm_sub_ps(_mm_min_ps(_mm_max_ps(centerX, boxMinX), boxMaxX), centerX);
+        __m128 dy = _mm_sub_ps(_mm_min_ps(_mm_max_ps(centerY, boxMinY), boxMaxY), centerY);
+        __m128 distance2 = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+        int hits = _mm_movemask_ps(_mm_cmplt_ps(distance2, radius2));
+        for (unsigned int k = 0; k < 4; ++k)
+            if (hits & (1 << k))
+                bricks.push_back(this->candidates[i + k]);
+    }
+#endif
+    // remaining boxes (or all of them without SIMD support)
+    for (; i < count; ++i)
+    {
+        const glm::vec2 &position = this->BrickPositions[this->candidates[i]];
+        glm::vec2 closest = glm::clamp(center, position, position + this->CellSize);
+        glm::vec2 difference = closest - center;
+        if (glm::dot(difference, difference) < radius * radius)
+            bricks.push_back(this->candidates[i]);
+    }
+}
+
+// swept circle vs. box: the time [0, 1] at which a circle moving by displacement starts
+// to touch the box, or false if it doesn't within this movement. Equivalent to a ray
+// against the box grown by the radius with rounded corners.
+static bool sweepCircleBox(glm::vec2 center, float radius, glm::vec2 displacement, glm::vec2 boxMin, glm::vec2 boxMax, float &time, glm::vec2 &normal)
+{
+    // already touching: only a hit if moving into the box (otherwise it's leaving after a bounce)
+    glm::vec2 closest = glm::clamp(center, boxMin, boxMax);
+    glm::vec2 difference = center - closest;
+    float distance2 = glm::dot(difference, difference);
+    if (distance2 < radius * radius)
+    {
+        if (distance2 > 0.0f)
+            normal = difference / std::sqrt(distance2);
+        else
+        {
+            // center inside the box: push out along the axis of least penetration
+            glm::vec2 boxCenter = 0.5f * (boxMin + boxMax);
+            glm::vec2 penetration = 0.5f * (boxMax - boxMin) - glm::abs(center - boxCenter);
+            if (penetration.x < penetration.y)
+                normal = glm::vec2(center.x < boxCenter.x ? -1.0f : 1.0f, 0.0f);
+            else
+                normal = glm::vec2(0.0f, center.y < boxCenter.y ? -1.0f : 1.0f);
+        }
+        time = 0.0f;
+        return glm::dot(displacement, normal) < 0.0f;
+    }
+    // slab test against the box grown by the radius
+    glm::vec2 grownMin = boxMin - radius, grownMax = boxMax + radius;
+    float enter = -FLT_MAX, exit = FLT_MAX;
+    glm::vec2 enterNormal(0.0f);
+    for (int axis = 0; axis < 2; ++axis)
+    {
+        if (std::abs(displacement[axis]) < 1e-8f)
+        {
+            if (center[axis] < grownMin[axis] || center[axis] > grownMax[axis])
+                return false;
+            continue;
+        }
+        float t0 = (grownMin[axis] - center[axis]) / displacement[axis];
+        float t1 = (grownMax[axis] - center[axis]) / displacement[axis];
+        float side = -1.0f;
+        if (t0 > t1)
+        {
+            std::swap(t0, t1);
+            side = 1.0f;
+        }
+        if (t0 > enter)
+        {
+            enter = t0;
+            enterNormal = glm::vec2(0.0f);
+            enterNormal[axis] = side;
+        }
+        exit = std::min(exit, t1);
+    }
+    // (an exit at 0 means the circle touches the box while moving away from it)
+    if (enter > exit || exit <= 0.0f || enter > 1.0f)
+        return false;
+    // entering through one of the grown box's faces: done, unless it's beyond a corner of the original box
+    // (starting inside the grown box without touching the original one also means a corner region)
+    enter = std::max(enter, 0.0f);
+    glm::vec2 point = center + displacement * enter;
+    bool outsideX = point.x < boxMin.x || point.x > boxMax.x;
+    bool outsideY = point.y < boxMin.y || point.y > boxMax.y;
+    if (!(outsideX && outsideY))
+    {
+        time = enter;
+        normal = enterNormal;
+        return glm::dot(displacement, normal) < 0.0f;
+    }
+    // corner region: intersect the ray with the circle around the corner
+    glm::vec2 corner = glm::clamp(point, boxMin, boxMax);
+    glm::vec2 offset = center - corner;
+    float a = glm::dot(displacement, displacement);
+    float b = glm::dot(offset, displacement);
+    float c = glm::dot(offset, offset) - radius * radius;
+    float discriminant = b * b - a * c;
+    if (discriminant < 0.0f)
+        return false;
+    float t = (-b - std::sqrt(discriminant)) / a;
+    if (t < 0.0f || t > 1.0f)
+        return false;
+    time = t;
+    normal = glm::normalize(center + displacement * t - corner);
+    return glm::dot(displacement, normal) < 0.0f;
+}
+
+bool GameLevel::SweepCircle(glm::vec2 center, float radius, glm::vec2 displacement, BrickHit &hit)
+{
+    // broadphase: every cell the swept circle's bounding box touches
+    glm::vec2 end = center + displacement;
+    this->QueryBricks(glm::min(center, end) - radius, glm::max(center, end) + radius, this->candidates);
+    bool found = false;
+    hit.Time = 2.0f;
+    for (unsigned int index : this->candidates)
+    {
+        const glm::vec2 &position = this->BrickPositions[index];
+        float time;
+        glm::vec2 normal;
+        if (sweepCircleBox(center, radius, displacement, position, position + this->CellSize, time, normal) && time < hit.Time)
+        {
+            hit.Brick = index;
+            hit.Time = time;
+            hit.Normal = normal;
+            found = true;
+        }
+    }
+    return found;
+}
+
+void GameLevel::MoveBall(BallObject &ball, float dt, unsigned int windowWidth, std::vector<unsigned int> &hits)
+{
+    hits.clear();
+    // if not stuck to player board
+    if (ball.Stuck)
+        return;
+    float maxX = windowWidth - ball.Size.x;
+    float remaining = dt;
+    for (unsigned int i = 0; i < MAX_BALL_HITS && remaining > 0.0f; ++i)
+    {
+        glm::vec2 displacement = ball.Velocity * remaining;
+        // earliest window edge the ball reaches in this step (left, right and top; the bottom is open)
+        float wallTime = 2.0f;
+        glm::vec2 wallNormal(0.0f);
+        glm::vec2 end = ball.Position + displacement;
+        if (displacement.x < 0.0f && end.x < 0.0f)
+        {
+            wallTime = -ball.Position.x / displacement.x;
+            wallNormal = glm::vec2(1.0f, 0.0f);
+        }
+        else if (displacement.x > 0.0f && end.x > maxX)
+        {
+            wallTime = (maxX - ball.Position.x) / displacement.x;
+            wallNormal = glm::vec2(-1.0f, 0.0f);
+        }
+        if (displacement.y < 0.0f && end.y < 0.0f && -ball.Position.y / displacement.y < wallTime)
+        {
+            wallTime = -ball.Position.y / displacement.y;
+            wallNormal = glm::vec2(0.0f, 1.0f);
+        }
+        wallTime = glm::clamp(wallTime, 0.0f, 2.0f);
+
+        BrickHit hit;
+        bool brickHit = this->SweepCircle(ball.Position + ball.Radius, ball.Radius, displacement, hit) && hit.Time <= wallTime;
+        float time = brickHit ? hit.Time : std::min(wallTime, 1.0f);
+        // advance to the point of impact (or the end of the step)
+        ball.Position += displacement * time;
+        remaining *= 1.0f - time;
+        if (brickHit)
+        {
+            hits.push_back(hit.Brick);
+            bool solid = this->IsSolid(hit.Brick);
+            if (!solid)
+                this->DestroyBrick(hit.Brick);
+            // don't bounce off non-solid bricks if pass-through is activated
+            if (!(ball.PassThrough && !solid))
+                ball.Velocity = glm::reflect(ball.Velocity, hit.Normal);
+        }
+        else if (wallTime <= 1.0f)
+        {
+            ball.Velocity = glm::reflect(ball.Velocity, wallNormal);
+            ball.Position.x = glm::clamp(ball.Position.x, 0.0f, maxX);
+            ball.Position.y = std::max(ball.Position.y, 0.0f);
+        }
+        else
+            break;
+    }
+}
+
+void GameLevel::reset()
+{
+    this->clearBricks();
+    this->Grid.clear();
+    this->GridWidth = this->GridHeight = this->GridTop = 0;
+    this->CellSize = glm::vec2(0.0f);
+    this->file.reset();
+    this->destroyedTiles.clear();
+    this->chunkRows = this->firstChunk = this->lastChunk = this->remaining = 0;
+}
+
+void GameLevel::init(const unsigned char *tiles, unsigned int width, unsigned int height, unsigned int levelWidth, unsigned int levelHeight)
+{
+    // calculate dimensions; the collision grid has one cell per tile
+    this->GridWidth = width;
+    this->GridHeight = height;
+    this->CellSize = glm::vec2(levelWidth / static_cast<float>(width), levelHeight / height);
+    this->loadRows(tiles, 0, height);
+}
+
+void GameLevel::clearBricks()
+{
+    this->BrickPositions.clear();
+    this->BrickCodes.clear();
+    this->destroyed.clear();
 }
 
-void GameLevel::init(std::vector<std::vector<unsigned int>> tileData, unsigned int levelWidth, unsigned int levelHeight)
+void GameLevel::loadRows(const unsigned char *tiles, unsigned int firstRow, unsigned int lastRow)
 {
-    // calculate dimensions
-    unsigned int height = tileData.size();
-    unsigned int width = tileData[0].size(); // note we can index vector at [0] since this function is only called if height > 0
-    float unit_width = levelWidth / static_cast<float>(width), unit_height = levelHeight / height; 
-    // initialize level tiles based on tileData		
-    for (unsigned int y = 0; y < height; ++y)
+    unsigned int width = this->GridWidth;
+    float unit_width = this->CellSize.x, unit_height = this->CellSize.y;
+    this->GridTop = firstRow;
+    this->Grid.assign(static_cast<size_t>(width) * (lastRow - firstRow), -1);
+    this->BrickPositions.reserve(this->BrickPositions.size() + static_cast<size_t>(width) * (lastRow - firstRow));
+    this->BrickCodes.reserve(this->BrickCodes.size() + static_cast<size_t>(width) * (lastRow - firstRow));
+    this->solidTexture = ResourceManager::GetTexture("block_solid");
+    this->blockTexture = ResourceManager::GetTexture("block");
+    // initialize level tiles based on tile data
+    for (unsigned int y = firstRow; y < lastRow; ++y)
     {
+        const unsigned char *row = tiles + static_cast<size_t>(y) * width;
+        int *cells = &this->Grid[static_cast<size_t>(y - firstRow) * width];
         for (unsigned int x = 0; x < width; ++x)
         {
-            // check block type from level data (2D level array)
-            if (tileData[y][x] == 1) // solid
-            {
-                glm::vec2 pos(unit_width * x, unit_height * y);
-                glm::vec2 size(unit_width, unit_height);
-                GameObject obj(pos, size, ResourceManager::GetTexture("block_solid"), glm::vec3(0.8f, 0.8f, 0.7f));
-                obj.IsSolid = true;
-                this->Bricks.push_back(obj);
-            }
-            else if (tileData[y][x] > 1)	// non-solid; now determine its color based on level data
-            {
-                glm::vec3 color = glm::vec3(1.0f); // original: white
-                if (tileData[y][x] == 2)
-                    color = glm::vec3(0.2f, 0.6f, 1.0f);
-                else if (tileData[y][x] == 3)
-                    color = glm::vec3(0.0f, 0.7f, 0.0f);
-                else if (tileData[y][x] == 4)
-                    color = glm::vec3(0.8f, 0.8f, 0.4f);
-                else if (tileData[y][x] == 5)
-                    color = glm::vec3(1.0f, 0.5f, 0.0f);
-
-                glm::vec2 pos(unit_width * x, unit_height * y);
-                glm::vec2 size(unit_width, unit_height);
-                this->Bricks.push_back(GameObject(pos, size, ResourceManager::GetTexture("block"), color));
-            }
+            if (row[x] == 0 || (!this->destroyedTiles.empty() && this->destroyedTiles[static_cast<size_t>(y) * width + x]))
+                continue;
+            cells[x] = static_cast<int>(this->BrickCodes.size());
+            this->BrickPositions.push_back(glm::vec2(unit_width * x, unit_height * y));
+            this->BrickCodes.push_back(row[x]);
+            // a streamed level's count comes from its header, it isn't all loaded
+            if (row[x] != 1 && !this->file)
+                this->remaining++;
         }
     }
+    // all loaded bricks start out live; the bits past the last one are set
+    size_t count = this->BrickCodes.size();
+    this->destroyed.assign((count + 63) / 64, 0);
+    if (count % 64 != 0)
+        this->destroyed.back() = ~static_cast<uint64_t>(0) << (count % 64);
 }
\ No newline at end of file
@@ -8,34 +8,111 @@
 ******************************************************************/
 #ifndef GAMELEVEL_H
 #define GAMELEVEL_H
+#include <cstdint>
+#include <memory>
 #include <vector>
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
 #include "game_object.h"
+#include "ball_object.h"
 #include "sprite_renderer.h"
 #include "resource_manager.h"
+#include "level_file.h"
+
+
+// The first brick a moving circle runs into
+struct BrickHit {
+    unsigned int Brick;  // brick index (see GameLevel::BrickPositions)
+    float        Time;   // time of impact as a fraction [0, 1] of the movement
+    glm::vec2    Normal; // surface normal at the point of impact
+};
+
+// Maximum number of bounces resolved for a ball within a single step
+const unsigned int MAX_BALL_HITS = 16;
 
 
 /// GameLevel holds all Tiles as part of a Breakout level and 
 /// hosts functionality to Load/render levels from the harddisk.
+/// The tile layout doubles as a uniform grid for collision detection:
+/// every cell stores the index of the brick in it, so a ball only has
+/// to be tested against the bricks in the few cells it overlaps.
+/// Levels too large to hold at once can be streamed from a binary level:
+/// only the bricks of the rows around the view are created.
+/// Bricks are stored as arrays indexed by brick rather than as objects: all
+/// bricks are CellSize large, never move and look the same per tile code, so
+/// a brick is a position, a code and a bit in the destroyed set.
 class GameLevel
 {
 public:
-    // level state
-    std::vector<GameObject> Bricks;
+    // level state (the bricks of the loaded rows when streaming), one entry per brick
+    std::vector<glm::vec2>     BrickPositions;
+    std::vector<unsigned char> BrickCodes; // tile code: 1 is solid, 2 to 5 colored
+    // collision grid (one cell per tile); holds a brick index or -1 if the cell is empty or its brick was destroyed.
+    // Grid only covers the loaded rows, starting at row GridTop
+    unsigned int     GridWidth, GridHeight;
+    unsigned int     GridTop;
+    glm::vec2        CellSize;
+    std::vector<int> Grid;
     // constructor
-    GameLevel() { }
-    // loads level from file
+    GameLevel() : GridWidth(0), GridHeight(0), GridTop(0), CellSize(0.0f), remaining(0), chunkRows(0), firstChunk(0), lastChunk(0) { }
+    // loads level from file (a text level or a binary one)
     void Load(const char *file, unsigned int levelWidth, unsigned int levelHeight);
-    // render level
+    // maps a binary level without loading any rows yet: StreamRows loads the ones in view, rowsPerChunk at a time
+    bool LoadStreaming(const char *file, unsigned int levelWidth, unsigned int levelHeight, unsigned int rowsPerChunk = 32);
+    // loads the chunks of rows overlapping [top, bottom] (in level coordinates) and drops the others; brick indices
+    // change when it does. Returns the number of chunks that had to be loaded
+    unsigned int StreamRows(float top, float bottom);
+    bool IsStreaming() const;
+    // generates a random level of tilesX * tilesY tiles (used to stress test the game's systems)
+    // (optionally surrounded by a border of solid bricks)
+    void Generate(unsigned int tilesX, unsigned int tilesY, unsigned int levelWidth, unsigned int levelHeight, unsigned int seed = 0, bool solidBorder = false);
+    // render level (only the bricks that are left)
     void Draw(SpriteRenderer &renderer);
     // check if the level is completed (all non-solid tiles are destroyed)
-    bool IsCompleted();
+    bool IsCompleted() const;
+    // brick state
+    unsigned int BrickCount() const;
+    bool IsSolid(unsigned int index) const;
+    bool IsDestroyed(unsigned int index) const;
+    // non-solid bricks left (in the whole level when streaming)
+    unsigned int Remaining() const;
+    // marks a brick as destroyed and removes it from the collision grid
+    void DestroyBrick(unsigned int index);
+    // broadphase: collects the (live) bricks whose grid cells overlap the given rectangle, in ascending order
+    void QueryBricks(glm::vec2 min, glm::vec2 max, std::vector<unsigned int> &bricks) const;
+    // broadphase + narrow phase: collects the bricks overlapped by the given circle, in ascending order
+    void CollideCircle(glm::vec2 center, float radius, std::vector<unsigned int> &bricks);
+    // continuous collision: finds the first brick a circle moving by displacement runs into
+    bool SweepCircle(glm::vec2 center, float radius, glm::vec2 displacement, BrickHit &hit);
+    // moves the ball over dt, bouncing it off the bricks it sweeps into (in order of impact, so fast balls can't tunnel)
+    // and off the window's edges (except the bottom); non-solid bricks it hits are destroyed and all hit bricks are
+    // collected in hits
+    void MoveBall(BallObject &ball, float dt, unsigned int windowWidth, std::vector<unsigned int> &hits);
 private:
-    // initialize level from tile data
-    void init(std::vector<std::vector<unsigned int>> tileData, unsigned int levelWidth, unsigned int levelHeight);
+    // one bit per brick, set once it's destroyed; the bits past the last brick are set too, so
+    // the live bricks are the zero bits
+    std::vector<uint64_t> destroyed;
+    unsigned int          remaining;
+    // textures shared by all bricks
+    Texture2D solidTexture, blockTexture;
+    // scratch list of broadphase candidates
+    std::vector<unsigned int> candidates;
+    // streaming state: the mapped level, the loaded chunks [firstChunk, lastChunk) and the tiles destroyed so far
+    // (bricks are recreated when their rows come back)
+    std::shared_ptr<LevelFile> file;
+    unsigned int      chunkRows;
+    unsigned int      firstChunk, lastChunk;
+    std::vector<bool> destroyedTiles;
+    // clears all level data
+    void reset();
+    // initialize level from tile data (width * height tile codes, row by row)
+    void init(const unsigned char *tiles, unsigned int width, unsigned int height, unsigned int levelWidth, unsigned int levelHeight);
+    // clears the bricks (but not the grid or the streaming state)
+    void clearBricks();
+    // creates the bricks of rows [firstRow, lastRow) and makes the grid cover them
+    void loadRows(const unsigned char *tiles, unsigned int firstRow, unsigned int lastRow);
 };
 
 #endif
\ No newline at end of file
@@ -10,12 +10,13 @@
 
 
 GameObject::GameObject() 
-    : Position(0.0f, 0.0f), Size(1.0f, 1.0f), Velocity(0.0f), Color(1.0f), Rotation(0.0f), Sprite(), IsSolid(false), Destroyed(false) { }
+    : Position(0.0f, 0.0f), Size(1.0f, 1.0f), Velocity(0.0f), Color(1.0f), Rotation(0.0f), Sprite(), IsSolid(false), Destroyed(false), PreviousPosition(0.0f, 0.0f) { }
 
 GameObject::GameObject(glm::vec2 pos, glm::vec2 size, Texture2D sprite, glm::vec3 color, glm::vec2 velocity) 
-    : Position(pos), Size(size), Velocity(velocity), Color(color), Rotation(0.0f), Sprite(sprite), IsSolid(false), Destroyed(false) { }
+    : Position(pos), Size(size), Velocity(velocity), Color(color), Rotation(0.0f), Sprite(sprite), IsSolid(false), Destroyed(false), PreviousPosition(pos) { }
 
-void GameObject::Draw(SpriteRenderer &renderer)
+void GameObject::Draw(SpriteRenderer &renderer, float alpha)
 {
-    renderer.DrawSprite(this->Sprite, this->Position, this->Size, this->Rotation, this->Color);
+    glm::vec2 position = glm::mix(this->PreviousPosition, this->Position, alpha);
+    renderer.DrawSprite(this->Sprite, position, this->Size, this->Rotation, this->Color);
 }
\ No newline at end of file
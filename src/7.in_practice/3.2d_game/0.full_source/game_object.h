@@ -28,13 +28,15 @@ public:
     float       Rotation;
     bool        IsSolid;
     bool        Destroyed;
+    // position at the previous simulation tick, rendering interpolates from it
+    glm::vec2   PreviousPosition;
     // render state
     Texture2D   Sprite;	
     // constructor(s)
     GameObject();
     GameObject(glm::vec2 pos, glm::vec2 size, Texture2D sprite, glm::vec3 color = glm::vec3(1.0f), glm::vec2 velocity = glm::vec2(0.0f, 0.0f));
-    // draw sprite
-    virtual void Draw(SpriteRenderer &renderer);
+    // draw sprite; alpha (0 to 1) interpolates between the previous and the current position
+    virtual void Draw(SpriteRenderer &renderer, float alpha = 1.0f);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,198 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#include "level_file.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// bump when the layout changes
+const uint32_t LEVEL_FILE_VERSION = 1;
+
+
+LevelFile::LevelFile()
+    : data(nullptr), size(0)
+{
+
+}
+
+LevelFile::~LevelFile()
+{
+    this->Close();
+}
+
+bool LevelFile::Open(const char *file)
+{
+    this->Close();
+    // map the whole file read-only; the mapping outlives the file handle
+#ifdef _WIN32
+    HANDLE handle = CreateFileA(file, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (handle == INVALID_HANDLE_VALUE)
+        return false;
+    LARGE_INTEGER fileSize;
+    HANDLE mapping = NULL;
+    if (GetFileSizeEx(handle, &fileSize) && fileSize.QuadPart >= static_cast<LONGLONG>(sizeof(LevelHeader)))
+        mapping = CreateFileMappingA(handle, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(handle);
+    if (mapping == NULL)
+        return false;
+    this->data = static_cast<const unsigned char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    CloseHandle(mapping);
+    if (this->data == nullptr)
+        return false;
+    this->size = static_cast<size_t>(fileSize.QuadPart);
+#else
+    int handle = open(file, O_RDONLY);
+    if (handle < 0)
+        return false;
+    struct stat status;
+    void *mapped = MAP_FAILED;
+    if (fstat(handle, &status) == 0 && status.st_size >= static_cast<off_t>(sizeof(LevelHeader)))
+        mapped = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, handle, 0);
+    close(handle);
+    if (mapped == MAP_FAILED)
+        return false;
+    this->data = static_cast<const unsigned char*>(mapped);
+    this->size = static_cast<size_t>(status.st_size);
+#endif
+    // only the header is touched here, the tiles are paged in as they're used
+    const LevelHeader &header = this->Header();
+    if (std::memcmp(header.Magic, "BLVL", 4) != 0)
+    {
+        // not a binary level (probably a text one)
+        this->Close();
+        return false;
+    }
+    if (header.Version != LEVEL_FILE_VERSION || this->size < sizeof(LevelHeader) + static_cast<size_t>(header.Width) * header.Height)
+    {
+        std::cout << "ERROR::LEVEL: " << file << " is truncated or of an unsupported version" << std::endl;
+        this->Close();
+        return false;
+    }
+    return true;
+}
+
+void LevelFile::Close()
+{
+    if (this->data == nullptr)
+        return;
+#ifdef _WIN32
+    UnmapViewOfFile(this->data);
+#else
+    munmap(const_cast<unsigned char*>(this->data), this->size);
+#endif
+    this->data = nullptr;
+    this->size = 0;
+}
+
+bool LevelFile::IsOpen() const
+{
+    return this->data != nullptr;
+}
+
+const LevelHeader &LevelFile::Header() const
+{
+    return *reinterpret_cast<const LevelHeader*>(this->data);
+}
+
+const unsigned char *LevelFile::Tiles() const
+{
+    return this->data + sizeof(LevelHeader);
+}
+
+bool LevelFile::ReadText(const char *file, std::vector<unsigned char> &tiles, unsigned int &width, unsigned int &height)
+{
+    tiles.clear();
+    width = height = 0;
+    std::ifstream stream(file, std::ios::binary);
+    if (!stream)
+        return false;
+    // read it all at once and scan the digits directly (no stream extraction per tile)
+    std::vector<char> text((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+    text.push_back('\n');
+    unsigned int column = 0, code = 0;
+    bool inNumber = false;
+    for (char c : text)
+    {
+        if (c >= '0' && c <= '9')
+        {
+            code = std::min(code * 10 + (c - '0'), 255u);
+            inNumber = true;
+            continue;
+        }
+        if (inNumber)
+        {
+            // the first row sets the width; extra tiles on longer rows are dropped
+            if (height == 0 || column < width)
+                tiles.push_back(static_cast<unsigned char>(code));
+            column++;
+            code = 0;
+            inNumber = false;
+        }
+        if (c == '\n' && column > 0)
+        {
+            if (height == 0)
+                width = column;
+            else if (column < width)
+                tiles.resize(tiles.size() + (width - column), 0);
+            height++;
+            column = 0;
+        }
+    }
+    return height > 0;
+}
+
+bool LevelFile::Write(const char *file, const unsigned char *tiles, unsigned int width, unsigned int height)
+{
+    LevelHeader header;
+    std::memcpy(header.Magic, "BLVL", 4);
+    header.Version = LEVEL_FILE_VERSION;
+    header.Width = width;
+    header.Height = height;
+    header.Bricks = header.Destructible = 0;
+    size_t count = static_cast<size_t>(width) * height;
+    for (size_t i = 0; i < count; ++i)
+    {
+        header.Bricks += tiles[i] != 0;
+        header.Destructible += tiles[i] > 1;
+    }
+    std::ofstream stream(file, std::ios::binary);
+    stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    stream.write(reinterpret_cast<const char*>(tiles), count);
+    if (!stream)
+    {
+        std::cout << "ERROR::LEVEL: Failed to write " << file << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool LevelFile::Convert(const char *textFile, const char *binaryFile)
+{
+    std::vector<unsigned char> tiles;
+    unsigned int width, height;
+    if (!ReadText(textFile, tiles, width, height))
+    {
+        std::cout << "ERROR::LEVEL: Failed to read " << textFile << std::endl;
+        return false;
+    }
+    return Write(binaryFile, &tiles[0], width, height);
+}
\ No newline at end of file
@@ -0,0 +1,61 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#ifndef LEVEL_FILE_H
+#define LEVEL_FILE_H
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+// Header of a binary level (.blvl). It's followed by Width * Height tile
+// codes, one byte each, row by row from the top: 0 is empty, 1 a solid
+// brick and 2 to 5 colored bricks. Integers are stored little endian.
+struct LevelHeader {
+    char     Magic[4];     // "BLVL"
+    uint32_t Version;
+    uint32_t Width;        // in tiles
+    uint32_t Height;       // in tiles
+    uint32_t Bricks;       // non-empty tiles
+    uint32_t Destructible; // non-solid bricks
+};
+
+// LevelFile maps a binary level into memory. Opening a level costs the
+// same whatever its size: no tile is read until it's used, at which point
+// the OS pages in the rows around it, so a level can be far larger than
+// the part of it that's ever looked at. Also reads the text levels (.lvl:
+// lines of whitespace separated tile codes) and converts them.
+class LevelFile
+{
+public:
+    // constructor/destructor
+    LevelFile();
+    ~LevelFile();
+    // the mapping has a single owner
+    LevelFile(const LevelFile&) = delete;
+    LevelFile &operator=(const LevelFile&) = delete;
+    // maps a binary level; returns false if the file can't be opened or isn't a binary level
+    bool Open(const char *file);
+    // unmaps the level
+    void Close();
+    bool IsOpen() const;
+    const LevelHeader &Header() const;
+    // tile codes, row by row (Header().Width per row)
+    const unsigned char *Tiles() const;
+    // reads a text level; rows shorter than the first one are padded with empty tiles, empty lines are skipped
+    static bool ReadText(const char *file, std::vector<unsigned char> &tiles, unsigned int &width, unsigned int &height);
+    // writes tile codes as a binary level
+    static bool Write(const char *file, const unsigned char *tiles, unsigned int width, unsigned int height);
+    // converts a text level into a binary one
+    static bool Convert(const char *textFile, const char *binaryFile);
+private:
+    const unsigned char *data;
+    size_t               size;
+};
+
+#endif
\ No newline at end of file
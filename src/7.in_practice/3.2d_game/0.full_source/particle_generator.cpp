@@ -8,59 +8,129 @@
 ******************************************************************/
 #include "particle_generator.h"
 
-ParticleGenerator::ParticleGenerator(Shader shader, Texture2D texture, unsigned int amount)
-    : shader(shader), texture(texture), amount(amount)
+#include <algorithm>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define PARTICLES_SSE
+#endif
+
+// per-particle data streamed to the GPU each frame: <vec2 offset, vec4 color>
+const unsigned int PARTICLE_INSTANCE_FLOATS = 6;
+
+ParticleGenerator::ParticleGenerator(Shader shader, Texture2D texture, unsigned int amount, ParticleOverflow overflow, StreamBuffer *stream)
+    : amount(0), alive(0), overflow(overflow), windowSpawned(0), windowTime(0.0f), shader(shader), texture(texture),
+      stream(stream), ownsStream(stream == nullptr)
 {
+    if (this->ownsStream)
+        this->stream = new StreamBuffer();
+    this->amount = amount > 0 ? amount : 1;
     this->init();
 }
 
-void ParticleGenerator::Update(float dt, GameObject &object, unsigned int newParticles, glm::vec2 offset)
+ParticleGenerator::~ParticleGenerator()
+{
+    glDeleteVertexArrays(1, &this->VAO);
+    glDeleteBuffers(1, &this->quadVBO);
+    if (this->ownsStream)
+        delete this->stream;
+}
+
+unsigned int ParticleGenerator::Update(float dt, GameObject &object, unsigned int newParticles, glm::vec2 offset)
 {
-    // add new particles 
-    for (unsigned int i = 0; i < newParticles; ++i)
+    // make room for the new particles, or spawn only what fits
+    unsigned int spawn = newParticles;
+    if (this->alive + newParticles > this->amount)
     {
-        int unusedParticle = this->firstUnusedParticle();
-        this->respawnParticle(this->particles[unusedParticle], object, offset);
+        this->stats.Overflows++;
+        if (this->overflow == PARTICLES_GROW)
+        {
+            unsigned int capacity = this->amount;
+            while (capacity < this->alive + newParticles)
+                capacity *= 2;
+            this->reserve(capacity);
+            this->stats.Grows++;
+        }
+        else
+        {
+            spawn = this->amount - this->alive;
+            this->stats.Dropped += newParticles - spawn;
+        }
     }
+    // add new particles at the end of the alive range
+    for (unsigned int i = 0; i < spawn; ++i)
+        this->respawnParticle(this->alive++, object, offset);
+    this->stats.PeakAlive = std::max(this->stats.PeakAlive, this->alive);
     // update all particles
-    for (unsigned int i = 0; i < this->amount; ++i)
+    this->simulate(dt);
+    this->removeDead();
+
+    // update counters
+    this->stats.Spawned += spawn;
+    this->stats.Alive = this->alive;
+    this->windowSpawned += spawn;
+    this->windowTime += dt;
+    if (this->windowTime >= 1.0f)
     {
-        Particle &p = this->particles[i];
-        p.Life -= dt; // reduce life
-        if (p.Life > 0.0f)
-        {	// particle is alive, thus update
-            p.Position -= p.Velocity * dt; 
-            p.Color.a -= dt * 2.5f;
-        }
+        this->stats.EmissionRate = this->windowSpawned / this->windowTime;
+        this->windowSpawned = 0;
+        this->windowTime = 0.0f;
     }
+    return spawn;
 }
 
 // render all particles
 void ParticleGenerator::Draw()
 {
+    if (this->alive == 0)
+        return;
+    // write the alive particles straight into the stream buffer
+    const GLsizei stride = PARTICLE_INSTANCE_FLOATS * sizeof(float);
+    StreamAllocation allocation = this->stream->Allocate(this->alive * stride);
+    if (!allocation.Data)
+        return;
+    float *instances = static_cast<float*>(allocation.Data);
+    for (unsigned int i = 0; i < this->alive; ++i)
+    {
+        float *instance = instances + i * PARTICLE_INSTANCE_FLOATS;
+        instance[0] = this->positionX[i];
+        instance[1] = this->positionY[i];
+        instance[2] = this->colorR[i];
+        instance[3] = this->colorG[i];
+        instance[4] = this->colorB[i];
+        instance[5] = this->colorA[i];
+    }
+    this->stream->Commit();
+
     // use additive blending to give it a 'glow' effect
     glBlendFunc(GL_SRC_ALPHA, GL_ONE);
     this->shader.Use();
-    for (Particle particle : this->particles)
-    {
-        if (particle.Life > 0.0f)
-        {
-            this->shader.SetVector2f("offset", particle.Position);
-            this->shader.SetVector4f("color", particle.Color);
-            this->texture.Bind();
-            glBindVertexArray(this->VAO);
-            glDrawArrays(GL_TRIANGLES, 0, 6);
-            glBindVertexArray(0);
-        }
-    }
+    glActiveTexture(GL_TEXTURE0);
+    this->texture.Bind();
+    glBindVertexArray(this->VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, allocation.Buffer);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, (void*)allocation.Offset);
+    glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, stride, (void*)(allocation.Offset + 2 * sizeof(float)));
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glDrawArraysInstanced(GL_TRIANGLES, 0, 6, this->alive);
+    glBindVertexArray(0);
     // don't forget to reset to default blending mode
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 }
 
+unsigned int ParticleGenerator::AliveCount() const
+{
+    return this->alive;
+}
+
+const ParticleStats &ParticleGenerator::Stats() const
+{
+    return this->stats;
+}
+
 void ParticleGenerator::init()
 {
     // set up mesh and attribute properties
-    unsigned int VBO;
     float particle_quad[] = {
         0.0f, 1.0f, 0.0f, 1.0f,
         1.0f, 0.0f, 1.0f, 0.0f,
@@ -71,50 +141,95 @@ void ParticleGenerator::init()
         1.0f, 0.0f, 1.0f, 0.0f
     }; 
     glGenVertexArrays(1, &this->VAO);
-    glGenBuffers(1, &VBO);
+    glGenBuffers(1, &this->quadVBO);
     glBindVertexArray(this->VAO);
     // fill mesh buffer
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBindBuffer(GL_ARRAY_BUFFER, this->quadVBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(particle_quad), particle_quad, GL_STATIC_DRAW);
     // set mesh attributes
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
+    // instance attributes, pointed into the stream buffer by Draw each frame
+    glEnableVertexAttribArray(1);
+    glVertexAttribDivisor(1, 1);
+    glEnableVertexAttribArray(2);
+    glVertexAttribDivisor(2, 1);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindVertexArray(0);
 
-    // create this->amount default particle instances
-    for (unsigned int i = 0; i < this->amount; ++i)
-        this->particles.push_back(Particle());
+    this->reserve(this->amount);
 }
 
-// stores the index of the last particle used (for quick access to next dead particle)
-unsigned int lastUsedParticle = 0;
-unsigned int ParticleGenerator::firstUnusedParticle()
+void ParticleGenerator::reserve(unsigned int capacity)
 {
-    // first search from last used particle, this will usually return almost instantly
-    for (unsigned int i = lastUsedParticle; i < this->amount; ++i){
-        if (this->particles[i].Life <= 0.0f){
-            lastUsedParticle = i;
-            return i;
-        }
+    std::vector<float> *arrays[] = { &this->positionX, &this->positionY, &this->velocityX, &this->velocityY,
+                                     &this->colorR, &this->colorG, &this->colorB, &this->colorA, &this->life };
+    for (std::vector<float> *array : arrays)
+        array->resize(capacity, 0.0f);
+    this->amount = capacity;
+    this->stats.Capacity = capacity;
+}
+
+void ParticleGenerator::simulate(float dt)
+{
+    unsigned int i = 0;
+#ifdef PARTICLES_SSE
+    // 4 particles at a time
+    __m128 delta = _mm_set1_ps(dt);
+    __m128 fade = _mm_set1_ps(dt * 2.5f);
+    for (; i + 4 <= this->alive; i += 4)
+    {
+        _mm_storeu_ps(&this->life[i], _mm_sub_ps(_mm_loadu_ps(&this->life[i]), delta));
+        _mm_storeu_ps(&this->positionX[i], _mm_sub_ps(_mm_loadu_ps(&this->positionX[i]), _mm_mul_ps(_mm_loadu_ps(&this->velocityX[i]), delta)));
+        _mm_storeu_ps(&this->positionY[i], _mm_sub_ps(_mm_loadu_ps(&this->positionY[i]), _mm_mul_ps(_mm_loadu_ps(&this->velocityY[i]), delta)));
+        _mm_storeu_ps(&this->colorA[i], _mm_sub_ps(_mm_loadu_ps(&this->colorA[i]), fade));
     }
-    // otherwise, do a linear search
-    for (unsigned int i = 0; i < lastUsedParticle; ++i){
-        if (this->particles[i].Life <= 0.0f){
-            lastUsedParticle = i;
-            return i;
+#endif
+    // remaining particles (or all of them without SIMD support)
+    for (; i < this->alive; ++i)
+    {
+        this->life[i] -= dt; // reduce life
+        this->positionX[i] -= this->velocityX[i] * dt;
+        this->positionY[i] -= this->velocityY[i] * dt;
+        this->colorA[i] -= dt * 2.5f;
+    }
+}
+
+void ParticleGenerator::removeDead()
+{
+    unsigned int i = 0;
+    while (i < this->alive)
+    {
+        if (this->life[i] > 0.0f)
+        {
+            ++i;
+            continue;
         }
+        // move the last alive particle into this slot and check it next
+        unsigned int last = --this->alive;
+        this->positionX[i] = this->positionX[last];
+        this->positionY[i] = this->positionY[last];
+        this->velocityX[i] = this->velocityX[last];
+        this->velocityY[i] = this->velocityY[last];
+        this->colorR[i] = this->colorR[last];
+        this->colorG[i] = this->colorG[last];
+        this->colorB[i] = this->colorB[last];
+        this->colorA[i] = this->colorA[last];
+        this->life[i] = this->life[last];
     }
-    // all particles are taken, override the first one (note that if it repeatedly hits this case, more particles should be reserved)
-    lastUsedParticle = 0;
-    return 0;
 }
 
-void ParticleGenerator::respawnParticle(Particle &particle, GameObject &object, glm::vec2 offset)
+void ParticleGenerator::respawnParticle(unsigned int index, GameObject &object, glm::vec2 offset)
 {
     float random = ((rand() % 100) - 50) / 10.0f;
     float rColor = 0.5f + ((rand() % 100) / 100.0f);
-    particle.Position = object.Position + random + offset;
-    particle.Color = glm::vec4(rColor, rColor, rColor, 1.0f);
-    particle.Life = 1.0f;
-    particle.Velocity = object.Velocity * 0.1f;
+    this->positionX[index] = object.Position.x + random + offset.x;
+    this->positionY[index] = object.Position.y + random + offset.y;
+    this->colorR[index] = rColor;
+    this->colorG[index] = rColor;
+    this->colorB[index] = rColor;
+    this->colorA[index] = 1.0f;
+    this->life[index] = 1.0f;
+    this->velocityX[index] = object.Velocity.x * 0.1f;
+    this->velocityY[index] = object.Velocity.y * 0.1f;
 }
\ No newline at end of file
@@ -13,47 +13,90 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include <learnopengl/stream_buffer.h>
+
 #include "shader.h"
 #include "texture.h"
 #include "game_object.h"
 
 
-// Represents a single particle and its state
-struct Particle {
-    glm::vec2 Position, Velocity;
-    glm::vec4 Color;
-    float     Life;
-
-    Particle() : Position(0.0f), Velocity(0.0f), Color(1.0f), Life(0.0f) { }
+// Defines what a generator does when asked to spawn more particles than it has room for
+enum ParticleOverflow {
+    PARTICLES_DROP, // back-pressure: the extra particles aren't spawned (and are counted as dropped)
+    PARTICLES_GROW  // double the capacity of the pool
 };
 
+// Counters a generator keeps about its pool; totals are since construction
+struct ParticleStats {
+    unsigned long long Spawned;   // particles emitted
+    unsigned long long Dropped;   // particles that couldn't be spawned because the pool was full
+    unsigned int       Overflows; // Update calls that ran into a full pool
+    unsigned int       Grows;     // times the pool grew
+    unsigned int       Alive;     // currently alive particles
+    unsigned int       PeakAlive; // most particles alive at once
+    unsigned int       Capacity;  // current pool size
+    float              EmissionRate; // particles spawned per second, averaged over the last second
+
+    ParticleStats() : Spawned(0), Dropped(0), Overflows(0), Grows(0), Alive(0), PeakAlive(0), Capacity(0), EmissionRate(0.0f) { }
+};
 
 // ParticleGenerator acts as a container for rendering a large number of 
 // particles by repeatedly spawning and updating particles and killing 
 // them after a given amount of time.
+// Particles are stored as a structure of arrays so the update kernel can
+// process several particles per SIMD instruction. Alive particles are kept
+// densely packed at the front of the arrays: a dying particle is replaced by
+// the last alive one, so updating and drawing never touch dead particles and
+// all alive particles are rendered with a single instanced draw call.
+// The alive/dead partition doubles as the pool's allocator: spawning takes the
+// first dead slot and killing a particle swaps it out, both in constant time.
+// The per-particle instance data is written into a StreamBuffer each frame
+// (shared with the other renderers when one is passed in).
 class ParticleGenerator
 {
 public:
     // constructor
-    ParticleGenerator(Shader shader, Texture2D texture, unsigned int amount);
-    // update all particles
-    void Update(float dt, GameObject &object, unsigned int newParticles, glm::vec2 offset = glm::vec2(0.0f, 0.0f));
+    ParticleGenerator(Shader shader, Texture2D texture, unsigned int amount, ParticleOverflow overflow = PARTICLES_DROP, StreamBuffer *stream = nullptr);
+    // destructor
+    ~ParticleGenerator();
+    // spawns up to newParticles particles and updates all particles; returns the number of particles spawned
+    unsigned int Update(float dt, GameObject &object, unsigned int newParticles, glm::vec2 offset = glm::vec2(0.0f, 0.0f));
     // render all particles
     void Draw();
+    // number of particles currently alive
+    unsigned int AliveCount() const;
+    // pool counters (emission rate, occupancy, overflows)
+    const ParticleStats &Stats() const;
 private:
-    // state
-    std::vector<Particle> particles;
+    // state (structure of arrays; only the first this->alive entries are alive)
+    std::vector<float> positionX, positionY;
+    std::vector<float> velocityX, velocityY;
+    std::vector<float> colorR, colorG, colorB, colorA;
+    std::vector<float> life;
     unsigned int amount;
+    unsigned int alive;
+    ParticleOverflow overflow;
+    ParticleStats stats;
+    // spawns counted towards the current emission rate window
+    unsigned int windowSpawned;
+    float windowTime;
     // render state
     Shader shader;
     Texture2D texture;
     unsigned int VAO;
+    unsigned int quadVBO;
+    StreamBuffer *stream;
+    bool ownsStream;
     // initializes buffer and vertex attributes
     void init();
-    // returns the first Particle index that's currently unused e.g. Life <= 0.0f or 0 if no particle is currently inactive
-    unsigned int firstUnusedParticle();
-    // respawns particle
-    void respawnParticle(Particle &particle, GameObject &object, glm::vec2 offset = glm::vec2(0.0f, 0.0f));
+    // resizes the pool to the given capacity
+    void reserve(unsigned int capacity);
+    // advances all alive particles by dt
+    void simulate(float dt);
+    // swap-removes all particles whose life ran out
+    void removeDead();
+    // respawns the particle at the given index
+    void respawnParticle(unsigned int index, GameObject &object, glm::vec2 offset = glm::vec2(0.0f, 0.0f));
 };
 
 #endif
\ No newline at end of file
@@ -10,9 +10,16 @@
 
 #include <iostream>
 
-PostProcessor::PostProcessor(Shader shader, unsigned int width, unsigned int height) 
-    : PostProcessingShader(shader), Texture(), Width(width), Height(height), Confuse(false), Chaos(false), Shake(false)
+PostProcessor::PostProcessor(std::string shaderName, unsigned int width, unsigned int height, unsigned int samples) 
+    : Texture(), Width(width), Height(height), Samples(samples), Confuse(false), Chaos(false), Shake(false), FramesProcessed(0), FramesSkipped(0), frameEffects(EFFECT_NONE)
 {
+    // clamp the requested sample count to what the driver supports
+    int maxSamples;
+    glGetIntegerv(GL_MAX_SAMPLES, &maxSamples);
+    if (this->Samples > (unsigned int)maxSamples)
+        this->Samples = maxSamples;
+    if (this->Samples < 1)
+        this->Samples = 1;
     // initialize renderbuffer/framebuffer object
     glGenFramebuffers(1, &this->MSFBO);
     glGenFramebuffers(1, &this->FBO);
@@ -20,7 +27,7 @@ PostProcessor::PostProcessor(Shader shader, unsigned int width, unsigned int hei
     // initialize renderbuffer storage with a multisampled color buffer (don't need a depth/stencil buffer)
     glBindFramebuffer(GL_FRAMEBUFFER, this->MSFBO);
     glBindRenderbuffer(GL_RENDERBUFFER, this->RBO);
-    glRenderbufferStorageMultisample(GL_RENDERBUFFER, 4, GL_RGB, width, height); // allocate storage for render buffer object
+    glRenderbufferStorageMultisample(GL_RENDERBUFFER, this->Samples, GL_RGB, width, height); // allocate storage for render buffer object
     glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, this->RBO); // attach MS render buffer object to framebuffer
     if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
         std::cout << "ERROR::POSTPROCESSOR: Failed to initialize MSFBO" << std::endl;
@@ -31,44 +38,61 @@ PostProcessor::PostProcessor(Shader shader, unsigned int width, unsigned int hei
     if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
         std::cout << "ERROR::POSTPROCESSOR: Failed to initialize FBO" << std::endl;
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    // initialize render data and uniforms
+    // initialize render data and the shader variants; combinations that fuse into a smaller one share its variant
     this->initRenderData();
-    this->PostProcessingShader.SetInteger("scene", 0, true);
-    float offset = 1.0f / 300.0f;
-    float offsets[9][2] = {
-        { -offset,  offset  },  // top-left
-        {  0.0f,    offset  },  // top-center
-        {  offset,  offset  },  // top-right
-        { -offset,  0.0f    },  // center-left
-        {  0.0f,    0.0f    },  // center-center
-        {  offset,  0.0f    },  // center - right
-        { -offset, -offset  },  // bottom-left
-        {  0.0f,   -offset  },  // bottom-center
-        {  offset, -offset  }   // bottom-right    
-    };
-    glUniform2fv(glGetUniformLocation(this->PostProcessingShader.ID, "offsets"), 9, (float*)offsets);
-    int edge_kernel[9] = {
-        -1, -1, -1,
-        -1,  8, -1,
-        -1, -1, -1
-    };
-    glUniform1iv(glGetUniformLocation(this->PostProcessingShader.ID, "edge_kernel"), 9, edge_kernel);
-    float blur_kernel[9] = {
-        1.0f / 16.0f, 2.0f / 16.0f, 1.0f / 16.0f,
-        2.0f / 16.0f, 4.0f / 16.0f, 2.0f / 16.0f,
-        1.0f / 16.0f, 2.0f / 16.0f, 1.0f / 16.0f
-    };
-    glUniform1fv(glGetUniformLocation(this->PostProcessingShader.ID, "blur_kernel"), 9, blur_kernel);    
+    this->programs[EFFECT_NONE].ID = 0; // no pass
+    for (unsigned int effects = 1; effects < EFFECT_COMBINATIONS; ++effects)
+    {
+        if (Fuse(effects) != effects)
+        {
+            this->programs[effects] = this->programs[Fuse(effects)];
+            continue;
+        }
+        this->programs[effects] = ResourceManager::GetShader(variantName(shaderName, effects));
+        this->programs[effects].SetInteger("scene", 0, true);
+    }
+}
+
+std::vector<LoadHandle> PostProcessor::LoadShaders(const char *vShaderFile, const char *fShaderFile, std::string shaderName)
+{
+    std::vector<LoadHandle> loads;
+    for (unsigned int effects = 1; effects < EFFECT_COMBINATIONS; ++effects)
+        if (Fuse(effects) == effects)
+            loads.push_back(ResourceManager::LoadShaderAsync(vShaderFile, fShaderFile, nullptr, variantName(shaderName, effects), variantDefines(effects)));
+    return loads;
+}
+
+unsigned int PostProcessor::Fuse(unsigned int effects)
+{
+    if (effects & EFFECT_CHAOS)
+        effects &= ~EFFECT_CONFUSE;
+    return effects;
+}
+
+unsigned int PostProcessor::Effects() const
+{
+    return Fuse((this->Shake ? EFFECT_SHAKE : 0) | (this->Confuse ? EFFECT_CONFUSE : 0) | (this->Chaos ? EFFECT_CHAOS : 0));
 }
 
 void PostProcessor::BeginRender()
 {
+    // the effects can't change until the frame is done: the game is rendered offscreen for them or not at all
+    this->frameEffects = this->Effects();
+    if (this->frameEffects == EFFECT_NONE)
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        this->FramesSkipped++;
+        return;
+    }
     glBindFramebuffer(GL_FRAMEBUFFER, this->MSFBO);
     glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT);
+    this->FramesProcessed++;
 }
 void PostProcessor::EndRender()
 {
+    if (this->frameEffects == EFFECT_NONE)
+        return;
     // now resolve multisampled color-buffer into intermediate FBO to store to texture
     glBindFramebuffer(GL_READ_FRAMEBUFFER, this->MSFBO);
     glBindFramebuffer(GL_DRAW_FRAMEBUFFER, this->FBO);
@@ -78,12 +102,12 @@ void PostProcessor::EndRender()
 
 void PostProcessor::Render(float time)
 {
+    if (this->frameEffects == EFFECT_NONE)
+        return;
     // set uniforms/options
-    this->PostProcessingShader.Use();
-    this->PostProcessingShader.SetFloat("time", time);
-    this->PostProcessingShader.SetInteger("confuse", this->Confuse);
-    this->PostProcessingShader.SetInteger("chaos", this->Chaos);
-    this->PostProcessingShader.SetInteger("shake", this->Shake);
+    Shader &program = this->programs[this->frameEffects];
+    program.Use();
+    program.SetFloat("time", time);
     // render textured quad
     glActiveTexture(GL_TEXTURE0);
     this->Texture.Bind();	
@@ -92,6 +116,23 @@ void PostProcessor::Render(float time)
     glBindVertexArray(0);
 }
 
+std::string PostProcessor::variantDefines(unsigned int effects)
+{
+    std::string defines;
+    if (effects & EFFECT_SHAKE)
+        defines += "#define SHAKE\n";
+    if (effects & EFFECT_CONFUSE)
+        defines += "#define CONFUSE\n";
+    if (effects & EFFECT_CHAOS)
+        defines += "#define CHAOS\n";
+    return defines;
+}
+
+std::string PostProcessor::variantName(const std::string &shaderName, unsigned int effects)
+{
+    return shaderName + "_" + std::to_string(effects);
+}
+
 void PostProcessor::initRenderData()
 {
     // configure VAO/VBO
@@ -9,31 +9,58 @@
 #ifndef POST_PROCESSOR_H
 #define POST_PROCESSOR_H
 
+#include <string>
+#include <vector>
+
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
 #include "texture.h"
 #include "sprite_renderer.h"
 #include "shader.h"
+#include "resource_manager.h"
+
 
+// Postprocessing effects, combined as a bitmask
+enum PostEffect {
+    EFFECT_NONE    = 0,
+    EFFECT_SHAKE   = 1, // wobbles the screen and blurs it
+    EFFECT_CONFUSE = 2, // flips the screen and inverts its colors
+    EFFECT_CHAOS   = 4  // swirls the screen around and only shows its edges (replaces confuse)
+};
+// number of effect bitmasks
+const unsigned int EFFECT_COMBINATIONS = 8;
 
 // PostProcessor hosts all PostProcessing effects for the Breakout
 // Game. It renders the game on a textured quad after which one can
 // enable specific effects by enabling either the Confuse, Chaos or 
 // Shake boolean. 
+// Each combination of effects is a variant of the postprocessing
+// shader, compiled up front with a #define per effect, so whatever
+// is enabled is applied in a single pass without branching per
+// pixel. With no effect enabled there's no pass at all: the game
+// is rendered straight to the default framebuffer.
 // It is required to call BeginRender() before rendering the game
 // and EndRender() after rendering the game for the class to work.
 class PostProcessor
 {
 public:
     // state
-    Shader PostProcessingShader;
     Texture2D Texture;
     unsigned int Width, Height;
+    unsigned int Samples; // MSAA sample count of the offscreen color buffer (1 disables multisampling)
     // options
     bool Confuse, Chaos, Shake;
-    // constructor
-    PostProcessor(Shader shader, unsigned int width, unsigned int height);
+    // frames rendered with a postprocessing pass and without (straight to the default framebuffer)
+    unsigned int FramesProcessed, FramesSkipped;
+    // constructor; takes the shader variants queued by LoadShaders under the given name
+    PostProcessor(std::string shaderName, unsigned int width, unsigned int height, unsigned int samples = 4);
+    // queues the shader variant of each combination of effects for asynchronous loading
+    static std::vector<LoadHandle> LoadShaders(const char *vShaderFile, const char *fShaderFile, std::string shaderName);
+    // the effects that make a difference in a combination (chaos replaces confuse)
+    static unsigned int Fuse(unsigned int effects);
+    // the enabled effects (fused)
+    unsigned int Effects() const;
     // prepares the postprocessor's framebuffer operations before rendering the game
     void BeginRender();
     // should be called after rendering the game, so it stores all the rendered data into a texture object
@@ -45,6 +72,13 @@ private:
     unsigned int MSFBO, FBO; // MSFBO = Multisampled FBO. FBO is regular, used for blitting MS color-buffer to texture
     unsigned int RBO; // RBO is used for multisampled color buffer
     unsigned int VAO;
+    // shader variant per (fused) combination of effects
+    Shader programs[EFFECT_COMBINATIONS];
+    // the effects the frame was begun with
+    unsigned int frameEffects;
+    // the defines and name of a shader variant
+    static std::string variantDefines(unsigned int effects);
+    static std::string variantName(const std::string &shaderName, unsigned int effects);
     // initialize quad for rendering postprocessing texture
     void initRenderData();
 };
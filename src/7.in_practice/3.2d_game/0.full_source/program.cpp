@@ -9,24 +9,89 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
+#include <learnopengl/filesystem.h>
+#include <learnopengl/fixed_timestep.h>
+
 #include "game.h"
 #include "resource_manager.h"
+#include "sprite_renderer.h"
+#include "particle_generator.h"
+#include "ball_object.h"
+#include "text_renderer.h"
+#include "level_file.h"
+#include "audio_mixer.h"
+#include "post_processor.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <fstream>
 #include <iostream>
+#include <sstream>
 
 // GLFW function declerations
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mode);
+void benchmarkSprites(GLFWwindow* window, unsigned int count);
+void benchmarkText(GLFWwindow* window, unsigned int count);
+void benchmarkHud(GLFWwindow* window, unsigned int count);
+void benchmarkPostProcessing(GLFWwindow* window, unsigned int frames);
+void benchmarkParticles(unsigned int count);
+void benchmarkCollisions(unsigned int tiles, unsigned int balls);
+void testTunneling(float speed);
+void benchmarkSimulation(unsigned int ticks, const char *input);
+void testReplay(const char *input, unsigned int ticks, const char *log);
+void benchmarkLevels(unsigned int tiles);
+void benchmarkAudio(unsigned int voices, const char *outputFile);
 
 // The Width of the screen
 const unsigned int SCREEN_WIDTH = 800;
 // The height of the screen
 const unsigned int SCREEN_HEIGHT = 600;
+// Milliseconds per frame spent creating OpenGL objects for asynchronously loaded resources
+const double LOAD_BUDGET = 2.0;
 
 Game Breakout(SCREEN_WIDTH, SCREEN_HEIGHT);
+// input recorded with --record, for replaying with --replay-test
+std::ofstream Recording;
 
 int main(int argc, char *argv[])
 {
+    // the simulation benchmark and replay test run the game without window, GPU or audio:
+    // --simulation-benchmark [ticks] [input] or --replay-test <input or -> [ticks] [hash log]
+    // ---------------------------------------------------------------------------------------
+    if (argc > 1 && std::strcmp(argv[1], "--simulation-benchmark") == 0)
+    {
+        benchmarkSimulation(argc > 2 ? std::atoi(argv[2]) : 100000, argc > 3 ? argv[3] : nullptr);
+        return 0;
+    }
+    if (argc > 2 && std::strcmp(argv[1], "--replay-test") == 0)
+    {
+        testReplay(argv[2], argc > 3 ? std::atoi(argv[3]) : 10000, argc > 4 ? argv[4] : nullptr);
+        return 0;
+    }
+    // so does level conversion and loading: --convert-level <text level> <binary level> or --level-benchmark [tiles]
+    if (argc > 3 && std::strcmp(argv[1], "--convert-level") == 0)
+        return LevelFile::Convert(argv[2], argv[3]) ? 0 : 1;
+    if (argc > 1 && std::strcmp(argv[1], "--level-benchmark") == 0)
+    {
+        benchmarkLevels(argc > 2 ? std::atoi(argv[2]) : 1000);
+        return 0;
+    }
+    // and audio mixing: --audio-benchmark [voices] [output wav]
+    if (argc > 1 && std::strcmp(argv[1], "--audio-benchmark") == 0)
+    {
+        benchmarkAudio(argc > 2 ? std::atoi(argv[2]) : 32, argc > 3 ? argv[3] : nullptr);
+        return 0;
+    }
+
+    // other benchmarks (--sprite-benchmark, --text-benchmark, --hud-benchmark, --post-benchmark, --particle-benchmark, --collision-benchmark) and tests
+    // (--tunneling-test) run headless in a hidden window
+    bool benchmark = argc > 1 && std::strncmp(argv[1], "--", 2) == 0 && (std::strstr(argv[1], "-benchmark") != nullptr || std::strstr(argv[1], "-test") != nullptr);
+
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
@@ -35,6 +100,9 @@ int main(int argc, char *argv[])
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 #endif
     glfwWindowHint(GLFW_RESIZABLE, false);
+    glfwWindowHint(GLFW_SAMPLES, 4); // without postprocessing effects the game renders straight to the window
+    if (benchmark)
+        glfwWindowHint(GLFW_VISIBLE, false);
 
     GLFWwindow* window = glfwCreateWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "Breakout", nullptr, nullptr);
     glfwMakeContextCurrent(window);
@@ -56,40 +124,101 @@ int main(int argc, char *argv[])
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-    // initialize game
-    // ---------------
+    // initialize game (resources load in the background)
+    // ---------------------------------------------------
+    double initStart = glfwGetTime();
     Breakout.Init();
 
-    // deltaTime variables
-    // -------------------
-    float deltaTime = 0.0f;
-    float lastFrame = 0.0f;
+    // run with --sprite-benchmark [count], --text-benchmark [glyphs],
+    // --hud-benchmark [labels], --post-benchmark [frames], --particle-benchmark [count] or
+    // --collision-benchmark [tiles] [balls] to measure the sprite renderer, text renderer,
+    // postprocessing, particle system or collision detection instead of playing, or with
+    // --tunneling-test [speed] to check collisions of very fast balls
+    // ----------------------------------------------------------------------
+    if (benchmark)
+    {
+        ResourceManager::FinishLoads();
+        Breakout.FinishInit();
+        if (std::strcmp(argv[1], "--sprite-benchmark") == 0)
+            benchmarkSprites(window, argc > 2 ? std::atoi(argv[2]) : 10000);
+        else if (std::strcmp(argv[1], "--text-benchmark") == 0)
+            benchmarkText(window, argc > 2 ? std::atoi(argv[2]) : 20000);
+        else if (std::strcmp(argv[1], "--hud-benchmark") == 0)
+            benchmarkHud(window, argc > 2 ? std::atoi(argv[2]) : 500);
+        else if (std::strcmp(argv[1], "--post-benchmark") == 0)
+            benchmarkPostProcessing(window, argc > 2 ? std::atoi(argv[2]) : 200);
+        else if (std::strcmp(argv[1], "--particle-benchmark") == 0)
+            benchmarkParticles(argc > 2 ? std::atoi(argv[2]) : 1000000);
+        else if (std::strcmp(argv[1], "--collision-benchmark") == 0)
+            benchmarkCollisions(argc > 2 ? std::atoi(argv[2]) : 1000, argc > 3 ? std::atoi(argv[3]) : 64);
+        else if (std::strcmp(argv[1], "--tunneling-test") == 0)
+            testTunneling(argc > 2 ? static_cast<float>(std::atof(argv[2])) : 50000.0f);
+        else
+            std::cout << "unknown benchmark: " << argv[1] << std::endl;
+        ResourceManager::Clear();
+        glfwTerminate();
+        return 0;
+    }
+
+    // the simulation runs at a fixed tick rate (--tick-rate [hz] to change it),
+    // independent of the frame rate; rendering interpolates between ticks.
+    // --record [file] records the input for --replay-test
+    // -----------------------------------------------------------------------
+    FixedTimestep loop;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if (std::strcmp(argv[i], "--tick-rate") == 0)
+            loop.SetTickRate(std::atof(argv[i + 1]));
+        else if (std::strcmp(argv[i], "--record") == 0)
+            Recording.open(argv[i + 1]);
+    }
+    if (Recording.is_open())
+        Recording << "breakout-input " << loop.TickRate << '\n';
+    double lastFrame = glfwGetTime();
+    // startup: frames rendered while loading and the longest of them
+    bool loading = true;
+    unsigned int loadingFrames = 0;
+    double longestLoadingFrame = 0.0;
 
     while (!glfwWindowShouldClose(window))
     {
-        // calculate delta time
+        // calculate frame time
         // --------------------
-        float currentFrame = glfwGetTime();
-        deltaTime = currentFrame - lastFrame;
+        double currentFrame = glfwGetTime();
+        double frameTime = currentFrame - lastFrame;
         lastFrame = currentFrame;
         glfwPollEvents();
 
-        // manage user input
-        // -----------------
-        Breakout.ProcessInput(deltaTime);
+        // create the OpenGL objects of resources loaded in the background, within the frame's budget
+        // ------------------------------------------------------------------------------------------
+        if (loading)
+        {
+            loadingFrames++;
+            longestLoadingFrame = std::max(longestLoadingFrame, frameTime);
+            if (ResourceManager::Update(LOAD_BUDGET) == 0)
+            {
+                std::cout << "resources loaded in " << (glfwGetTime() - initStart) * 1000.0 << " ms, " << loadingFrames
+                          << " frames rendered meanwhile (longest " << longestLoadingFrame * 1000.0 << " ms)" << std::endl;
+                loading = false;
+            }
+        }
 
-        // update game state
-        // -----------------
-        Breakout.Update(deltaTime);
+        // manage user input and update game state, one fixed tick at a time
+        // ------------------------------------------------------------------
+        unsigned int ticks = loop.Advance(frameTime);
+        for (unsigned int i = 0; i < ticks; ++i)
+            Breakout.Step(static_cast<float>(loop.Step));
 
         // render
         // ------
         glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT);
-        Breakout.Render();
+        Breakout.Render(loop.Alpha());
 
         glfwSwapBuffers(window);
     }
+    if (loop.ClampedFrames > 0)
+        std::cout << "simulation fell behind in " << loop.ClampedFrames << " frames, " << loop.DroppedTime << " s dropped" << std::endl;
 
     // delete all resources as loaded using the resource manager
     // ---------------------------------------------------------
@@ -99,20 +228,771 @@ int main(int argc, char *argv[])
     return 0;
 }
 
+// renders count randomly placed sprites over the game's textures for a number of frames and
+// reports the average frame time, the number of draw calls the batching needed and how often
+// streaming the instance data had to wait for the GPU
+void benchmarkSprites(GLFWwindow* window, unsigned int count)
+{
+    const char *textures[] = { "block", "block_solid", "paddle", "face", "powerup_speed", "powerup_sticky" };
+    const unsigned int frames = 200;
+    Shader shader = ResourceManager::GetShader("sprite");
+    StreamBuffer stream;
+    SpriteRenderer renderer(shader, &stream);
+    std::vector<Texture2D> sprites;
+    std::vector<glm::vec4> placements;
+    srand(1337);
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        sprites.push_back(ResourceManager::GetTexture(textures[rand() % 6]));
+        placements.push_back(glm::vec4(rand() % SCREEN_WIDTH, rand() % SCREEN_HEIGHT, 8.0f + rand() % 24, rand() % 360));
+    }
+    glfwSwapInterval(0); // don't measure vsync
+    glFinish();
+    double start = glfwGetTime();
+    for (unsigned int frame = 0; frame < frames; ++frame)
+    {
+        glClear(GL_COLOR_BUFFER_BIT);
+        for (unsigned int i = 0; i < count; ++i)
+            renderer.DrawSprite(sprites[i], glm::vec2(placements[i]), glm::vec2(placements[i].z), placements[i].w);
+        renderer.Flush();
+        stream.EndFrame();
+        glfwSwapBuffers(window);
+    }
+    glFinish();
+    double elapsed = glfwGetTime() - start;
+    std::cout << "sprites: " << count << " | frame: " << elapsed * 1000.0 / frames << " ms"
+              << " | draw calls per frame: " << renderer.DrawCalls / frames
+              << " | " << renderer.SpritesDrawn / elapsed / 1000000.0 << " M sprites/s" << std::endl;
+    std::cout << "stream buffer: " << (stream.Persistent ? "persistent" : "orphaned") << ", " << stream.Regions << " x "
+              << stream.RegionSize / 1024 << " KB | " << stream.Allocated / frames / 1024 << " KB per frame | waits: " << stream.Waits
+              << " | grows: " << stream.Grows << std::endl;
+}
+
+// renders lines of text adding up to count glyphs for a number of frames and reports the
+// glyph throughput and the number of draw calls (one per atlas page)
+void benchmarkText(GLFWwindow* window, unsigned int count)
+{
+    const unsigned int frames = 200;
+    const std::string line = "Lives: 3 | Press W or S to select level 0123456789";
+    TextRenderer text(SCREEN_WIDTH, SCREEN_HEIGHT);
+    text.Load(FileSystem::getPath("resources/fonts/OCRAEXT.TTF"), 24);
+    unsigned int lines = std::max(count / static_cast<unsigned int>(line.size()), 1u);
+    glfwSwapInterval(0);
+    glFinish();
+    double start = glfwGetTime();
+    for (unsigned int frame = 0; frame < frames; ++frame)
+    {
+        glClear(GL_COLOR_BUFFER_BIT);
+        for (unsigned int i = 0; i < lines; ++i)
+            text.RenderText(line, static_cast<float>(i % 4) * 10.0f, static_cast<float>(i % 60) * 10.0f, 0.5f, glm::vec3(1.0f, 1.0f - (i % 8) / 8.0f, 0.5f));
+        text.Flush();
+        glfwSwapBuffers(window);
+    }
+    glFinish();
+    double elapsed = glfwGetTime() - start;
+    TextBatch &batch = text.Batch;
+    std::cout << "glyphs: " << batch.GlyphsDrawn / frames << " per frame | frame: " << elapsed * 1000.0 / frames << " ms | draw calls per frame: "
+              << batch.DrawCalls / frames << " | " << batch.GlyphsDrawn / elapsed / 1000000.0 << " M glyphs/s | atlas: " << text.Atlas.Pages.size()
+              << " page(s), " << text.Atlas.Occupancy() * 100.0f << "% used" << std::endl;
+}
+
+// renders a HUD of count labels of which one in ten changes every frame (a counter), three ways: laying out every
+// string every frame, with the layout cache, and as retained labels that only update their transforms and changed
+// text; reports the CPU time spent submitting the text, the frame time and the bytes uploaded per frame
+void benchmarkHud(GLFWwindow* window, unsigned int count)
+{
+    const unsigned int frames = 300;
+    const char *names[] = { "Health", "Ammo", "Shield", "Armor", "Speed", "Level", "Gold", "Keys" };
+    TextRenderer text(SCREEN_WIDTH, SCREEN_HEIGHT);
+    text.Load(FileSystem::getPath("resources/fonts/OCRAEXT.TTF"), 24);
+    std::vector<std::string> labels(count);
+    std::vector<glm::vec2> positions(count);
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        labels[i] = std::string(names[i % 8]) + " " + std::to_string(i);
+        positions[i] = glm::vec2(static_cast<float>(i % 5) * 160.0f, static_cast<float>(i / 5 % 50) * 12.0f);
+    }
+    // the dynamic labels show a counter after the name
+    auto current = [&](unsigned int i, unsigned int frame)
+    {
+        return i % 10 == 0 ? labels[i] + ": " + std::to_string(frame * 7 + i) : labels[i];
+    };
+    const AtlasGlyph *h = text.Atlas.Find('H');
+    float top = h != nullptr ? h->Bearing.y * 0.5f : 0.0f;
+    const char *modes[] = { "layout every frame", "layout cache", "retained labels" };
+    glfwSwapInterval(0);
+    for (unsigned int mode = 0; mode < 3; ++mode)
+    {
+        std::vector<unsigned int> handles;
+        if (mode == 2)
+            for (unsigned int i = 0; i < count; ++i)
+                handles.push_back(text.AddLabel(current(i, 0), positions[i].x, positions[i].y, 0.5f));
+        text.Batch.ResetStats();
+        text.Labels.ResetStats();
+        text.Layouts.Hits = text.Layouts.Misses = 0;
+        double submit = 0.0;
+        glFinish();
+        double start = glfwGetTime();
+        for (unsigned int frame = 0; frame < frames; ++frame)
+        {
+            glClear(GL_COLOR_BUFFER_BIT);
+            double submitStart = glfwGetTime();
+            for (unsigned int i = 0; i < count; ++i)
+            {
+                if (mode == 0)
+                    text.Batch.Add(text.Atlas, current(i, frame), positions[i].x, positions[i].y + top, 0.5f, glm::vec3(1.0f), true);
+                else if (mode == 1)
+                    text.RenderText(current(i, frame), positions[i].x, positions[i].y, 0.5f);
+                else if (i % 10 == 0)
+                    text.Labels.SetText(handles[i], current(i, frame));
+            }
+            text.Flush();
+            submit += glfwGetTime() - submitStart;
+            glfwSwapBuffers(window);
+        }
+        glFinish();
+        double elapsed = glfwGetTime() - start;
+        unsigned int drawCalls = text.Batch.DrawCalls + text.Labels.DrawCalls;
+        size_t uploaded = mode == 2 ? text.Labels.BytesUploaded : text.Batch.GlyphsDrawn * 6 * 7 * sizeof(float);
+        std::cout << modes[mode] << ": " << count << " labels | submit: " << submit * 1000.0 / frames << " ms | frame: "
+                  << elapsed * 1000.0 / frames << " ms | draw calls per frame: " << drawCalls / frames << " | uploaded per frame: "
+                  << uploaded / frames / 1024 << " KB";
+        if (mode == 1)
+            std::cout << " | layout cache: " << text.Layouts.Hits * 100 / std::max(text.Layouts.Hits + text.Layouts.Misses, 1ull) << "% hits";
+        if (mode == 2)
+            std::cout << " | glyphs laid out per frame: " << text.Labels.LaidOutGlyphs / frames;
+        std::cout << std::endl;
+        for (unsigned int handle : handles)
+            text.Labels.Remove(handle);
+    }
+}
+
+// renders the game (the menu over the first level) with each combination of postprocessing effects for a number of
+// frames and reports the GPU time per frame measured with timer queries; with no effect enabled there's no
+// postprocessing pass at all, so the difference to the others is what the pass costs
+void benchmarkPostProcessing(GLFWwindow* window, unsigned int frames)
+{
+    const unsigned int combinations[] = { EFFECT_NONE, EFFECT_SHAKE, EFFECT_CONFUSE, EFFECT_CONFUSE | EFFECT_SHAKE, EFFECT_CHAOS, EFFECT_CHAOS | EFFECT_SHAKE };
+    const char *names[] = { "none", "shake", "confuse", "confuse + shake", "chaos", "chaos + shake" };
+    const unsigned int warmup = 10;
+    frames = std::max(frames, 1u);
+    std::vector<unsigned int> queries(frames);
+    glGenQueries(frames, &queries[0]);
+    glfwSwapInterval(0);
+    for (unsigned int c = 0; c < sizeof(combinations) / sizeof(combinations[0]); ++c)
+    {
+        Breakout.Shake = (combinations[c] & EFFECT_SHAKE) != 0;
+        Breakout.Confuse = (combinations[c] & EFFECT_CONFUSE) != 0;
+        Breakout.Chaos = (combinations[c] & EFFECT_CHAOS) != 0;
+        for (unsigned int frame = 0; frame < warmup; ++frame)
+        {
+            glClear(GL_COLOR_BUFFER_BIT);
+            Breakout.Render(1.0f);
+            glfwSwapBuffers(window);
+        }
+        glFinish();
+        double start = glfwGetTime();
+        for (unsigned int frame = 0; frame < frames; ++frame)
+        {
+            glClear(GL_COLOR_BUFFER_BIT);
+            glBeginQuery(GL_TIME_ELAPSED, queries[frame]);
+            Breakout.Render(1.0f);
+            glEndQuery(GL_TIME_ELAPSED);
+            glfwSwapBuffers(window);
+        }
+        glFinish();
+        double elapsed = glfwGetTime() - start;
+        GLuint64 total = 0;
+        for (unsigned int frame = 0; frame < frames; ++frame)
+        {
+            GLuint64 time;
+            glGetQueryObjectui64v(queries[frame], GL_QUERY_RESULT, &time);
+            total += time;
+        }
+        std::cout << "effects: " << names[c] << " | GPU: " << total / 1e6 / frames << " ms per frame | frame: " << elapsed * 1000.0 / frames << " ms" << std::endl;
+    }
+    glDeleteQueries(frames, &queries[0]);
+    Breakout.Shake = Breakout.Confuse = Breakout.Chaos = false;
+}
+
+// fills a particle generator with count particles, then measures the (CPU) update and the
+// instanced draw separately
+void benchmarkParticles(unsigned int count)
+{
+    const unsigned int frames = 100;
+    const float dt = 0.001f; // small enough that no particle dies during the benchmark
+    ParticleGenerator particles(ResourceManager::GetShader("particle"), ResourceManager::GetTexture("particle"), count);
+    GameObject emitter(glm::vec2(SCREEN_WIDTH / 2.0f, SCREEN_HEIGHT / 2.0f), glm::vec2(10.0f), ResourceManager::GetTexture("particle"), glm::vec3(1.0f), glm::vec2(100.0f, -350.0f));
+    particles.Update(0.0f, emitter, count);
+    // the pool is full now: further emission is rejected (back-pressure) and counted
+    particles.Update(0.0f, emitter, count / 10);
+
+    double start = glfwGetTime();
+    for (unsigned int frame = 0; frame < frames; ++frame)
+        particles.Update(dt, emitter, 0);
+    double update = (glfwGetTime() - start) / frames;
+
+    glfwSwapInterval(0);
+    glFinish();
+    start = glfwGetTime();
+    for (unsigned int frame = 0; frame < frames; ++frame)
+    {
+        glClear(GL_COLOR_BUFFER_BIT);
+        particles.Draw();
+        glFinish();
+    }
+    double draw = (glfwGetTime() - start) / frames;
+
+    std::cout << "particles: " << particles.AliveCount() << " | update: " << update * 1000.0 << " ms (" << update * 1e9 / count << " ns/particle)"
+              << " | draw: " << draw * 1000.0 << " ms (1 draw call)" << std::endl;
+    const ParticleStats &stats = particles.Stats();
+    std::cout << "pool: " << stats.Alive << "/" << stats.Capacity << " alive (peak " << stats.PeakAlive << ") | spawned: " << stats.Spawned
+              << " | dropped: " << stats.Dropped << " in " << stats.Overflows << " overflows | grows: " << stats.Grows << std::endl;
+}
+
+// generates a level of tiles x tiles bricks with a number of balls flying through it. First
+// compares the grid broadphase against testing every brick, then plays a number of frames in
+// which the balls destroy the (non-solid) bricks they hit. Last, clears all but one brick and
+// compares drawing the level and checking completion against a GameObject per brick
+void benchmarkCollisions(unsigned int tiles, unsigned int balls)
+{
+    const float tileSize = 16.0f;
+    const unsigned int frames = 100;
+    const float dt = 1.0f / 60.0f;
+    unsigned int levelSize = static_cast<unsigned int>(tiles * tileSize);
+    GameLevel level;
+    double start = glfwGetTime();
+    level.Generate(tiles, tiles, levelSize, levelSize, 1337);
+    std::cout << "level: " << tiles << "x" << tiles << " tiles, " << level.BrickCount() << " bricks generated in "
+              << (glfwGetTime() - start) * 1000.0 << " ms" << std::endl;
+
+    Texture2D face = ResourceManager::GetTexture("face");
+    std::vector<BallObject> ballObjects;
+    srand(42);
+    for (unsigned int i = 0; i < balls; ++i)
+    {
+        glm::vec2 position(rand() % levelSize, rand() % levelSize);
+        glm::vec2 velocity((rand() % 600) - 300.0f, (rand() % 600) - 300.0f);
+        ballObjects.push_back(BallObject(position, BALL_RADIUS, velocity, face));
+    }
+
+    // every brick against every ball, as DoCollisions used to do
+    std::vector<unsigned int> hits;
+    unsigned int bruteHits = 0, gridHits = 0;
+    start = glfwGetTime();
+    for (BallObject &ball : ballObjects)
+    {
+        glm::vec2 center = ball.Position + ball.Radius;
+        for (unsigned int i = 0; i < level.BrickCount(); ++i)
+        {
+            if (level.IsDestroyed(i))
+                continue;
+            glm::vec2 difference = glm::clamp(center, level.BrickPositions[i], level.BrickPositions[i] + level.CellSize) - center;
+            if (glm::dot(difference, difference) < ball.Radius * ball.Radius)
+                ++bruteHits;
+        }
+    }
+    double brute = glfwGetTime() - start;
+    start = glfwGetTime();
+    for (BallObject &ball : ballObjects)
+    {
+        level.CollideCircle(ball.Position + ball.Radius, ball.Radius, hits);
+        gridHits += static_cast<unsigned int>(hits.size());
+    }
+    double grid = glfwGetTime() - start;
+    std::cout << "all bricks: " << brute * 1000.0 << " ms (" << bruteHits << " hits) | grid: " << grid * 1000.0 << " ms ("
+              << gridHits << " hits) for " << balls << " balls" << std::endl;
+
+    // play it out: bounce the balls off the level's edges and whatever they hit
+    unsigned int destroyed = 0;
+    start = glfwGetTime();
+    for (unsigned int frame = 0; frame < frames; ++frame)
+    {
+        for (BallObject &ball : ballObjects)
+        {
+            ball.Position += ball.Velocity * dt;
+            if (ball.Position.x < 0.0f || ball.Position.x + 2.0f * ball.Radius > levelSize)
+                ball.Velocity.x = -ball.Velocity.x;
+            if (ball.Position.y < 0.0f || ball.Position.y + 2.0f * ball.Radius > levelSize)
+                ball.Velocity.y = -ball.Velocity.y;
+            level.CollideCircle(ball.Position + ball.Radius, ball.Radius, hits);
+            for (unsigned int index : hits)
+            {
+                if (!level.IsSolid(index))
+                {
+                    level.DestroyBrick(index);
+                    ++destroyed;
+                }
+            }
+            if (!hits.empty())
+                ball.Velocity = -ball.Velocity;
+        }
+    }
+    double played = (glfwGetTime() - start) / frames;
+    std::cout << "simulation: " << played * 1000.0 << " ms per frame, " << destroyed << " bricks destroyed in " << frames << " frames" << std::endl;
+
+    // the end of the level: every non-solid brick but the last one destroyed
+    unsigned int last = level.BrickCount();
+    while (last > 0 && level.IsSolid(last - 1))
+        --last;
+    for (unsigned int i = 0; i + 1 < last; ++i)
+        if (!level.IsSolid(i))
+            level.DestroyBrick(i);
+    // the same state as a GameObject per brick, the way the level used to keep it
+    Texture2D block = ResourceManager::GetTexture("block");
+    std::vector<GameObject> objects;
+    objects.reserve(level.BrickCount());
+    for (unsigned int i = 0; i < level.BrickCount(); ++i)
+    {
+        GameObject brick(level.BrickPositions[i], level.CellSize, block);
+        brick.IsSolid = level.IsSolid(i);
+        brick.Destroyed = level.IsDestroyed(i);
+        objects.push_back(brick);
+    }
+    Shader shader = ResourceManager::GetShader("sprite");
+    SpriteRenderer renderer(shader);
+    const unsigned int repeats = 20;
+    double drawObjects = 0.0, drawLevel = 0.0, scanObjects = 0.0, checkLevel = 0.0;
+    unsigned int incomplete = 0;
+    for (unsigned int repeat = 0; repeat < repeats; ++repeat)
+    {
+        glFinish();
+        start = glfwGetTime();
+        for (GameObject &brick : objects)
+            if (!brick.Destroyed)
+                brick.Draw(renderer);
+        renderer.Flush();
+        glFinish();
+        drawObjects += glfwGetTime() - start;
+        start = glfwGetTime();
+        level.Draw(renderer);
+        renderer.Flush();
+        glFinish();
+        drawLevel += glfwGetTime() - start;
+        // completion as it used to be checked: until the first non-solid brick that's left
+        start = glfwGetTime();
+        bool completed = true;
+        for (GameObject &brick : objects)
+        {
+            if (!brick.IsSolid && !brick.Destroyed)
+            {
+                completed = false;
+                break;
+            }
+        }
+        scanObjects += glfwGetTime() - start;
+        start = glfwGetTime();
+        incomplete += !level.IsCompleted();
+        incomplete += !completed;
+        checkLevel += glfwGetTime() - start;
+    }
+    size_t count = level.BrickCount();
+    std::cout << "level end: " << level.Remaining() << " bricks to go | draw: objects " << drawObjects * 1000.0 / repeats << " ms, arrays "
+              << drawLevel * 1000.0 / repeats << " ms | completion check: objects " << scanObjects * 1e6 / repeats << " us, count "
+              << checkLevel * 1e6 / repeats << " us (" << incomplete << "/" << 2 * repeats << " incomplete)" << std::endl;
+    std::cout << "brick state: objects " << count * sizeof(GameObject) / 1024 << " KB | arrays "
+              << (count * (sizeof(glm::vec2) + 1) + (count + 63) / 64 * 8) / 1024 << " KB" << std::endl;
+}
+
+// shoots balls at the given speed (pixels per second) around a level enclosed by solid bricks,
+// once moving them discretely (move, then test for overlap) and once with the swept collision
+// detection the game uses. Tunneling shows up as balls escaping the enclosure or ending a step
+// inside a brick; the swept version should report neither
+void testTunneling(float speed)
+{
+    const unsigned int tiles = 25, balls = 64, steps = 600;
+    const float dt = 1.0f / 30.0f;
+    const float tileSize = static_cast<float>(SCREEN_WIDTH) / tiles;
+    Texture2D face = ResourceManager::GetTexture("face");
+    for (int swept = 0; swept < 2; ++swept)
+    {
+        GameLevel level;
+        level.Generate(tiles, tiles, SCREEN_WIDTH, SCREEN_WIDTH, 7, true);
+        // start the balls in empty cells (inside the border) in random directions
+        std::vector<BallObject> ballObjects;
+        srand(42);
+        while (ballObjects.size() < balls)
+        {
+            unsigned int x = 1 + rand() % (tiles - 2), y = 1 + rand() % (tiles - 2);
+            if (level.Grid[y * tiles + x] >= 0)
+                continue;
+            float angle = (rand() % 3600) / 1800.0f * 3.14159265f;
+            glm::vec2 position = (glm::vec2(x, y) + 0.5f) * tileSize - BALL_RADIUS;
+            BallObject ball(position, BALL_RADIUS, speed * glm::vec2(std::cos(angle), std::sin(angle)), face);
+            ball.Stuck = false;
+            ballObjects.push_back(ball);
+        }
+        unsigned int escaped = 0, inside = 0, hitCount = 0;
+        std::vector<unsigned int> hits;
+        double start = glfwGetTime();
+        for (BallObject &ball : ballObjects)
+        {
+            for (unsigned int step = 0; step < steps; ++step)
+            {
+                if (swept)
+                    level.MoveBall(ball, dt, SCREEN_WIDTH, hits);
+                else
+                {
+                    ball.Position += ball.Velocity * dt;
+                    level.CollideCircle(ball.Position + ball.Radius, ball.Radius, hits);
+                    for (unsigned int index : hits)
+                        if (!level.IsSolid(index))
+                            level.DestroyBrick(index);
+                    if (!hits.empty())
+                        ball.Velocity = -ball.Velocity;
+                }
+                hitCount += static_cast<unsigned int>(hits.size());
+                // out of the enclosure: went through the border
+                glm::vec2 center = ball.Position + ball.Radius;
+                if (center.x < tileSize || center.y < tileSize || center.x > SCREEN_WIDTH - tileSize || center.y > SCREEN_WIDTH - tileSize)
+                {
+                    ++escaped;
+                    break;
+                }
+                // ended the step overlapping a brick by more than a pixel
+                level.CollideCircle(center, ball.Radius - 1.0f, hits);
+                if (!hits.empty())
+                    ++inside;
+            }
+        }
+        double elapsed = glfwGetTime() - start;
+        std::cout << (swept ? "swept:    " : "discrete: ") << balls << " balls at " << speed << " px/s | escaped: " << escaped
+                  << " | steps ending inside a brick: " << inside << " | hits: " << hitCount
+                  << " | " << elapsed * 1e6 / (balls * steps) << " us per ball step" << std::endl;
+    }
+}
+
+// a key press or release, applied before simulating the given tick
+struct InputEvent
+{
+    unsigned int Tick;
+    int          Key;
+    bool         Pressed;
+};
+
+// reads input recorded with --record: a header with the tick rate, then one "tick key pressed" line per event
+bool loadInput(const char *file, double &tickRate, std::vector<InputEvent> &events)
+{
+    std::ifstream stream(file);
+    std::string header;
+    if (!(stream >> header >> tickRate) || header != "breakout-input")
+    {
+        std::cout << "ERROR::REPLAY: Failed to read input recording: " << file << std::endl;
+        return false;
+    }
+    InputEvent event;
+    int pressed;
+    while (stream >> event.Tick >> event.Key >> pressed)
+    {
+        event.Pressed = pressed != 0;
+        events.push_back(event);
+    }
+    return true;
+}
+
+// scripted input for when there's no recording: start (again) from the menu, launch the ball and
+// sweep the paddle left and right
+void generateInput(unsigned int ticks, std::vector<InputEvent> &events)
+{
+    InputEvent space = { 0, GLFW_KEY_SPACE, true };
+    events.push_back(space);
+    for (unsigned int tick = 0; tick < ticks; tick += 60)
+    {
+        InputEvent enter = { tick, GLFW_KEY_ENTER, (tick / 60) % 2 == 0 };
+        events.push_back(enter);
+    }
+    for (unsigned int tick = 0; tick < ticks; tick += 45)
+    {
+        bool left = (tick / 45) % 2 == 0;
+        InputEvent release = { tick, left ? GLFW_KEY_D : GLFW_KEY_A, false };
+        InputEvent press = { tick, left ? GLFW_KEY_A : GLFW_KEY_D, true };
+        events.push_back(release);
+        events.push_back(press);
+    }
+    std::stable_sort(events.begin(), events.end(), [](const InputEvent &a, const InputEvent &b) { return a.Tick < b.Tick; });
+}
+
+// runs a fresh headless game for the given number of ticks, feeding it the input events; optionally
+// keeps the state hash after every tick. Returns the elapsed (wall clock) time in seconds
+double simulate(const std::vector<InputEvent> &events, unsigned int ticks, double tickRate, std::vector<unsigned long long> *hashes)
+{
+    Game game(SCREEN_WIDTH, SCREEN_HEIGHT);
+    game.Init(true);
+    FixedTimestep loop(tickRate);
+    float dt = static_cast<float>(loop.Step);
+    size_t next = 0;
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+    for (unsigned int tick = 0; tick < ticks; ++tick)
+    {
+        for (; next < events.size() && events[next].Tick <= tick; ++next)
+            game.SetKey(events[next].Key, events[next].Pressed);
+        game.Step(dt);
+        if (hashes)
+            hashes->push_back(game.StateHash());
+    }
+    return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+// plays the game without a window, GPU or audio device, one fixed tick after the other as fast as
+// the simulation allows, and reports the throughput
+void benchmarkSimulation(unsigned int ticks, const char *input)
+{
+    if (ticks == 0)
+    {
+        std::cout << "ERROR::SIMULATION: Nothing to benchmark, the number of ticks has to be at least 1" << std::endl;
+        return;
+    }
+    double tickRate = TICK_RATE;
+    std::vector<InputEvent> events;
+    if (input != nullptr)
+    {
+        if (!loadInput(input, tickRate, events))
+            return;
+    }
+    else
+        generateInput(ticks, events);
+    std::vector<unsigned long long> hashes;
+    simulate(events, ticks / 10, tickRate, nullptr); // warm up
+    double elapsed = simulate(events, ticks, tickRate, nullptr);
+    simulate(events, ticks, tickRate, &hashes);
+    std::cout << "simulation: " << ticks << " ticks at " << tickRate << " Hz (" << ticks / tickRate << " s of game time) in "
+              << elapsed * 1000.0 << " ms | " << ticks / elapsed << " ticks/s | " << elapsed * 1e6 / ticks << " us per tick | "
+              << ticks / tickRate / elapsed << "x real time | final state hash: " << std::hex << hashes.back() << std::dec << std::endl;
+}
+
+// replays recorded (or scripted) input twice and compares the state hashes of every tick; any
+// difference means the simulation isn't deterministic. The hashes can be written to a log (one
+// "tick hash" line per tick) to compare against other builds or platforms
+void testReplay(const char *input, unsigned int ticks, const char *log)
+{
+    if (ticks == 0)
+    {
+        std::cout << "ERROR::REPLAY: Nothing to replay, the number of ticks has to be at least 1" << std::endl;
+        return;
+    }
+    double tickRate = TICK_RATE;
+    std::vector<InputEvent> events;
+    if (std::strcmp(input, "-") != 0)
+    {
+        if (!loadInput(input, tickRate, events))
+            return;
+    }
+    else
+        generateInput(ticks, events);
+    std::vector<unsigned long long> first, second;
+    double elapsed = simulate(events, ticks, tickRate, &first);
+    elapsed += simulate(events, ticks, tickRate, &second);
+    unsigned int mismatch = ticks;
+    for (unsigned int tick = 0; tick < ticks && mismatch == ticks; ++tick)
+        if (first[tick] != second[tick])
+            mismatch = tick;
+    if (log != nullptr)
+    {
+        std::ofstream stream(log);
+        for (unsigned int tick = 0; tick < ticks; ++tick)
+            stream << std::dec << tick << ' ' << std::hex << first[tick] << '\n';
+    }
+    std::cout << "replay: " << events.size() << " input events over " << ticks << " ticks | " << 2 * ticks / elapsed << " ticks/s | ";
+    if (mismatch == ticks)
+        std::cout << "deterministic, final state hash: " << std::hex << first.back() << std::dec << std::endl;
+    else
+        std::cout << "DIVERGED at tick " << mismatch << std::endl;
+}
+
+// writes a random level of tiles x tiles as a text level and as a binary one, then times loading them: parsing the
+// text the way levels used to be read (a line at a time through a string stream), Load on either file, and streaming
+// the binary one a screen at a time while scrolling from the top to the bottom of the level
+void benchmarkLevels(unsigned int tiles)
+{
+    typedef std::chrono::high_resolution_clock Clock;
+    const float tileSize = 16.0f;
+    const char *textFile = "level_benchmark.lvl", *binaryFile = "level_benchmark.blvl";
+    if (tiles == 0)
+        return;
+    unsigned int levelSize = static_cast<unsigned int>(tiles * tileSize);
+    auto milliseconds = [](Clock::time_point start) { return std::chrono::duration<double, std::milli>(Clock::now() - start).count(); };
+
+    // the same mix of tiles as GameLevel::Generate
+    std::vector<unsigned char> codes(static_cast<size_t>(tiles) * tiles);
+    srand(1337);
+    for (unsigned char &tile : codes)
+    {
+        unsigned int r = rand() % 10;
+        tile = r < 3 ? 0 : r == 3 ? 1 : 2 + rand() % 4;
+    }
+    {
+        std::ofstream text(textFile);
+        std::string row;
+        for (unsigned int y = 0; y < tiles; ++y)
+        {
+            row.clear();
+            for (unsigned int x = 0; x < tiles; ++x)
+            {
+                row += static_cast<char>('0' + codes[static_cast<size_t>(y) * tiles + x]);
+                row += ' ';
+            }
+            text << row << '\n';
+        }
+    }
+    Clock::time_point start = Clock::now();
+    LevelFile::Convert(textFile, binaryFile);
+    double convert = milliseconds(start);
+    std::cout << "level: " << tiles << "x" << tiles << " tiles | converted in " << convert << " ms" << std::endl;
+
+    // parsing only: string streams against scanning the file
+    start = Clock::now();
+    {
+        std::ifstream stream(textFile);
+        std::string line;
+        std::vector<std::vector<unsigned int>> tileData;
+        while (std::getline(stream, line))
+        {
+            std::istringstream sstream(line);
+            std::vector<unsigned int> row;
+            unsigned int tileCode;
+            while (sstream >> tileCode)
+                row.push_back(tileCode);
+            tileData.push_back(row);
+        }
+    }
+    double streams = milliseconds(start);
+    std::vector<unsigned char> parsed;
+    unsigned int width, height;
+    start = Clock::now();
+    LevelFile::ReadText(textFile, parsed, width, height);
+    double scan = milliseconds(start);
+    std::cout << "parse text: string streams " << streams << " ms | scanning " << scan << " ms" << (parsed == codes ? "" : " (MISMATCH)") << std::endl;
+
+    // full loads, every brick created
+    GameLevel level;
+    start = Clock::now();
+    level.Load(textFile, levelSize, levelSize);
+    double text = milliseconds(start);
+    start = Clock::now();
+    level.Load(binaryFile, levelSize, levelSize);
+    double binary = milliseconds(start);
+    std::cout << "load all " << level.BrickCount() << " bricks: text " << text << " ms | binary (mapped) " << binary << " ms" << std::endl;
+
+    // streaming: only the rows of a screen (and the rest of their chunks)
+    start = Clock::now();
+    level.LoadStreaming(binaryFile, levelSize, levelSize);
+    level.StreamRows(0.0f, static_cast<float>(SCREEN_HEIGHT));
+    double first = milliseconds(start);
+    std::cout << "stream: first screen in " << first << " ms (" << level.BrickCount() << " bricks loaded)";
+    // scroll down a tile per frame
+    unsigned int frames = 0, chunks = 0;
+    double total = 0.0, longest = 0.0;
+    for (float top = tileSize; top + SCREEN_HEIGHT <= levelSize; top += tileSize, ++frames)
+    {
+        start = Clock::now();
+        chunks += level.StreamRows(top, top + SCREEN_HEIGHT);
+        double elapsed = milliseconds(start);
+        total += elapsed;
+        longest = std::max(longest, elapsed);
+    }
+    std::cout << " | scrolling: " << chunks << " chunks loaded over " << frames << " frames, " << (frames > 0 ? total / frames : 0.0)
+              << " ms per frame (longest " << longest << " ms)" << std::endl;
+    std::remove(textFile);
+    std::remove(binaryFile);
+}
+
+// mixes a number of looping voices for ten seconds of audio, on this thread and as fast as it goes,
+// and reports the cost per voice against the same mix without SSE; the mix is written to
+// outputFile if given. Then plays them on the mixer thread for a second, paced like a device
+void benchmarkAudio(unsigned int voices, const char *outputFile)
+{
+    typedef std::chrono::high_resolution_clock Clock;
+    const char *files[] = { "resources/audio/bleep.wav", "resources/audio/solid.wav", "resources/audio/powerup.wav" };
+    voices = std::max(std::min(voices, MAX_VOICES), 1u);
+    AudioMixer mixer(new NullAudioOutput(false));
+    unsigned int sounds[3];
+    for (unsigned int i = 0; i < 3; ++i)
+        sounds[i] = mixer.LoadSound(FileSystem::getPath(files[i]).c_str());
+    for (unsigned int i = 0; i < voices; ++i)
+        mixer.Play(sounds[i % 3], 1.0f / voices, true);
+    WavFileAudioOutput file(outputFile ? outputFile : "");
+    if (outputFile && !file.Open(mixer.SampleRate, mixer.BlockFrames))
+        std::cout << "ERROR::AUDIO: Failed to create " << outputFile << std::endl;
+    const unsigned int blocks = 10 * mixer.SampleRate / mixer.BlockFrames;
+    std::vector<float> block(mixer.BlockFrames * 2);
+    double mixing = 0.0;
+    for (unsigned int i = 0; i < blocks; ++i)
+    {
+        Clock::time_point start = Clock::now();
+        mixer.Mix(&block[0], mixer.BlockFrames);
+        mixing += std::chrono::duration<double>(Clock::now() - start).count();
+        if (outputFile)
+            file.Write(&block[0], mixer.BlockFrames);
+    }
+    file.Close();
+
+    // the same voices with a plain loop: wrapped a piece at a time like Mix, only the mixing isn't SSE
+    std::vector<std::vector<float>> pcm(3);
+    for (unsigned int i = 0; i < 3; ++i)
+    {
+        WavDecoder decoder;
+        if (decoder.Open(FileSystem::getPath(files[i]).c_str()))
+        {
+            pcm[i].resize(decoder.Frames * 2);
+            pcm[i].resize(decoder.Read(&pcm[i][0], decoder.Frames) * 2);
+        }
+        if (pcm[i].empty())
+            pcm[i].assign(2, 0.0f);
+    }
+    std::vector<size_t> positions(voices, 0);
+    Clock::time_point start = Clock::now();
+    for (unsigned int i = 0; i < blocks; ++i)
+    {
+        std::fill(block.begin(), block.end(), 0.0f);
+        for (unsigned int v = 0; v < voices; ++v)
+        {
+            const std::vector<float> &samples = pcm[v % 3];
+            size_t done = 0;
+            while (done < block.size())
+            {
+                size_t count = std::min(block.size() - done, samples.size() - positions[v]);
+                for (size_t k = 0; k < count; ++k)
+                    block[done + k] += samples[positions[v] + k] * (1.0f / voices);
+                done += count;
+                positions[v] += count;
+                if (positions[v] == samples.size())
+                    positions[v] = 0;
+            }
+        }
+    }
+    double reference = std::chrono::duration<double>(Clock::now() - start).count();
+    double budget = static_cast<double>(mixer.BlockFrames) / mixer.SampleRate;
+    double voiceFrames = static_cast<double>(blocks) * mixer.BlockFrames * voices;
+    std::cout << "audio: " << voices << " voices, " << blocks << " blocks of " << mixer.BlockFrames << " frames at " << mixer.SampleRate << " Hz ("
+              << budget * 1000.0 << " ms each)" << std::endl;
+    std::cout << "mixer: " << mixing * 1e6 / blocks << " us per block (" << mixing / blocks / budget * 100.0 << "% of a block), "
+              << mixing * 1e9 / voiceFrames << " ns per voice frame | without SSE: " << reference * 1e6 / blocks << " us per block, "
+              << reference * 1e9 / voiceFrames << " ns per voice frame" << std::endl;
+
+    // on the mixer thread, against the clock
+    AudioMixer live(new NullAudioOutput());
+    unsigned int sound = live.LoadSound(FileSystem::getPath(files[2]).c_str());
+    live.Start();
+    for (unsigned int i = 0; i < voices; ++i)
+        live.Play(sound, 1.0f / voices, true);
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+    live.Shutdown();
+    MixerStats stats = live.Stats();
+    std::cout << "mixer thread: " << stats.Blocks << " blocks in 1 s (" << live.SampleRate / live.BlockFrames << " expected), busy "
+              << stats.MixSeconds * 100.0 << "% | peak voices: " << stats.PeakVoices << " | dropped: " << stats.DroppedCommands + stats.DroppedVoices << std::endl;
+}
+
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mode)
 {
     // when a user presses the escape key, we set the WindowShouldClose property to true, closing the application
     if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
-    if (key >= 0 && key < 1024)
+    if (key >= 0 && key < 1024 && (action == GLFW_PRESS || action == GLFW_RELEASE))
     {
-        if (action == GLFW_PRESS)
-            Breakout.Keys[key] = true;
-        else if (action == GLFW_RELEASE)
-        {
-            Breakout.Keys[key] = false;
-            Breakout.KeysProcessed[key] = false;
-        }
+        Breakout.SetKey(key, action == GLFW_PRESS);
+        // applies before the next tick is simulated
+        if (Recording.is_open())
+            Recording << Breakout.Ticks << ' ' << key << ' ' << (action == GLFW_PRESS) << '\n';
     }
 }
 
@@ -8,7 +8,10 @@
 ******************************************************************/
 #include "resource_manager.h"
 
+#include <algorithm>
+#include <chrono>
 #include <iostream>
+#include <memory>
 #include <sstream>
 #include <fstream>
 
@@ -17,11 +20,20 @@
 // Instantiate static variables
 std::map<std::string, Texture2D>    ResourceManager::Textures;
 std::map<std::string, Shader>       ResourceManager::Shaders;
+std::vector<LoadState>              ResourceManager::loadStates;
+std::deque<ResourceManager::Load>   ResourceManager::queuedLoads;
+std::deque<ResourceManager::Load>   ResourceManager::readLoads;
+unsigned int                        ResourceManager::pendingLoads = 0;
+std::vector<std::thread>            ResourceManager::workers;
+std::mutex                          ResourceManager::loadMutex;
+std::condition_variable             ResourceManager::queuedCondition;
+std::condition_variable             ResourceManager::readCondition;
+bool                                ResourceManager::stopWorkers = false;
 
 
-Shader ResourceManager::LoadShader(const char *vShaderFile, const char *fShaderFile, const char *gShaderFile, std::string name)
+Shader ResourceManager::LoadShader(const char *vShaderFile, const char *fShaderFile, const char *gShaderFile, std::string name, std::string defines)
 {
-    Shaders[name] = loadShaderFromFile(vShaderFile, fShaderFile, gShaderFile);
+    Shaders[name] = loadShaderFromFile(vShaderFile, fShaderFile, gShaderFile, defines);
     return Shaders[name];
 }
 
@@ -41,8 +53,109 @@ Texture2D ResourceManager::GetTexture(std::string name)
     return Textures[name];
 }
 
+LoadHandle ResourceManager::LoadTextureAsync(const char *file, bool alpha, std::string name)
+{
+    // create the texture object now, so copies handed out before the image is in refer to the same object
+    Texture2D texture;
+    if (alpha)
+    {
+        texture.Internal_Format = GL_RGBA;
+        texture.Image_Format = GL_RGBA;
+    }
+    unsigned char placeholder[4] = { 0, 0, 0, 0 };
+    texture.Generate(1, 1, placeholder);
+    Textures[name] = texture;
+    // shared by both halves of the load
+    std::shared_ptr<TextureData> data = std::make_shared<TextureData>();
+    std::string path = file;
+    return queueLoad(
+        [data, path]() { readTexture(path, *data); },
+        [data, path, name]() -> bool
+        {
+            if (!generateTexture(Textures[name], *data))
+            {
+                std::cout << "ERROR::TEXTURE: Failed to load " << path << std::endl;
+                return false;
+            }
+            return true;
+        });
+}
+
+LoadHandle ResourceManager::LoadShaderAsync(const char *vShaderFile, const char *fShaderFile, const char *gShaderFile, std::string name, std::string defines)
+{
+    std::shared_ptr<ShaderSource> source = std::make_shared<ShaderSource>();
+    std::string vertex = vShaderFile, fragment = fShaderFile, geometry = gShaderFile != nullptr ? gShaderFile : "";
+    return queueLoad(
+        [source, vertex, fragment, geometry, defines]()
+        {
+            *source = readShaderSource(vertex.c_str(), fragment.c_str(), geometry.empty() ? nullptr : geometry.c_str());
+            source->Defines = defines;
+        },
+        [source, name]() -> bool
+        {
+            Shaders[name] = compileShader(*source);
+            return true;
+        });
+}
+
+LoadState ResourceManager::GetState(LoadHandle handle)
+{
+    return handle.ID < loadStates.size() ? loadStates[handle.ID] : LOAD_FAILED;
+}
+
+bool ResourceManager::IsReady(LoadHandle handle)
+{
+    return GetState(handle) == LOAD_READY;
+}
+
+unsigned int ResourceManager::Update(double budget)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    while (pendingLoads > 0)
+    {
+        Load load;
+        {
+            std::lock_guard<std::mutex> lock(loadMutex);
+            if (readLoads.empty())
+                break;
+            load = readLoads.front();
+            readLoads.pop_front();
+        }
+        loadStates[load.Handle] = load.Create() ? LOAD_READY : LOAD_FAILED;
+        --pendingLoads;
+        if (std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() >= budget)
+            break;
+    }
+    return pendingLoads;
+}
+
+void ResourceManager::FinishLoads()
+{
+    while (Update(1e9) > 0)
+    {
+        std::unique_lock<std::mutex> lock(loadMutex);
+        readCondition.wait(lock, []() { return !readLoads.empty(); });
+    }
+}
+
 void ResourceManager::Clear()
 {
+    // stop the workers; loads that didn't finish are dropped
+    {
+        std::lock_guard<std::mutex> lock(loadMutex);
+        stopWorkers = true;
+    }
+    queuedCondition.notify_all();
+    for (std::thread &worker : workers)
+        worker.join();
+    workers.clear();
+    stopWorkers = false;
+    queuedLoads.clear();
+    readLoads.clear();
+    for (unsigned int i = 0; i < loadStates.size(); ++i)
+        if (loadStates[i] == LOAD_PENDING)
+            loadStates[i] = LOAD_FAILED;
+    pendingLoads = 0;
     // (properly) delete all shaders	
     for (auto iter : Shaders)
         glDeleteProgram(iter.second.ID);
@@ -51,12 +164,18 @@ void ResourceManager::Clear()
         glDeleteTextures(1, &iter.second.ID);
 }
 
-Shader ResourceManager::loadShaderFromFile(const char *vShaderFile, const char *fShaderFile, const char *gShaderFile)
+Shader ResourceManager::loadShaderFromFile(const char *vShaderFile, const char *fShaderFile, const char *gShaderFile, const std::string &defines)
+{
+    ShaderSource source = readShaderSource(vShaderFile, fShaderFile, gShaderFile);
+    source.Defines = defines;
+    return compileShader(source);
+}
+
+ResourceManager::ShaderSource ResourceManager::readShaderSource(const char *vShaderFile, const char *fShaderFile, const char *gShaderFile)
 {
     // 1. retrieve the vertex/fragment source code from filePath
-    std::string vertexCode;
-    std::string fragmentCode;
-    std::string geometryCode;
+    ShaderSource source;
+    source.HasGeometry = gShaderFile != nullptr;
     try
     {
         // open files
@@ -70,8 +189,8 @@ Shader ResourceManager::loadShaderFromFile(const char *vShaderFile, const char *
         vertexShaderFile.close();
         fragmentShaderFile.close();
         // convert stream into string
-        vertexCode = vShaderStream.str();
-        fragmentCode = fShaderStream.str();
+        source.Vertex = vShaderStream.str();
+        source.Fragment = fShaderStream.str();
         // if geometry shader path is present, also load a geometry shader
         if (gShaderFile != nullptr)
         {
@@ -79,22 +198,43 @@ Shader ResourceManager::loadShaderFromFile(const char *vShaderFile, const char *
             std::stringstream gShaderStream;
             gShaderStream << geometryShaderFile.rdbuf();
             geometryShaderFile.close();
-            geometryCode = gShaderStream.str();
+            source.Geometry = gShaderStream.str();
         }
     }
     catch (std::exception e)
     {
         std::cout << "ERROR::SHADER: Failed to read shader files" << std::endl;
     }
-    const char *vShaderCode = vertexCode.c_str();
-    const char *fShaderCode = fragmentCode.c_str();
-    const char *gShaderCode = geometryCode.c_str();
+    return source;
+}
+
+Shader ResourceManager::compileShader(const ShaderSource &source)
+{
     // 2. now create shader object from source code
     Shader shader;
-    shader.Compile(vShaderCode, fShaderCode, gShaderFile != nullptr ? gShaderCode : nullptr);
+    std::string vertex = addDefines(source.Vertex, source.Defines), fragment = addDefines(source.Fragment, source.Defines);
+    std::string geometry = source.HasGeometry ? addDefines(source.Geometry, source.Defines) : "";
+    shader.Compile(vertex.c_str(), fragment.c_str(), source.HasGeometry ? geometry.c_str() : nullptr);
     return shader;
 }
 
+std::string ResourceManager::addDefines(const std::string &source, const std::string &defines)
+{
+    // #version has to come first, so the defines go right after it
+    if (defines.empty())
+        return source;
+    size_t position = 0;
+    if (source.compare(0, 8, "#version") == 0)
+    {
+        position = source.find('\n');
+        position = position == std::string::npos ? source.size() : position + 1;
+    }
+    std::string result = source.substr(0, position);
+    if (position > 0 && result[position - 1] != '\n')
+        result += '\n';
+    return result + defines + source.substr(position);
+}
+
 Texture2D ResourceManager::loadTextureFromFile(const char *file, bool alpha)
 {
     // create texture object
@@ -104,12 +244,89 @@ Texture2D ResourceManager::loadTextureFromFile(const char *file, bool alpha)
         texture.Internal_Format = GL_RGBA;
         texture.Image_Format = GL_RGBA;
     }
-    // load image
-    int width, height, nrChannels;
-    unsigned char* data = stbi_load(file, &width, &height, &nrChannels, 0);
+    TextureData data;
+    readTexture(file, data);
+    generateTexture(texture, data);
+    return texture;
+}
+
+ResourceManager::TextureData::~TextureData()
+{
+    stbi_image_free(this->Data);
+}
+
+void ResourceManager::readTexture(const std::string &file, TextureData &data)
+{
+    // use the compressed version made by the texture baker if there is one (in the orientation stb_image loads images)
+    // and the context supports its format; glad's extension flags are only written while loading GL, so this is safe
+    // on a loader thread
+    std::string baked = BakedTexturePath(file);
+    data.Baked = !baked.empty() && ReadCompressedImage(baked, data.Compressed) && CompressedFormatSupported(data.Compressed.Format) &&
+                 OrientCompressedImage(data.Compressed, StbiFlipsVertically());
+    // otherwise load image
+    if (!data.Baked)
+        data.Data = stbi_load(file.c_str(), &data.Width, &data.Height, &data.Channels, 0);
+}
+
+bool ResourceManager::generateTexture(Texture2D &texture, TextureData &data)
+{
+    if (data.Baked)
+    {
+        texture.Generate(data.Compressed);
+        return true;
+    }
     // now generate texture
-    texture.Generate(width, height, data);
+    texture.Generate(data.Width, data.Height, data.Data);
     // and finally free image data
-    stbi_image_free(data);
-    return texture;
+    bool loaded = data.Data != nullptr;
+    stbi_image_free(data.Data);
+    data.Data = nullptr;
+    return loaded;
+}
+
+LoadHandle ResourceManager::queueLoad(std::function<void()> read, std::function<bool()> create)
+{
+    LoadHandle handle;
+    handle.ID = static_cast<unsigned int>(loadStates.size());
+    loadStates.push_back(LOAD_PENDING);
+    ++pendingLoads;
+    // leave a core to the main thread
+    if (workers.empty())
+    {
+        unsigned int threads = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+        for (unsigned int i = 0; i < threads; ++i)
+            workers.push_back(std::thread(work));
+    }
+    Load load;
+    load.Handle = handle.ID;
+    load.Read = read;
+    load.Create = create;
+    {
+        std::lock_guard<std::mutex> lock(loadMutex);
+        queuedLoads.push_back(load);
+    }
+    queuedCondition.notify_one();
+    return handle;
+}
+
+void ResourceManager::work()
+{
+    while (true)
+    {
+        Load load;
+        {
+            std::unique_lock<std::mutex> lock(loadMutex);
+            queuedCondition.wait(lock, []() { return stopWorkers || !queuedLoads.empty(); });
+            if (stopWorkers)
+                return;
+            load = queuedLoads.front();
+            queuedLoads.pop_front();
+        }
+        load.Read();
+        {
+            std::lock_guard<std::mutex> lock(loadMutex);
+            readLoads.push_back(load);
+        }
+        readCondition.notify_one();
+    }
 }
\ No newline at end of file
@@ -9,8 +9,14 @@
 #ifndef RESOURCE_MANAGER_H
 #define RESOURCE_MANAGER_H
 
+#include <condition_variable>
+#include <deque>
+#include <functional>
 #include <map>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include <glad/glad.h>
 
@@ -18,6 +24,18 @@
 #include "shader.h"
 
 
+// Represents the progress of an asynchronous load
+enum LoadState {
+    LOAD_PENDING, // queued, being read/decoded or waiting for its OpenGL object
+    LOAD_READY,
+    LOAD_FAILED
+};
+
+// Refers to an asynchronous load; returned right away by the Load*Async functions
+struct LoadHandle {
+    unsigned int ID;
+};
+
 // A static singleton ResourceManager class that hosts several
 // functions to load Textures and Shaders. Each loaded texture
 // and/or shader is also stored for future reference by string
@@ -30,22 +48,75 @@ public:
     static std::map<std::string, Shader>    Shaders;
     static std::map<std::string, Texture2D> Textures;
     // loads (and generates) a shader program from file loading vertex, fragment (and geometry) shader's source code. If gShaderFile is not nullptr, it also loads a geometry shader
-    static Shader    LoadShader(const char *vShaderFile, const char *fShaderFile, const char *gShaderFile, std::string name);
+    // defines (lines of #define) are inserted after each stage's #version line, to compile variants of the same source
+    static Shader    LoadShader(const char *vShaderFile, const char *fShaderFile, const char *gShaderFile, std::string name, std::string defines = "");
     // retrieves a stored sader
     static Shader    GetShader(std::string name);
     // loads (and generates) a texture from file
     static Texture2D LoadTexture(const char *file, bool alpha, std::string name);
     // retrieves a stored texture
     static Texture2D GetTexture(std::string name);
+    // asynchronous loading: file I/O and image decoding run on a pool of worker threads and the OpenGL objects are
+    // created on the main thread by Update, a few per frame. The texture object is created right away (a transparent
+    // 1x1 placeholder until its image is in), so GetTexture can hand it out immediately; a shader can only be used
+    // once its load is ready.
+    static LoadHandle   LoadTextureAsync(const char *file, bool alpha, std::string name);
+    static LoadHandle   LoadShaderAsync(const char *vShaderFile, const char *fShaderFile, const char *gShaderFile, std::string name, std::string defines = "");
+    // retrieves the state of an asynchronous load
+    static LoadState    GetState(LoadHandle handle);
+    static bool         IsReady(LoadHandle handle);
+    // creates the OpenGL objects of decoded loads, for at most budget milliseconds (but at least one load), and
+    // returns the number of loads still pending. Call once per frame from the thread owning the OpenGL context.
+    static unsigned int Update(double budget);
+    // blocks until every asynchronous load is done
+    static void         FinishLoads();
     // properly de-allocates all loaded resources
     static void      Clear();
 private:
+    // an image read from disk: block-compressed if it was baked, otherwise decoded by stb_image
+    struct TextureData {
+        bool            Baked;
+        CompressedImage Compressed;
+        int             Width, Height, Channels;
+        unsigned char  *Data;
+        TextureData() : Baked(false), Width(0), Height(0), Channels(0), Data(nullptr) { }
+        // frees the decoded image if it never made it into a texture
+        ~TextureData();
+    };
+    // the source code of a shader program
+    struct ShaderSource {
+        std::string Vertex, Fragment, Geometry;
+        bool        HasGeometry;
+        std::string Defines;
+    };
+    // an asynchronous load: Read runs on a worker thread, Create on the main thread and returns whether it succeeded
+    struct Load {
+        unsigned int          Handle;
+        std::function<void()> Read;
+        std::function<bool()> Create;
+    };
+    static std::vector<LoadState>   loadStates;
+    static std::deque<Load>         queuedLoads, readLoads;
+    static unsigned int             pendingLoads;
+    static std::vector<std::thread> workers;
+    static std::mutex               loadMutex;
+    static std::condition_variable  queuedCondition, readCondition;
+    static bool                     stopWorkers;
     // private constructor, that is we do not want any actual resource manager objects. Its members and functions should be publicly available (static).
     ResourceManager() { }
     // loads and generates a shader from file
-    static Shader    loadShaderFromFile(const char *vShaderFile, const char *fShaderFile, const char *gShaderFile = nullptr);
+    static Shader    loadShaderFromFile(const char *vShaderFile, const char *fShaderFile, const char *gShaderFile = nullptr, const std::string &defines = "");
     // loads a single texture from file
     static Texture2D loadTextureFromFile(const char *file, bool alpha);
+    // the halves of loading a shader or texture that don't and do need the OpenGL context
+    static ShaderSource readShaderSource(const char *vShaderFile, const char *fShaderFile, const char *gShaderFile);
+    static Shader       compileShader(const ShaderSource &source);
+    static std::string  addDefines(const std::string &source, const std::string &defines);
+    static void         readTexture(const std::string &file, TextureData &data);
+    static bool         generateTexture(Texture2D &texture, TextureData &data);
+    // queues a load for the worker threads, starting them on first use
+    static LoadHandle   queueLoad(std::function<void()> read, std::function<bool()> create);
+    static void         work();
 };
 
 #endif
\ No newline at end of file
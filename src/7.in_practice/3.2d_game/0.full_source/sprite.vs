@@ -1,14 +1,24 @@
 #version 330 core
 layout (location = 0) in vec4 vertex; // <vec2 position, vec2 texCoords>
+layout (location = 1) in vec4 positionSize; // per sprite: <vec2 position, vec2 size>
+layout (location = 2) in vec4 colorRotation; // per sprite: <vec3 color, float rotation in degrees>
 
 out vec2 TexCoords;
+out vec3 SpriteColor;
 
-uniform mat4 model;
 // note that we're omitting the view matrix; the view never changes so we basically have an identity view matrix and can therefore omit it.
 uniform mat4 projection;
 
 void main()
 {
     TexCoords = vertex.zw;
-    gl_Position = projection * model * vec4(vertex.xy, 0.0, 1.0);
+    SpriteColor = colorRotation.rgb;
+    // same transformation the model matrix used to do: scale, rotate around the quad's center, then translate
+    vec2 size = positionSize.zw;
+    vec2 local = vertex.xy * size - 0.5 * size;
+    float angle = radians(colorRotation.w);
+    float s = sin(angle);
+    float c = cos(angle);
+    local = vec2(c * local.x - s * local.y, s * local.x + c * local.y);
+    gl_Position = projection * vec4(local + 0.5 * size + positionSize.xy, 0.0, 1.0);
 }
\ No newline at end of file
@@ -8,48 +8,96 @@
 ******************************************************************/
 #include "sprite_renderer.h"
 
+#include <algorithm>
 
-SpriteRenderer::SpriteRenderer(Shader &shader)
+
+SpriteRenderer::SpriteRenderer(Shader &shader, StreamBuffer *stream)
+    : DrawCalls(0), SpritesDrawn(0), stream(stream), ownsStream(stream == nullptr)
 {
     this->shader = shader;
+    if (this->ownsStream)
+        this->stream = new StreamBuffer();
     this->initRenderData();
 }
 
 SpriteRenderer::~SpriteRenderer()
 {
     glDeleteVertexArrays(1, &this->quadVAO);
+    glDeleteBuffers(1, &this->quadVBO);
+    if (this->ownsStream)
+        delete this->stream;
 }
 
 void SpriteRenderer::DrawSprite(Texture2D &texture, glm::vec2 position, glm::vec2 size, float rotate, glm::vec3 color)
 {
-    // prepare transformations
-    this->shader.Use();
-    glm::mat4 model = glm::mat4(1.0f);
-    model = glm::translate(model, glm::vec3(position, 0.0f));  // first translate (transformations are: scale happens first, then rotation, and then final translation happens; reversed order)
-
-    model = glm::translate(model, glm::vec3(0.5f * size.x, 0.5f * size.y, 0.0f)); // move origin of rotation to center of quad
-    model = glm::rotate(model, glm::radians(rotate), glm::vec3(0.0f, 0.0f, 1.0f)); // then rotate
-    model = glm::translate(model, glm::vec3(-0.5f * size.x, -0.5f * size.y, 0.0f)); // move origin back
-
-    model = glm::scale(model, glm::vec3(size, 1.0f)); // last scale
-
-    this->shader.SetMatrix4("model", model);
+    SpriteInstance sprite;
+    sprite.Texture = texture.ID;
+    sprite.PositionSize = glm::vec4(position, size);
+    sprite.ColorRotation = glm::vec4(color, rotate);
+    this->sprites.push_back(sprite);
+}
 
-    // render textured quad
-    this->shader.SetVector3f("spriteColor", color);
+void SpriteRenderer::Flush()
+{
+    if (this->sprites.empty())
+        return;
+    // group sprites by texture (stable, so equally textured sprites keep their draw order)
+    std::stable_sort(this->sprites.begin(), this->sprites.end(), [](const SpriteInstance &a, const SpriteInstance &b) {
+        return a.Texture < b.Texture;
+    });
+    // write the instance data straight into the stream buffer
+    unsigned int count = static_cast<unsigned int>(this->sprites.size());
+    const GLsizei stride = 2 * sizeof(glm::vec4);
+    StreamAllocation instances = this->stream->Allocate(count * stride);
+    if (!instances.Data)
+    {
+        this->sprites.clear();
+        return;
+    }
+    glm::vec4 *instance = static_cast<glm::vec4*>(instances.Data);
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        *instance++ = this->sprites[i].PositionSize;
+        *instance++ = this->sprites[i].ColorRotation;
+    }
+    this->stream->Commit();
 
+    // one instanced draw per texture; GL 3.3 has no base instance, so point the
+    // instance attributes at the start of each batch instead
+    this->shader.Use();
     glActiveTexture(GL_TEXTURE0);
-    texture.Bind();
-
     glBindVertexArray(this->quadVAO);
-    glDrawArrays(GL_TRIANGLES, 0, 6);
+    glBindBuffer(GL_ARRAY_BUFFER, instances.Buffer);
+    unsigned int first = 0;
+    while (first < count)
+    {
+        unsigned int texture = this->sprites[first].Texture;
+        unsigned int last = first + 1;
+        while (last < count && this->sprites[last].Texture == texture)
+            ++last;
+        glBindTexture(GL_TEXTURE_2D, texture);
+        GLintptr offset = instances.Offset + first * stride;
+        glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, stride, (void*)offset);
+        glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, stride, (void*)(offset + sizeof(glm::vec4)));
+        glDrawArraysInstanced(GL_TRIANGLES, 0, 6, last - first);
+        this->DrawCalls++;
+        first = last;
+    }
     glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    this->SpritesDrawn += count;
+    this->sprites.clear();
+}
+
+void SpriteRenderer::ResetStats()
+{
+    this->DrawCalls = 0;
+    this->SpritesDrawn = 0;
 }
 
 void SpriteRenderer::initRenderData()
 {
     // configure VAO/VBO
-    unsigned int VBO;
     float vertices[] = { 
         // pos      // tex
         0.0f, 1.0f, 0.0f, 1.0f,
@@ -62,14 +110,19 @@ void SpriteRenderer::initRenderData()
     };
 
     glGenVertexArrays(1, &this->quadVAO);
-    glGenBuffers(1, &VBO);
+    glGenBuffers(1, &this->quadVBO);
 
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBindBuffer(GL_ARRAY_BUFFER, this->quadVBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
 
     glBindVertexArray(this->quadVAO);
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
+    // per-sprite attributes, advanced once per instance; Flush points them into the stream buffer
+    glEnableVertexAttribArray(1);
+    glVertexAttribDivisor(1, 1);
+    glEnableVertexAttribArray(2);
+    glVertexAttribDivisor(2, 1);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindVertexArray(0);
 }
\ No newline at end of file
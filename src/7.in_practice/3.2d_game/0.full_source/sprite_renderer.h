@@ -9,27 +9,53 @@
 #ifndef SPRITE_RENDERER_H
 #define SPRITE_RENDERER_H
 
+#include <vector>
+
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <learnopengl/stream_buffer.h>
+
 #include "texture.h"
 #include "shader.h"
 
 
+// SpriteRenderer batches sprites: DrawSprite only queues a sprite and Flush
+// renders all queued sprites with one instanced draw call per texture. The
+// per-sprite data is written straight into a StreamBuffer (shared with the
+// other renderers when one is passed in).
 class SpriteRenderer
 {
 public:
+    // statistics since the last ResetStats
+    unsigned int DrawCalls;
+    unsigned int SpritesDrawn;
     // Constructor (inits shaders/shapes)
-    SpriteRenderer(Shader &shader);
+    SpriteRenderer(Shader &shader, StreamBuffer *stream = nullptr);
     // Destructor
     ~SpriteRenderer();
-    // Renders a defined quad textured with given sprite
+    // Queues a defined quad textured with given sprite; it's rendered by the next Flush
     void DrawSprite(Texture2D &texture, glm::vec2 position, glm::vec2 size = glm::vec2(10.0f, 10.0f), float rotate = 0.0f, glm::vec3 color = glm::vec3(1.0f));
+    // Renders all queued sprites. Sprites are grouped by texture: sprites sharing a texture keep their order,
+    // but sprites with different textures may be reordered, so flush between layers that overlap
+    void Flush();
+    void ResetStats();
 private:
+    // a queued sprite; the two vectors are uploaded as per-instance vertex attributes
+    struct SpriteInstance
+    {
+        unsigned int Texture;
+        glm::vec4    PositionSize;  // <vec2 position, vec2 size>
+        glm::vec4    ColorRotation; // <vec3 color, float rotation in degrees>
+    };
     // Render state
     Shader       shader; 
     unsigned int quadVAO;
+    unsigned int quadVBO;
+    StreamBuffer *stream;
+    bool          ownsStream;
+    std::vector<SpriteInstance> sprites;
     // Initializes and configures the quad's buffer and vertex attributes
     void initRenderData();
 };
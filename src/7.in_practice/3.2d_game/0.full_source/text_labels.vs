@@ -0,0 +1,18 @@
+#version 330 core
+layout (location = 0) in vec4 vertex; // <vec2 pos, vec2 tex> relative to the label
+layout (location = 1) in float label;
+out vec2 TexCoords;
+out vec3 TextColor;
+
+uniform mat4 projection;
+// per label: <vec2 position, vec2 scale> and <vec3 color>
+uniform samplerBuffer labels;
+
+void main()
+{
+    int index = int(label) * 2;
+    vec4 transform = texelFetch(labels, index);
+    gl_Position = projection * vec4(transform.xy + vertex.xy * transform.zw, 0.0, 1.0);
+    TexCoords = vertex.zw;
+    TextColor = texelFetch(labels, index + 1).rgb;
+}
\ No newline at end of file
@@ -9,43 +9,52 @@
 #ifndef TEXT_RENDERER_H
 #define TEXT_RENDERER_H
 
-#include <map>
+#include <string>
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include <learnopengl/glyph_atlas.h>
+#include <learnopengl/text_layout.h>
+
 #include "texture.h"
 #include "shader.h"
 
 
-/// Holds all state information relevant to a character as loaded using FreeType
-struct Character {
-    unsigned int TextureID; // ID handle of the glyph texture
-    glm::ivec2   Size;      // size of glyph
-    glm::ivec2   Bearing;   // offset from baseline to left/top of glyph
-    unsigned int Advance;   // horizontal offset to advance to next glyph
-};
-
-
 // A renderer class for rendering text displayed by a font loaded using the 
-// FreeType library. A single font is loaded, processed into a list of Character
-// items for later rendering.
+// FreeType library. A single font is loaded and its characters are packed into
+// a glyph atlas; text is batched and drawn with one draw call per atlas page.
+// Strings are laid out once and cached; labels that stay on screen can be
+// kept on the GPU instead, so that only their transform is updated per frame.
 class TextRenderer
 {
 public:
-    // holds a list of pre-compiled Characters
-    std::map<char, Character> Characters; 
-    // shader used for text rendering
+    // holds the pre-compiled characters
+    GlyphAtlas Atlas;
+    // queued text, drawn on Flush (keeps draw call statistics)
+    TextBatch  Batch;
+    // layouts of recently rendered strings
+    TextLayoutCache Layouts;
+    // retained text, drawn on Flush
+    TextLabels Labels;
+    // shaders used for text rendering and for labels
     Shader TextShader;
-    // constructor
-    TextRenderer(unsigned int width, unsigned int height);
+    Shader LabelShader;
+    // constructor; queued text is streamed through the given stream buffer (or one of its own)
+    TextRenderer(unsigned int width, unsigned int height, StreamBuffer *stream = nullptr);
     // pre-compiles a list of characters from the given font
     void Load(std::string font, unsigned int fontSize);
-    // renders a string of text using the precompiled list of characters
+    // queues a string of text using the precompiled list of characters
     void RenderText(std::string text, float x, float y, float scale, glm::vec3 color = glm::vec3(1.0f));
+    // adds a label that is drawn every Flush until removed (change it through Labels); returns its handle
+    unsigned int AddLabel(std::string text, float x, float y, float scale, glm::vec3 color = glm::vec3(1.0f));
+    // moves a label, placed by its top like RenderText
+    void MoveLabel(unsigned int label, float x, float y, float scale);
+    // draws all queued text
+    void Flush();
 private:
-    // render state
-    unsigned int VAO, VBO;
+    // baseline of text whose top is at y
+    float baseline(float y, float scale);
 };
 
 #endif 
\ No newline at end of file
@@ -11,6 +11,8 @@
 
 #include <glad/glad.h>
 
+#include <learnopengl/compressed_texture.h>
+
 // Texture2D is able to store and configure a texture in OpenGL.
 // It also hosts utility functions for easy management.
 class Texture2D
@@ -28,10 +30,13 @@ public:
     unsigned int Wrap_T; // wrapping mode on T axis
     unsigned int Filter_Min; // filtering mode if texture pixels < screen pixels
     unsigned int Filter_Max; // filtering mode if texture pixels > screen pixels
-    // constructor (sets default texture modes)
+    // constructor (sets default texture modes); the texture object itself is created by Generate, so
+    // textures can be passed around without an OpenGL context (e.g. by the headless simulation)
     Texture2D();
     // generates texture from image data
     void Generate(unsigned int width, unsigned int height, unsigned char* data);
+    // generates texture from block-compressed data, uploading all of its mip levels as is
+    void Generate(const CompressedImage &image);
     // binds the texture as the current active GL_TEXTURE_2D texture object
     void Bind() const;
 };
@@ -0,0 +1,162 @@
+// Offline texture baker: compresses images into BC1/BC3/BC5/BC7 with a complete mip chain and writes them next to
+// the source as .dds (or .ktx), where TextureFromFile and the Breakout resource manager pick them up instead of the
+// original. For example, from the repository root:
+//     texture_baker resources/textures/*.png resources/textures/*.jpg
+//     find resources/objects -name "*.png" -o -name "*.jpg" | xargs texture_baker --format bc7
+// Options (before the files they apply to):
+//     --format auto|bc1|bc3|bc5|bc7   auto (the default) picks BC7 for normal maps, BC3 for images with alpha and
+//                                     BC1 otherwise; BC5 keeps only red and green, the shader has to rebuild z
+//     --srgb / --linear               store color as sRGB (sampled through an sRGB format, mipmaps filtered in
+//                                     linear space) or as is (default)
+//     --filter box|kaiser|lanczos     mipmap filter (default kaiser)
+//     --wrap / --clamp                filter across the edges for tiling textures (default) or clamp to them
+//     --ktx / --dds                   container to write (DDS by default)
+//     --threads n                     threads per image (default: one per core)
+//     --flip-y / --no-flip-y          store the rows bottom first, the way stb_image loads them after
+//                                     stbi_set_flip_vertically_on_load(true) (as most demos do), or top first (default).
+//                                     The orientation is recorded in the file; loaders flip the blocks of textures
+//                                     baked the other way up, so this only saves them that work
+#include <stb_image.h>
+
+#include <learnopengl/texture_compression.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+const char *formatName(BlockFormat format)
+{
+    const char *names[] = { "BC1", "BC3", "BC5", "BC7" };
+    return names[format];
+}
+
+int main(int argc, char *argv[])
+{
+    bool automatic = true, srgb = false, ktx = false, wrap = true, flipY = false;
+    BlockFormat format = FORMAT_BC1;
+    MipFilter filter = MIP_FILTER_KAISER;
+    unsigned int threads = 0;
+    unsigned int baked = 0, failed = 0;
+    double totalSeconds = 0.0, totalMipSeconds = 0.0, totalPixels = 0.0;
+    size_t totalRaw = 0, totalCompressed = 0;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--format" && i + 1 < argc)
+        {
+            std::string name = argv[++i];
+            automatic = name == "auto";
+            if (name == "bc1") format = FORMAT_BC1;
+            else if (name == "bc3") format = FORMAT_BC3;
+            else if (name == "bc5") format = FORMAT_BC5;
+            else if (name == "bc7") format = FORMAT_BC7;
+            else if (!automatic)
+            {
+                std::cout << "unknown format: " << name << std::endl;
+                return 1;
+            }
+            continue;
+        }
+        if (arg == "--srgb" || arg == "--linear")
+        {
+            srgb = arg == "--srgb";
+            continue;
+        }
+        if (arg == "--filter" && i + 1 < argc)
+        {
+            std::string name = argv[++i];
+            filter = name == "box" ? MIP_FILTER_BOX : (name == "lanczos" ? MIP_FILTER_LANCZOS : MIP_FILTER_KAISER);
+            continue;
+        }
+        if (arg == "--wrap" || arg == "--clamp")
+        {
+            wrap = arg == "--wrap";
+            continue;
+        }
+        if (arg == "--ktx" || arg == "--dds")
+        {
+            ktx = arg == "--ktx";
+            continue;
+        }
+        if (arg == "--flip-y" || arg == "--no-flip-y")
+        {
+            flipY = arg == "--flip-y";
+            continue;
+        }
+        if (arg == "--threads" && i + 1 < argc)
+        {
+            threads = std::atoi(argv[++i]);
+            continue;
+        }
+
+        int width, height, channels;
+        stbi_set_flip_vertically_on_load(flipY);
+        unsigned char *data = stbi_load(arg.c_str(), &width, &height, &channels, 4);
+        if (data == nullptr)
+        {
+            std::cout << "ERROR::TEXTURE_BAKER:: Failed to load " << arg << std::endl;
+            ++failed;
+            continue;
+        }
+        // normal maps hold vectors, never sRGB color
+        bool normalMap = arg.find("normal") != std::string::npos;
+        BlockFormat chosen = format;
+        if (automatic)
+        {
+            bool opaque = true;
+            for (size_t p = 0; p < (size_t)width * height && opaque; ++p)
+                opaque = data[p * 4 + 3] == 255;
+            if (normalMap)
+                chosen = FORMAT_BC7;
+            else
+                chosen = opaque ? FORMAT_BC1 : FORMAT_BC3;
+        }
+        bool colorSRGB = srgb && chosen != FORMAT_BC5 && !normalMap;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        std::vector<MipLevel> levels = MipmapGenerator(filter, colorSRGB, wrap, threads).Generate(data, width, height, 4);
+        std::chrono::steady_clock::time_point mipsDone = std::chrono::steady_clock::now();
+        CompressedImage image = CompressMipChain(levels, chosen, colorSRGB, threads);
+        image.BottomUp = flipY;
+        double mipSeconds = std::chrono::duration<double>(mipsDone - start).count();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - mipsDone).count();
+
+        size_t dot = arg.find_last_of('.');
+        std::string output = arg.substr(0, dot) + (ktx ? ".ktx" : ".dds");
+        if (!(ktx ? WriteKTX(output, image) : WriteDDS(output, image)))
+        {
+            stbi_image_free(data);
+            ++failed;
+            continue;
+        }
+        // what the texture takes uncompressed as RGBA8 with mipmaps, and the error of the top level
+        size_t raw = 0;
+        for (unsigned int level = 0, w = width, h = height; level < image.Levels.size(); ++level, w = std::max(w / 2, 1u), h = std::max(h / 2, 1u))
+            raw += (size_t)w * h * 4;
+        std::vector<unsigned char> decoded = DecompressImage(&image.Levels[0][0], width, height, chosen);
+        unsigned int compared = chosen == FORMAT_BC5 ? 2 : (chosen == FORMAT_BC1 ? 3 : 4);
+        std::cout << output << ": " << formatName(chosen) << (image.SRGB ? " sRGB" : "") << " " << width << "x" << height << ", "
+                  << image.Levels.size() << " levels | " << raw / 1024 << " KB -> " << image.Bytes() / 1024 << " KB ("
+                  << (double)raw / image.Bytes() << "x) | mipmaps " << mipSeconds * 1000.0 << " ms, " << width * (double)height / mipSeconds / 1000000.0
+                  << " MPix/s | compression " << seconds * 1000.0 << " ms, " << width * (double)height / seconds / 1000000.0
+                  << " MPix/s | PSNR " << ImagePSNR(data, &decoded[0], width, height, compared) << " dB" << std::endl;
+        stbi_image_free(data);
+        ++baked;
+        totalSeconds += seconds;
+        totalMipSeconds += mipSeconds;
+        totalPixels += (double)width * height;
+        totalRaw += raw;
+        totalCompressed += image.Bytes();
+    }
+    if (baked + failed == 0)
+    {
+        std::cout << "usage: texture_baker [--format auto|bc1|bc3|bc5|bc7] [--srgb] [--filter box|kaiser|lanczos] [--clamp] [--ktx] [--flip-y] [--threads n] images..." << std::endl;
+        return 1;
+    }
+    if (baked > 0)
+        std::cout << baked << " textures baked | " << totalRaw / 1024 << " KB -> " << totalCompressed / 1024 << " KB ("
+                  << (double)totalRaw / totalCompressed << "x) | mipmaps " << totalPixels / totalMipSeconds / 1000000.0 << " MPix/s, compression "
+                  << totalPixels / totalSeconds / 1000000.0 << " MPix/s" << std::endl;
+    return failed > 0 ? 1 : 0;
+}